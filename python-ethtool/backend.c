@@ -0,0 +1,1337 @@
+/* backend.c - Pluggable kernel access layer, with record and replay backends
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * All ioctls, NETLINK traffic and file reads of the module go through the
+ * backend selected with ethtool.set_backend():
+ *
+ *  "kernel"  talks to the running kernel, this is the default.
+ *  "record"  talks to the kernel and appends every request and its reply
+ *            to a capture file.
+ *  "replay"  loads a capture file into memory and answers from it, without
+ *            touching the kernel.  Optionally sleeps for as long as the
+ *            recorded request took, to reproduce slow hosts.
+ *
+ * NETLINK traffic is diverted with the libnl send/recv overrides installed
+ * by backend_nl_setup() on every socket the module connects.
+ *
+ * Replay looks requests up by their content rather than their position in
+ * the capture: ioctls by request, device name and ETHTOOL command, NETLINK
+ * requests by their bytes with sequence number and port id ignored, files
+ * by path.  Repeated requests are answered with the recorded replies in
+ * order, the last one being served again once they run out.
+ *
+ * A NETLINK conversation is a request and its replies.  They are tracked
+ * per socket of the calling thread, so that a dump can be read in pieces
+ * interleaved with requests on other sockets, as ethtool.iter_interfaces_info()
+ * does.  A thread can have BACKEND_NR_CONVS of them going at once.
+ *
+ * The kernel backend is static and used without any locking.  Calls into
+ * another backend hold backend_lock for reading, so set_backend() can tear
+ * the old one down once it got the lock for writing.  A NETLINK exchange
+ * which is in flight while the backend is switched fails.
+ *
+ * Unlike the NETLINK connection, the backend is not part of the module
+ * state: it is used by worker threads and libnl callbacks which have no
+ * module at hand.  A set_backend() in one interpreter therefore applies
+ * to all the interpreters of the process.
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netlink/netlink.h>
+#include <netlink/errno.h>
+#include <netlink/msg.h>
+#include <netlink/handlers.h>
+#include <netlink/socket.h>
+
+#include "ethtool.h"
+#include "backend.h"
+#include "stats.h"
+
+#define CAP_MAGIC	"PYETHCAP"
+#define CAP_VERSION	1
+
+enum cap_type {
+	CAP_IOCTL = 1,
+	CAP_NL_SEND,
+	CAP_NL_RECV,
+	CAP_FILE,
+	CAP_IFADDRS,
+	CAP_DEVICE,	/* Replay index only: device names seen in ioctls */
+};
+
+/*
+ * Capture file layout, in host byte order: struct cap_file_header, then
+ * records made of a struct cap_header followed by 'len' bytes of payload.
+ *
+ *  CAP_IOCTL	struct cap_ioctl, then data_len bytes ifr_data points to
+ *  CAP_NL_SEND	uint32_t send id, then the message
+ *  CAP_NL_RECV	uint32_t id of the send it answers, int32_t nl_recv()
+ *		return value, then that many bytes if positive
+ *  CAP_FILE	struct cap_file, the path, then the contents
+ *  CAP_IFADDRS	struct cap_file (path_len is the entry count), then the
+ *		struct backend_ifaddr entries
+ */
+struct cap_file_header {
+	char	 magic[8];
+	uint32_t version;
+	uint32_t ifreq_size;
+};
+
+struct cap_header {
+	uint32_t type;
+	uint32_t len;
+	uint64_t duration_ns;
+};
+
+struct cap_ioctl {
+	uint64_t     request;
+	int32_t	     ret;
+	int32_t	     err;
+	uint32_t     data_len;
+	uint32_t     reserved;
+	struct ifreq ifr;
+};
+
+struct cap_nl_recv {
+	uint32_t send_id;
+	int32_t	 ret;
+};
+
+struct cap_file {
+	int32_t	 err;
+	uint32_t path_len;
+};
+
+struct backend;
+
+struct backend_ops {
+	const char *name;
+	int (*ioctl)(struct backend *b, int fd, unsigned long request,
+		     struct ifreq *ifr, size_t data_len);
+	int (*nl_send)(struct backend *b, struct nl_sock *sk, struct nl_msg *msg);
+	int (*nl_recv)(struct backend *b, struct nl_sock *sk, struct sockaddr_nl *nla,
+		       unsigned char **buf, struct ucred **creds);
+	int (*read_file)(struct backend *b, const char *path, char **buf, size_t *len);
+	int (*list_ifaddrs)(struct backend *b, struct backend_ifaddr **list, int *count);
+	int (*destroy)(struct backend *b);
+};
+
+struct backend {
+	const struct backend_ops *ops;
+};
+
+#define BACKEND_NR_CONVS	4
+
+/* Sockets of the NETLINK conversations this thread has going */
+static __thread struct nl_sock *backend_conv_socks[BACKEND_NR_CONVS];
+static __thread unsigned int backend_conv_next;
+
+/**
+ * Finds the conversation slot of a socket
+ *
+ * @param sk    NETLINK socket
+ * @param start Whether a request is being sent, which takes over the
+ *              least recently started slot if sk has none yet
+ *
+ * @return Returns the slot, or -1 if sk has none and start is not set
+ */
+static int backend_conv(struct nl_sock *sk, int start)
+{
+	int i;
+
+	for (i = 0; i < BACKEND_NR_CONVS; i++)
+		if (backend_conv_socks[i] == sk)
+			return i;
+	if (!start)
+		return -1;
+
+	i = backend_conv_next++ % BACKEND_NR_CONVS;
+	backend_conv_socks[i] = sk;
+	return i;
+}
+
+/*
+ *
+ *   Kernel backend
+ *
+ */
+
+static int kernel_ioctl(struct backend *b __unused, int fd,
+			unsigned long request, struct ifreq *ifr,
+			size_t data_len __unused)
+{
+	return ioctl(fd, request, ifr);
+}
+
+static int kernel_nl_send(struct backend *b __unused,
+			  struct nl_sock *sk, struct nl_msg *msg)
+{
+	/* What nl_send() does when no override is installed */
+	struct iovec iov = {
+		.iov_base = nlmsg_hdr(msg),
+		.iov_len = nlmsg_hdr(msg)->nlmsg_len,
+	};
+
+	return nl_send_iovec(sk, msg, &iov, 1);
+}
+
+static int kernel_nl_recv(struct backend *b __unused,
+			  struct nl_sock *sk, struct sockaddr_nl *nla,
+			  unsigned char **buf, struct ucred **creds)
+{
+	return nl_recv(sk, nla, buf, creds);
+}
+
+static int kernel_read_file(struct backend *b __unused,
+			    const char *path, char **buf, size_t *len)
+{
+	size_t size = 0, alloc = 4096;
+	char *data, *tmp;
+	ssize_t n;
+	int fd, err = 0;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return errno;
+
+	data = malloc(alloc + 1);
+	while (data) {
+		if (size == alloc) {
+			alloc *= 2;
+			tmp = realloc(data, alloc + 1);
+			if (!tmp) {
+				free(data);
+				data = NULL;
+				break;
+			}
+			data = tmp;
+		}
+		n = read(fd, data + size, alloc - size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0) {
+			err = errno;
+			break;
+		}
+		if (n == 0)
+			break;
+		size += n;
+	}
+	close(fd);
+
+	if (!data)
+		return ENOMEM;
+	if (err) {
+		free(data);
+		return err;
+	}
+	data[size] = '\0';
+	*buf = data;
+	*len = size;
+	return 0;
+}
+
+static int kernel_list_ifaddrs(struct backend *b __unused,
+			       struct backend_ifaddr **list, int *count)
+{
+	struct ifaddrs *ifaddr, *ifa;
+	int n = 0;
+
+	if (getifaddrs(&ifaddr) == -1)
+		return errno;
+
+	for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next)
+		n++;
+	*list = calloc(n ? n : 1, sizeof(**list));
+	if (!*list) {
+		freeifaddrs(ifaddr);
+		return ENOMEM;
+	}
+	for (n = 0, ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next, n++) {
+		strncpy((*list)[n].name, ifa->ifa_name, IFNAMSIZ - 1);
+		(*list)[n].flags = ifa->ifa_flags;
+	}
+	*count = n;
+	freeifaddrs(ifaddr);
+	return 0;
+}
+
+static const struct backend_ops kernel_ops = {
+	.name = "kernel",
+	.ioctl = kernel_ioctl,
+	.nl_send = kernel_nl_send,
+	.nl_recv = kernel_nl_recv,
+	.read_file = kernel_read_file,
+	.list_ifaddrs = kernel_list_ifaddrs,
+};
+
+static struct backend kernel_backend = {
+	.ops = &kernel_ops,
+};
+
+/*
+ *
+ *   Recording backend
+ *
+ */
+
+struct recorder {
+	struct backend	b;
+	pthread_mutex_t lock;
+	FILE		*file;
+	int		err;		/**< First write error, under lock */
+	uint32_t	next_send_id;
+};
+
+/* Id of the last NETLINK request recorded per conversation of this thread */
+static __thread uint32_t record_send_ids[BACKEND_NR_CONVS];
+
+static void record_write(struct recorder *r, uint32_t type, uint64_t duration,
+			 const struct iovec *iov, int iovcnt)
+{
+	struct cap_header hdr;
+	int i;
+
+	hdr.type = type;
+	hdr.len = 0;
+	hdr.duration_ns = duration;
+	for (i = 0; i < iovcnt; i++)
+		hdr.len += iov[i].iov_len;
+
+	pthread_mutex_lock(&r->lock);
+	if (r->file && !r->err) {
+		if (fwrite(&hdr, sizeof(hdr), 1, r->file) != 1)
+			r->err = errno ? errno : EIO;
+		for (i = 0; i < iovcnt && !r->err; i++)
+			if (iov[i].iov_len &&
+			    fwrite(iov[i].iov_base, iov[i].iov_len, 1, r->file) != 1)
+				r->err = errno ? errno : EIO;
+	}
+	pthread_mutex_unlock(&r->lock);
+}
+
+static int record_ioctl(struct backend *b, int fd, unsigned long request,
+			struct ifreq *ifr, size_t data_len)
+{
+	struct cap_ioctl rec;
+	struct iovec iov[2];
+	uint64_t start = clock_now_ns(CLOCK_MONOTONIC);
+	int ret, err;
+
+	ret = kernel_ioctl(b, fd, request, ifr, data_len);
+	err = errno;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.request = request;
+	rec.ret = ret;
+	rec.err = ret < 0 ? err : 0;
+	rec.data_len = data_len;
+	rec.ifr = *ifr;
+	iov[0].iov_base = &rec;
+	iov[0].iov_len = sizeof(rec);
+	iov[1].iov_base = data_len ? ifr->ifr_data : NULL;
+	iov[1].iov_len = data_len;
+	record_write((struct recorder *)b, CAP_IOCTL, clock_now_ns(CLOCK_MONOTONIC) - start,
+		     iov, 2);
+
+	errno = err;
+	return ret;
+}
+
+static int record_nl_send(struct backend *b, struct nl_sock *sk, struct nl_msg *msg)
+{
+	struct recorder *r = (struct recorder *)b;
+	struct iovec iov[2];
+	uint64_t start = clock_now_ns(CLOCK_MONOTONIC);
+	uint32_t id;
+	int ret;
+
+	ret = kernel_nl_send(b, sk, msg);
+
+	id = __atomic_fetch_add(&r->next_send_id, 1, __ATOMIC_RELAXED);
+	record_send_ids[backend_conv(sk, 1)] = id;
+	iov[0].iov_base = &id;
+	iov[0].iov_len = sizeof(id);
+	iov[1].iov_base = nlmsg_hdr(msg);
+	iov[1].iov_len = nlmsg_hdr(msg)->nlmsg_len;
+	record_write(r, CAP_NL_SEND, clock_now_ns(CLOCK_MONOTONIC) - start, iov, 2);
+	return ret;
+}
+
+static int record_nl_recv(struct backend *b, struct nl_sock *sk, struct sockaddr_nl *nla,
+			  unsigned char **buf, struct ucred **creds)
+{
+	struct cap_nl_recv rec;
+	struct iovec iov[2];
+	uint64_t start = clock_now_ns(CLOCK_MONOTONIC);
+	int conv = backend_conv(sk, 0);
+
+	rec.ret = kernel_nl_recv(b, sk, nla, buf, creds);
+	rec.send_id = conv >= 0 ? record_send_ids[conv] : 0;
+	iov[0].iov_base = &rec;
+	iov[0].iov_len = sizeof(rec);
+	iov[1].iov_base = rec.ret > 0 ? *buf : NULL;
+	iov[1].iov_len = rec.ret > 0 ? rec.ret : 0;
+	record_write((struct recorder *)b, CAP_NL_RECV, clock_now_ns(CLOCK_MONOTONIC) - start,
+		     iov, 2);
+	return rec.ret;
+}
+
+static int record_read_file(struct backend *b, const char *path, char **buf, size_t *len)
+{
+	struct cap_file rec;
+	struct iovec iov[3];
+	uint64_t start = clock_now_ns(CLOCK_MONOTONIC);
+
+	rec.err = kernel_read_file(b, path, buf, len);
+	rec.path_len = strlen(path);
+	iov[0].iov_base = &rec;
+	iov[0].iov_len = sizeof(rec);
+	iov[1].iov_base = (void *)path;
+	iov[1].iov_len = rec.path_len;
+	iov[2].iov_base = rec.err ? NULL : *buf;
+	iov[2].iov_len = rec.err ? 0 : *len;
+	record_write((struct recorder *)b, CAP_FILE, clock_now_ns(CLOCK_MONOTONIC) - start,
+		     iov, 3);
+	return rec.err;
+}
+
+static int record_list_ifaddrs(struct backend *b, struct backend_ifaddr **list, int *count)
+{
+	struct cap_file rec;
+	struct iovec iov[2];
+	uint64_t start = clock_now_ns(CLOCK_MONOTONIC);
+
+	rec.err = kernel_list_ifaddrs(b, list, count);
+	rec.path_len = rec.err ? 0 : *count;
+	iov[0].iov_base = &rec;
+	iov[0].iov_len = sizeof(rec);
+	iov[1].iov_base = rec.err ? NULL : *list;
+	iov[1].iov_len = rec.path_len * sizeof(**list);
+	record_write((struct recorder *)b, CAP_IFADDRS, clock_now_ns(CLOCK_MONOTONIC) - start,
+		     iov, 2);
+	return rec.err;
+}
+
+static int record_destroy(struct backend *b)
+{
+	struct recorder *r = (struct recorder *)b;
+	int err = r->err;
+
+	if (fclose(r->file) != 0 && !err)
+		err = errno;
+	pthread_mutex_destroy(&r->lock);
+	free(r);
+	return err;
+}
+
+static const struct backend_ops record_ops = {
+	.name = "record",
+	.ioctl = record_ioctl,
+	.nl_send = record_nl_send,
+	.nl_recv = record_nl_recv,
+	.read_file = record_read_file,
+	.list_ifaddrs = record_list_ifaddrs,
+	.destroy = record_destroy,
+};
+
+/**
+ * Creates a recording backend
+ *
+ * @param path Capture file to create
+ *
+ * @return Returns the backend, or NULL with a Python exception set
+ */
+static struct backend *record_new(const char *path)
+{
+	struct cap_file_header hdr;
+	struct recorder *r;
+
+	r = calloc(1, sizeof(*r));
+	if (!r)
+		return (struct backend *)PyErr_NoMemory();
+	r->b.ops = &record_ops;
+	pthread_mutex_init(&r->lock, NULL);
+
+	r->file = fopen(path, "wbe");
+	if (!r->file) {
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)path);
+		free(r);
+		return NULL;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, CAP_MAGIC, sizeof(hdr.magic));
+	hdr.version = CAP_VERSION;
+	hdr.ifreq_size = sizeof(struct ifreq);
+	if (fwrite(&hdr, sizeof(hdr), 1, r->file) != 1) {
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)path);
+		fclose(r->file);
+		free(r);
+		return NULL;
+	}
+	return &r->b;
+}
+
+/*
+ *
+ *   Replay backend
+ *
+ */
+
+struct replay_reply {
+	const unsigned char *data;
+	uint64_t	    duration;
+	int32_t		    ret;
+};
+
+/**
+ * One recorded answer.  For NETLINK requests it is the list of replies
+ * received after the request was sent.
+ */
+struct replay_item {
+	const unsigned char  *payload;
+	uint32_t	     len;
+	uint64_t	     duration;
+	struct replay_reply  *replies;
+	unsigned int	     nr_replies;
+};
+
+struct replay_entry {
+	struct replay_entry *next;	/**< Hash chain */
+	uint32_t	    type;
+	unsigned char	    *key;
+	size_t		    key_len;
+	struct replay_item  *items;
+	unsigned int	    nr_items;
+	unsigned int	    cursor;	/**< Next item to serve, atomic */
+};
+
+struct replay {
+	struct backend	    b;
+	unsigned int	    generation;
+	int		    timed;
+	char		    *data;
+	size_t		    size;
+	struct replay_entry **buckets;
+	size_t		    nr_buckets;
+};
+
+static unsigned int replay_generation;
+
+/* NETLINK exchanges this thread is replaying, per conversation */
+static __thread struct replay_conv {
+	unsigned int	   generation;
+	struct replay_item *item;
+	unsigned int	   pos;
+	uint32_t	   seq;
+	uint32_t	   port;
+} replay_convs[BACKEND_NR_CONVS];
+
+static size_t replay_hash(uint32_t type, const unsigned char *key, size_t len)
+{
+	uint64_t h = 14695981039346656037ULL ^ type;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= key[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static struct replay_entry *replay_lookup(struct replay *r, uint32_t type,
+					  const void *key, size_t len)
+{
+	struct replay_entry *e;
+
+	e = r->buckets[replay_hash(type, key, len) & (r->nr_buckets - 1)];
+	for (; e; e = e->next)
+		if (e->type == type && e->key_len == len && !memcmp(e->key, key, len))
+			return e;
+	return NULL;
+}
+
+/**
+ * Adds an item to the entry of a key, creating the entry if needed
+ *
+ * @return Returns the new item, or NULL when out of memory
+ */
+static struct replay_item *replay_add(struct replay *r, uint32_t type,
+				      const void *key, size_t len)
+{
+	struct replay_entry *e = replay_lookup(r, type, key, len);
+	struct replay_item *items;
+
+	if (!e) {
+		size_t h = replay_hash(type, key, len) & (r->nr_buckets - 1);
+
+		e = calloc(1, sizeof(*e));
+		if (!e)
+			return NULL;
+		e->key = malloc(len ? len : 1);
+		if (!e->key) {
+			free(e);
+			return NULL;
+		}
+		memcpy(e->key, key, len);
+		e->key_len = len;
+		e->type = type;
+		e->next = r->buckets[h];
+		r->buckets[h] = e;
+	}
+
+	items = realloc(e->items, (e->nr_items + 1) * sizeof(*items));
+	if (!items)
+		return NULL;
+	e->items = items;
+	memset(&items[e->nr_items], 0, sizeof(*items));
+	return &items[e->nr_items++];
+}
+
+static struct replay_item *replay_pick(struct replay_entry *e)
+{
+	unsigned int i = __atomic_load_n(&e->cursor, __ATOMIC_RELAXED);
+
+	if (i + 1 < e->nr_items)
+		i = __atomic_fetch_add(&e->cursor, 1, __ATOMIC_RELAXED);
+	if (i >= e->nr_items)
+		i = e->nr_items - 1;
+	return &e->items[i];
+}
+
+static void replay_wait(struct replay *r, uint64_t duration)
+{
+	struct timespec ts;
+
+	if (!r->timed || !duration)
+		return;
+	ts.tv_sec = duration / 1000000000ULL;
+	ts.tv_nsec = duration % 1000000000ULL;
+	while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+		;
+}
+
+/* ioctl lookup key: request, device and the ETHTOOL command if any */
+struct replay_ioctl_key {
+	uint64_t request;
+	char	 name[IFNAMSIZ];
+	uint32_t cmd;
+};
+
+static void replay_ioctl_key(struct replay_ioctl_key *key, unsigned long request,
+			     const char *name, const void *data, size_t data_len)
+{
+	memset(key, 0, sizeof(*key));
+	key->request = request;
+	memcpy(key->name, name, strnlen(name, IFNAMSIZ - 1));
+	if (data_len >= sizeof(key->cmd))
+		memcpy(&key->cmd, data, sizeof(key->cmd));
+}
+
+static int replay_ioctl(struct backend *b, int fd __unused,
+			unsigned long request, struct ifreq *ifr, size_t data_len)
+{
+	struct replay *r = (struct replay *)b;
+	struct replay_ioctl_key key;
+	struct replay_entry *e;
+	struct replay_item *item;
+	struct cap_ioctl rec;
+
+	replay_ioctl_key(&key, request, ifr->ifr_name, ifr->ifr_data, data_len);
+	e = replay_lookup(r, CAP_IOCTL, &key, sizeof(key));
+	if (!e) {
+		errno = replay_lookup(r, CAP_DEVICE, key.name, strlen(key.name))
+			? EOPNOTSUPP : ENODEV;
+		return -1;
+	}
+	item = replay_pick(e);
+	replay_wait(r, item->duration);
+
+	memcpy(&rec, item->payload, sizeof(rec));
+	if (data_len) {
+		memcpy(ifr->ifr_data, item->payload + sizeof(rec),
+		       rec.data_len < data_len ? rec.data_len : data_len);
+	} else {
+		memcpy(ifr, &rec.ifr, sizeof(*ifr));
+	}
+	if (rec.ret < 0)
+		errno = rec.err;
+	return rec.ret;
+}
+
+/**
+ * Copies a NETLINK message with the fields which differ between the
+ * recording and the replay cleared, for use as lookup key
+ */
+static unsigned char *replay_nl_key(const struct nlmsghdr *hdr, size_t len)
+{
+	unsigned char *key = malloc(len);
+
+	if (key) {
+		memcpy(key, hdr, len);
+		((struct nlmsghdr *)key)->nlmsg_seq = 0;
+		((struct nlmsghdr *)key)->nlmsg_pid = 0;
+	}
+	return key;
+}
+
+static int replay_nl_send(struct backend *b, struct nl_sock *sk, struct nl_msg *msg)
+{
+	struct replay *r = (struct replay *)b;
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+	struct replay_conv *conv;
+	struct replay_entry *e;
+	unsigned char *key;
+
+	key = replay_nl_key(hdr, hdr->nlmsg_len);
+	if (!key)
+		return -NLE_NOMEM;
+	e = replay_lookup(r, CAP_NL_SEND, key, hdr->nlmsg_len);
+	free(key);
+	if (!e)
+		return -NLE_OBJ_NOTFOUND;
+
+	conv = &replay_convs[backend_conv(sk, 1)];
+	conv->generation = r->generation;
+	conv->item = replay_pick(e);
+	conv->pos = 0;
+	conv->seq = hdr->nlmsg_seq;
+	conv->port = hdr->nlmsg_pid;
+	replay_wait(r, conv->item->duration);
+	return hdr->nlmsg_len;
+}
+
+static int replay_nl_recv(struct backend *b, struct nl_sock *sk,
+			  struct sockaddr_nl *nla, unsigned char **buf,
+			  struct ucred **creds __unused)
+{
+	struct replay *r = (struct replay *)b;
+	struct replay_reply *reply;
+	struct replay_conv *conv;
+	struct nlmsghdr *hdr;
+	unsigned char *data;
+	int len, slot;
+
+	slot = backend_conv(sk, 0);
+	if (slot < 0)
+		return -NLE_OBJ_NOTFOUND;
+	conv = &replay_convs[slot];
+	if (conv->generation != r->generation || !conv->item ||
+	    conv->pos >= conv->item->nr_replies)
+		return -NLE_OBJ_NOTFOUND;
+
+	reply = &conv->item->replies[conv->pos++];
+	replay_wait(r, reply->duration);
+	if (reply->ret <= 0)
+		return reply->ret;
+
+	data = malloc(reply->ret);
+	if (!data)
+		return -NLE_NOMEM;
+	memcpy(data, reply->data, reply->ret);
+
+	/* Make the replies match the request libnl just sent */
+	len = reply->ret;
+	for (hdr = (struct nlmsghdr *)data; nlmsg_ok(hdr, len); hdr = nlmsg_next(hdr, &len)) {
+		hdr->nlmsg_seq = conv->seq;
+		hdr->nlmsg_pid = conv->port;
+	}
+
+	memset(nla, 0, sizeof(*nla));
+	nla->nl_family = AF_NETLINK;
+	*buf = data;
+	return reply->ret;
+}
+
+static int replay_read_file(struct backend *b, const char *path, char **buf, size_t *len)
+{
+	struct replay *r = (struct replay *)b;
+	struct replay_entry *e;
+	struct replay_item *item;
+	struct cap_file rec;
+
+	e = replay_lookup(r, CAP_FILE, path, strlen(path));
+	if (!e)
+		return ENOENT;
+	item = replay_pick(e);
+	replay_wait(r, item->duration);
+
+	memcpy(&rec, item->payload, sizeof(rec));
+	if (rec.err)
+		return rec.err;
+	*len = item->len - sizeof(rec) - rec.path_len;
+	*buf = malloc(*len + 1);
+	if (!*buf)
+		return ENOMEM;
+	memcpy(*buf, item->payload + sizeof(rec) + rec.path_len, *len);
+	(*buf)[*len] = '\0';
+	return 0;
+}
+
+static int replay_list_ifaddrs(struct backend *b, struct backend_ifaddr **list, int *count)
+{
+	struct replay *r = (struct replay *)b;
+	struct replay_entry *e;
+	struct replay_item *item;
+	struct cap_file rec;
+
+	e = replay_lookup(r, CAP_IFADDRS, NULL, 0);
+	if (!e) {
+		*list = calloc(1, sizeof(**list));
+		*count = 0;
+		return *list ? 0 : ENOMEM;
+	}
+	item = replay_pick(e);
+	replay_wait(r, item->duration);
+
+	memcpy(&rec, item->payload, sizeof(rec));
+	if (rec.err)
+		return rec.err;
+	*list = calloc(rec.path_len ? rec.path_len : 1, sizeof(**list));
+	if (!*list)
+		return ENOMEM;
+	memcpy(*list, item->payload + sizeof(rec), rec.path_len * sizeof(**list));
+	*count = rec.path_len;
+	return 0;
+}
+
+static int replay_destroy(struct backend *b)
+{
+	struct replay *r = (struct replay *)b;
+	struct replay_entry *e, *next;
+	unsigned int i;
+	size_t h;
+
+	for (h = 0; h < r->nr_buckets; h++) {
+		for (e = r->buckets[h]; e; e = next) {
+			next = e->next;
+			for (i = 0; i < e->nr_items; i++)
+				free(e->items[i].replies);
+			free(e->items);
+			free(e->key);
+			free(e);
+		}
+	}
+	free(r->buckets);
+	free(r->data);
+	free(r);
+	return 0;
+}
+
+static const struct backend_ops replay_ops = {
+	.name = "replay",
+	.ioctl = replay_ioctl,
+	.nl_send = replay_nl_send,
+	.nl_recv = replay_nl_recv,
+	.read_file = replay_read_file,
+	.list_ifaddrs = replay_list_ifaddrs,
+	.destroy = replay_destroy,
+};
+
+/**
+ * Indexes one record of a capture file
+ *
+ * @param r        The replay backend being built
+ * @param hdr      Record header
+ * @param payload  Record payload, hdr->len bytes, inside r->data
+ * @param sends    Items of the NETLINK requests by send id, grown as needed
+ * @param nr_sends Size of the sends array
+ *
+ * @return Returns 0 on success, ENOMEM or EINVAL for malformed records
+ */
+static int replay_index(struct replay *r, const struct cap_header *hdr,
+			const unsigned char *payload, struct replay_item ***sends,
+			uint32_t *nr_sends)
+{
+	struct replay_item *item = NULL;
+	struct cap_ioctl ioc;
+	struct cap_file file;
+	struct cap_nl_recv recv;
+	struct replay_ioctl_key key;
+	struct replay_reply *replies;
+	uint32_t id;
+	unsigned char *nlkey;
+
+	switch (hdr->type) {
+	case CAP_IOCTL:
+		if (hdr->len < sizeof(ioc))
+			return EINVAL;
+		memcpy(&ioc, payload, sizeof(ioc));
+		if (hdr->len != sizeof(ioc) + ioc.data_len)
+			return EINVAL;
+		ioc.ifr.ifr_name[IFNAMSIZ - 1] = '\0';
+		replay_ioctl_key(&key, ioc.request, ioc.ifr.ifr_name,
+				 payload + sizeof(ioc), ioc.data_len);
+		item = replay_add(r, CAP_IOCTL, &key, sizeof(key));
+		if (item && !replay_lookup(r, CAP_DEVICE, key.name, strlen(key.name)) &&
+		    !replay_add(r, CAP_DEVICE, key.name, strlen(key.name)))
+			return ENOMEM;
+		break;
+
+	case CAP_NL_SEND:
+		if (hdr->len < sizeof(id) + sizeof(struct nlmsghdr))
+			return EINVAL;
+		memcpy(&id, payload, sizeof(id));
+		nlkey = replay_nl_key((const struct nlmsghdr *)(payload + sizeof(id)),
+				      hdr->len - sizeof(id));
+		if (!nlkey)
+			return ENOMEM;
+		item = replay_add(r, CAP_NL_SEND, nlkey, hdr->len - sizeof(id));
+		free(nlkey);
+		if (!item)
+			return ENOMEM;
+		if (id >= *nr_sends) {
+			struct replay_item **tmp;
+			uint32_t n = id + 1 > *nr_sends * 2 ? id + 1 : *nr_sends * 2;
+
+			tmp = realloc(*sends, n * sizeof(*tmp));
+			if (!tmp)
+				return ENOMEM;
+			memset(tmp + *nr_sends, 0, (n - *nr_sends) * sizeof(*tmp));
+			*sends = tmp;
+			*nr_sends = n;
+		}
+		break;
+
+	case CAP_NL_RECV:
+		if (hdr->len < sizeof(recv))
+			return EINVAL;
+		memcpy(&recv, payload, sizeof(recv));
+		if (hdr->len != sizeof(recv) + (recv.ret > 0 ? recv.ret : 0))
+			return EINVAL;
+		if (recv.send_id >= *nr_sends || !(*sends)[recv.send_id])
+			return 0;	/* Answer to a request we could not resolve */
+		item = (*sends)[recv.send_id];
+		replies = realloc(item->replies, (item->nr_replies + 1) * sizeof(*replies));
+		if (!replies)
+			return ENOMEM;
+		item->replies = replies;
+		replies[item->nr_replies].data = payload + sizeof(recv);
+		replies[item->nr_replies].ret = recv.ret;
+		replies[item->nr_replies].duration = hdr->duration_ns;
+		item->nr_replies++;
+		return 0;
+
+	case CAP_FILE:
+	case CAP_IFADDRS:
+		if (hdr->len < sizeof(file))
+			return EINVAL;
+		memcpy(&file, payload, sizeof(file));
+		if (hdr->type == CAP_FILE) {
+			if (hdr->len < sizeof(file) + file.path_len)
+				return EINVAL;
+			item = replay_add(r, CAP_FILE, payload + sizeof(file), file.path_len);
+		} else {
+			if (hdr->len != sizeof(file) + file.path_len * sizeof(struct backend_ifaddr))
+				return EINVAL;
+			item = replay_add(r, CAP_IFADDRS, NULL, 0);
+		}
+		break;
+
+	default:
+		return 0;	/* Unknown record types are skipped */
+	}
+
+	if (!item)
+		return ENOMEM;
+	item->payload = payload;
+	item->len = hdr->len;
+	item->duration = hdr->duration_ns;
+	return 0;
+}
+
+/**
+ * Creates a replay backend serving the contents of a capture file
+ *
+ * @param path  Capture file written by the recording backend
+ * @param timed Whether to take as long as the recorded requests did
+ *
+ * @return Returns the backend, or NULL with a Python exception set
+ */
+static struct backend *replay_new(const char *path, int timed)
+{
+	struct cap_file_header fhdr;
+	struct cap_header hdr;
+	struct replay_item **sends = NULL;
+	uint32_t nr_sends = 0;
+	struct replay *r;
+	size_t off, nr_records = 0;
+	int err;
+
+	r = calloc(1, sizeof(*r));
+	if (!r)
+		return (struct backend *)PyErr_NoMemory();
+	r->b.ops = &replay_ops;
+	r->timed = timed;
+	r->generation = __atomic_add_fetch(&replay_generation, 1, __ATOMIC_RELAXED);
+
+	err = kernel_read_file(NULL, path, &r->data, &r->size);
+	if (err) {
+		free(r);
+		errno = err;
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)path);
+		return NULL;
+	}
+
+	if (r->size < sizeof(fhdr))
+		goto invalid;
+	memcpy(&fhdr, r->data, sizeof(fhdr));
+	if (memcmp(fhdr.magic, CAP_MAGIC, sizeof(fhdr.magic)) ||
+	    fhdr.version != CAP_VERSION || fhdr.ifreq_size != sizeof(struct ifreq))
+		goto invalid;
+
+	/* Size the hash table for the number of records */
+	for (off = sizeof(fhdr); off + sizeof(hdr) <= r->size; off += sizeof(hdr) + hdr.len) {
+		memcpy(&hdr, r->data + off, sizeof(hdr));
+		nr_records++;
+	}
+	for (r->nr_buckets = 64; r->nr_buckets < nr_records; r->nr_buckets *= 2)
+		;
+	r->buckets = calloc(r->nr_buckets, sizeof(*r->buckets));
+	if (!r->buckets) {
+		replay_destroy(&r->b);
+		return (struct backend *)PyErr_NoMemory();
+	}
+
+	/*
+	 * Two passes: NETLINK replies refer to their request's item, which
+	 * only has a stable address once all requests have been added.
+	 */
+	for (off = sizeof(fhdr); off < r->size; off += sizeof(hdr) + hdr.len) {
+		if (off + sizeof(hdr) > r->size)
+			goto invalid;
+		memcpy(&hdr, r->data + off, sizeof(hdr));
+		if (hdr.len > r->size - off - sizeof(hdr))
+			goto invalid;
+		if (hdr.type == CAP_NL_RECV)
+			continue;
+		err = replay_index(r, &hdr, (unsigned char *)r->data + off + sizeof(hdr),
+				   &sends, &nr_sends);
+		if (err == ENOMEM) {
+			free(sends);
+			replay_destroy(&r->b);
+			return (struct backend *)PyErr_NoMemory();
+		} else if (err) {
+			goto invalid;
+		}
+	}
+
+	/* Resolve the send ids now that the items do not move anymore */
+	for (off = sizeof(fhdr); off < r->size; off += sizeof(hdr) + hdr.len) {
+		struct replay_entry *e;
+		unsigned char *nlkey;
+		uint32_t id;
+
+		memcpy(&hdr, r->data + off, sizeof(hdr));
+		if (hdr.type != CAP_NL_SEND)
+			continue;
+		memcpy(&id, r->data + off + sizeof(hdr), sizeof(id));
+		nlkey = replay_nl_key((const struct nlmsghdr *)(r->data + off + sizeof(hdr) + sizeof(id)),
+				      hdr.len - sizeof(id));
+		if (!nlkey) {
+			free(sends);
+			replay_destroy(&r->b);
+			return (struct backend *)PyErr_NoMemory();
+		}
+		e = replay_lookup(r, CAP_NL_SEND, nlkey, hdr.len - sizeof(id));
+		free(nlkey);
+		/* The items of an entry are in file order, the cursor counts
+		 * the ones seen so far */
+		if (e && id < nr_sends)
+			sends[id] = &e->items[e->cursor++];
+	}
+	for (off = 0; off < r->nr_buckets; off++) {
+		struct replay_entry *e;
+
+		for (e = r->buckets[off]; e; e = e->next)
+			e->cursor = 0;
+	}
+
+	for (off = sizeof(fhdr); off < r->size; off += sizeof(hdr) + hdr.len) {
+		memcpy(&hdr, r->data + off, sizeof(hdr));
+		if (hdr.type != CAP_NL_RECV)
+			continue;
+		err = replay_index(r, &hdr, (unsigned char *)r->data + off + sizeof(hdr),
+				   &sends, &nr_sends);
+		if (err == ENOMEM) {
+			free(sends);
+			replay_destroy(&r->b);
+			return (struct backend *)PyErr_NoMemory();
+		} else if (err) {
+			goto invalid;
+		}
+	}
+	free(sends);
+	return &r->b;
+
+ invalid:
+	free(sends);
+	replay_destroy(&r->b);
+	PyErr_Format(PyExc_ValueError, "%s is not a valid capture file", path);
+	return NULL;
+}
+
+/*
+ *
+ *   Dispatching
+ *
+ */
+
+static struct backend *current_backend = &kernel_backend;
+static pthread_rwlock_t backend_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/**
+ * Returns the backend to use for one call, which must be handed back to
+ * backend_release() once done with it
+ */
+static struct backend *backend_acquire(int *locked)
+{
+	struct backend *b = __atomic_load_n(&current_backend, __ATOMIC_ACQUIRE);
+
+	*locked = 0;
+	if (b == &kernel_backend)
+		return b;
+
+	pthread_rwlock_rdlock(&backend_lock);
+	*locked = 1;
+	return current_backend;
+}
+
+static void backend_release(int locked)
+{
+	if (locked)
+		pthread_rwlock_unlock(&backend_lock);
+}
+
+/**
+ * ioctl() through the current backend, accounted in ethtool.stats()
+ *
+ * @param fd       AF_INET control socket
+ * @param request  ioctl request
+ * @param ifr      Request structure
+ * @param data_len Size of the buffer ifr->ifr_data points to, 0 if the
+ *                 request does not use it
+ *
+ * @return Returns the result of ioctl(), with errno set on failure
+ */
+int backend_ioctl(int fd, unsigned long request, struct ifreq *ifr, size_t data_len)
+{
+	struct backend *b;
+	int locked, ret, err;
+
+	stats_count_ioctl();
+	b = backend_acquire(&locked);
+	ret = b->ops->ioctl(b, fd, request, ifr, data_len);
+	err = errno;
+	backend_release(locked);
+	errno = err;
+	return ret;
+}
+
+/**
+ * Reads a whole file through the current backend
+ *
+ * @param path File to read
+ * @param buf  Where to store the NUL terminated contents, to be free()d
+ * @param len  Where to store the length of the contents
+ *
+ * @return Returns 0 on success, otherwise an errno value
+ */
+int backend_read_file(const char *path, char **buf, size_t *len)
+{
+	struct backend *b;
+	int locked, err;
+
+	b = backend_acquire(&locked);
+	err = b->ops->read_file(b, path, buf, len);
+	backend_release(locked);
+	return err;
+}
+
+/**
+ * Lists the addresses of all interfaces through the current backend,
+ * like getifaddrs()
+ *
+ * @param list  Where to store the entries, to be free()d
+ * @param count Where to store the number of entries
+ *
+ * @return Returns 0 on success, otherwise an errno value
+ */
+int backend_list_ifaddrs(struct backend_ifaddr **list, int *count)
+{
+	struct backend *b;
+	int locked, err;
+
+	b = backend_acquire(&locked);
+	err = b->ops->list_ifaddrs(b, list, count);
+	backend_release(locked);
+	return err;
+}
+
+static int backend_nl_send(struct nl_sock *sk, struct nl_msg *msg)
+{
+	struct backend *b;
+	int locked, ret;
+
+	b = backend_acquire(&locked);
+	ret = b->ops->nl_send(b, sk, msg);
+	backend_release(locked);
+	return ret;
+}
+
+/**
+ * Receives one buffer of NETLINK messages through the backend, for
+ * callers which parse the replies themselves instead of using
+ * nl_recvmsgs().  Takes the same arguments as nl_recv().
+ */
+int backend_nl_recv(struct nl_sock *sk, struct sockaddr_nl *nla,
+		    unsigned char **buf, struct ucred **creds)
+{
+	struct backend *b;
+	int locked, ret;
+
+	b = backend_acquire(&locked);
+	ret = b->ops->nl_recv(b, sk, nla, buf, creds);
+	backend_release(locked);
+	return ret;
+}
+
+/**
+ * Maps a libnl error code to the errno it most likely came from
+ */
+int backend_nlerr2syserr(int err)
+{
+	switch (-err) {
+	case NLE_INTR:		return EINTR;
+	case NLE_BAD_SOCK:	return EBADF;
+	case NLE_AGAIN:		return EAGAIN;
+	case NLE_NOMEM:		return ENOMEM;
+	case NLE_EXIST:		return EEXIST;
+	case NLE_INVAL:		return EINVAL;
+	case NLE_RANGE:		return ERANGE;
+	case NLE_MSGSIZE:	return EMSGSIZE;
+	case NLE_OPNOTSUPP:	return EOPNOTSUPP;
+	case NLE_AF_NOSUPPORT:	return EAFNOSUPPORT;
+	case NLE_OBJ_NOTFOUND:	return ENODEV;
+	case NLE_NOACCESS:	return EACCES;
+	case NLE_PERM:		return EPERM;
+	case NLE_BUSY:		return EBUSY;
+	case NLE_NODEV:		return ENODEV;
+	default:		return EIO;
+	}
+}
+
+/**
+ * Routes the traffic of a freshly connected NETLINK socket through the
+ * backends and accounts it in ethtool.stats()
+ *
+ * @param sk NETLINK socket
+ */
+void backend_nl_setup(struct nl_sock *sk)
+{
+	struct nl_cb *cb = nl_socket_get_cb(sk);
+
+	nl_cb_overwrite_send(cb, backend_nl_send);
+	nl_cb_overwrite_recv(cb, backend_nl_recv);
+	nl_cb_set(cb, NL_CB_MSG_IN, NL_CB_CUSTOM, stats_nl_msg_in, NULL);
+	nl_cb_put(cb);
+}
+
+/**
+ * ethtool.set_backend(name, path=None, timed=False)
+ */
+PyObject *backend_set(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "name", "path", "timed", NULL };
+	const char *name, *path = NULL;
+	int timed = 0, err;
+	struct backend *b, *old;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|zi:set_backend", kwlist,
+					 &name, &path, &timed))
+		return NULL;
+
+	if (strcmp(name, "kernel") && strcmp(name, "record") && strcmp(name, "replay")) {
+		PyErr_Format(PyExc_ValueError, "unknown backend '%s'", name);
+		return NULL;
+	}
+	if (strcmp(name, "kernel") && !path) {
+		PyErr_Format(PyExc_ValueError, "the %s backend needs a path", name);
+		return NULL;
+	}
+
+	/*
+	 * Retire the old backend first, waiting for the calls still using it,
+	 * so that a capture which was just recorded is complete on disk when
+	 * it gets replayed.  Should the new backend fail to load, the kernel
+	 * one stays in place.
+	 */
+	Py_BEGIN_ALLOW_THREADS
+	pthread_rwlock_wrlock(&backend_lock);
+	old = current_backend;
+	__atomic_store_n(&current_backend, &kernel_backend, __ATOMIC_RELEASE);
+	pthread_rwlock_unlock(&backend_lock);
+	err = old->ops->destroy ? old->ops->destroy(old) : 0;
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		errno = err;
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+	if (!strcmp(name, "kernel"))
+		Py_RETURN_NONE;
+
+	b = !strcmp(name, "record") ? record_new(path) : replay_new(path, timed);
+	if (!b)
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_rwlock_wrlock(&backend_lock);
+	__atomic_store_n(&current_backend, b, __ATOMIC_RELEASE);
+	pthread_rwlock_unlock(&backend_lock);
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+/**
+ * ethtool.get_backend(): name of the current backend
+ */
+PyObject *backend_get(PyObject *self __unused, PyObject *unused __unused)
+{
+	struct backend *b;
+	PyObject *name;
+	int locked;
+
+	b = backend_acquire(&locked);
+	name = Py_BuildValue("s", b->ops->name);
+	backend_release(locked);
+	return name;
+}
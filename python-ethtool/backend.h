@@ -0,0 +1,45 @@
+/* backend.h - Pluggable kernel access layer, with record and replay backends
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _BACKEND_H
+#define _BACKEND_H
+
+#include <Python.h>
+#include <stddef.h>
+#include <net/if.h>
+
+struct nl_sock;
+struct sockaddr_nl;
+struct ucred;
+
+/**
+ * What get_active_devices() needs to know about an interface address
+ */
+struct backend_ifaddr {
+	char	     name[IFNAMSIZ];
+	unsigned int flags;
+};
+
+int backend_ioctl(int fd, unsigned long request, struct ifreq *ifr, size_t data_len);
+int backend_read_file(const char *path, char **buf, size_t *len);
+int backend_list_ifaddrs(struct backend_ifaddr **list, int *count);
+void backend_nl_setup(struct nl_sock *sk);
+int backend_nl_recv(struct nl_sock *sk, struct sockaddr_nl *nla,
+		    unsigned char **buf, struct ucred **creds);
+int backend_nlerr2syserr(int err);
+
+PyObject *backend_set(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *backend_get(PyObject *self, PyObject *unused);
+
+#endif
@@ -0,0 +1,235 @@
+/* common.c - Helpers shared by the modules of the extension
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <Python.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <net/if.h>
+
+#include "ethtool.h"
+
+/**
+ * Reads a clock in nanoseconds
+ *
+ * @param clock The clock to read, such as CLOCK_MONOTONIC
+ *
+ * @return Returns the current time of the clock in nanoseconds.
+ */
+uint64_t clock_now_ns(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Stores a new reference into a dict, stealing it
+ *
+ * @param dict  The dict to store into
+ * @param key   The key to store value under
+ * @param value The new reference to store, or NULL after a failed build
+ *
+ * @return Returns 0 on success, otherwise -1 with a Python exception set.
+ */
+int dict_set_steal(PyObject *dict, const char *key, PyObject *value)
+{
+	int rc;
+
+	if (!value)
+		return -1;
+	rc = PyDict_SetItemString(dict, key, value);
+	Py_DECREF(value);
+	return rc;
+}
+
+/**
+ * Converts a device name given as str, bytes or os.PathLike to a bytes object
+ *
+ * @param obj    Python object holding the device name
+ * @param result Where to store the new bytes object reference
+ *
+ * @return Returns 1 on success, otherwise 0 with a Python exception set.
+ */
+int devname_to_bytes(PyObject *obj, PyObject **result)
+{
+#if PY_MAJOR_VERSION >= 3
+	return PyUnicode_FSConverter(obj, result);
+#else
+	if (PyUnicode_Check(obj)) {
+		*result = PyUnicode_AsUTF8String(obj);
+		return *result != NULL;
+	}
+	if (PyBytes_Check(obj)) {
+		Py_INCREF(obj);
+		*result = obj;
+		return 1;
+	}
+	PyErr_Format(PyExc_TypeError, "device name must be a string, not %.200s",
+		     Py_TYPE(obj)->tp_name);
+	return 0;
+#endif
+}
+
+/**
+ * Copies a device name into an IFNAMSIZ sized buffer.  Names which can't
+ * fit are left for the caller to report, as a truncated name could be that
+ * of another device.
+ *
+ * @param obj Python object holding the device name
+ * @param buf char[IFNAMSIZ] buffer receiving the nul terminated name
+ *
+ * @return Returns 0 on success, 1 if the name is too long for any device,
+ *         otherwise -1 with a Python exception set.
+ */
+int devname_copy(PyObject *obj, char *buf)
+{
+	PyObject *bytes;
+	Py_ssize_t len;
+
+	if (!devname_to_bytes(obj, &bytes))
+		return -1;
+
+	len = PyBytes_GET_SIZE(bytes);
+	if ((size_t)len != strlen(PyBytes_AS_STRING(bytes))) {
+		PyErr_SetString(PyExc_ValueError, "embedded null byte in device name");
+		Py_DECREF(bytes);
+		return -1;
+	}
+	if (len >= IFNAMSIZ) {
+		Py_DECREF(bytes);
+		return 1;
+	}
+
+	memcpy(buf, PyBytes_AS_STRING(bytes), len + 1);
+	Py_DECREF(bytes);
+	return 0;
+}
+
+/**
+ * PyArg "O&" converter storing a device name into an IFNAMSIZ sized buffer,
+ * such as ifreq.ifr_name.  Names which can't fit are reported as ENODEV,
+ * as no such device can exist.
+ *
+ * @param obj  Python object holding the device name
+ * @param addr char[IFNAMSIZ] buffer receiving the nul terminated name
+ *
+ * @return Returns 1 on success, otherwise 0 with a Python exception set.
+ */
+int devname_converter(PyObject *obj, void *addr)
+{
+	switch (devname_copy(obj, addr)) {
+	case 0:
+		return 1;
+	case 1:
+		errno = ENODEV;
+		PyErr_SetFromErrno(PyExc_IOError);
+		break;
+	}
+	return 0;
+}
+
+/**
+ * Initialises a worker, whose thread is not running yet
+ *
+ * @param w The worker to initialise
+ */
+void worker_init(struct worker *w)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&w->wake, &attr);
+	pthread_condattr_destroy(&attr);
+	w->running = w->stopping = 0;
+}
+
+/**
+ * Releases a worker, after worker_stop()
+ *
+ * @param w The worker to release
+ */
+void worker_destroy(struct worker *w)
+{
+	pthread_cond_destroy(&w->wake);
+}
+
+/**
+ * Starts the thread of a worker, unless it is running already.  The thread
+ * runs with all signals blocked, as they are for the threads running Python.
+ * The caller serialises worker_start() and worker_stop().
+ *
+ * @param w    The worker to start
+ * @param func The thread function, polling w->stopping
+ * @param arg  The argument of func
+ *
+ * @return Returns 0 on success, otherwise an errno.
+ */
+int worker_start(struct worker *w, void *(*func)(void *), void *arg)
+{
+	sigset_t all, old;
+	int err;
+
+	if (w->running)
+		return 0;
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	err = pthread_create(&w->thread, NULL, func, arg);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	w->running = !err;
+	return err;
+}
+
+/**
+ * Asks the thread of a worker to stop and waits for it to exit
+ *
+ * @param w    The worker to stop
+ * @param lock The mutex protecting w->stopping, not held by the caller
+ */
+void worker_stop(struct worker *w, pthread_mutex_t *lock)
+{
+	if (!w->running)
+		return;
+
+	pthread_mutex_lock(lock);
+	w->stopping = 1;
+	pthread_cond_signal(&w->wake);
+	pthread_mutex_unlock(lock);
+	pthread_join(w->thread, NULL);
+	w->running = 0;
+	w->stopping = 0;
+}
+
+/**
+ * Sleeps in the thread of a worker until a deadline, or until it is asked
+ * to stop
+ *
+ * @param w        The worker whose thread is sleeping
+ * @param lock     The mutex protecting w->stopping, held by the caller
+ * @param deadline CLOCK_MONOTONIC time to wake up at, in nanoseconds
+ */
+void worker_sleep(struct worker *w, pthread_mutex_t *lock, uint64_t deadline)
+{
+	struct timespec ts;
+
+	ts.tv_sec = deadline / 1000000000ULL;
+	ts.tv_nsec = deadline % 1000000000ULL;
+	while (!w->stopping && pthread_cond_timedwait(&w->wake, lock, &ts) != ETIMEDOUT)
+		;
+}
@@ -0,0 +1,780 @@
+/* dim.c - Dynamic interrupt moderation from userspace
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * A coalescing controller picks the interrupt coalescing of a few devices
+ * from their packet rates, like the kernel's net_dim does for drivers
+ * which support it.  The receive and transmit directions are handled on
+ * their own: each moves along a table of profiles, ordered by the packet
+ * rate they are meant for, from low latency to high throughput.
+ *
+ * Moving to a lower profile needs the rate to fall below the limit of that
+ * profile by the hysteresis, so a rate hovering around a limit does not
+ * flap between two profiles.  Settings are only written with
+ * ETHTOOL_SCOALESCE when a profile changes and the device is not at its
+ * settings already.
+ *
+ * The controller either runs on a thread of its own, sampling the link
+ * counters, or is stepped with counters passed in, which lets it be
+ * driven by a simulated source with apply=False.
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/sockios.h>
+
+#include "ethtool.h"
+#include "dim.h"
+#include "metrics.h"
+#include "nicstats.h"
+#include "snapshot.h"
+#include "backend.h"
+
+enum dim_dir {
+	DIM_RX,
+	DIM_TX,
+	DIM_NR_DIRS
+};
+
+static const char *dim_dir_names[DIM_NR_DIRS] = { "rx", "tx" };
+
+/**
+ * Coalescing for packet rates up to max_rate
+ */
+struct dim_profile {
+	double	 max_rate;	/**< Packets per second */
+	uint32_t usecs;
+	uint32_t frames;
+};
+
+/* Loosely after the profiles of the kernel's net_dim */
+static const struct dim_profile dim_default_profiles[] = {
+	{ 10000,    1,   1 },
+	{ 50000,    8,  16 },
+	{ 200000,  64,  32 },
+	{ 1000000, 128, 64 },
+	{ INFINITY, 256, 128 },
+};
+
+struct dim_dev {
+	char	 name[IFNAMSIZ];
+	int	 ifindex;			/**< 0 until looked up */
+	int	 have_prev;
+	uint64_t prev[DIM_NR_DIRS];		/**< Packets at the last sample */
+	uint64_t prev_ns;
+	double	 rate[DIM_NR_DIRS];		/**< Packets per second */
+	int	 level[DIM_NR_DIRS];		/**< Profile, -1 before the first one */
+	uint64_t changes;			/**< Profile changes applied */
+	uint64_t errors;
+	int	 last_error;
+};
+
+/**
+ * The ethtool.CoalesceController object
+ */
+typedef struct {
+	PyObject_HEAD
+	pthread_mutex_t	   ctl;		/**< Serialises start(), stop() and close() */
+	pthread_mutex_t	   lock;	/**< Protects everything below */
+	struct worker	   worker;	/**< The controller thread */
+	int		   apply;	/**< Whether to write ETHTOOL_SCOALESCE */
+	int		   ioctl_fd;
+	struct linkstats   links;
+	double		   interval;
+	double		   hysteresis;
+	uint32_t	   nr_profiles;
+	struct dim_profile *profiles;
+	uint32_t	   nr_devs;
+	struct dim_dev	   *devs;
+	struct metrics_out out;
+} PyCoalesceController;
+
+/**
+ * Picks the profile for a packet rate
+ *
+ * @param cur Current profile, or -1
+ */
+static int dim_pick(const PyCoalesceController *self, int cur, double rate)
+{
+	int level = 0, last = self->nr_profiles - 1;
+
+	while (level < last && rate > self->profiles[level].max_rate)
+		level++;
+	while (level < cur &&
+	       rate >= self->profiles[level].max_rate * (1 - self->hysteresis))
+		level++;
+	return level;
+}
+
+static int dim_ioctl(int fd, const char devname[IFNAMSIZ], void *data, size_t size)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	memcpy(ifr.ifr_name, devname, IFNAMSIZ);
+	ifr.ifr_data = data;
+	return backend_ioctl(fd, SIOCETHTOOL, &ifr, size) < 0 ? errno : 0;
+}
+
+/**
+ * Writes the coalescing of the profiles, keeping the other settings
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int dim_apply(PyCoalesceController *self, const struct dim_dev *dev, const int *level)
+{
+	const struct dim_profile *rx = &self->profiles[level[DIM_RX]];
+	const struct dim_profile *tx = &self->profiles[level[DIM_TX]];
+	struct ethtool_coalesce coal;
+	int err;
+
+	memset(&coal, 0, sizeof(coal));
+	coal.cmd = ETHTOOL_GCOALESCE;
+	if ((err = dim_ioctl(self->ioctl_fd, dev->name, &coal, sizeof(coal))) != 0)
+		return err;
+	if (coal.rx_coalesce_usecs == rx->usecs && coal.rx_max_coalesced_frames == rx->frames &&
+	    coal.tx_coalesce_usecs == tx->usecs && coal.tx_max_coalesced_frames == tx->frames)
+		return 0;
+
+	coal.cmd = ETHTOOL_SCOALESCE;
+	coal.rx_coalesce_usecs = rx->usecs;
+	coal.rx_max_coalesced_frames = rx->frames;
+	coal.tx_coalesce_usecs = tx->usecs;
+	coal.tx_max_coalesced_frames = tx->frames;
+	return dim_ioctl(self->ioctl_fd, dev->name, &coal, sizeof(coal));
+}
+
+/**
+ * Feeds the packet counters of a device to the controller.  Called with
+ * self->lock held, without the GIL.
+ *
+ * @return Returns 1 if the profiles changed, otherwise 0
+ */
+static int dim_update(PyCoalesceController *self, struct dim_dev *dev,
+		      const uint64_t *packets, uint64_t now_ns)
+{
+	int level[DIM_NR_DIRS], d, changed = 0, err = 0;
+
+	/* Counters going backwards were reset, the next sample tells */
+	if (dev->have_prev && now_ns > dev->prev_ns &&
+	    packets[DIM_RX] >= dev->prev[DIM_RX] && packets[DIM_TX] >= dev->prev[DIM_TX]) {
+		for (d = 0; d < DIM_NR_DIRS; d++) {
+			dev->rate[d] = (packets[d] - dev->prev[d]) * 1e9 / (now_ns - dev->prev_ns);
+			level[d] = dim_pick(self, dev->level[d], dev->rate[d]);
+			changed |= level[d] != dev->level[d];
+		}
+		if (changed && self->apply)
+			err = dim_apply(self, dev, level);
+		/*
+		 * Not retried until the profiles change again, most failures
+		 * are devices without coalescing settings
+		 */
+		if (err) {
+			dev->errors++;
+			dev->last_error = err;
+		} else if (changed) {
+			dev->changes++;
+		}
+		memcpy(dev->level, level, sizeof(level));
+	}
+
+	memcpy(dev->prev, packets, sizeof(dev->prev));
+	dev->prev_ns = now_ns;
+	dev->have_prev = 1;
+	return changed;
+}
+
+/**
+ * Samples the link counters of all devices and updates them.  Called with
+ * self->lock held, without the GIL.
+ *
+ * @param changed Set to whether the profiles of each device changed, or NULL
+ */
+static void dim_sample(PyCoalesceController *self, char *changed)
+{
+	uint64_t values[SNAPSHOT_NR_COUNTERS], packets[DIM_NR_DIRS];
+	struct dim_dev *dev;
+	uint32_t i;
+	int err;
+
+	for (i = 0; i < self->nr_devs; i++) {
+		dev = &self->devs[i];
+		if (!dev->ifindex)
+			dev->ifindex = linkstats_ifindex(self->ioctl_fd, dev->name);
+		err = dev->ifindex ? linkstats_read(&self->links, dev->ifindex, values) : ENODEV;
+		if (err) {
+			/* The device may come back under another index */
+			dev->ifindex = 0;
+			dev->errors++;
+			dev->last_error = err;
+			continue;
+		}
+		packets[DIM_RX] = values[SNAPSHOT_RX_PACKETS];
+		packets[DIM_TX] = values[SNAPSHOT_TX_PACKETS];
+		if (dim_update(self, dev, packets, clock_now_ns(CLOCK_MONOTONIC)) && changed)
+			changed[i] = 1;
+	}
+}
+
+static void *dim_thread(void *arg)
+{
+	PyCoalesceController *self = arg;
+	uint64_t interval = self->interval * 1e9, next = clock_now_ns(CLOCK_MONOTONIC), now;
+
+	pthread_mutex_lock(&self->lock);
+	while (!self->worker.stopping) {
+		dim_sample(self, NULL);
+
+		next += interval;
+		now = clock_now_ns(CLOCK_MONOTONIC);
+		if (next < now)
+			next = now + interval;
+		worker_sleep(&self->worker, &self->lock, next);
+	}
+	pthread_mutex_unlock(&self->lock);
+	return NULL;
+}
+
+/* Called with self->ctl held, or from the destructor */
+static void dim_stop(PyCoalesceController *self)
+{
+	worker_stop(&self->worker, &self->lock);
+}
+
+/* Called with self->ctl held, or from the destructor */
+static void dim_close(PyCoalesceController *self)
+{
+	dim_stop(self);
+	/* step() may be sampling or applying on another thread */
+	pthread_mutex_lock(&self->lock);
+	linkstats_close(&self->links);
+	if (self->ioctl_fd >= 0)
+		close(self->ioctl_fd);
+	self->ioctl_fd = -1;
+	pthread_mutex_unlock(&self->lock);
+}
+
+static int dim_parse_profiles(PyCoalesceController *self, PyObject *profiles)
+{
+	PyObject *seq;
+	Py_ssize_t i, n;
+	int rc = 0;
+
+	if (!profiles || profiles == Py_None) {
+		n = ARRAY_SIZE(dim_default_profiles);
+		self->profiles = malloc(sizeof(dim_default_profiles));
+		if (!self->profiles) {
+			PyErr_NoMemory();
+			return -1;
+		}
+		memcpy(self->profiles, dim_default_profiles, sizeof(dim_default_profiles));
+		self->nr_profiles = n;
+		return 0;
+	}
+
+	seq = PySequence_Fast(profiles, "profiles must be a sequence of "
+			      "(max_rate, usecs, frames) tuples");
+	if (!seq)
+		return -1;
+	n = PySequence_Fast_GET_SIZE(seq);
+	self->profiles = calloc(n ? n : 1, sizeof(*self->profiles));
+	if (!self->profiles) {
+		Py_DECREF(seq);
+		PyErr_NoMemory();
+		return -1;
+	}
+	for (i = 0; i < n && rc == 0; i++) {
+		struct dim_profile *p = &self->profiles[i];
+
+		if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i), "dII:profiles",
+				      &p->max_rate, &p->usecs, &p->frames)) {
+			rc = -1;
+		} else if (i && !(p->max_rate > p[-1].max_rate)) {
+			PyErr_SetString(PyExc_ValueError,
+					"profiles must be ordered by increasing max_rate");
+			rc = -1;
+		}
+	}
+	if (rc == 0 && n == 0) {
+		PyErr_SetString(PyExc_ValueError, "no profiles");
+		rc = -1;
+	}
+	Py_DECREF(seq);
+	self->nr_profiles = n;
+	return rc;
+}
+
+/**
+ * ethtool.coalesce_controller(devices, profiles=None, interval=0.25,
+ *                             hysteresis=0.2, apply=True)
+ *
+ * @return Returns a new CoalesceController object
+ */
+PyObject *dim_controller(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devices", "profiles", "interval", "hysteresis",
+				  "apply", NULL };
+	PyObject *devices, *profiles = NULL, *seq;
+	PyCoalesceController *c;
+	double interval = 0.25, hysteresis = 0.2;
+	int apply = 1, err = 0;
+	Py_ssize_t i, n;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|Oddi:coalesce_controller", kwlist,
+					 &devices, &profiles, &interval, &hysteresis,
+					 &apply))
+		return NULL;
+	if (!(interval >= 1e-3 && interval <= 3600)) {
+		PyErr_SetString(PyExc_ValueError, "interval must be between 1ms and 1h");
+		return NULL;
+	}
+	if (!(hysteresis >= 0 && hysteresis < 1)) {
+		PyErr_SetString(PyExc_ValueError, "hysteresis must be at least 0 and below 1");
+		return NULL;
+	}
+
+	seq = PySequence_Fast(devices, "devices must be a sequence of device names");
+	if (!seq)
+		return NULL;
+	n = PySequence_Fast_GET_SIZE(seq);
+
+	c = PyObject_New(PyCoalesceController, &PyCoalesceController_Type);
+	if (!c) {
+		Py_DECREF(seq);
+		return NULL;
+	}
+	pthread_mutex_init(&c->ctl, NULL);
+	pthread_mutex_init(&c->lock, NULL);
+	worker_init(&c->worker);
+	c->apply = apply;
+	c->ioctl_fd = -1;
+	c->links.sk = NULL;
+	c->interval = interval;
+	c->hysteresis = hysteresis;
+	c->nr_profiles = 0;
+	c->profiles = NULL;
+	c->nr_devs = 0;
+	memset(&c->out, 0, sizeof(c->out));
+	c->devs = calloc(n ? n : 1, sizeof(*c->devs));
+	if (!c->devs) {
+		Py_DECREF(seq);
+		Py_DECREF(c);
+		return PyErr_NoMemory();
+	}
+	c->nr_devs = n;
+	for (i = 0; i < n; i++) {
+		if (!devname_converter(PySequence_Fast_GET_ITEM(seq, i), c->devs[i].name)) {
+			Py_DECREF(seq);
+			Py_DECREF(c);
+			return NULL;
+		}
+		c->devs[i].level[DIM_RX] = c->devs[i].level[DIM_TX] = -1;
+	}
+	Py_DECREF(seq);
+	if (dim_parse_profiles(c, profiles) < 0) {
+		Py_DECREF(c);
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	c->ioctl_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (c->ioctl_fd < 0)
+		err = errno;
+	else
+		err = linkstats_open(&c->links);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		errno = err;
+		PyErr_SetFromErrno(PyExc_IOError);
+		Py_DECREF(c);
+		return NULL;
+	}
+	return (PyObject *)c;
+}
+
+static PyObject *dim_levels(const struct dim_dev *dev)
+{
+	return Py_BuildValue("(ii)", dev->level[DIM_RX], dev->level[DIM_TX]);
+}
+
+static PyObject *dim_step(PyCoalesceController *self, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "samples", "now", NULL };
+	PyObject *samples = NULL, *key, *value, *result, *levels;
+	uint64_t (*packets)[DIM_NR_DIRS] = NULL, now_ns;
+	struct dim_dev *devs = NULL;
+	int closed = 0;
+	unsigned long long rx, tx;
+	double now = -1;
+	char devname[IFNAMSIZ];
+	Py_ssize_t pos = 0;
+	char *given = NULL, *changed = NULL;
+	uint32_t i;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Od:step", kwlist, &samples, &now))
+		return NULL;
+	if (samples == Py_None)
+		samples = NULL;
+	if (samples && !PyDict_Check(samples)) {
+		PyErr_SetString(PyExc_TypeError,
+				"samples must map device names to (rx_packets, tx_packets)");
+		return NULL;
+	}
+	now_ns = now >= 0 ? (uint64_t)(now * 1e9) : clock_now_ns(CLOCK_MONOTONIC);
+
+	given = calloc(self->nr_devs + 1, 1);
+	changed = calloc(self->nr_devs + 1, 1);
+	packets = calloc(self->nr_devs + 1, sizeof(*packets));
+	devs = calloc(self->nr_devs + 1, sizeof(*devs));
+	if (!given || !changed || !packets || !devs) {
+		PyErr_NoMemory();
+		goto out;
+	}
+
+	while (samples && PyDict_Next(samples, &pos, &key, &value)) {
+		if (!devname_converter(key, devname))
+			goto out;
+		for (i = 0; i < self->nr_devs; i++) {
+			if (strcmp(self->devs[i].name, devname) == 0)
+				break;
+		}
+		if (i == self->nr_devs) {
+			PyErr_Format(PyExc_ValueError, "%s is not controlled", devname);
+			goto out;
+		}
+		if (!PyArg_ParseTuple(value, "KK:step", &rx, &tx))
+			goto out;
+		packets[i][DIM_RX] = rx;
+		packets[i][DIM_TX] = tx;
+		given[i] = 1;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	if (self->ioctl_fd < 0) {
+		closed = 1;
+	} else if (!samples) {
+		dim_sample(self, changed);
+	} else {
+		for (i = 0; i < self->nr_devs; i++) {
+			if (given[i])
+				changed[i] = dim_update(self, &self->devs[i], packets[i], now_ns);
+		}
+	}
+	memcpy(devs, self->devs, self->nr_devs * sizeof(*devs));
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	if (closed) {
+		errno = EBADF;
+		PyErr_SetFromErrno(PyExc_IOError);
+		goto out;
+	}
+
+	result = PyDict_New();
+	for (i = 0; result && i < self->nr_devs; i++) {
+		if (!changed[i])
+			continue;
+		key = PyBytes_FromString(devs[i].name);
+		levels = dim_levels(&devs[i]);
+		if (!key || !levels || PyDict_SetItem(result, key, levels) < 0)
+			Py_CLEAR(result);
+		Py_XDECREF(key);
+		Py_XDECREF(levels);
+	}
+	free(given);
+	free(changed);
+	free(packets);
+	free(devs);
+	return result;
+out:
+	free(given);
+	free(changed);
+	free(packets);
+	free(devs);
+	return NULL;
+}
+
+static PyObject *dim_dev_state(const struct dim_dev *dev)
+{
+	PyObject *dict = PyDict_New();
+
+	if (dict &&
+	    (dict_set_steal(dict, "rx_rate", PyFloat_FromDouble(dev->rate[DIM_RX])) ||
+	     dict_set_steal(dict, "tx_rate", PyFloat_FromDouble(dev->rate[DIM_TX])) ||
+	     dict_set_steal(dict, "rx_profile", PyLong_FromLong(dev->level[DIM_RX])) ||
+	     dict_set_steal(dict, "tx_profile", PyLong_FromLong(dev->level[DIM_TX])) ||
+	     dict_set_steal(dict, "changes", PyLong_FromUnsignedLongLong(dev->changes)) ||
+	     dict_set_steal(dict, "errors", PyLong_FromUnsignedLongLong(dev->errors)) ||
+	     dict_set_steal(dict, "last_error", PyLong_FromLong(dev->last_error))))
+		Py_CLEAR(dict);
+	return dict;
+}
+
+/*
+ * The lock is only ever taken without the GIL, and Python objects are only
+ * built from a copy of the devices once it is dropped again.
+ */
+static PyObject *dim_state(PyCoalesceController *self, PyObject *unused __unused)
+{
+	PyObject *result, *key, *state;
+	struct dim_dev *devs;
+	uint32_t i;
+
+	devs = calloc(self->nr_devs + 1, sizeof(*devs));
+	if (!devs)
+		return PyErr_NoMemory();
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	memcpy(devs, self->devs, self->nr_devs * sizeof(*devs));
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	result = PyDict_New();
+	for (i = 0; result && i < self->nr_devs; i++) {
+		key = PyBytes_FromString(devs[i].name);
+		state = dim_dev_state(&devs[i]);
+		if (!key || !state || PyDict_SetItem(result, key, state) < 0)
+			Py_CLEAR(result);
+		Py_XDECREF(key);
+		Py_XDECREF(state);
+	}
+	free(devs);
+	return result;
+}
+
+/**
+ * Renders one gauge per device and direction
+ */
+static void dim_render_dirs(PyCoalesceController *self, const char *name, const char *help,
+			    int what)
+{
+	struct metrics_out *o = &self->out;
+	const struct dim_dev *dev;
+	uint64_t v;
+	uint32_t i;
+	int d;
+
+	metrics_family(o, name, "gauge", help);
+	for (i = 0; i < self->nr_devs; i++) {
+		dev = &self->devs[i];
+		for (d = 0; d < DIM_NR_DIRS; d++) {
+			if (dev->level[d] < 0)
+				continue;
+			switch (what) {
+			case 0:
+				v = dev->level[d];
+				break;
+			case 1:
+				v = dev->rate[d];
+				break;
+			case 2:
+				v = self->profiles[dev->level[d]].usecs;
+				break;
+			default:
+				v = self->profiles[dev->level[d]].frames;
+				break;
+			}
+			metrics_sample(o, name, "", dev->name);
+			metrics_label(o, "direction", dim_dir_names[d], 3);
+			metrics_value(o, v);
+		}
+	}
+}
+
+static PyObject *dim_metrics(PyCoalesceController *self, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "prefix", NULL };
+	struct metrics_out *o = &self->out;
+	const char *prefix = "ethtool";
+	PyObject *result;
+	char *data = NULL;
+	size_t len = 0;
+	uint32_t i;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|s:metrics", kwlist, &prefix))
+		return NULL;
+	if (!metrics_valid_prefix(prefix)) {
+		PyErr_Format(PyExc_ValueError, "Invalid metric name prefix '%s'", prefix);
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	o->len = 0;
+	o->err = 0;
+	o->prefix = prefix;
+	dim_render_dirs(self, "coalesce_profile", "Coalescing profile chosen", 0);
+	dim_render_dirs(self, "coalesce_packet_rate", "Packets per second at the last sample", 1);
+	dim_render_dirs(self, "coalesce_target_usecs", "Coalescing usecs of the profile", 2);
+	dim_render_dirs(self, "coalesce_target_frames", "Coalescing frames of the profile", 3);
+	metrics_family(o, "coalesce_changes", "counter", "Coalescing profile changes applied");
+	for (i = 0; i < self->nr_devs; i++) {
+		metrics_sample(o, "coalesce_changes", "_total", self->devs[i].name);
+		metrics_value(o, self->devs[i].changes);
+	}
+	metrics_family(o, "coalesce_errors", "counter", "Failures to sample or apply");
+	for (i = 0; i < self->nr_devs; i++) {
+		metrics_sample(o, "coalesce_errors", "_total", self->devs[i].name);
+		metrics_value(o, self->devs[i].errors);
+	}
+	metrics_puts(o, "# EOF\n");
+	/* The buffer is reused by the next call, which may come from any thread */
+	if (!o->err && (data = malloc(o->len + 1)) != NULL) {
+		memcpy(data, o->data, o->len);
+		len = o->len;
+	}
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	if (!data)
+		return PyErr_NoMemory();
+	result = PyBytes_FromStringAndSize(data, len);
+	free(data);
+	return result;
+}
+
+static PyObject *dim_start(PyCoalesceController *self, PyObject *unused __unused)
+{
+	int err;
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->ctl);
+	if (self->ioctl_fd < 0)
+		err = EBADF;
+	else
+		err = worker_start(&self->worker, dim_thread, self);
+	pthread_mutex_unlock(&self->ctl);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		errno = err;
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+	Py_RETURN_NONE;
+}
+
+static PyObject *dim_stop_method(PyCoalesceController *self, PyObject *unused __unused)
+{
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->ctl);
+	dim_stop(self);
+	pthread_mutex_unlock(&self->ctl);
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *dim_close_method(PyCoalesceController *self, PyObject *unused __unused)
+{
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->ctl);
+	dim_close(self);
+	pthread_mutex_unlock(&self->ctl);
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *dim_get_profiles(PyCoalesceController *self, void *unused __unused)
+{
+	PyObject *tuple, *item;
+	uint32_t i;
+
+	tuple = PyTuple_New(self->nr_profiles);
+	for (i = 0; tuple && i < self->nr_profiles; i++) {
+		item = Py_BuildValue("(dII)", self->profiles[i].max_rate,
+				     self->profiles[i].usecs, self->profiles[i].frames);
+		if (!item)
+			Py_CLEAR(tuple);
+		else
+			PyTuple_SET_ITEM(tuple, i, item);
+	}
+	return tuple;
+}
+
+static PyObject *dim_get_running(PyCoalesceController *self, void *unused __unused)
+{
+	return PyBool_FromLong(self->worker.running);
+}
+
+static void dim_dealloc(PyCoalesceController *self)
+{
+	Py_BEGIN_ALLOW_THREADS
+	dim_close(self);
+	Py_END_ALLOW_THREADS
+	free(self->devs);
+	free(self->profiles);
+	free(self->out.data);
+	worker_destroy(&self->worker);
+	pthread_mutex_destroy(&self->lock);
+	pthread_mutex_destroy(&self->ctl);
+	PyObject_Del(self);
+}
+
+static PyMethodDef dim_methods[] = {
+	{"start", (PyCFunction)dim_start, METH_NOARGS,
+	 "Starts sampling the link counters every interval on a thread of its "
+	 "own, applying the profiles they call for."},
+	{"stop", (PyCFunction)dim_stop_method, METH_NOARGS,
+	 "Stops the controller thread.  The settings are left as they are."},
+	{"close", (PyCFunction)dim_close_method, METH_NOARGS,
+	 "Stops the controller for good."},
+	{"step", (PyCFunction)dim_step, METH_VARARGS | METH_KEYWORDS,
+	 "step(samples=None, now=None)\n\n"
+	 "Runs the controller once, on the link counters, or on the "
+	 "{device: (rx_packets, tx_packets)} counters of samples taken at "
+	 "'now' seconds, e.g. from a simulation.  Returns {device: (rx_profile, "
+	 "tx_profile)} for the devices whose profiles changed."},
+	{"state", (PyCFunction)dim_state, METH_NOARGS,
+	 "Returns {device: state} with the rates, profiles, number of changes "
+	 "and errors, and the errno of the last error of each device."},
+	{"metrics", (PyCFunction)dim_metrics, METH_VARARGS | METH_KEYWORDS,
+	 "metrics(prefix=\"ethtool\")\n\n"
+	 "Returns the decisions of the controller in the OpenMetrics text "
+	 "format."},
+	{NULL}
+};
+
+static PyGetSetDef dim_getset[] = {
+	{"profiles", (getter)dim_get_profiles, NULL,
+	 "The (max_rate, usecs, frames) profiles, from low latency to high "
+	 "throughput", NULL},
+	{"running", (getter)dim_get_running, NULL,
+	 "Whether the controller thread is running", NULL},
+	{NULL}
+};
+
+PyTypeObject PyCoalesceController_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.CoalesceController",
+	.tp_basicsize = sizeof(PyCoalesceController),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)dim_dealloc,
+	.tp_methods = dim_methods,
+	.tp_getset = dim_getset,
+	.tp_doc = "Adapts interrupt coalescing to packet rates, see "
+	"ethtool.coalesce_controller()"
+};
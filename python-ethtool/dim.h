@@ -0,0 +1,24 @@
+/* dim.h - Dynamic interrupt moderation from userspace
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _DIM_H
+#define _DIM_H
+
+#include <Python.h>
+
+extern PyTypeObject PyCoalesceController_Type;
+
+PyObject *dim_controller(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif
@@ -36,6 +36,12 @@
 #include <pthread.h>
 #include "etherinfo_struct.h"
 #include "etherinfo.h"
+#include "probes.h"
+#include "stats.h"
+
+/* Device name passed to the USDT probes */
+#define ETHERINFO_DEVNAME(self) \
+	((self) && (self)->device ? PyBytes_AS_STRING((self)->device) : "")
 
 /*
  *
@@ -115,18 +121,29 @@ static void callback_nl_address(struct nl_object *obj, void *arg)
  *
  * @return Returns 1 on success, otherwise 0.  On error, a Python error exception is set.
  */
-static int _set_device_index(PyEtherInfo *self)
+static int __set_device_index(PyEtherInfo *self)
 {
 	struct nl_cache *link_cache;
 	struct rtnl_link *link;
+	struct nl_sock *sock;
+	int index, err;
+
+	ETHERINFO_BEGIN_CRITICAL_SECTION(self);
+	index = self->index;
+	ETHERINFO_END_CRITICAL_SECTION();
 
 	/* Find the interface index we're looking up.
 	 * As we don't expect it to change, we're reusing a "cached"
 	 * interface index if we have that
 	 */
-	if( self->index < 0 ) {
-		if( (errno = rtnl_link_alloc_cache(get_nlc(), AF_UNSPEC, &link_cache)) < 0) {
-                        PyErr_SetString(PyExc_OSError, nl_geterror(errno));
+	if( index < 0 ) {
+		Py_BEGIN_ALLOW_THREADS
+		sock = lock_netlink(self);
+		err = rtnl_link_alloc_cache(sock, AF_UNSPEC, &link_cache);
+		unlock_netlink(self);
+		Py_END_ALLOW_THREADS
+		if( err < 0) {
+                        PyErr_SetString(PyExc_OSError, nl_geterror(err));
                         return 0;
                 }
 
@@ -138,20 +155,34 @@ static int _set_device_index(PyEtherInfo *self)
                         return 0;
                 }
 
-		self->index = rtnl_link_get_ifindex(link);
-		if( self->index <= 0 ) {
+		index = rtnl_link_get_ifindex(link);
+		rtnl_link_put(link);
+		nl_cache_free(link_cache);
+		if( index <= 0 ) {
 			errno = ENODEV;
 			PyErr_SetFromErrno(PyExc_IOError);
-			rtnl_link_put(link);
-			nl_cache_free(link_cache);
 			return 0;
 		}
-		rtnl_link_put(link);
-		nl_cache_free(link_cache);
+
+		ETHERINFO_BEGIN_CRITICAL_SECTION(self);
+		self->index = index;
+		ETHERINFO_END_CRITICAL_SECTION();
 	}
         return 1;
 }
 
+/* Instrumented in ethtool.stats() as "set_device_index" */
+static int _set_device_index(PyEtherInfo *self)
+{
+	struct stats_scope scope;
+	int ret;
+
+	stats_enter(&scope, STATS_SET_DEVICE_INDEX);
+	ret = __set_device_index(self);
+	stats_leave(&scope);
+	return ret;
+}
+
 
 /*
  *
@@ -166,16 +197,28 @@ static int _set_device_index(PyEtherInfo *self)
  *
  * @return Returns 1 on success, otherwise 0
  */
-int get_etherinfo_link(PyEtherInfo *self)
+static int __get_etherinfo_link(PyEtherInfo *self)
 {
 	struct nl_cache *link_cache;
 	struct rtnl_link *link;
+	struct nl_sock *sock;
 	int err = 0;
 
 	if( !self ) {
 		return 0;
 	}
 
+	/* callback_nl_link() never replaces a known hardware address, so
+	 * there is nothing left to query, e.g. for objects returned by
+	 * ethtool.iter_interfaces_info()
+	 */
+	ETHERINFO_BEGIN_CRITICAL_SECTION(self);
+	err = self->hwaddress != NULL;
+	ETHERINFO_END_CRITICAL_SECTION();
+	if( err ) {
+		return 1;
+	}
+
 	/* Open a NETLINK connection on-the-fly */
 	if( !open_netlink(self) ) {
 		PyErr_Format(PyExc_RuntimeError,
@@ -189,7 +232,12 @@ int get_etherinfo_link(PyEtherInfo *self)
         }
 
         /* Extract MAC/hardware address of the interface */
-        if( (err = rtnl_link_alloc_cache(get_nlc(), AF_UNSPEC, &link_cache)) < 0) {
+	Py_BEGIN_ALLOW_THREADS
+	sock = lock_netlink(self);
+	err = rtnl_link_alloc_cache(sock, AF_UNSPEC, &link_cache);
+	unlock_netlink(self);
+	Py_END_ALLOW_THREADS
+        if( err < 0) {
                 PyErr_SetString(PyExc_OSError, nl_geterror(err));
                 return 0;
         }
@@ -199,14 +247,31 @@ int get_etherinfo_link(PyEtherInfo *self)
                 PyErr_SetFromErrno(PyExc_OSError);
                 return 0;
         }
+        ETHERINFO_BEGIN_CRITICAL_SECTION(self);
         rtnl_link_set_ifindex(link, self->index);
         nl_cache_foreach_filter(link_cache, OBJ_CAST(link), callback_nl_link, self);
+        ETHERINFO_END_CRITICAL_SECTION();
         rtnl_link_put(link);
         nl_cache_free(link_cache);
 
         return 1;
 }
 
+/* Instrumented in ethtool.stats() as "get_etherinfo_link", traced by the
+ * etherinfo_link_entry/etherinfo_link_return probes */
+int get_etherinfo_link(PyEtherInfo *self)
+{
+	struct stats_scope scope;
+	int ret;
+
+	ETHTOOL_PROBE1(etherinfo_link_entry, ETHERINFO_DEVNAME(self));
+	stats_enter(&scope, STATS_ETHERINFO_LINK);
+	ret = __get_etherinfo_link(self);
+	stats_leave(&scope);
+	ETHTOOL_PROBE2(etherinfo_link_return, ETHERINFO_DEVNAME(self), ret);
+	return ret;
+}
+
 
 
 /**
@@ -219,10 +284,11 @@ int get_etherinfo_link(PyEtherInfo *self)
  *
  * @return Returns a Python list containing PyNetlinkIPaddress objects on success, otherwise NULL
  */
-PyObject * get_etherinfo_address(PyEtherInfo *self, nlQuery query)
+static PyObject *__get_etherinfo_address(PyEtherInfo *self, nlQuery query)
 {
 	struct nl_cache *addr_cache;
 	struct rtnl_addr *addr;
+	struct nl_sock *sock;
         PyObject *addrlist = NULL;
 	int err = 0;
 
@@ -230,6 +296,14 @@ PyObject * get_etherinfo_address(PyEtherInfo *self, nlQuery query)
 		return NULL;
 	}
 
+	/* Addresses fetched along with the link are never refreshed, hand
+	 * out copies as callers may modify the lists
+	 */
+	addrlist = query == NLQRY_ADDR4 ? self->ipv4_addresses : self->ipv6_addresses;
+	if( addrlist ) {
+		return PyList_GetSlice(addrlist, 0, PyList_GET_SIZE(addrlist));
+	}
+
 	/* Open a NETLINK connection on-the-fly */
 	if( !open_netlink(self) ) {
 		PyErr_Format(PyExc_RuntimeError,
@@ -245,9 +319,13 @@ PyObject * get_etherinfo_address(PyEtherInfo *self, nlQuery query)
 	/* Query the for requested info via NETLINK */
 
         /* Extract IP address information */
-        if( (err = rtnl_addr_alloc_cache(get_nlc(), &addr_cache)) < 0) {
+	Py_BEGIN_ALLOW_THREADS
+	sock = lock_netlink(self);
+	err = rtnl_addr_alloc_cache(sock, &addr_cache);
+	unlock_netlink(self);
+	Py_END_ALLOW_THREADS
+        if( err < 0) {
                 PyErr_SetString(PyExc_OSError, nl_geterror(err));
-                nl_cache_free(addr_cache);
                 return NULL;
         }
         addr = rtnl_addr_alloc();
@@ -256,7 +334,9 @@ PyObject * get_etherinfo_address(PyEtherInfo *self, nlQuery query)
                 PyErr_SetFromErrno(PyExc_OSError);
                 return NULL;
         }
+	ETHERINFO_BEGIN_CRITICAL_SECTION(self);
         rtnl_addr_set_ifindex(addr, self->index);
+	ETHERINFO_END_CRITICAL_SECTION();
 
 	switch( query ) {
         case NLQRY_ADDR4:
@@ -282,3 +362,19 @@ PyObject * get_etherinfo_address(PyEtherInfo *self, nlQuery query)
 
 	return addrlist;
 }
+
+/* Instrumented in ethtool.stats() as "get_etherinfo_address", traced by the
+ * etherinfo_address_entry/etherinfo_address_return probes */
+PyObject *get_etherinfo_address(PyEtherInfo *self, nlQuery query)
+{
+	struct stats_scope scope;
+	PyObject *ret;
+
+	ETHTOOL_PROBE2(etherinfo_address_entry, ETHERINFO_DEVNAME(self), query);
+	stats_enter(&scope, STATS_ETHERINFO_ADDRESS);
+	ret = __get_etherinfo_address(self, query);
+	stats_leave(&scope);
+	ETHTOOL_PROBE3(etherinfo_address_return, ETHERINFO_DEVNAME(self), query,
+		       ret ? PyList_GET_SIZE(ret) : -1);
+	return ret;
+}
@@ -22,8 +22,12 @@ typedef enum {NLQRY_ADDR4, NLQRY_ADDR6} nlQuery; /**<  Supported query types in
 int get_etherinfo_link(PyEtherInfo *data);
 PyObject * get_etherinfo_address(PyEtherInfo *self, nlQuery query);
 
+nlConnection *nlc_new(void);
+nlConnection *nlc_get(nlConnection *);
+void nlc_put(nlConnection *);
 int open_netlink(PyEtherInfo *);
-struct nl_sock * get_nlc();
+struct nl_sock * lock_netlink(PyEtherInfo *);
+void unlock_netlink(PyEtherInfo *);
 void close_netlink(PyEtherInfo *);
 
 #endif
@@ -0,0 +1,426 @@
+/* etherinfo_iter.c - Streams etherinfo objects from a single link dump
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * ethtool.iter_interfaces_info() keeps one RTM_GETLINK dump open and only
+ * reads the next buffer of it from the kernel once the interfaces of the
+ * previous one are consumed.  The addresses of each interface are then
+ * dumped on a second socket with the interface index as filter, which
+ * kernels with NETLINK_GET_STRICT_CHK honour, so every step only costs
+ * what one interface needs.  The memory in use thus does not depend on
+ * the number of interfaces, and the first ones are available long before
+ * the dump is complete.
+ */
+
+#include <Python.h>
+#include <bytesobject.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <linux/rtnetlink.h>
+#include <netlink/netlink.h>
+#include <netlink/errno.h>
+#include <netlink/msg.h>
+#include <netlink/socket.h>
+#include <netlink/route/addr.h>
+#include <netlink/route/link.h>
+
+#include "etherinfo_struct.h"
+#include "etherinfo.h"
+#include "etherinfo_obj.h"
+#include "backend.h"
+#include "stats.h"
+
+#ifndef NETLINK_GET_STRICT_CHK
+#define NETLINK_GET_STRICT_CHK 12
+#endif
+
+extern PyTypeObject PyEtherInfo_Type;
+
+/**
+ * The ethtool.InterfaceIterator object
+ */
+typedef struct {
+	PyObject_HEAD
+	pthread_mutex_t	  lock;		/**< Protects everything below */
+	nlConnection	  *nlc;		/**< Handed to the etherinfo objects */
+	struct nl_sock	  *link_sk;	/**< Socket the link dump is read from */
+	struct nl_sock	  *addr_sk;	/**< Socket for the address dumps */
+	int		  done;		/**< The link dump is complete */
+	struct nl_object  **links;	/**< Interfaces of the last buffer read */
+	unsigned int	  nr_links;
+	unsigned int	  next_link;
+	size_t		  links_size;
+	struct nl_object  **addrs;	/**< Addresses of the interface being built */
+	unsigned int	  nr_addrs;
+	size_t		  addrs_size;
+	int		  addr_ifindex;
+} PyEtherInfoIter;
+
+static void iter_free_links(PyEtherInfoIter *it)
+{
+	unsigned int i;
+
+	for (i = it->next_link; i < it->nr_links; i++)
+		nl_object_put(it->links[i]);
+	it->nr_links = it->next_link = 0;
+}
+
+static void iter_free_addrs(PyEtherInfoIter *it)
+{
+	unsigned int i;
+
+	for (i = 0; i < it->nr_addrs; i++)
+		nl_object_put(it->addrs[i]);
+	it->nr_addrs = 0;
+}
+
+static void iter_close(PyEtherInfoIter *it)
+{
+	iter_free_links(it);
+	iter_free_addrs(it);
+	if (it->link_sk) {
+		nl_close(it->link_sk);
+		nl_socket_free(it->link_sk);
+		it->link_sk = NULL;
+	}
+	if (it->addr_sk) {
+		nl_close(it->addr_sk);
+		nl_socket_free(it->addr_sk);
+		it->addr_sk = NULL;
+	}
+	it->done = 1;
+}
+
+/**
+ * Grows an array of pointers to hold one more
+ *
+ * @return Returns 0 on success, otherwise -NLE_NOMEM
+ */
+static int iter_grow(struct nl_object ***array, size_t *size, unsigned int count)
+{
+	struct nl_object **tmp;
+	size_t n = *size ? *size * 2 : 16;
+
+	if (count < *size)
+		return 0;
+	tmp = realloc(*array, n * sizeof(*tmp));
+	if (!tmp)
+		return -NLE_NOMEM;
+	*array = tmp;
+	*size = n;
+	return 0;
+}
+
+static void iter_parsed_link(struct nl_object *obj, void *arg)
+{
+	PyEtherInfoIter *it = arg;
+
+	if (iter_grow(&it->links, &it->links_size, it->nr_links) == 0) {
+		nl_object_get(obj);
+		it->links[it->nr_links++] = obj;
+	}
+}
+
+static void iter_parsed_addr(struct nl_object *obj, void *arg)
+{
+	PyEtherInfoIter *it = arg;
+	struct rtnl_addr *addr = (struct rtnl_addr *)obj;
+	int family = rtnl_addr_get_family(addr);
+
+	/* Kernels without strict checking dump the addresses of all links */
+	if (rtnl_addr_get_ifindex(addr) != it->addr_ifindex ||
+	    (family != AF_INET && family != AF_INET6))
+		return;
+	if (iter_grow(&it->addrs, &it->addrs_size, it->nr_addrs) == 0) {
+		nl_object_get(obj);
+		it->addrs[it->nr_addrs++] = obj;
+	}
+}
+
+static int iter_addr_msg(struct nl_msg *msg, void *arg)
+{
+	return nl_msg_parse(msg, iter_parsed_addr, arg) < 0 ? NL_SKIP : NL_OK;
+}
+
+/**
+ * Reads the next buffer of the link dump
+ *
+ * @return Returns 0 on success, otherwise a negative libnl error code
+ */
+static int iter_read_links(PyEtherInfoIter *it)
+{
+	struct sockaddr_nl nla;
+	struct nlmsghdr *hdr;
+	unsigned char *buf = NULL;
+	int len, err = 0;
+
+	iter_free_links(it);
+	len = backend_nl_recv(it->link_sk, &nla, &buf, NULL);
+	if (len <= 0) {
+		free(buf);
+		return len < 0 ? len : -NLE_AGAIN;
+	}
+
+	for (hdr = (struct nlmsghdr *)buf; nlmsg_ok(hdr, len); hdr = nlmsg_next(hdr, &len)) {
+		struct nl_msg *msg;
+
+		if (hdr->nlmsg_type == NLMSG_DONE) {
+			it->done = 1;
+			break;
+		}
+		if (hdr->nlmsg_type == NLMSG_ERROR) {
+			struct nlmsgerr *e = nlmsg_data(hdr);
+
+			err = e->error ? -nl_syserr2nlerr(e->error) : 0;
+			it->done = 1;
+			break;
+		}
+		if (hdr->nlmsg_type != RTM_NEWLINK)
+			continue;
+
+		msg = nlmsg_convert(hdr);
+		if (!msg) {
+			err = -NLE_NOMEM;
+			break;
+		}
+		nlmsg_set_proto(msg, NETLINK_ROUTE);
+		stats_nl_msg_in(msg, NULL);
+		err = nl_msg_parse(msg, iter_parsed_link, it);
+		nlmsg_free(msg);
+		if (err < 0)
+			break;
+		err = 0;
+	}
+	free(buf);
+	return err;
+}
+
+/**
+ * Dumps the IPv4 and IPv6 addresses of one interface into it->addrs
+ *
+ * @return Returns 0 on success, otherwise a negative libnl error code
+ */
+static int iter_read_addrs(PyEtherInfoIter *it, int ifindex)
+{
+	struct ifaddrmsg ifa;
+	int err;
+
+	iter_free_addrs(it);
+	it->addr_ifindex = ifindex;
+
+	memset(&ifa, 0, sizeof(ifa));
+	ifa.ifa_family = AF_UNSPEC;
+	ifa.ifa_index = ifindex;
+	if ((err = nl_send_simple(it->addr_sk, RTM_GETADDR, NLM_F_DUMP, &ifa, sizeof(ifa))) < 0)
+		return err;
+	err = nl_recvmsgs_default(it->addr_sk);
+	return err < 0 ? err : 0;
+}
+
+/**
+ * Connects both sockets and starts the link dump.  Does not need the GIL.
+ *
+ * @return Returns 0 on success, otherwise a negative libnl error code
+ */
+static int iter_start(PyEtherInfoIter *it)
+{
+	struct ifinfomsg ifi;
+	int one = 1, err;
+
+	it->link_sk = nl_socket_alloc();
+	it->addr_sk = nl_socket_alloc();
+	if (!it->link_sk || !it->addr_sk)
+		return -NLE_NOMEM;
+	if ((err = nl_connect(it->link_sk, NETLINK_ROUTE)) < 0 ||
+	    (err = nl_connect(it->addr_sk, NETLINK_ROUTE)) < 0)
+		return err;
+	backend_nl_setup(it->link_sk);
+	backend_nl_setup(it->addr_sk);
+
+	/* The link dump is parsed here, the addresses by nl_recvmsgs() */
+	nl_socket_disable_auto_ack(it->link_sk);
+	nl_socket_enable_msg_peek(it->link_sk);
+	nl_socket_modify_cb(it->addr_sk, NL_CB_VALID, NL_CB_CUSTOM, iter_addr_msg, it);
+	setsockopt(nl_socket_get_fd(it->addr_sk), SOL_NETLINK, NETLINK_GET_STRICT_CHK,
+		   &one, sizeof(one));
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	return nl_send_simple(it->link_sk, RTM_GETLINK, NLM_F_DUMP, &ifi, sizeof(ifi));
+}
+
+/**
+ * ethtool.iter_interfaces_info()
+ *
+ * @param nlc NETLINK connection of the module, for the etherinfo objects
+ *
+ * @return Returns a new ethtool.InterfaceIterator, or NULL with a Python
+ *         exception set.
+ */
+PyObject *etherinfo_iter_new(nlConnection *nlc)
+{
+	PyEtherInfoIter *it;
+	int err;
+
+	it = PyObject_New(PyEtherInfoIter, &PyEtherInfoIter_Type);
+	if (!it)
+		return NULL;
+	pthread_mutex_init(&it->lock, NULL);
+	it->nlc = nlc_get(nlc);
+	it->link_sk = it->addr_sk = NULL;
+	it->done = 0;
+	it->links = NULL;
+	it->nr_links = it->next_link = 0;
+	it->links_size = 0;
+	it->addrs = NULL;
+	it->nr_addrs = 0;
+	it->addrs_size = 0;
+	it->addr_ifindex = 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	err = iter_start(it);
+	if (err < 0)
+		iter_close(it);
+	Py_END_ALLOW_THREADS
+
+	if (err < 0) {
+		PyErr_SetString(PyExc_OSError, nl_geterror(err));
+		Py_DECREF(it);
+		return NULL;
+	}
+	return (PyObject *)it;
+}
+
+static PyObject *iter_address_list(struct nl_object **addrs, unsigned int nr, int family)
+{
+	PyObject *list = PyList_New(0);
+	unsigned int i;
+
+	for (i = 0; list && i < nr; i++) {
+		struct rtnl_addr *rtaddr = (struct rtnl_addr *)addrs[i];
+		PyObject *addr;
+
+		if (rtnl_addr_get_family(rtaddr) != family)
+			continue;
+		addr = make_python_address_from_rtnl_addr(rtaddr);
+		if (!addr || PyList_Append(list, addr) < 0) {
+			Py_XDECREF(addr);
+			Py_CLEAR(list);
+			break;
+		}
+		Py_DECREF(addr);
+	}
+	return list;
+}
+
+/**
+ * Builds the etherinfo object of an interface with its addresses
+ */
+static PyObject *iter_etherinfo(PyEtherInfoIter *self, struct rtnl_link *link,
+				struct nl_object **addrs, unsigned int nr_addrs)
+{
+	PyEtherInfo *dev;
+	const char *name = rtnl_link_get_name(link);
+	char hwaddr[130];
+
+	dev = PyObject_New(PyEtherInfo, &PyEtherInfo_Type);
+	if (!dev)
+		return NULL;
+	memset(hwaddr, 0, sizeof(hwaddr));
+	nl_addr2str(rtnl_link_get_addr(link), hwaddr, sizeof(hwaddr));
+
+	dev->device = PyBytes_FromString(name ? name : "");
+	dev->index = rtnl_link_get_ifindex(link);
+	dev->hwaddress = PyBytes_FromString(hwaddr);
+	dev->nlc_active = 0;
+	dev->nlc = nlc_get(self->nlc);
+	dev->ipv4_addresses = iter_address_list(addrs, nr_addrs, AF_INET);
+	dev->ipv6_addresses = iter_address_list(addrs, nr_addrs, AF_INET6);
+	if (!dev->device || !dev->hwaddress || !dev->ipv4_addresses || !dev->ipv6_addresses) {
+		Py_DECREF(dev);
+		return NULL;
+	}
+	return (PyObject *)dev;
+}
+
+static PyObject *iter_next(PyEtherInfoIter *self)
+{
+	struct rtnl_link *link = NULL;
+	struct nl_object **addrs = NULL;
+	struct stats_scope scope;
+	unsigned int nr_addrs = 0;
+	PyObject *dev;
+	int err = 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	stats_enter(&scope, STATS_ITER_INTERFACES);
+	while (!err && self->next_link == self->nr_links && !self->done)
+		err = iter_read_links(self);
+	if (!err && self->next_link < self->nr_links) {
+		link = (struct rtnl_link *)self->links[self->next_link++];
+		err = iter_read_addrs(self, rtnl_link_get_ifindex(link));
+		/* Take over the addresses, the lock is dropped before using them */
+		addrs = self->addrs;
+		nr_addrs = self->nr_addrs;
+		self->addrs = NULL;
+		self->nr_addrs = 0;
+		self->addrs_size = 0;
+	}
+	if (err || !link)
+		iter_close(self);
+	stats_leave(&scope);
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	dev = NULL;
+	if (err < 0)
+		PyErr_SetString(PyExc_OSError, nl_geterror(err));
+	else if (link)
+		dev = iter_etherinfo(self, link, addrs, nr_addrs);
+
+	/* Nothing left without an exception set ends the iteration */
+	if (link)
+		rtnl_link_put(link);
+	while (nr_addrs)
+		nl_object_put(addrs[--nr_addrs]);
+	free(addrs);
+	return dev;
+}
+
+static void iter_dealloc(PyEtherInfoIter *self)
+{
+	iter_close(self);
+	free(self->links);
+	free(self->addrs);
+	nlc_put(self->nlc);
+	pthread_mutex_destroy(&self->lock);
+	PyObject_Del(self);
+}
+
+PyTypeObject PyEtherInfoIter_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.InterfaceIterator",
+	.tp_basicsize = sizeof(PyEtherInfoIter),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)iter_dealloc,
+	.tp_iter = PyObject_SelfIter,
+	.tp_iternext = (iternextfunc)iter_next,
+	.tp_doc = "Iterator over the etherinfo objects of all interfaces, see "
+	"ethtool.iter_interfaces_info()"
+};
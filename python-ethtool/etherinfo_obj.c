@@ -40,8 +40,11 @@
 static void _ethtool_etherinfo_dealloc(PyEtherInfo *self)
 {
 	close_netlink(self);
+	nlc_put(self->nlc);          self->nlc = NULL;
         Py_XDECREF(self->device);    self->device = NULL;
         Py_XDECREF(self->hwaddress); self->hwaddress = NULL;
+	Py_XDECREF(self->ipv4_addresses); self->ipv4_addresses = NULL;
+	Py_XDECREF(self->ipv6_addresses); self->ipv6_addresses = NULL;
 	Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
@@ -86,7 +89,7 @@ static PyNetlinkIPaddress * get_last_ipv4_address(PyObject *addrlist)
  */
 PyObject *_ethtool_etherinfo_str(PyEtherInfo *self)
 {
-	PyObject *ret = NULL;
+	PyObject *ret = NULL, *hwaddress;
         PyObject *ipv4addrs = NULL, *ipv6addrs = NULL;
 
 	if( !self ) {
@@ -100,9 +103,13 @@ PyObject *_ethtool_etherinfo_str(PyEtherInfo *self)
 	PyBytes_Concat(&ret, self->device);
 	PyBytes_ConcatAndDel(&ret, PyBytes_FromString(":\n"));
 
-	if( self->hwaddress ) {
+	ETHERINFO_BEGIN_CRITICAL_SECTION(self);
+	hwaddress = self->hwaddress;
+	Py_XINCREF(hwaddress);
+	ETHERINFO_END_CRITICAL_SECTION();
+	if( hwaddress ) {
 		PyBytes_ConcatAndDel(&ret, PyBytes_FromString("\tMAC address: "));
-		PyBytes_Concat(&ret, self->hwaddress);
+		PyBytes_ConcatAndDel(&ret, hwaddress);
 		PyBytes_ConcatAndDel(&ret, PyBytes_FromString("\n"));
 	}
 
@@ -212,12 +219,14 @@ static PyObject *get_device(PyObject *obj, void *info)
 static PyObject *get_mac_addr(PyObject *obj, void *info)
 {
 	PyEtherInfo *self = (PyEtherInfo *) obj;
+	PyObject *hwaddress;
 
 	get_etherinfo_link(self);
-	if( self->hwaddress ) {
-		Py_INCREF(self->hwaddress);
-	}
-	return self->hwaddress;
+	ETHERINFO_BEGIN_CRITICAL_SECTION(self);
+	hwaddress = self->hwaddress;
+	Py_XINCREF(hwaddress);
+	ETHERINFO_END_CRITICAL_SECTION();
+	return hwaddress;
 }
 
 static PyObject *get_ipv4_addr(PyObject *obj, void *info)
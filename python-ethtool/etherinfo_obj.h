@@ -35,4 +35,7 @@ PyObject *_ethtool_etherinfo_getter(PyEtherInfo *, PyObject *);
 int _ethtool_etherinfo_setter(PyEtherInfo *, PyObject *, PyObject *);
 PyObject *_ethtool_etherinfo_str(PyEtherInfo *self);
 
+extern PyTypeObject PyEtherInfoIter_Type;
+PyObject *etherinfo_iter_new(nlConnection *nlc);
+
 #endif
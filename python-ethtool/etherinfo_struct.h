@@ -26,8 +26,21 @@
 #ifndef _ETHERINFO_STRUCT_H
 #define _ETHERINFO_STRUCT_H
 
+#include <pthread.h>
 #include <netlink/route/addr.h>
 
+/**
+ * A NETLINK connection shared by all ethtool.etherinfo objects created by
+ * one instance of the ethtool module.  The socket is opened on demand and
+ * closed again once no object uses it any more.
+ */
+typedef struct {
+	pthread_mutex_t lock;		/**< Protects all members and the use of sock */
+	struct nl_sock *sock;		/**< NETLINK socket, NULL when not connected */
+	unsigned int users;		/**< Number of objects using sock */
+	unsigned int refcnt;		/**< Module state + objects referencing this */
+} nlConnection;
+
 /* Python object containing data baked from a (struct rtnl_addr) */
 typedef struct PyNetlinkIPaddress {
 	PyObject_HEAD
@@ -50,8 +63,22 @@ typedef struct {
 	int index;                          /**< NETLINK index reference */
 	PyObject *hwaddress;                /**< string: HW address / MAC address of device */
 	unsigned short nlc_active;	    /**< Is this instance using NETLINK? */
+	nlConnection *nlc;                  /**< NETLINK connection of the owning module */
+	PyObject *ipv4_addresses;           /**< list: Addresses fetched along with the link, or NULL */
+	PyObject *ipv6_addresses;           /**< list: Addresses fetched along with the link, or NULL */
 } PyEtherInfo;
 
+/* The lazily filled in members of PyEtherInfo may be updated by several
+ * threads at once when running without the GIL.
+ */
+#ifdef Py_GIL_DISABLED
+#define ETHERINFO_BEGIN_CRITICAL_SECTION(obj) Py_BEGIN_CRITICAL_SECTION(obj)
+#define ETHERINFO_END_CRITICAL_SECTION() Py_END_CRITICAL_SECTION()
+#else
+#define ETHERINFO_BEGIN_CRITICAL_SECTION(obj) {
+#define ETHERINFO_END_CRITICAL_SECTION() }
+#endif
+
 
 
 PyObject * make_python_address_from_rtnl_addr(struct rtnl_addr *addr);
@@ -12,6 +12,8 @@
 #ifndef _LINUX_ETHTOOL_H
 #define _LINUX_ETHTOOL_H
 
+#include <linux/if_ether.h>
+
 #ifndef __unused
 #define __unused __attribute__ ((unused))
 #endif
@@ -27,9 +29,36 @@ struct ethtool_cmd {
 	u8	phy_address;
 	u8	transceiver;	/* Which tranceiver to use */
 	u8	autoneg;	/* Enable or disable autonegotiation */
+	u8	mdio_support;
 	u32	maxtxpkt;	/* Tx pkts before generating tx int */
 	u32	maxrxpkt;	/* Rx pkts before generating rx int */
-	u32	reserved[4];
+	u16	speed_hi;	/* The high 16 bits of the speed */
+	u8	eth_tp_mdix;
+	u8	eth_tp_mdix_ctrl;
+	u32	lp_advertising;	/* Features the link partner advertises */
+	u32	reserved[2];
+};
+
+/* for ETHTOOL_{G,S}LINKSETTINGS, followed by the supported, advertising
+ * and lp_advertising link mode masks of link_mode_masks_nwords u32 each
+ */
+struct ethtool_link_settings {
+	u32	cmd;
+	u32	speed;
+	u8	duplex;
+	u8	port;
+	u8	phy_address;
+	u8	autoneg;
+	u8	mdio_support;
+	u8	eth_tp_mdix;
+	u8	eth_tp_mdix_ctrl;
+	s8	link_mode_masks_nwords;
+	u8	transceiver;
+	u8	master_slave_cfg;
+	u8	master_slave_state;
+	u8	rate_matching;
+	u32	reserved[7];
+	u32	link_mode_masks[0];
 };
 
 #define ETHTOOL_BUSINFO_LEN	32
@@ -42,7 +71,8 @@ struct ethtool_drvinfo {
 	char	bus_info[ETHTOOL_BUSINFO_LEN];	/* Bus info for this IF. */
 				/* For PCI devices, use pci_dev->slot_name. */
 	char	reserved1[32];
-	char	reserved2[16];
+	char	reserved2[12];
+	u32	n_priv_flags;	/* number of flags valid in ETHTOOL_GPFLAGS */
 	u32	n_stats;	/* number of u64's from ETHTOOL_GSTATS */
 	u32	testinfo_len;
 	u32	eedump_len;	/* Size of data from ETHTOOL_GEEPROM (bytes) */
@@ -218,10 +248,37 @@ struct ethtool_pauseparam {
 	u32	tx_pause;
 };
 
+/* for configuring Energy Efficient Ethernet (IEEE 802.3az) */
+struct ethtool_eee {
+	u32	cmd;		/* ETHTOOL_{G,S}EEE */
+	u32	supported;	/* Link modes EEE is supported on */
+	u32	advertised;	/* Link modes EEE is advertised on */
+	u32	lp_advertised;	/* Link modes the link partner advertises */
+	u32	eee_active;	/* Both ends advertise EEE at the link speed */
+	u32	eee_enabled;	/* EEE is advertised */
+	u32	tx_lpi_enabled;	/* Low Power Idle is asserted on transmit */
+	u32	tx_lpi_timer;	/* Microseconds before asserting it */
+	u32	reserved[2];
+};
+
+/* for ETHTOOL_GET_TS_INFO, the masks are bits of SOF_TIMESTAMPING_*,
+ * HWTSTAMP_TX_* and HWTSTAMP_FILTER_*
+ */
+struct ethtool_ts_info {
+	u32	cmd;
+	u32	so_timestamping;
+	s32	phc_index;	/* Of the PTP hardware clock, or -1 */
+	u32	tx_types;
+	u32	tx_reserved[3];
+	u32	rx_filters;
+	u32	rx_reserved[3];
+};
+
 #define ETH_GSTRING_LEN		32
 enum ethtool_stringset {
 	ETH_SS_TEST		= 0,
 	ETH_SS_STATS,
+	ETH_SS_PRIV_FLAGS,
 };
 
 /* for passing string sets for data tagging */
@@ -232,6 +289,36 @@ struct ethtool_gstrings {
 	u8	data[0];
 };
 
+enum tunable_id {
+	ETHTOOL_ID_UNSPEC,
+	ETHTOOL_RX_COPYBREAK,
+	ETHTOOL_TX_COPYBREAK,
+	ETHTOOL_PFC_PREVENTION_TOUT,	/* timeout in msecs */
+	ETHTOOL_TX_COPYBREAK_BUF_SIZE,
+};
+
+enum tunable_type_id {
+	ETHTOOL_TUNABLE_UNSPEC,
+	ETHTOOL_TUNABLE_U8,
+	ETHTOOL_TUNABLE_U16,
+	ETHTOOL_TUNABLE_U32,
+	ETHTOOL_TUNABLE_U64,
+	ETHTOOL_TUNABLE_STRING,
+	ETHTOOL_TUNABLE_S8,
+	ETHTOOL_TUNABLE_S16,
+	ETHTOOL_TUNABLE_S32,
+	ETHTOOL_TUNABLE_S64,
+};
+
+/* for ETHTOOL_{G,S}TUNABLE, len bytes of data follow */
+struct ethtool_tunable {
+	u32	cmd;
+	u32	id;
+	u32	type_id;
+	u32	len;
+	void	*data[0];
+};
+
 enum ethtool_test_flags {
 	ETH_TEST_FL_OFFLINE	= (1 << 0),	/* online / offline */
 	ETH_TEST_FL_FAILED	= (1 << 1),	/* test passed / failed */
@@ -253,6 +340,112 @@ struct ethtool_stats {
 	u64	data[0];
 };
 
+/* Specs of RX network flow classification rules.  The address, port and
+ * SPI fields are in network byte order.
+ */
+struct ethtool_tcpip4_spec {
+	u32	ip4src;
+	u32	ip4dst;
+	u16	psrc;
+	u16	pdst;
+	u8	tos;
+};
+
+struct ethtool_ah_espip4_spec {
+	u32	ip4src;
+	u32	ip4dst;
+	u32	spi;
+	u8	tos;
+};
+
+#define	ETH_RX_NFC_IP4	1
+
+struct ethtool_usrip4_spec {
+	u32	ip4src;
+	u32	ip4dst;
+	u32	l4_4_bytes;
+	u8	tos;
+	u8	ip_ver;		/* ETH_RX_NFC_IP4 */
+	u8	proto;
+};
+
+struct ethtool_tcpip6_spec {
+	u32	ip6src[4];
+	u32	ip6dst[4];
+	u16	psrc;
+	u16	pdst;
+	u8	tclass;
+};
+
+struct ethtool_ah_espip6_spec {
+	u32	ip6src[4];
+	u32	ip6dst[4];
+	u32	spi;
+	u8	tclass;
+};
+
+struct ethtool_usrip6_spec {
+	u32	ip6src[4];
+	u32	ip6dst[4];
+	u32	l4_4_bytes;
+	u8	tclass;
+	u8	l4_proto;
+};
+
+union ethtool_flow_union {
+	struct ethtool_tcpip4_spec	tcp_ip4_spec;
+	struct ethtool_tcpip4_spec	udp_ip4_spec;
+	struct ethtool_tcpip4_spec	sctp_ip4_spec;
+	struct ethtool_ah_espip4_spec	ah_ip4_spec;
+	struct ethtool_ah_espip4_spec	esp_ip4_spec;
+	struct ethtool_usrip4_spec	usr_ip4_spec;
+	struct ethtool_tcpip6_spec	tcp_ip6_spec;
+	struct ethtool_tcpip6_spec	udp_ip6_spec;
+	struct ethtool_tcpip6_spec	sctp_ip6_spec;
+	struct ethtool_ah_espip6_spec	ah_ip6_spec;
+	struct ethtool_ah_espip6_spec	esp_ip6_spec;
+	struct ethtool_usrip6_spec	usr_ip6_spec;
+	struct ethhdr			ether_spec;
+	u8				hdata[52];
+};
+
+/* Additional fields, with FLOW_EXT and FLOW_MAC_EXT */
+struct ethtool_flow_ext {
+	u8	padding[2];
+	u8	h_dest[ETH_ALEN];
+	u16	vlan_etype;
+	u16	vlan_tci;
+	u32	data[2];
+};
+
+/* An RX classification rule, with masks whose set bits are compared */
+struct ethtool_rx_flow_spec {
+	u32				flow_type;
+	union ethtool_flow_union	h_u;
+	struct ethtool_flow_ext		h_ext;
+	union ethtool_flow_union	m_u;
+	struct ethtool_flow_ext		m_ext;
+	u64				ring_cookie;
+	u32				location;
+};
+
+#define ETHTOOL_RX_FLOW_SPEC_RING	0x00000000FFFFFFFFLL
+#define ETHTOOL_RX_FLOW_SPEC_RING_VF	0x000000FF00000000LL
+#define ETHTOOL_RX_FLOW_SPEC_RING_VF_OFF 32
+
+/* for ETHTOOL_{G,S}RX* commands */
+struct ethtool_rxnfc {
+	u32				cmd;
+	u32				flow_type;
+	u64				data;
+	struct ethtool_rx_flow_spec	fs;
+	union {
+		u32			rule_cnt;
+		u32			rss_context;
+	};
+	u32				rule_locs[0];
+};
+
 /* CMDs currently supported */
 #define ETHTOOL_GSET		0x00000001 /* Get settings. */
 #define ETHTOOL_SSET		0x00000002 /* Set settings, privileged. */
@@ -290,6 +483,32 @@ struct ethtool_stats {
 #define ETHTOOL_SUFO		0x00000022 /* Set UFO enable (ethtool_value) */
 #define ETHTOOL_GGSO		0x00000023 /* Get GSO enable (ethtool_value) */
 #define ETHTOOL_SGSO		0x00000024 /* Set GSO enable (ethtool_value) */
+#define ETHTOOL_GFLAGS		0x00000025 /* Get flags bitmap(ethtool_value) */
+#define ETHTOOL_SFLAGS		0x00000026 /* Set flags bitmap(ethtool_value) */
+#define ETHTOOL_GPFLAGS		0x00000027 /* Get driver-private flags bitmap */
+#define ETHTOOL_SPFLAGS		0x00000028 /* Set driver-private flags bitmap */
+#define ETHTOOL_GGRO		0x0000002b /* Get GRO enable (ethtool_value) */
+#define ETHTOOL_SGRO		0x0000002c /* Set GRO enable (ethtool_value) */
+#define ETHTOOL_GRXRINGS	0x0000002d /* Get RX rings available for LB */
+#define ETHTOOL_GRXCLSRLCNT	0x0000002e /* Get RX class rule count */
+#define ETHTOOL_GRXCLSRULE	0x0000002f /* Get RX classification rule */
+#define ETHTOOL_GRXCLSRLALL	0x00000030 /* Get all RX classification rule */
+#define ETHTOOL_SRXCLSRLDEL	0x00000031 /* Delete RX classification rule */
+#define ETHTOOL_SRXCLSRLINS	0x00000032 /* Insert RX classification rule */
+#define ETHTOOL_GET_TS_INFO	0x00000041 /* Get time stamping and PHC info */
+#define ETHTOOL_GEEE		0x00000044 /* Get EEE settings */
+#define ETHTOOL_SEEE		0x00000045 /* Set EEE settings */
+#define ETHTOOL_GTUNABLE	0x00000048 /* Get tunable configuration */
+#define ETHTOOL_STUNABLE	0x00000049 /* Set tunable configuration */
+#define ETHTOOL_GLINKSETTINGS	0x0000004c /* Get ethtool_link_settings */
+#define ETHTOOL_SLINKSETTINGS	0x0000004d /* Set ethtool_link_settings */
+
+/* ETHTOOL_{G,S}FLAGS bits */
+#define ETH_FLAG_TXVLAN		(1 << 7)	/* TX VLAN offload enabled */
+#define ETH_FLAG_RXVLAN		(1 << 8)	/* RX VLAN offload enabled */
+#define ETH_FLAG_LRO		(1 << 15)	/* LRO is enabled */
+#define ETH_FLAG_NTUPLE		(1 << 27)
+#define ETH_FLAG_RXHASH		(1 << 28)
 
 /* compatibility with older code */
 #define SPARC_ETH_GSET		ETHTOOL_GSET
@@ -337,9 +556,12 @@ struct ethtool_stats {
 #define SPEED_1000		1000
 #define SPEED_10000		10000
 
+#define SPEED_UNKNOWN		-1
+
 /* Duplex, half or full. */
 #define DUPLEX_HALF		0x00
 #define DUPLEX_FULL		0x01
+#define DUPLEX_UNKNOWN		0xff
 
 /* Which connector port. */
 #define PORT_TP			0x00
@@ -370,4 +592,38 @@ struct ethtool_stats {
 #define WAKE_MAGIC		(1 << 5)
 #define WAKE_MAGICSECURE	(1 << 6) /* only meaningful if WAKE_MAGIC */
 
+/* L2-L4 network traffic flow types */
+#define	TCP_V4_FLOW	0x01	/* hash or spec (tcp_ip4_spec) */
+#define	UDP_V4_FLOW	0x02	/* hash or spec (udp_ip4_spec) */
+#define	SCTP_V4_FLOW	0x03	/* hash or spec (sctp_ip4_spec) */
+#define	AH_ESP_V4_FLOW	0x04	/* hash only */
+#define	TCP_V6_FLOW	0x05	/* hash or spec (tcp_ip6_spec; nfc only) */
+#define	UDP_V6_FLOW	0x06	/* hash or spec (udp_ip6_spec; nfc only) */
+#define	SCTP_V6_FLOW	0x07	/* hash or spec (sctp_ip6_spec; nfc only) */
+#define	AH_ESP_V6_FLOW	0x08	/* hash only */
+#define	AH_V4_FLOW	0x09	/* hash or spec (ah_ip4_spec) */
+#define	ESP_V4_FLOW	0x0a	/* hash or spec (esp_ip4_spec) */
+#define	AH_V6_FLOW	0x0b	/* hash or spec (ah_ip6_spec; nfc only) */
+#define	ESP_V6_FLOW	0x0c	/* hash or spec (esp_ip6_spec; nfc only) */
+#define	IPV4_USER_FLOW	0x0d	/* spec only (usr_ip4_spec) */
+#define	IP_USER_FLOW	IPV4_USER_FLOW
+#define	IPV6_USER_FLOW	0x0e	/* spec only (usr_ip6_spec; nfc only) */
+#define	IPV4_FLOW	0x10	/* hash only */
+#define	IPV6_FLOW	0x11	/* hash only */
+#define	ETHER_FLOW	0x12	/* spec only (ether_spec) */
+/* Flag to enable additional fields in struct ethtool_rx_flow_spec */
+#define	FLOW_EXT	0x80000000
+#define	FLOW_MAC_EXT	0x40000000
+/* Flag to enable RSS spreading of traffic matching rule (nfc only) */
+#define	FLOW_RSS	0x20000000
+
+/* Special RX classification rule insert location values */
+#define RX_CLS_FLOW_DISC	0xffffffffffffffffULL
+#define RX_CLS_FLOW_WAKE	0xfffffffffffffffeULL
+
+#define RX_CLS_LOC_SPECIAL	0x80000000	/* flag */
+#define RX_CLS_LOC_ANY		0xffffffff
+#define RX_CLS_LOC_FIRST	0xfffffffe
+#define RX_CLS_LOC_LAST		0xfffffffd
+
 #endif /* _LINUX_ETHTOOL_H */
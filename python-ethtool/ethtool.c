@@ -26,7 +26,6 @@
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
-#include <ifaddrs.h>
 #include <netlink/route/addr.h>
 #include <net/if.h>
 
@@ -40,65 +39,188 @@ extern PyTypeObject PyEtherInfo_Type;
 #define IFF_DYNAMIC     0x8000          /* dialup device with changing addresses*/
 #endif
 
-typedef unsigned long long u64;
-typedef __uint32_t u32;
-typedef __uint16_t u16;
-typedef __uint8_t u8;
-
-#include "ethtool-copy.h"
+#include "ethtool.h"
+#include "parallel.h"
+#include "backend.h"
+#include "probes.h"
+#include "shm.h"
+#include "metrics.h"
+#include "recorder.h"
+#include "dim.h"
+#include "rings.h"
+#include "steering.h"
+#include "irq.h"
+#include "topology.h"
+#include "napi.h"
+#include "netdev.h"
+#include "flow.h"
+#include "tunables.h"
+#include "linksettings.h"
+#include "pause.h"
+#include "snapshot.h"
+#include "stats.h"
 #include <linux/sockios.h> /* for SIOCETHTOOL */
-
-#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+#include <linux/net_tstamp.h>
 
 #define _PATH_PROCNET_DEV "/proc/net/dev"
 
-static PyObject *get_active_devices(PyObject *self __unused, PyObject *args __unused)
+/**
+ * State of one instance of the ethtool module
+ */
+typedef struct {
+	nlConnection *nlc;	/**< NETLINK connection shared by its etherinfo objects */
+	int ioctl_fd;		/**< AF_INET control socket for ioctls, -1 until first used */
+} ethtoolState;
+
+#if PY_MAJOR_VERSION >= 3
+#define get_ethtool_state(module) ((ethtoolState *)PyModule_GetState(module))
+#else
+/* Python 2 modules only exist once per process */
+static ethtoolState ethtool_state;
+#define get_ethtool_state(module) (&ethtool_state)
+#endif
+
+/* The module functions receive their positional arguments as a C array.
+ * Python 3.7 and later pass it directly (METH_FASTCALL), older versions
+ * pass a tuple which FASTCALL_PROLOGUE unpacks.
+ */
+#if PY_VERSION_HEX >= 0x03070000
+#define METH_ETH_FASTCALL METH_FASTCALL
+#define FASTCALL_ARGS PyObject *const *args, Py_ssize_t nargs
+#define FASTCALL_PROLOGUE
+#else
+#define METH_ETH_FASTCALL METH_VARARGS
+#define FASTCALL_ARGS PyObject *argtuple
+#define FASTCALL_PROLOGUE \
+	PyObject *const *args = &PyTuple_GET_ITEM(argtuple, 0); \
+	Py_ssize_t nargs = PyTuple_GET_SIZE(argtuple);
+#endif
+
+static int check_nargs(const char *fname, Py_ssize_t nargs, Py_ssize_t expected)
+{
+	if (nargs == expected)
+		return 0;
+
+	PyErr_Format(PyExc_TypeError, "%s() takes exactly %zd argument%s (%zd given)",
+		     fname, expected, expected == 1 ? "" : "s", nargs);
+	return -1;
+}
+
+/**
+ * Parses the arguments of a function taking a device name as its first argument
+ *
+ * @param fname    Python name of the function, for error messages
+ * @param args     Positional arguments
+ * @param nargs    Number of positional arguments
+ * @param expected Number of arguments the function takes
+ * @param devname  char[IFNAMSIZ] buffer receiving the device name
+ *
+ * @return Returns 0 on success, otherwise -1 with a Python exception set.
+ */
+static int parse_devname_args(const char *fname, PyObject *const *args, Py_ssize_t nargs,
+			      Py_ssize_t expected, char *devname)
+{
+	if (check_nargs(fname, nargs, expected) < 0)
+		return -1;
+
+	return devname_converter(args[0], devname) ? 0 : -1;
+}
+
+/**
+ * Returns the control socket used for the ioctl() calls of a module instance.
+ * The socket is created on first use and shared by all threads.
+ *
+ * @param module The ethtool module
+ *
+ * @return Returns the socket, or -1 with a Python exception set.
+ */
+static int get_ioctl_fd(PyObject *module)
+{
+	ethtoolState *state = get_ethtool_state(module);
+	int fd, expected = -1;
+
+	fd = __atomic_load_n(&state->ioctl_fd, __ATOMIC_ACQUIRE);
+	if (fd >= 0)
+		return fd;
+
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		PyErr_SetFromErrno(PyExc_OSError);
+		return -1;
+	}
+
+	/* Another thread may have been quicker */
+	if (!__atomic_compare_exchange_n(&state->ioctl_fd, &expected, fd, 0,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		fd = expected;
+	}
+	return fd;
+}
+
+/* Arguments are accepted and ignored, as they always were */
+static PyObject *get_active_devices(PyObject *self __unused, FASTCALL_ARGS)
 {
 	PyObject *list;
-	struct ifaddrs *ifaddr, *ifa;
+	struct backend_ifaddr *ifaddr;
+	int i, count, err;
 
-	if (getifaddrs(&ifaddr) == -1)
+	err = backend_list_ifaddrs(&ifaddr, &count);
+	if (err) {
+		errno = err;
 		return PyErr_SetFromErrno(PyExc_OSError);
+	}
 
 	list = PyList_New(0);
-	for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
-		PyObject *str = PyBytes_FromString(ifa->ifa_name);
+	for (i = 0; i < count; i++) {
+		PyObject *str = PyBytes_FromString(ifaddr[i].name);
 		/* names are not unique (listed for both ipv4 and ipv6) */
-		if (!PySequence_Contains(list, str) && (ifa->ifa_flags & (IFF_UP))) {
+		if (!PySequence_Contains(list, str) && (ifaddr[i].flags & (IFF_UP))) {
 			PyList_Append(list, str);
 		}
 	Py_DECREF(str);
 	}
 
-	freeifaddrs(ifaddr);
+	free(ifaddr);
 
 	return list;
 }
 
-static PyObject *get_devices(PyObject *self __unused, PyObject *args __unused)
+/* Arguments are accepted and ignored, as they always were */
+static PyObject *get_devices(PyObject *self __unused, FASTCALL_ARGS)
 {
-	char buffer[256];
-	char *ret;
-	PyObject *list = PyList_New(0);
-	FILE *fd = fopen(_PATH_PROCNET_DEV, "r");
+	char *buffer, *line, *next;
+	size_t len;
+	PyObject *list;
+	int i, err;
 
-	if (fd == NULL) {
+	err = backend_read_file(_PATH_PROCNET_DEV, &buffer, &len);
+	if (err) {
+		errno = err;
 		return PyErr_SetFromErrno(PyExc_OSError);
 	}
+
 	/* skip over first two lines */
-	ret = fgets(buffer, 256, fd);
-	ret = fgets(buffer, 256, fd);
-	if( !ret ) {
+	line = buffer;
+	for (i = 0; i < 2 && line; i++) {
+		line = strchr(line, '\n');
+		if (line)
+			line++;
+	}
+	if (!line) {
+		free(buffer);
+		errno = EINVAL;
 		return PyErr_SetFromErrno(PyExc_OSError);
 	}
 
-	while (!feof(fd)) {
+	list = PyList_New(0);
+	for (; line && *line; line = next) {
 		PyObject *str;
-		char *name = buffer;
-		char *end = buffer;
+		char *name = line;
+		char *end = line;
 
-		if (fgets(buffer, 256, fd) == NULL)
-			break;
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = 0;
 		/* find colon */
 		while (*end && *end != ':')
 			end++;
@@ -110,40 +232,37 @@ static PyObject *get_devices(PyObject *self __unused, PyObject *args __unused)
 		PyList_Append(list, str);
 		Py_DECREF(str);
 	}
-	fclose(fd);
+	free(buffer);
 	return list;
 }
 
-static PyObject *get_hwaddress(PyObject *self __unused, PyObject *args)
+static PyObject *get_hwaddress(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	struct ifreq ifr;
+	struct stats_scope scope;
 	int fd, err;
-	const char *devname;
 	char hwaddr[20];
 
-	if (!PyArg_ParseTuple(args, "s*", &devname))
-		return NULL;
-
 	/* Setup our request structure. */
 	memset(&ifr, 0, sizeof(ifr));
-	strncpy(&ifr.ifr_name[0], devname, IFNAMSIZ);
-	ifr.ifr_name[IFNAMSIZ - 1] = 0;
+	if (parse_devname_args("get_hwaddr", args, nargs, 1, ifr.ifr_name) < 0)
+		return NULL;
 
-	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0);
-	if (fd < 0) {
-		return PyErr_SetFromErrno(PyExc_OSError);
-	}
+	/* Control socket, shared by all calls */
+	fd = get_ioctl_fd(self);
+	if (fd < 0)
+		return NULL;
 
 	/* Get current settings. */
-	err = ioctl(fd, SIOCGIFHWADDR, &ifr);
+	stats_enter(&scope, STATS_GET_HWADDR);
+	err = backend_ioctl(fd, SIOCGIFHWADDR, &ifr, 0);
+	stats_leave(&scope);
 	if (err < 0) {
 		PyErr_SetFromErrno(PyExc_IOError);
-		close(fd);
 		return NULL;
 	}
 
-	close(fd);
 
 	sprintf(hwaddr, "%02x:%02x:%02x:%02x:%02x:%02x",
 		(unsigned int)ifr.ifr_hwaddr.sa_data[0] % 256,
@@ -156,36 +275,33 @@ static PyObject *get_hwaddress(PyObject *self __unused, PyObject *args)
 	return PyBytes_FromString(hwaddr);
 }
 
-static PyObject *get_ipaddress(PyObject *self __unused, PyObject *args)
+static PyObject *get_ipaddress(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	struct ifreq ifr;
+	struct stats_scope scope;
 	int fd, err;
-	const char *devname;
 	char ipaddr[20];
 
-	if (!PyArg_ParseTuple(args, "s*", &devname))
-		return NULL;
-
 	/* Setup our request structure. */
 	memset(&ifr, 0, sizeof(ifr));
-	strncpy(&ifr.ifr_name[0], devname, IFNAMSIZ);
-	ifr.ifr_name[IFNAMSIZ - 1] = 0;
+	if (parse_devname_args("get_ipaddr", args, nargs, 1, ifr.ifr_name) < 0)
+		return NULL;
 
-	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0);
-	if (fd < 0) {
-		return PyErr_SetFromErrno(PyExc_OSError);
-	}
+	/* Control socket, shared by all calls */
+	fd = get_ioctl_fd(self);
+	if (fd < 0)
+		return NULL;
 
 	/* Get current settings. */
-	err = ioctl(fd, SIOCGIFADDR, &ifr);
+	stats_enter(&scope, STATS_GET_IPADDR);
+	err = backend_ioctl(fd, SIOCGIFADDR, &ifr, 0);
+	stats_leave(&scope);
 	if (err < 0) {
 		PyErr_SetFromErrno(PyExc_IOError);
-		close(fd);
 		return NULL;
 	}
 
-	close(fd);
 
 	sprintf(ipaddr, "%u.%u.%u.%u",
 		(unsigned int)ifr.ifr_addr.sa_data[2] % 256,
@@ -201,68 +317,84 @@ static PyObject *get_ipaddress(PyObject *self __unused, PyObject *args)
  * Retrieves the current information about all interfaces.  All interfaces will be
  * returned as a list of objects per interface.
  *
- * @param self Not used
- * @param args Python arguments - device name(s) as either a string or a list
+ * @param self  The module, providing the NETLINK connection for the objects
+ * @param args  Python arguments - device name(s) as either a string or a list
+ * @param nargs Number of Python arguments
  *
  * @return Python list of objects on success, otherwise NULL.
  */
-static PyObject *get_interfaces_info(PyObject *self __unused, PyObject *args) {
+static PyObject *get_interfaces_info(PyObject *self, FASTCALL_ARGS) {
+	FASTCALL_PROLOGUE
+	ethtoolState *state = get_ethtool_state(self);
 	PyObject *devlist = NULL;
 	PyObject *inargs = NULL;
-	char **fetch_devs = NULL;
-	int i = 0, fetch_devs_len = 0;
+	PyObject *devnames = NULL;
+	Py_ssize_t i;
 
-	if (!PyArg_ParseTuple(args, "|O", &inargs)) {
+	if (nargs > 1) {
 		PyErr_SetString(PyExc_LookupError,
 				"Argument must be either a string, list or a tuple");
 		return NULL;
 	}
+	if (nargs == 1) {
+		inargs = args[0];
+	}
 
-	/* Parse input arguments if we got them */
+	/* Parse input arguments if we got them, collecting the names as bytes */
+	devnames = PyList_New(0);
+	if( !devnames ) {
+		return NULL;
+	}
 	if( inargs != NULL ) {
-		if( PyBytes_Check(inargs) ) { /* Input argument is just a string */
-			fetch_devs_len = 1;
-			fetch_devs = calloc(1, sizeof(char *));
-			fetch_devs[0] = PyBytes_AsString(inargs);
-#if PY_MAJOR_VERSION >= 3
-		} else if( PyUnicode_Check(inargs) ) { /* Input argument is just a ustring */
-			fetch_devs_len = 1;
-			fetch_devs = calloc(1, sizeof(char *));
-			fetch_devs[0] = PyUnicode_AsUTF8(inargs);
-#endif
-		} else if( PyTuple_Check(inargs) ) { /* Input argument is a tuple list with devices */
-			int j = 0;
-
-			fetch_devs_len = PyTuple_Size(inargs);
-			fetch_devs = calloc(fetch_devs_len+1, sizeof(char *));
-			for( i = 0; i < fetch_devs_len; i++ ) {
-				PyObject *elmt = PyTuple_GetItem(inargs, i);
-				if( elmt && PyBytes_Check(elmt) ) {
-					fetch_devs[j++] = PyBytes_AsString(elmt);
-				}
+		if( PyBytes_Check(inargs) || PyUnicode_Check(inargs) ) { /* Input argument is just a string */
+			PyObject *name;
+
+			if( !devname_to_bytes(inargs, &name) ) {
+				goto error;
 			}
-			fetch_devs_len = j;
-		} else if( PyList_Check(inargs) ) { /* Input argument is a list with devices */
-			int j = 0;
-
-			fetch_devs_len = PyList_Size(inargs);
-			fetch_devs = calloc(fetch_devs_len+1, sizeof(char *));
-			for( i = 0; i < fetch_devs_len; i++ ) {
-				PyObject *elmt = PyList_GetItem(inargs, i);
-				if( elmt && PyBytes_Check(elmt) ) {
-					fetch_devs[j++] = PyBytes_AsString(elmt);
+			if( PyList_Append(devnames, name) < 0 ) {
+				Py_DECREF(name);
+				goto error;
+			}
+			Py_DECREF(name);
+		} else if( PyTuple_Check(inargs) || PyList_Check(inargs) ) { /* Input argument is a tuple or a list with devices */
+			/* Work on a private copy, the list may be changed by other threads */
+			PyObject *devtuple = PySequence_Tuple(inargs);
+
+			if( !devtuple ) {
+				goto error;
+			}
+			for( i = 0; i < PyTuple_GET_SIZE(devtuple); i++ ) {
+				PyObject *elmt = PyTuple_GET_ITEM(devtuple, i);
+				PyObject *name;
+
+				if( !PyBytes_Check(elmt) && !PyUnicode_Check(elmt) ) {
+					continue;
+				}
+				if( !devname_to_bytes(elmt, &name) ) {
+					Py_DECREF(devtuple);
+					goto error;
+				}
+				if( PyList_Append(devnames, name) < 0 ) {
+					Py_DECREF(name);
+					Py_DECREF(devtuple);
+					goto error;
 				}
+				Py_DECREF(name);
 			}
-			fetch_devs_len = j;
+			Py_DECREF(devtuple);
 		} else {
 			PyErr_SetString(PyExc_LookupError,
 					"Argument must be either a string, list or a tuple");
-			return NULL;
+			goto error;
 		}
 	}
 
 	devlist = PyList_New(0);
-	for( i = 0; i < fetch_devs_len; i++ ) {
+	if( !devlist ) {
+		goto error;
+	}
+	for( i = 0; i < PyList_GET_SIZE(devnames); i++ ) {
                 PyEtherInfo *dev = NULL;
 
 		/* Store the device name and a reference to the NETLINK connection for
@@ -271,86 +403,100 @@ static PyObject *get_interfaces_info(PyObject *self __unused, PyObject *args) {
 
                 dev = PyObject_New(PyEtherInfo, &PyEtherInfo_Type);
                 if( !dev ) {
-			PyErr_SetFromErrno(PyExc_OSError);
-			free(fetch_devs);
-			return NULL;
+			Py_DECREF(devlist);
+			goto error;
                 }
-		dev->device = PyBytes_FromString(fetch_devs[i]);
+		dev->device = PyList_GET_ITEM(devnames, i);
+		Py_INCREF(dev->device);
 		dev->hwaddress = NULL;
 		dev->index = -1;
+		dev->nlc_active = 0;
+		dev->nlc = nlc_get(state->nlc);
+		dev->ipv4_addresses = NULL;
+		dev->ipv6_addresses = NULL;
 
 		/* Append device object to the device list */
 		PyList_Append(devlist, (PyObject *)dev);
 		Py_DECREF(dev);
 	}
-	free(fetch_devs);
+	Py_DECREF(devnames);
 
 	return devlist;
+
+ error:
+	Py_DECREF(devnames);
+	return NULL;
 }
 
+/**
+ * Streams the information about all interfaces from a single link dump
+ *
+ * @param self  The module, providing the NETLINK connection for the objects
+ *
+ * @return Returns an iterator over etherinfo objects, otherwise NULL.
+ */
+static PyObject *iter_interfaces_info(PyObject *self, PyObject *unused __unused)
+{
+	return etherinfo_iter_new(get_ethtool_state(self)->nlc);
+}
 
-static PyObject *get_flags (PyObject *self __unused, PyObject *args)
+
+static PyObject *get_flags(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	struct ifreq ifr;
-	const char *devname;
+	struct stats_scope scope;
 	int fd, err;
 
-	if (!PyArg_ParseTuple(args, "s*", &devname))
-		return NULL;
-
 	/* Setup our request structure. */
 	memset(&ifr, 0, sizeof(ifr));
-	strncpy(&ifr.ifr_name[0], devname, IFNAMSIZ);
-	ifr.ifr_name[IFNAMSIZ - 1] = 0;
+	if (parse_devname_args("get_flags", args, nargs, 1, ifr.ifr_name) < 0)
+		return NULL;
 
-	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0);
-	if (fd < 0) {
-		return PyErr_SetFromErrno(PyExc_OSError);
-	}
-	err = ioctl(fd, SIOCGIFFLAGS, &ifr);
+	/* Control socket, shared by all calls */
+	fd = get_ioctl_fd(self);
+	if (fd < 0)
+		return NULL;
+	stats_enter(&scope, STATS_GET_FLAGS);
+	err = backend_ioctl(fd, SIOCGIFFLAGS, &ifr, 0);
+	stats_leave(&scope);
 	if(err < 0) {
 		PyErr_SetFromErrno(PyExc_IOError);
-		close(fd);
 		return NULL;
 	}
 
-	close(fd);
 
 	return Py_BuildValue("h", ifr.ifr_flags);
 
 
 }
-static PyObject *get_netmask (PyObject *self __unused, PyObject *args)
+static PyObject *get_netmask(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	struct ifreq ifr;
+	struct stats_scope scope;
 	int fd, err;
-	const char *devname;
 	char netmask[20];
 
-	if (!PyArg_ParseTuple(args, "s*", &devname))
-		return NULL;
-
 	/* Setup our request structure. */
 	memset(&ifr, 0, sizeof(ifr));
-	strncpy(&ifr.ifr_name[0], devname, IFNAMSIZ);
-	ifr.ifr_name[IFNAMSIZ - 1] = 0;
+	if (parse_devname_args("get_netmask", args, nargs, 1, ifr.ifr_name) < 0)
+		return NULL;
 
-	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0);
-	if (fd < 0) {
-		return PyErr_SetFromErrno(PyExc_OSError);
-	}
+	/* Control socket, shared by all calls */
+	fd = get_ioctl_fd(self);
+	if (fd < 0)
+		return NULL;
 
 	/* Get current settings. */
-	err = ioctl(fd, SIOCGIFNETMASK, &ifr);
+	stats_enter(&scope, STATS_GET_NETMASK);
+	err = backend_ioctl(fd, SIOCGIFNETMASK, &ifr, 0);
+	stats_leave(&scope);
 	if (err < 0) {
 		PyErr_SetFromErrno(PyExc_IOError);
-		close(fd);
 		return NULL;
 	}
 
-	close(fd);
 
 	sprintf(netmask, "%u.%u.%u.%u",
 		(unsigned int)ifr.ifr_netmask.sa_data[2] % 256,
@@ -361,36 +507,33 @@ static PyObject *get_netmask (PyObject *self __unused, PyObject *args)
 	return PyBytes_FromString(netmask);
 }
 
-static PyObject *get_broadcast(PyObject *self __unused, PyObject *args)
+static PyObject *get_broadcast(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	struct ifreq ifr;
+	struct stats_scope scope;
 	int fd, err;
-	const char *devname;
 	char broadcast[20];
 
-	if (!PyArg_ParseTuple(args, "s*", &devname))
-		return NULL;
-
 	/* Setup our request structure. */
 	memset(&ifr, 0, sizeof(ifr));
-	strncpy(&ifr.ifr_name[0], devname, IFNAMSIZ);
-	ifr.ifr_name[IFNAMSIZ - 1] = 0;
+	if (parse_devname_args("get_broadcast", args, nargs, 1, ifr.ifr_name) < 0)
+		return NULL;
 
-	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0);
-	if (fd < 0) {
-		return PyErr_SetFromErrno(PyExc_OSError);
-	}
+	/* Control socket, shared by all calls */
+	fd = get_ioctl_fd(self);
+	if (fd < 0)
+		return NULL;
 
 	/* Get current settings. */
-	err = ioctl(fd, SIOCGIFBRDADDR, &ifr);
+	stats_enter(&scope, STATS_GET_BROADCAST);
+	err = backend_ioctl(fd, SIOCGIFBRDADDR, &ifr, 0);
+	stats_leave(&scope);
 	if (err < 0) {
 		PyErr_SetFromErrno(PyExc_IOError);
-		close(fd);
 		return NULL;
 	}
 
-	close(fd);
 
 	sprintf(broadcast, "%u.%u.%u.%u",
 		(unsigned int)ifr.ifr_broadaddr.sa_data[2] % 256,
@@ -401,64 +544,62 @@ static PyObject *get_broadcast(PyObject *self __unused, PyObject *args)
 	return PyBytes_FromString(broadcast);
 }
 
-static PyObject *get_module(PyObject *self __unused, PyObject *args)
+static PyObject *get_module(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	struct ethtool_cmd ecmd;
 	struct ifreq ifr;
+	struct stats_scope scope;
 	int fd, err;
 	char buf[2048];
-	const char *devname;
-
-	if (!PyArg_ParseTuple(args, "s*", &devname))
-		return NULL;
 
 	/* Setup our control structures. */
 	memset(&ecmd, 0, sizeof(ecmd));
 	memset(&ifr, 0, sizeof(ifr));
-	strncpy(&ifr.ifr_name[0], devname, IFNAMSIZ);
-	ifr.ifr_name[IFNAMSIZ - 1] = 0;
+	if (parse_devname_args("get_module", args, nargs, 1, ifr.ifr_name) < 0)
+		return NULL;
 	ifr.ifr_data = (caddr_t) &buf;
 	ecmd.cmd = ETHTOOL_GDRVINFO;
 	memcpy(&buf, &ecmd, sizeof(ecmd));
 
-	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0);
-	if (fd < 0) {
-		return PyErr_SetFromErrno(PyExc_OSError);
-	}
+	/* Control socket, shared by all calls */
+	fd = get_ioctl_fd(self);
+	if (fd < 0)
+		return NULL;
 
 	/* Get current settings. */
-	err = ioctl(fd, SIOCETHTOOL, &ifr);
+	stats_enter(&scope, STATS_GET_MODULE);
+	err = backend_ioctl(fd, SIOCETHTOOL, &ifr, sizeof(struct ethtool_drvinfo));
+	stats_leave(&scope);
 
 	if (err < 0) {  /* failed? */
 		PyErr_SetFromErrno(PyExc_IOError);
-		FILE *file;
+		char *stab, *line, *next;
+		size_t len;
 		int found = 0;
 		char driver[101], dev[101];
-		close(fd);
 
 		/* Before bailing, maybe it is a PCMCIA/PC Card? */
-		file = fopen("/var/lib/pcmcia/stab", "r");
-		if (file == NULL) {
+		if (backend_read_file("/var/lib/pcmcia/stab", &stab, &len) != 0) {
 			return NULL;
 		}
 
-		while (!feof(file)) {
-			if (fgets(buf, 2048, file) == NULL)
-				break;
-			buf[2047] = '\0';
-			if (strncmp(buf, "Socket", 6) != 0) {
-				if (sscanf(buf, "%*d\t%*s\t%100s\t%*d\t%100s\n", driver, dev) > 0) {
+		for (line = stab; line && *line; line = next) {
+			next = strchr(line, '\n');
+			if (next)
+				*next++ = '\0';
+			if (strncmp(line, "Socket", 6) != 0) {
+				if (sscanf(line, "%*d\t%*s\t%100s\t%*d\t%100s", driver, dev) > 0) {
 					driver[99] = '\0';
 					dev[99] = '\0';
-					if (strcmp(devname, dev) == 0) {
+					if (strcmp(ifr.ifr_name, dev) == 0) {
 						found = 1;
 						break;
 					}
 				}
 			}
 		}
-		fclose(file);
+		free(stab);
 		if (!found) {
 			return NULL;
 		} else {
@@ -467,94 +608,113 @@ static PyObject *get_module(PyObject *self __unused, PyObject *args)
 		}
 	}
 
-	close(fd);
 	return PyBytes_FromString(((struct ethtool_drvinfo *)buf)->driver);
 }
 
-static PyObject *get_businfo(PyObject *self __unused, PyObject *args)
+static PyObject *get_businfo(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	struct ethtool_cmd ecmd;
 	struct ifreq ifr;
+	struct stats_scope scope;
 	int fd, err;
 	char buf[1024];
-	const char *devname;
-
-	if (!PyArg_ParseTuple(args, "s*", &devname))
-		return NULL;
 
 	/* Setup our control structures. */
 	memset(&ecmd, 0, sizeof(ecmd));
 	memset(&ifr, 0, sizeof(ifr));
-	strncpy(&ifr.ifr_name[0], devname, IFNAMSIZ);
-	ifr.ifr_name[IFNAMSIZ - 1] = 0;
+	if (parse_devname_args("get_businfo", args, nargs, 1, ifr.ifr_name) < 0)
+		return NULL;
 	ifr.ifr_data = (caddr_t) &buf;
 	ecmd.cmd = ETHTOOL_GDRVINFO;
 	memcpy(&buf, &ecmd, sizeof(ecmd));
 
-	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0);
-	if (fd < 0) {
-		return PyErr_SetFromErrno(PyExc_OSError);
-	}
+	/* Control socket, shared by all calls */
+	fd = get_ioctl_fd(self);
+	if (fd < 0)
+		return NULL;
 
 	/* Get current settings. */
-	err = ioctl(fd, SIOCETHTOOL, &ifr);
+	stats_enter(&scope, STATS_GET_BUSINFO);
+	err = backend_ioctl(fd, SIOCETHTOOL, &ifr, sizeof(struct ethtool_drvinfo));
+	stats_leave(&scope);
 
 	if (err < 0) {  /* failed? */
 		PyErr_SetFromErrno(PyExc_IOError);
-		close(fd);
 		return NULL;
 	}
 
-	close(fd);
 	return PyBytes_FromString(((struct ethtool_drvinfo *)buf)->bus_info);
 }
 
-static int send_command(int cmd, const char *devname, void *value)
+/**
+ * Issues an ioctl() taking a struct ifreq whose ifr_data points to size
+ * bytes, on the control socket
+ *
+ * @return Returns 0 on success, otherwise -1 with a Python exception set.
+ */
+static int send_ifreq(PyObject *self, unsigned long request, const char *devname,
+		      void *data, size_t size)
 {
-	/* Setup our request structure. */
+	struct stats_scope scope;
 	int fd, err;
 	struct ifreq ifr;
-	struct ethtool_value *eval = value;
 
 	memset(&ifr, 0, sizeof(ifr));
 	strncpy(&ifr.ifr_name[0], devname, IFNAMSIZ);
 	ifr.ifr_name[IFNAMSIZ - 1] = 0;
-	ifr.ifr_data = (caddr_t)eval;
-	eval->cmd = cmd;
+	ifr.ifr_data = (caddr_t)data;
 
-	/* Open control socket. */
-	fd = socket(AF_INET, SOCK_DGRAM, 0), err;
-	if (fd < 0) {
-		PyErr_SetFromErrno(PyExc_OSError);
+	/* Control socket, shared by all calls */
+	fd = get_ioctl_fd(self);
+	if (fd < 0)
 		return -1;
-	}
 
-	/* Get current settings. */
-	err = ioctl(fd, SIOCETHTOOL, &ifr);
+	stats_enter(&scope, STATS_SEND_COMMAND);
+	err = backend_ioctl(fd, request, &ifr, size);
+	stats_leave(&scope);
 	if (err < 0) {
+		int saved = errno;
+
 		PyErr_SetFromErrno(PyExc_IOError);
+		errno = saved;
 	}
 
-	close(fd);
 	return err;
 }
 
-static int get_dev_value(int cmd, PyObject *args, void *value)
+static int send_command(PyObject *self, int cmd, const char *devname, void *value,
+			size_t size)
 {
-	const char *devname;
-	int err = -1;
+	struct ethtool_value *eval = value;
+	int err;
 
-	if (PyArg_ParseTuple(args, "s*", &devname))
-		err = send_command(cmd, devname, value);
+	eval->cmd = cmd;
+
+	/* Get current settings. */
+	ETHTOOL_PROBE2(send_command_entry, devname, cmd);
+	err = send_ifreq(self, SIOCETHTOOL, devname, value, size);
+	ETHTOOL_PROBE3(send_command_return, devname, cmd, err < 0 ? errno : 0);
 
 	return err;
 }
 
-static int get_dev_int_value(int cmd, PyObject *args, int *value)
+static int get_dev_value(PyObject *self, const char *fname, int cmd, PyObject *const *args,
+			 Py_ssize_t nargs, void *value, size_t size)
+{
+	char devname[IFNAMSIZ];
+
+	if (parse_devname_args(fname, args, nargs, 1, devname) < 0)
+		return -1;
+
+	return send_command(self, cmd, devname, value, size);
+}
+
+static int get_dev_int_value(PyObject *self, const char *fname, int cmd, PyObject *const *args,
+			     Py_ssize_t nargs, int *value)
 {
 	struct ethtool_value eval;
-	int rc = get_dev_value(cmd, args, &eval);
+	int rc = get_dev_value(self, fname, cmd, args, nargs, &eval, sizeof(eval));
 
 	if (rc == 0)
 		*value = *(int *)&eval.data;
@@ -562,77 +722,79 @@ static int get_dev_int_value(int cmd, PyObject *args, int *value)
 	return rc;
 }
 
-static int dev_set_int_value(int cmd, PyObject *args)
+static int dev_set_int_value(PyObject *self, const char *fname, int cmd, PyObject *const *args,
+			     Py_ssize_t nargs)
 {
 	struct ethtool_value eval;
-	const char *devname;
+	char devname[IFNAMSIZ];
+	long data;
 
-	if (!PyArg_ParseTuple(args, "s*i", &devname, &eval.data))
+	if (parse_devname_args(fname, args, nargs, 2, devname) < 0)
 		return -1;
 
-	return send_command(cmd, devname, &eval);
+	data = PyLong_AsLong(args[1]);
+	if (data == -1 && PyErr_Occurred())
+		return -1;
+	eval.data = data;
+
+	return send_command(self, cmd, devname, &eval, sizeof(eval));
 }
 
-static PyObject *get_tso(PyObject *self __unused, PyObject *args)
+static PyObject *get_tso(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	int value = 0;
 
-	if (get_dev_int_value(ETHTOOL_GTSO, args, &value) < 0)
+	if (get_dev_int_value(self, "get_tso", ETHTOOL_GTSO, args, nargs, &value) < 0)
 		return NULL;
 
 	return Py_BuildValue("b", value);
 }
 
-static PyObject *set_tso(PyObject *self __unused, PyObject *args)
+static PyObject *set_tso(PyObject *self, FASTCALL_ARGS)
 {
-	if (dev_set_int_value(ETHTOOL_STSO, args) < 0)
+	FASTCALL_PROLOGUE
+
+	if (dev_set_int_value(self, "set_tso", ETHTOOL_STSO, args, nargs) < 0)
 		return NULL;
 
 	Py_INCREF(Py_None);
 	return Py_None;
 }
 
-static PyObject *get_ufo(PyObject *self __unused, PyObject *args)
+static PyObject *get_ufo(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	int value = 0;
 
-	if (get_dev_int_value(ETHTOOL_GUFO, args, &value) < 0)
+	if (get_dev_int_value(self, "get_ufo", ETHTOOL_GUFO, args, nargs, &value) < 0)
 		return NULL;
 
 	return Py_BuildValue("b", value);
 }
 
-static PyObject *get_gso(PyObject *self __unused, PyObject *args)
+static PyObject *get_gso(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	int value = 0;
 
-	if (get_dev_int_value(ETHTOOL_GGSO, args, &value) < 0)
+	if (get_dev_int_value(self, "get_gso", ETHTOOL_GGSO, args, nargs, &value) < 0)
 		return NULL;
 
 	return Py_BuildValue("b", value);
 }
 
-static PyObject *get_sg(PyObject *self __unused, PyObject *args)
+static PyObject *get_sg(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	int value = 0;
 
-	if (get_dev_int_value(ETHTOOL_GSG, args, &value) < 0)
+	if (get_dev_int_value(self, "get_sg", ETHTOOL_GSG, args, nargs, &value) < 0)
 		return NULL;
 
 	return Py_BuildValue("b", value);
 }
 
-struct struct_desc {
-	char	       *name;
-	unsigned short offset;
-	unsigned short size;
-};
-
-#define member_desc(type, member_name) { \
-	.name = #member_name, \
-	.offset = offsetof(type, member_name), \
-	.size = sizeof(((type *)0)->member_name), }
-
 struct struct_desc ethtool_coalesce_desc[] = {
 	member_desc(struct ethtool_coalesce, rx_coalesce_usecs),
 	member_desc(struct ethtool_coalesce, rx_max_coalesced_frames),
@@ -657,9 +819,10 @@ struct struct_desc ethtool_coalesce_desc[] = {
 	member_desc(struct ethtool_coalesce, tx_max_coalesced_frames_high),
 	member_desc(struct ethtool_coalesce, rate_sample_interval),
 };
+const int ethtool_coalesce_desc_len = ARRAY_SIZE(ethtool_coalesce_desc);
 
-static PyObject *__struct_desc_create_dict(struct struct_desc *table,
-					   int nr_entries, void *values)
+PyObject *__struct_desc_create_dict(struct struct_desc *table,
+				    int nr_entries, void *values)
 {
 	int i;
 	PyObject *dict = PyDict_New();
@@ -695,9 +858,6 @@ free_dict:
 	dict = NULL;
 }
 
-#define struct_desc_create_dict(table, values) \
-	__struct_desc_create_dict(table, ARRAY_SIZE(table), values)
-
 static int __struct_desc_from_dict(struct struct_desc *table,
 				   int nr_entries, void *to, PyObject *dict)
 {
@@ -736,29 +896,31 @@ static int __struct_desc_from_dict(struct struct_desc *table,
 #define struct_desc_from_dict(table, to, dict) \
 	__struct_desc_from_dict(table, ARRAY_SIZE(table), to, dict)
 
-static PyObject *get_coalesce(PyObject *self __unused, PyObject *args)
+static PyObject *get_coalesce(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	struct ethtool_coalesce coal;
 
-	if (get_dev_value(ETHTOOL_GCOALESCE, args, &coal) < 0)
+	if (get_dev_value(self, "get_coalesce", ETHTOOL_GCOALESCE, args, nargs,
+			  &coal, sizeof(coal)) < 0)
 		return NULL;
 
 	return struct_desc_create_dict(ethtool_coalesce_desc, &coal);
 }
 
-static PyObject *set_coalesce(PyObject *self __unused, PyObject *args)
+static PyObject *set_coalesce(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	struct ethtool_coalesce coal;
-	const char *devname;
-	PyObject *dict;
+	char devname[IFNAMSIZ];
 
-	if (!PyArg_ParseTuple(args, "s*O", &devname, &dict))
+	if (parse_devname_args("set_coalesce", args, nargs, 2, devname) < 0)
 		return NULL;
 
-	if (struct_desc_from_dict(ethtool_coalesce_desc, &coal, dict) != 0)
+	if (struct_desc_from_dict(ethtool_coalesce_desc, &coal, args[1]) != 0)
 		return NULL;
 
-	if (send_command(ETHTOOL_SCOALESCE, devname, &coal))
+	if (send_command(self, ETHTOOL_SCOALESCE, devname, &coal, sizeof(coal)))
 		return NULL;
 
 	Py_INCREF(Py_None);
@@ -775,165 +937,901 @@ struct struct_desc ethtool_ringparam_desc[] = {
 	member_desc(struct ethtool_ringparam, rx_jumbo_pending),
 	member_desc(struct ethtool_ringparam, tx_pending),
 };
+const int ethtool_ringparam_desc_len = ARRAY_SIZE(ethtool_ringparam_desc);
 
-static PyObject *get_ringparam(PyObject *self __unused, PyObject *args)
+static PyObject *get_ringparam(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	struct ethtool_ringparam ring;
 
-	if (get_dev_value(ETHTOOL_GRINGPARAM, args, &ring) < 0)
+	if (get_dev_value(self, "get_ringparam", ETHTOOL_GRINGPARAM, args, nargs,
+			  &ring, sizeof(ring)) < 0)
 		return NULL;
 
 	return struct_desc_create_dict(ethtool_ringparam_desc, &ring);
 }
 
-static PyObject *set_ringparam(PyObject *self __unused, PyObject *args)
+static PyObject *set_ringparam(PyObject *self, FASTCALL_ARGS)
 {
+	FASTCALL_PROLOGUE
 	struct ethtool_ringparam ring;
-	const char *devname;
-	PyObject *dict;
+	char devname[IFNAMSIZ];
+
+	if (parse_devname_args("set_ringparam", args, nargs, 2, devname) < 0)
+		return NULL;
+
+	if (struct_desc_from_dict(ethtool_ringparam_desc, &ring, args[1]) != 0)
+		return NULL;
+
+	if (send_command(self, ETHTOOL_SRINGPARAM, devname, &ring, sizeof(ring)))
+		return NULL;
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+struct struct_desc ethtool_pauseparam_desc[] = {
+	member_desc(struct ethtool_pauseparam, autoneg),
+	member_desc(struct ethtool_pauseparam, rx_pause),
+	member_desc(struct ethtool_pauseparam, tx_pause),
+};
+const int ethtool_pauseparam_desc_len = ARRAY_SIZE(ethtool_pauseparam_desc);
+
+static PyObject *get_pauseparam(PyObject *self, FASTCALL_ARGS)
+{
+	FASTCALL_PROLOGUE
+	struct ethtool_pauseparam pause;
+
+	if (get_dev_value(self, "get_pauseparam", ETHTOOL_GPAUSEPARAM, args, nargs,
+			  &pause, sizeof(pause)) < 0)
+		return NULL;
+
+	return struct_desc_create_dict(ethtool_pauseparam_desc, &pause);
+}
+
+static PyObject *set_pauseparam(PyObject *self, FASTCALL_ARGS)
+{
+	FASTCALL_PROLOGUE
+	struct ethtool_pauseparam pause;
+	char devname[IFNAMSIZ];
+
+	if (parse_devname_args("set_pauseparam", args, nargs, 2, devname) < 0)
+		return NULL;
+
+	if (struct_desc_from_dict(ethtool_pauseparam_desc, &pause, args[1]) != 0)
+		return NULL;
+
+	if (send_command(self, ETHTOOL_SPAUSEPARAM, devname, &pause, sizeof(pause)))
+		return NULL;
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+struct struct_desc ethtool_eee_desc[] = {
+	member_desc(struct ethtool_eee, supported),
+	member_desc(struct ethtool_eee, advertised),
+	member_desc(struct ethtool_eee, lp_advertised),
+	member_desc(struct ethtool_eee, eee_active),
+	member_desc(struct ethtool_eee, eee_enabled),
+	member_desc(struct ethtool_eee, tx_lpi_enabled),
+	member_desc(struct ethtool_eee, tx_lpi_timer),
+};
+const int ethtool_eee_desc_len = ARRAY_SIZE(ethtool_eee_desc);
 
-	if (!PyArg_ParseTuple(args, "s*O", &devname, &dict))
+static PyObject *get_eee(PyObject *self, FASTCALL_ARGS)
+{
+	FASTCALL_PROLOGUE
+	struct ethtool_eee eee;
+
+	if (get_dev_value(self, "get_eee", ETHTOOL_GEEE, args, nargs, &eee, sizeof(eee)) < 0)
 		return NULL;
 
-	if (struct_desc_from_dict(ethtool_ringparam_desc, &ring, dict) != 0)
+	return struct_desc_create_dict(ethtool_eee_desc, &eee);
+}
+
+static PyObject *set_eee(PyObject *self, FASTCALL_ARGS)
+{
+	FASTCALL_PROLOGUE
+	struct ethtool_eee eee;
+	char devname[IFNAMSIZ];
+
+	if (parse_devname_args("set_eee", args, nargs, 2, devname) < 0)
 		return NULL;
 
-	if (send_command(ETHTOOL_SRINGPARAM, devname, &ring))
+	/* supported, lp_advertised and eee_active are ignored by the kernel */
+	memset(&eee, 0, sizeof(eee));
+	if (struct_desc_from_dict(ethtool_eee_desc, &eee, args[1]) != 0)
+		return NULL;
+
+	if (send_command(self, ETHTOOL_SEEE, devname, &eee, sizeof(eee)))
 		return NULL;
 
 	Py_INCREF(Py_None);
 	return Py_None;
 }
 
+/* Bits of ethtool_ts_info.so_timestamping, as ethtool -T names them */
+static const char *const ts_sof_names[] = {
+	"hardware-transmit", "software-transmit", "hardware-receive",
+	"software-receive", "software-system-clock", "hardware-legacy-clock",
+	"hardware-raw-clock", "option-id", "sched-transmit", "ack-transmit",
+	"option-cmsg", "option-tsonly", "option-stats", "option-pktinfo",
+	"option-tx-swhw", "bind-phc", "option-id-tcp", "option-rx-filter",
+};
+
+/* HWTSTAMP_TX_* */
+static const char *const ts_tx_names[] = {
+	"off", "on", "onestep-sync", "onestep-p2p",
+};
+
+/* HWTSTAMP_FILTER_* */
+static const char *const ts_rx_names[] = {
+	"none", "all", "some", "ptpv1-l4-event", "ptpv1-l4-sync",
+	"ptpv1-l4-delay-req", "ptpv2-l4-event", "ptpv2-l4-sync",
+	"ptpv2-l4-delay-req", "ptpv2-l2-event", "ptpv2-l2-sync",
+	"ptpv2-l2-delay-req", "ptpv2-event", "ptpv2-sync", "ptpv2-delay-req",
+	"ntp-all",
+};
+
+/* The name of a value, or the value if this module does not know it */
+static PyObject *ts_name(const char *const *names, size_t nr_names, uint32_t value)
+{
+	if (value < nr_names)
+		return Py_BuildValue("s", names[value]);
+	return PyLong_FromUnsignedLong(value);
+}
+
+/* The names of the bits of a mask */
+static PyObject *ts_names(const char *const *names, size_t nr_names, uint32_t mask)
+{
+	PyObject *list, *name;
+	uint32_t bit;
+
+	list = PyList_New(0);
+	for (bit = 0; list && bit < 32; bit++) {
+		if (!(mask & (1U << bit)))
+			continue;
+		name = ts_name(names, nr_names, bit);
+		if (!name || PyList_Append(list, name) < 0)
+			Py_CLEAR(list);
+		Py_XDECREF(name);
+	}
+	return list;
+}
+
+/**
+ * Reads a HWTSTAMP_* value given by name or number
+ *
+ * @return Returns 0 on success, otherwise -1 with a Python exception set.
+ */
+static int ts_value(const char *const *names, size_t nr_names, PyObject *dict,
+		    const char *key, int *value)
+{
+	PyObject *obj = PyDict_GetItemString(dict, key);
+	PyObject *bytes;
+	size_t i;
+	long v;
+
+	if (obj == NULL) {
+		PyErr_Format(PyExc_ValueError, "missing %s", key);
+		return -1;
+	}
+	if (PyUnicode_Check(obj) || PyBytes_Check(obj)) {
+		if (!devname_to_bytes(obj, &bytes))
+			return -1;
+		for (i = 0; i < nr_names; i++) {
+			if (strcmp(names[i], PyBytes_AS_STRING(bytes)) == 0)
+				break;
+		}
+		if (i == nr_names)
+			PyErr_Format(PyExc_ValueError, "unknown %s '%s'", key,
+				     PyBytes_AS_STRING(bytes));
+		Py_DECREF(bytes);
+		*value = i;
+		return i < nr_names ? 0 : -1;
+	}
+	v = PyLong_AsLong(obj);
+	if (v == -1 && PyErr_Occurred())
+		return -1;
+	*value = v;
+	return 0;
+}
+
+static PyObject *ts_config_dict(const struct hwtstamp_config *config)
+{
+	return Py_BuildValue("{s:N,s:N,s:i}",
+			     "tx_type", ts_name(ts_tx_names, ARRAY_SIZE(ts_tx_names),
+						config->tx_type),
+			     "rx_filter", ts_name(ts_rx_names, ARRAY_SIZE(ts_rx_names),
+						  config->rx_filter),
+			     "flags", config->flags);
+}
+
+static PyObject *get_ts_info(PyObject *self, FASTCALL_ARGS)
+{
+	FASTCALL_PROLOGUE
+	struct ethtool_ts_info info;
+	char clock[32];
+
+	memset(&info, 0, sizeof(info));
+	if (get_dev_value(self, "get_ts_info", ETHTOOL_GET_TS_INFO, args, nargs,
+			  &info, sizeof(info)) < 0)
+		return NULL;
+
+	if (info.phc_index >= 0)
+		snprintf(clock, sizeof(clock), "/dev/ptp%d", info.phc_index);
+	return Py_BuildValue("{s:N,s:N,s:N,s:N,s:N}",
+			     "so_timestamping", ts_names(ts_sof_names, ARRAY_SIZE(ts_sof_names),
+							 info.so_timestamping),
+			     "phc_index", info.phc_index >= 0 ?
+					  PyLong_FromLong(info.phc_index) : Py_BuildValue(""),
+			     "ptp_clock", info.phc_index >= 0 ?
+					  Py_BuildValue("s", clock) : Py_BuildValue(""),
+			     "tx_types", ts_names(ts_tx_names, ARRAY_SIZE(ts_tx_names),
+						  info.tx_types),
+			     "rx_filters", ts_names(ts_rx_names, ARRAY_SIZE(ts_rx_names),
+						    info.rx_filters));
+}
+
+static PyObject *get_hwtstamp(PyObject *self, FASTCALL_ARGS)
+{
+	FASTCALL_PROLOGUE
+	struct hwtstamp_config config;
+	char devname[IFNAMSIZ];
+
+	if (parse_devname_args("get_hwtstamp", args, nargs, 1, devname) < 0)
+		return NULL;
+
+	memset(&config, 0, sizeof(config));
+	if (send_ifreq(self, SIOCGHWTSTAMP, devname, &config, sizeof(config)) < 0)
+		return NULL;
+
+	return ts_config_dict(&config);
+}
+
+static PyObject *set_hwtstamp(PyObject *self, FASTCALL_ARGS)
+{
+	FASTCALL_PROLOGUE
+	struct hwtstamp_config config;
+	char devname[IFNAMSIZ];
+	PyObject *flags;
+
+	if (parse_devname_args("set_hwtstamp", args, nargs, 2, devname) < 0)
+		return NULL;
+	if (!PyDict_Check(args[1])) {
+		PyErr_SetString(PyExc_TypeError, "the config must be a dict");
+		return NULL;
+	}
+
+	memset(&config, 0, sizeof(config));
+	if (ts_value(ts_tx_names, ARRAY_SIZE(ts_tx_names), args[1], "tx_type",
+		     &config.tx_type) < 0 ||
+	    ts_value(ts_rx_names, ARRAY_SIZE(ts_rx_names), args[1], "rx_filter",
+		     &config.rx_filter) < 0)
+		return NULL;
+	flags = PyDict_GetItemString(args[1], "flags");
+	if (flags) {
+		config.flags = PyLong_AsLong(flags);
+		if (config.flags == -1 && PyErr_Occurred())
+			return NULL;
+	}
+
+	/* The driver writes back what it did, which may time stamp more */
+	if (send_ifreq(self, SIOCSHWTSTAMP, devname, &config, sizeof(config)) < 0)
+		return NULL;
+
+	return ts_config_dict(&config);
+}
+
+static PyObject *take_snapshot(PyObject *self, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "ethtool", NULL };
+	int with_ethtool = 1, fd = -1;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i:snapshot", kwlist, &with_ethtool))
+		return NULL;
+
+	if (with_ethtool && (fd = get_ioctl_fd(self)) < 0)
+		return NULL;
+
+	return snapshot_take(fd, with_ethtool ? SNAPSHOT_ETHTOOL : 0);
+}
+
 static struct PyMethodDef PyEthModuleMethods[] = {
 	{
 		.ml_name = "get_module",
 		.ml_meth = (PyCFunction)get_module,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_businfo",
 		.ml_meth = (PyCFunction)get_businfo,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_hwaddr",
 		.ml_meth = (PyCFunction)get_hwaddress,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_ipaddr",
 		.ml_meth = (PyCFunction)get_ipaddress,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_interfaces_info",
 		.ml_meth = (PyCFunction)get_interfaces_info,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 		.ml_doc = "Accepts a string, list or tupples of interface names. "
 		"Returns a list of ethtool.etherinfo objets with device information."
 	},
+	{
+		.ml_name = "iter_interfaces_info",
+		.ml_meth = (PyCFunction)iter_interfaces_info,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = "Returns an iterator over ethtool.etherinfo objects for all "
+		"interfaces, read from a single link dump as the kernel delivers "
+		"it.  The objects come with their MAC and IP addresses already "
+		"filled in, and memory use does not grow with the number of "
+		"interfaces."
+	},
+	{
+		.ml_name = "set_backend",
+		.ml_meth = (PyCFunction)backend_set,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "set_backend(name, path=None, timed=False)\n"
+		"Selects how the module talks to the kernel: 'kernel' directly, "
+		"'record' directly while saving all requests and replies to the "
+		"capture file 'path', or 'replay' answering from the capture file "
+		"'path' without touching the kernel.  With timed=True, replayed "
+		"requests take as long as they did when recorded.  Switching the "
+		"backend closes the previous capture file; if the new one cannot "
+		"be set up, the kernel backend is left in place.  The backend is "
+		"shared by all the interpreters of the process."
+	},
+	{
+		.ml_name = "get_backend",
+		.ml_meth = (PyCFunction)backend_get,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = "get_backend()\n"
+		"Returns the name of the backend selected with set_backend()."
+	},
+	{
+		.ml_name = "stats",
+		.ml_meth = (PyCFunction)stats_get,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = "stats()\n"
+		"Returns the instrumentation counters of all threads since the last "
+		"reset_stats(), as a dict keyed by code path.  Each entry holds the "
+		"number of calls, ioctls, NETLINK messages and bytes received, the "
+		"total time in ns and a histogram of call durations, keyed by the "
+		"upper bound of each bucket in ns."
+	},
+	{
+		.ml_name = "reset_stats",
+		.ml_meth = (PyCFunction)stats_reset,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = "reset_stats()\n"
+		"Restarts the counters reported by stats() from zero."
+	},
+	{
+		.ml_name = "parallel_query",
+		.ml_meth = (PyCFunction)parallel_query,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "parallel_query(devices, fields, workers=0, timeout=None)\n"
+		"Queries the given fields (e.g. 'module', 'businfo', 'coalesce', "
+		"'ringparam', 'pauseparam', 'eee', 'flags', 'link') for all devices "
+		"concurrently from "
+		"native worker threads.  Returns a dict of per device dicts.  Fields "
+		"which failed, or were not answered within timeout seconds, hold an "
+		"IOError instance instead of a value.  At most 64 worker threads "
+		"are started, also when workers asks for more, so with more devices "
+		"than threads a worker queries several devices in turn and the call "
+		"can take longer than the slowest device."
+	},
+	{
+		.ml_name = "snapshot",
+		.ml_meth = (PyCFunction)take_snapshot,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "snapshot(ethtool=True)\n"
+		"Collects the links, addresses and counters of all interfaces, "
+		"plus their coalesce and ring parameters, driver information and "
+		"offloads with ethtool=True, into an ethtool.Snapshot object.  "
+		"Snapshots only become Python objects through their to_dict() "
+		"method, can be compared with their diff() method and encoded "
+		"with their to_bytes() method."
+	},
+	{
+		.ml_name = "load_snapshot",
+		.ml_meth = (PyCFunction)snapshot_load,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "load_snapshot(data, copy=False)\n"
+		"Decodes a snapshot encoded by Snapshot.to_bytes() from a bytes "
+		"object or any other buffer, without touching the kernel.  Unless "
+		"copy=True, the records of a read-only buffer encoded on a host of "
+		"the same byte order are used in place, the buffer must then not "
+		"change while the snapshot is in use."
+	},
+	{
+		.ml_name = "publisher",
+		.ml_meth = (PyCFunction)shm_publisher,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "publisher(name, ethtool=True)\n"
+		"Makes this process the publisher of the interface state in the "
+		"shared memory file 'name', taken relative to /dev/shm unless it "
+		"contains a slash.  Returns a Publisher object whose publish() "
+		"method collects the links, addresses and counters of all "
+		"interfaces, plus their ETHTOOL settings with ethtool=True, and "
+		"publishes them.  Only one process can publish "
+		"a given file at a time."
+	},
+	{
+		.ml_name = "metrics_renderer",
+		.ml_meth = (PyCFunction)metrics_renderer,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "metrics_renderer(families=None, prefix=\"ethtool\")\n"
+		"Returns a MetricsRenderer object whose render() method writes "
+		"the interface state in the OpenMetrics text format for "
+		"Prometheus, into a buffer reused across calls.  families limits "
+		"the output to some of link, counters, addresses, coalesce, "
+		"ringparam, drvinfo, features and nic_stats, the latter being the "
+		"driver statistics with a queue label where their names have one."
+	},
+	{
+		.ml_name = "recorder",
+		.ml_meth = (PyCFunction)recorder_new,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "recorder(path, devices, interval=0.01, capacity=65536, "
+		"nic_stats=True)\n"
+		"Creates the file 'path' holding a ring of 'capacity' records of "
+		"the link counters of the given devices, plus their driver "
+		"statistics (ETHTOOL_GSTATS) with nic_stats=True.  Returns a "
+		"Recorder object whose start() method samples them every "
+		"'interval' seconds on a thread of its own, without taking the "
+		"GIL, until stop() or close() is called.  See open_recording()."
+	},
+	{
+		.ml_name = "open_recording",
+		.ml_meth = (PyCFunction)recorder_open,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "open_recording(path)\n"
+		"Maps a file written by a Recorder, in this or another process.  "
+		"Returns a Recording object whose read() method returns the "
+		"recorded series as buffers."
+	},
+	{
+		.ml_name = "coalesce_controller",
+		.ml_meth = (PyCFunction)dim_controller,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "coalesce_controller(devices, profiles=None, interval=0.25, "
+		"hysteresis=0.2, apply=True)\n"
+		"Returns a CoalesceController object adapting the interrupt "
+		"coalescing of the given devices to their receive and transmit "
+		"packet rates.  'profiles' is a sequence of (max_rate, usecs, "
+		"frames) tuples ordered by the packets per second they are meant "
+		"for; a direction only moves to a lower profile once its rate is "
+		"'hysteresis' below the limit of that profile.  With apply=False "
+		"the decisions are only recorded."
+	},
+	{
+		.ml_name = "ring_advisor",
+		.ml_meth = (PyCFunction)rings_advisor,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "ring_advisor(devices=None, min_drops=1)\n"
+		"Returns a RingAdvisor object whose sample() method advises "
+		"doubling the rx or tx ring of a device, up to its maximum, when "
+		"at least 'min_drops' packets were lost to a full ring since the "
+		"previous sample, and optionally applies the advice.  Follows "
+		"all the devices of the host with devices=None."
+	},
+	{
+		.ml_name = "queue_steering",
+		.ml_meth = (PyCFunction)steer_new,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "queue_steering(devname)\n"
+		"Opens the sysfs queue directories of a device.  Returns a "
+		"QueueSteering object reading and writing the RPS CPUs, RFS flow "
+		"counts and XPS CPUs of all its queues in one call, with CPU sets "
+		"rather than masks."
+	},
+	{
+		.ml_name = "get_irq_map",
+		.ml_meth = (PyCFunction)irq_get_map,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_irq_map(devname)\n"
+		"Returns the bus_info, NUMA node and local CPUs of a device, with "
+		"its interrupts found from the MSI interrupts of its bus device "
+		"and the names in /proc/interrupts, as a list of {'irq', 'name', "
+		"'queue', 'affinity'} dicts ordered by queue."
+	},
+	{
+		.ml_name = "plan_irq_affinity",
+		.ml_meth = (PyCFunction)irq_plan_affinity,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "plan_irq_affinity(devname, cpus=None)\n"
+		"Returns a list of (irq, cpu) pairs pinning the interrupts of the "
+		"Nth queue of a device to the Nth of 'cpus', round robin.  By "
+		"default these are the CPUs local to the NUMA node of the device "
+		"which are not isolated, one thread per core first."
+	},
+	{
+		.ml_name = "set_irq_affinity",
+		.ml_meth = (PyCFunction)irq_set_affinity,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "set_irq_affinity(plan)\n"
+		"Writes the CPUs of each (irq, cpus) pair of the plan to "
+		"/proc/irq/<irq>/smp_affinity_list, cpus being a CPU number or an "
+		"iterable of them."
+	},
+	{
+		.ml_name = "get_topology",
+		.ml_meth = (PyCFunction)topo_get_topology,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_topology(devname, refresh=False)\n"
+		"Returns the NUMA node, local CPUs, PCI address and PCIe link "
+		"(speeds in GT/s, widths in lanes, current and max) of a device, "
+		"the PCI bridges above it, nearest first, and the interfaces of the "
+		"other functions of its PCI slot.  Cached after the first call for "
+		"a device unless refresh=True."
+	},
+	{
+		.ml_name = "get_netdev_queues",
+		.ml_meth = (PyCFunction)netdev_get_queues,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_netdev_queues(devname=None)\n"
+		"Returns a NetdevTable of the queues of a device, or of all devices, "
+		"from the netdev generic netlink family: ifindex, type (0 for rx, "
+		"1 for tx), id, the NAPI id and the per queue statistics.  Raises "
+		"IOError with EOPNOTSUPP on kernels without the family."
+	},
+	{
+		.ml_name = "get_netdev_napis",
+		.ml_meth = (PyCFunction)netdev_get_napis,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_netdev_napis(devname=None)\n"
+		"Returns a NetdevTable of the NAPI instances of a device, or of all "
+		"devices, with their IRQ, kthread pid and deferral settings."
+	},
+	{
+		.ml_name = "set_netdev_napi",
+		.ml_meth = (PyCFunction)netdev_set_napi,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "set_netdev_napi(napi_id, defer_hard_irqs=None, "
+		"gro_flush_timeout=None, irq_suspend_timeout=None)\n"
+		"Writes the given deferral settings of a single NAPI instance, by "
+		"the id get_netdev_napis() reports.  Raises IOError with EOPNOTSUPP "
+		"on kernels before 6.13."
+	},
+	{
+		.ml_name = "get_page_pools",
+		.ml_meth = (PyCFunction)netdev_get_page_pools,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_page_pools(devname=None)\n"
+		"Returns a NetdevTable of the page pools of a device, or of all "
+		"devices, with their pages in flight and, on kernels built with "
+		"CONFIG_PAGE_POOL_STATS, their allocation and recycling counters."
+	},
+	{
+		.ml_name = "get_flow_rules",
+		.ml_meth = (PyCFunction)flow_get_rules,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_flow_rules(devname)\n"
+		"Returns the RX flow classification (ntuple) rules of a device as "
+		"a list of FlowRules, by location."
+	},
+	{
+		.ml_name = "add_flow_rules",
+		.ml_meth = (PyCFunction)flow_add_rules,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "add_flow_rules(devname, rules)\n"
+		"Inserts FlowRules and returns their locations.  Rules without a "
+		"location get one from the driver, or the last free one.  The rules "
+		"inserted before a failure stay."
+	},
+	{
+		.ml_name = "delete_flow_rules",
+		.ml_meth = (PyCFunction)flow_delete_rules,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "delete_flow_rules(devname, locations)\n"
+		"Deletes the rules at the locations, given as numbers or FlowRules."
+	},
+	{
+		.ml_name = "diff_flow_rules",
+		.ml_meth = (PyCFunction)flow_diff_rules,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "diff_flow_rules(installed, rules)\n"
+		"Returns the FlowRules of rules which sync_flow_rules() would "
+		"insert over the installed ones, and the installed FlowRules it "
+		"would delete, without touching a device."
+	},
+	{
+		.ml_name = "sync_flow_rules",
+		.ml_meth = (PyCFunction)flow_sync_rules,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "sync_flow_rules(devname, rules, apply=True)\n"
+		"Makes the rules of a device those given, keeping the installed "
+		"rules equal to one of them and at its location if it has one, "
+		"deleting the others and inserting the missing ones.  Returns the "
+		"inserted FlowRules, with their locations if applied, and the "
+		"locations of the deleted rules."
+	},
+	{
+		.ml_name = "get_tunables",
+		.ml_meth = (PyCFunction)tunables_get,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_tunables(devname)\n"
+		"Returns a dict of the tunables the driver has, among rx_copybreak, "
+		"tx_copybreak, pfc_prevention_tout and tx_copybreak_buf_size."
+	},
+	{
+		.ml_name = "set_tunables",
+		.ml_meth = (PyCFunction)tunables_set,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "set_tunables(devname, tunables)\n"
+		"Sets the tunables of a dict, as returned by get_tunables().  The "
+		"tunables set before a failure stay."
+	},
+	{
+		.ml_name = "get_priv_flags",
+		.ml_meth = (PyCFunction)pflags_get,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_priv_flags(devname)\n"
+		"Returns a dict of the driver's private flags and whether they are "
+		"on, empty if it has none."
+	},
+	{
+		.ml_name = "set_priv_flags",
+		.ml_meth = (PyCFunction)pflags_set,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "set_priv_flags(devname, flags)\n"
+		"Turns the private flags of a dict of names and booleans on or off "
+		"at once, leaving the others as they are."
+	},
+	{
+		.ml_name = "get_link_settings",
+		.ml_meth = (PyCFunction)lset_get,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_link_settings(devname)\n"
+		"Returns a dict of the speed in Mb/s and duplex, None when unknown, "
+		"autoneg, port, phy_address and the supported, advertising and "
+		"lp_advertising link modes, named as the kernel does."
+	},
+	{
+		.ml_name = "set_link_settings",
+		.ml_meth = (PyCFunction)lset_set,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "set_link_settings(devname, speed=None, duplex=None, "
+		"autoneg=None, advertising=None)\n"
+		"Changes the given link settings, advertising being a sequence of "
+		"link modes."
+	},
+	{
+		.ml_name = "get_all_link_settings",
+		.ml_meth = (PyCFunction)lset_get_all,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_all_link_settings(refresh=False)\n"
+		"Returns a dict of the link settings of every device which has "
+		"them, by name.  They are cached until a link event about the "
+		"device, or refresh is set."
+	},
+	{
+		.ml_name = "open_published",
+		.ml_meth = (PyCFunction)shm_open_published,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "open_published(name)\n"
+		"Maps the interface state published by another process into the "
+		"shared memory file 'name'.  Returns a PublishedState object whose "
+		"read() method returns the latest snapshot without any system call "
+		"or lock."
+	},
 	{
 		.ml_name = "get_netmask",
 		.ml_meth = (PyCFunction)get_netmask,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_broadcast",
 		.ml_meth = (PyCFunction)get_broadcast,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_coalesce",
 		.ml_meth = (PyCFunction)get_coalesce,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "set_coalesce",
 		.ml_meth = (PyCFunction)set_coalesce,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
+	},
+	{
+		.ml_name = "get_napi",
+		.ml_meth = (PyCFunction)napi_get,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_napi(devname)\n"
+		"Returns napi_defer_hard_irqs, gro_flush_timeout and threaded of a "
+		"device, the global busy_poll and busy_read, None for those the "
+		"kernel or device lacks, and the threaded NAPI kthreads as dicts of "
+		"pid, name, napi_id and affinity."
+	},
+	{
+		.ml_name = "set_napi",
+		.ml_meth = (PyCFunction)napi_set,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "set_napi(devname, napi_defer_hard_irqs=None, "
+		"gro_flush_timeout=None, threaded=None, busy_poll=None, busy_read=None)\n"
+		"Writes the given settings.  napi_defer_hard_irqs and "
+		"gro_flush_timeout apply to every NAPI instance of the device, see "
+		"set_netdev_napi() for a single one.  busy_poll and busy_read are "
+		"global to the network namespace."
+	},
+	{
+		.ml_name = "set_napi_affinity",
+		.ml_meth = (PyCFunction)napi_set_affinity,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "set_napi_affinity(devname, cpus)\n"
+		"Pins the Nth threaded NAPI kthread of a device, by NAPI id, to the "
+		"Nth of the CPUs, round robin.  Returns a list of (pid, cpu)."
 	},
 	{
 		.ml_name = "get_devices",
 		.ml_meth = (PyCFunction)get_devices,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_active_devices",
 		.ml_meth = (PyCFunction)get_active_devices,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_ringparam",
 		.ml_meth = (PyCFunction)get_ringparam,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "set_ringparam",
 		.ml_meth = (PyCFunction)set_ringparam,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
+	},
+	{
+		.ml_name = "get_pauseparam",
+		.ml_meth = (PyCFunction)get_pauseparam,
+		.ml_flags = METH_ETH_FASTCALL,
+	},
+	{
+		.ml_name = "set_pauseparam",
+		.ml_meth = (PyCFunction)set_pauseparam,
+		.ml_flags = METH_ETH_FASTCALL,
+	},
+	{
+		.ml_name = "get_pause_stats",
+		.ml_meth = (PyCFunction)pause_get_stats,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = "get_pause_stats(devname)\n"
+		"Returns the tx_frames and rx_frames pause frame counters of a "
+		"device, those the driver reports, from the ethtool netlink family."
+	},
+	{
+		.ml_name = "get_eee",
+		.ml_meth = (PyCFunction)get_eee,
+		.ml_flags = METH_ETH_FASTCALL,
+	},
+	{
+		.ml_name = "set_eee",
+		.ml_meth = (PyCFunction)set_eee,
+		.ml_flags = METH_ETH_FASTCALL,
+	},
+	{
+		.ml_name = "get_ts_info",
+		.ml_meth = (PyCFunction)get_ts_info,
+		.ml_flags = METH_ETH_FASTCALL,
+		.ml_doc = "get_ts_info(devname)\n"
+		"Returns the so_timestamping flags, tx_types and rx_filters a "
+		"device supports, by name, and the phc_index and ptp_clock device "
+		"of its PTP hardware clock, None if it has none."
+	},
+	{
+		.ml_name = "get_hwtstamp",
+		.ml_meth = (PyCFunction)get_hwtstamp,
+		.ml_flags = METH_ETH_FASTCALL,
+		.ml_doc = "get_hwtstamp(devname)\n"
+		"Returns the hardware time stamping tx_type, rx_filter and flags "
+		"of a device."
+	},
+	{
+		.ml_name = "set_hwtstamp",
+		.ml_meth = (PyCFunction)set_hwtstamp,
+		.ml_flags = METH_ETH_FASTCALL,
+		.ml_doc = "set_hwtstamp(devname, config)\n"
+		"Sets the tx_type and rx_filter, and optionally flags, of a dict as "
+		"get_hwtstamp() returns.  Returns what the driver applied, whose "
+		"rx_filter may match more packets."
 	},
 	{
 		.ml_name = "get_tso",
 		.ml_meth = (PyCFunction)get_tso,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "set_tso",
 		.ml_meth = (PyCFunction)set_tso,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_ufo",
 		.ml_meth = (PyCFunction)get_ufo,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_gso",
 		.ml_meth = (PyCFunction)get_gso,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_sg",
 		.ml_meth = (PyCFunction)get_sg,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{
 		.ml_name = "get_flags",
 		.ml_meth = (PyCFunction)get_flags,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_ETH_FASTCALL,
 	},
 	{	.ml_name = NULL, },
 };
 
-#if PY_MAJOR_VERSION >= 3
-  #define MOD_ERROR_VAL NULL
-  #define MOD_SUCCESS_VAL(val) val
-  #define MOD_INIT(name) PyMODINIT_FUNC PyInit_##name(void)
-  #define MOD_DEF(ob, name, doc, methods) \
-          static struct PyModuleDef moduledef = { \
-            PyModuleDef_HEAD_INIT, name, doc, -1, methods, }; \
-          ob = PyModule_Create(&moduledef);
-#else
-  #define MOD_ERROR_VAL
-  #define MOD_SUCCESS_VAL(val)
-  #define MOD_INIT(name) void init##name(void)
-  #define MOD_DEF(ob, name, doc, methods) \
-          ob = Py_InitModule3(name, methods, doc);
-#endif
-
-MOD_INIT(ethtool)
+/**
+ * Initialises a new instance of the ethtool module
+ *
+ * @param m The module object being set up
+ *
+ * @return Returns 0 on success, otherwise -1 with a Python exception set
+ */
+static int ethtool_exec(PyObject *m)
 {
-	PyObject *m;
-	MOD_DEF(m, "ethtool", "Python ethtool module", PyEthModuleMethods);
+	ethtoolState *state = get_ethtool_state(m);
+
+	// Before anything can fail, as ethtool_free() closes it
+	state->ioctl_fd = -1;
 
 	// Prepare the ethtool.etherinfo class
 	if (PyType_Ready(&PyEtherInfo_Type) < 0)
-		return MOD_ERROR_VAL;
+		return -1;
+	if (PyType_Ready(&PyEtherInfoIter_Type) < 0)
+		return -1;
 
 	// Prepare the ethtool IPv6 and IPv4 address types
 	if (PyType_Ready(&ethtool_netlink_ip_address_Type))
-		return MOD_ERROR_VAL;
+		return -1;
+
+	// Prepare the snapshot, shared memory, metrics, recorder and tuning types
+	if (PyType_Ready(&PySnapshot_Type) < 0 ||
+	    PyType_Ready(&PyPublisher_Type) < 0 ||
+	    PyType_Ready(&PyPublishedState_Type) < 0 ||
+	    PyType_Ready(&PyMetricsRenderer_Type) < 0 ||
+	    PyType_Ready(&PyRecorder_Type) < 0 ||
+	    PyType_Ready(&PyRecording_Type) < 0 ||
+	    PyType_Ready(&PyCoalesceController_Type) < 0 ||
+	    PyType_Ready(&PyRingAdvisor_Type) < 0 ||
+	    PyType_Ready(&PyQueueSteering_Type) < 0 ||
+	    PyType_Ready(&PyNetdevTable_Type) < 0 ||
+	    PyType_Ready(&PyFlowRule_Type) < 0)
+		return -1;
+
+	// Flow rules are built by the caller
+	Py_INCREF(&PyFlowRule_Type);
+	if (PyModule_AddObject(m, "FlowRule", (PyObject *)&PyFlowRule_Type) < 0) {
+		Py_DECREF(&PyFlowRule_Type);
+		return -1;
+	}
+
+	// NETLINK connection used by the etherinfo objects of this module
+	state->nlc = nlc_new();
+	if (!state->nlc) {
+		PyErr_NoMemory();
+		return -1;
+	}
 
 	// Setup constants
 	PyModule_AddIntConstant(m, "IFF_UP", IFF_UP);			/* Interface is up. */
@@ -956,9 +1854,69 @@ MOD_INIT(ethtool)
 	PyModule_AddIntConstant(m, "AF_INET6", AF_INET6);               /* IPv6 interface */
 	PyModule_AddStringConstant(m, "version", "python-ethtool v" VERSION);
 
-	return MOD_SUCCESS_VAL(m);
+	return 0;
 }
 
+#if PY_MAJOR_VERSION >= 3
+static int ethtool_clear(PyObject *m)
+{
+	ethtoolState *state = get_ethtool_state(m);
+
+	nlc_put(state->nlc);
+	state->nlc = NULL;
+	if (state->ioctl_fd >= 0) {
+		close(state->ioctl_fd);
+		state->ioctl_fd = -1;
+	}
+	return 0;
+}
+
+static void ethtool_free(void *m)
+{
+	ethtool_clear((PyObject *)m);
+}
+
+static PyModuleDef_Slot ethtool_slots[] = {
+	{ Py_mod_exec, (void *)ethtool_exec },
+#ifdef Py_mod_multiple_interpreters
+	/* The etherinfo types are static, so they can't be shared between
+	 * interpreters having their own GIL */
+	{ Py_mod_multiple_interpreters, Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED },
+#endif
+#ifdef Py_mod_gil
+	{ Py_mod_gil, Py_MOD_GIL_NOT_USED },
+#endif
+	{ 0, NULL },
+};
+
+static struct PyModuleDef ethtool_moduledef = {
+	PyModuleDef_HEAD_INIT,
+	.m_name = "ethtool",
+	.m_doc = "Python ethtool module",
+	.m_size = sizeof(ethtoolState),
+	.m_methods = PyEthModuleMethods,
+	.m_slots = ethtool_slots,
+	.m_clear = ethtool_clear,
+	.m_free = ethtool_free,
+};
+
+PyMODINIT_FUNC PyInit_ethtool(void)
+{
+	return PyModuleDef_Init(&ethtool_moduledef);
+}
+#else
+PyMODINIT_FUNC initethtool(void)
+{
+	PyObject *m;
+
+	m = Py_InitModule3("ethtool", PyEthModuleMethods, "Python ethtool module");
+	if (m == NULL)
+		return;
+
+	ethtool_exec(m);
+}
+#endif
+
 
 /*
 Local variables:
@@ -0,0 +1,90 @@
+/* ethtool.h - Definitions shared by the ETHTOOL ioctl based functions
+ *
+ * Copyright (C) 2008-2013 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _ETHTOOL_H
+#define _ETHTOOL_H
+
+#include <Python.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+typedef unsigned long long u64;
+typedef __uint32_t u32;
+typedef __int32_t s32;
+typedef __uint16_t u16;
+typedef __uint8_t u8;
+typedef __int8_t s8;
+
+#include "ethtool-copy.h"
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+/**
+ * Describes one member of an ETHTOOL struct, so it can be converted
+ * to and from a Python dict entry of the same name
+ */
+struct struct_desc {
+	char	       *name;
+	unsigned short offset;
+	unsigned short size;
+};
+
+#define member_desc(type, member_name) { \
+	.name = #member_name, \
+	.offset = offsetof(type, member_name), \
+	.size = sizeof(((type *)0)->member_name), }
+
+extern struct struct_desc ethtool_coalesce_desc[];
+extern const int ethtool_coalesce_desc_len;
+extern struct struct_desc ethtool_ringparam_desc[];
+extern const int ethtool_ringparam_desc_len;
+extern struct struct_desc ethtool_pauseparam_desc[];
+extern const int ethtool_pauseparam_desc_len;
+extern struct struct_desc ethtool_eee_desc[];
+extern const int ethtool_eee_desc_len;
+
+PyObject *__struct_desc_create_dict(struct struct_desc *table,
+				    int nr_entries, void *values);
+
+#define struct_desc_create_dict(table, values) \
+	__struct_desc_create_dict(table, ARRAY_SIZE(table), values)
+
+/* common.c */
+uint64_t clock_now_ns(clockid_t clock);
+int dict_set_steal(PyObject *dict, const char *key, PyObject *value);
+int devname_to_bytes(PyObject *obj, PyObject **result);
+int devname_copy(PyObject *obj, char *buf);
+int devname_converter(PyObject *obj, void *addr);
+
+/**
+ * A background thread, stopped on request.  The thread polls stopping
+ * under a mutex of its owner, which worker_stop() and worker_sleep() take.
+ */
+struct worker {
+	pthread_cond_t wake;	/**< Wakes the thread up to stop */
+	pthread_t      thread;
+	int	       running;
+	int	       stopping;
+};
+
+void worker_init(struct worker *w);
+void worker_destroy(struct worker *w);
+int worker_start(struct worker *w, void *(*func)(void *), void *arg);
+void worker_stop(struct worker *w, pthread_mutex_t *lock);
+void worker_sleep(struct worker *w, pthread_mutex_t *lock, uint64_t deadline);
+
+#endif
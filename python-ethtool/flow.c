@@ -0,0 +1,1385 @@
+/* flow.c - RX network flow classification (ntuple) rules
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * An ethtool.FlowRule wraps a struct ethtool_rx_flow_spec.  Its match fields
+ * depend on the flow type and are given to the constructor as keyword
+ * arguments, each a value or a (value, mask) pair whose set mask bits are
+ * compared, as in the kernel.  Two rules are equal when they match the
+ * same packets and do the same with them, wherever they are in the table.
+ *
+ * All the rules of a device are read with ETHTOOL_GRXCLSRLALL, which gives
+ * their locations, and an ETHTOOL_GRXCLSRULE for each of them, and rules
+ * are inserted and deleted in bulk, all on one socket.  Drivers which do
+ * not pick locations themselves (no RX_CLS_LOC_SPECIAL) get the free one
+ * closest to the end of the table, as ethtool -N does.
+ */
+
+#include <Python.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/sockios.h>
+
+#include "flow.h"
+#include "ethtool.h"
+#include "backend.h"
+
+#if PY_MAJOR_VERSION < 3
+typedef long Py_hash_t;
+#endif
+
+#define FLOW_TYPE_MASK	(~(FLOW_EXT | FLOW_MAC_EXT | FLOW_RSS))
+
+/* Actions, besides a queue number */
+#define FLOW_ACTION_DROP	-1
+#define FLOW_ACTION_WAKE	-2
+
+enum {
+	FLOW_F_IP4,
+	FLOW_F_IP6,
+	FLOW_F_MAC,
+	FLOW_F_U8,
+	FLOW_F_BE16,
+	FLOW_F_BE32,
+	FLOW_F_BE64,
+};
+
+static const uint8_t flow_field_size[] = {
+	[FLOW_F_IP4] = 4,
+	[FLOW_F_IP6] = 16,
+	[FLOW_F_MAC] = ETH_ALEN,
+	[FLOW_F_U8] = 1,
+	[FLOW_F_BE16] = 2,
+	[FLOW_F_BE32] = 4,
+	[FLOW_F_BE64] = 8,
+};
+
+/**
+ * A match field, in h_u and m_u, or in h_ext and m_ext when flag is set
+ */
+struct flow_field {
+	const char *name;
+	uint8_t	   kind;
+	uint8_t	   offset;
+	uint32_t   flag;	/**< FLOW_EXT or FLOW_MAC_EXT, 0 for h_u */
+};
+
+#define FLOW_FIELD(name, kind, type, member) \
+	{ name, kind, offsetof(type, member), 0 }
+
+static const struct flow_field flow_tcpip4_fields[] = {
+	FLOW_FIELD("src_ip", FLOW_F_IP4, struct ethtool_tcpip4_spec, ip4src),
+	FLOW_FIELD("dst_ip", FLOW_F_IP4, struct ethtool_tcpip4_spec, ip4dst),
+	FLOW_FIELD("src_port", FLOW_F_BE16, struct ethtool_tcpip4_spec, psrc),
+	FLOW_FIELD("dst_port", FLOW_F_BE16, struct ethtool_tcpip4_spec, pdst),
+	FLOW_FIELD("tos", FLOW_F_U8, struct ethtool_tcpip4_spec, tos),
+	{ NULL }
+};
+
+static const struct flow_field flow_ah_espip4_fields[] = {
+	FLOW_FIELD("src_ip", FLOW_F_IP4, struct ethtool_ah_espip4_spec, ip4src),
+	FLOW_FIELD("dst_ip", FLOW_F_IP4, struct ethtool_ah_espip4_spec, ip4dst),
+	FLOW_FIELD("spi", FLOW_F_BE32, struct ethtool_ah_espip4_spec, spi),
+	FLOW_FIELD("tos", FLOW_F_U8, struct ethtool_ah_espip4_spec, tos),
+	{ NULL }
+};
+
+static const struct flow_field flow_usrip4_fields[] = {
+	FLOW_FIELD("src_ip", FLOW_F_IP4, struct ethtool_usrip4_spec, ip4src),
+	FLOW_FIELD("dst_ip", FLOW_F_IP4, struct ethtool_usrip4_spec, ip4dst),
+	FLOW_FIELD("l4_bytes", FLOW_F_BE32, struct ethtool_usrip4_spec, l4_4_bytes),
+	FLOW_FIELD("tos", FLOW_F_U8, struct ethtool_usrip4_spec, tos),
+	FLOW_FIELD("l4_proto", FLOW_F_U8, struct ethtool_usrip4_spec, proto),
+	{ NULL }
+};
+
+static const struct flow_field flow_tcpip6_fields[] = {
+	FLOW_FIELD("src_ip", FLOW_F_IP6, struct ethtool_tcpip6_spec, ip6src),
+	FLOW_FIELD("dst_ip", FLOW_F_IP6, struct ethtool_tcpip6_spec, ip6dst),
+	FLOW_FIELD("src_port", FLOW_F_BE16, struct ethtool_tcpip6_spec, psrc),
+	FLOW_FIELD("dst_port", FLOW_F_BE16, struct ethtool_tcpip6_spec, pdst),
+	FLOW_FIELD("tclass", FLOW_F_U8, struct ethtool_tcpip6_spec, tclass),
+	{ NULL }
+};
+
+static const struct flow_field flow_ah_espip6_fields[] = {
+	FLOW_FIELD("src_ip", FLOW_F_IP6, struct ethtool_ah_espip6_spec, ip6src),
+	FLOW_FIELD("dst_ip", FLOW_F_IP6, struct ethtool_ah_espip6_spec, ip6dst),
+	FLOW_FIELD("spi", FLOW_F_BE32, struct ethtool_ah_espip6_spec, spi),
+	FLOW_FIELD("tclass", FLOW_F_U8, struct ethtool_ah_espip6_spec, tclass),
+	{ NULL }
+};
+
+static const struct flow_field flow_usrip6_fields[] = {
+	FLOW_FIELD("src_ip", FLOW_F_IP6, struct ethtool_usrip6_spec, ip6src),
+	FLOW_FIELD("dst_ip", FLOW_F_IP6, struct ethtool_usrip6_spec, ip6dst),
+	FLOW_FIELD("l4_bytes", FLOW_F_BE32, struct ethtool_usrip6_spec, l4_4_bytes),
+	FLOW_FIELD("tclass", FLOW_F_U8, struct ethtool_usrip6_spec, tclass),
+	FLOW_FIELD("l4_proto", FLOW_F_U8, struct ethtool_usrip6_spec, l4_proto),
+	{ NULL }
+};
+
+static const struct flow_field flow_ether_fields[] = {
+	FLOW_FIELD("dst_mac", FLOW_F_MAC, struct ethhdr, h_dest),
+	FLOW_FIELD("src_mac", FLOW_F_MAC, struct ethhdr, h_source),
+	FLOW_FIELD("ethertype", FLOW_F_BE16, struct ethhdr, h_proto),
+	{ NULL }
+};
+
+/* Fields of every flow type but ether, which has its own dst_mac */
+static const struct flow_field flow_ext_fields[] = {
+	{ "vlan_etype", FLOW_F_BE16, offsetof(struct ethtool_flow_ext, vlan_etype), FLOW_EXT },
+	{ "vlan_tci", FLOW_F_BE16, offsetof(struct ethtool_flow_ext, vlan_tci), FLOW_EXT },
+	{ "user_def", FLOW_F_BE64, offsetof(struct ethtool_flow_ext, data), FLOW_EXT },
+	{ "dst_mac", FLOW_F_MAC, offsetof(struct ethtool_flow_ext, h_dest), FLOW_MAC_EXT },
+	{ NULL }
+};
+
+static const struct {
+	const char		*name;
+	uint32_t		type;
+	const struct flow_field *fields;
+} flow_types[] = {
+	{ "tcp4", TCP_V4_FLOW, flow_tcpip4_fields },
+	{ "udp4", UDP_V4_FLOW, flow_tcpip4_fields },
+	{ "sctp4", SCTP_V4_FLOW, flow_tcpip4_fields },
+	{ "ah4", AH_V4_FLOW, flow_ah_espip4_fields },
+	{ "esp4", ESP_V4_FLOW, flow_ah_espip4_fields },
+	{ "ip4", IPV4_USER_FLOW, flow_usrip4_fields },
+	{ "tcp6", TCP_V6_FLOW, flow_tcpip6_fields },
+	{ "udp6", UDP_V6_FLOW, flow_tcpip6_fields },
+	{ "sctp6", SCTP_V6_FLOW, flow_tcpip6_fields },
+	{ "ah6", AH_V6_FLOW, flow_ah_espip6_fields },
+	{ "esp6", ESP_V6_FLOW, flow_ah_espip6_fields },
+	{ "ip6", IPV6_USER_FLOW, flow_usrip6_fields },
+	{ "ether", ETHER_FLOW, flow_ether_fields },
+};
+
+/**
+ * The ethtool.FlowRule object
+ */
+typedef struct {
+	PyObject_HEAD
+	struct ethtool_rx_flow_spec fs;
+} PyFlowRule;
+
+/**
+ * The rules of a device and the locations in use
+ */
+struct flow_table {
+	uint32_t		    size;	/**< Of the table of the device */
+	int			    special;	/**< Driver picks locations */
+	uint32_t		    nr_rules;
+	struct ethtool_rx_flow_spec *rules;
+	uint8_t			    *used;	/**< A byte per location */
+};
+
+static int flow_type_index(uint32_t flow_type)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(flow_types); i++) {
+		if (flow_types[i].type == (flow_type & FLOW_TYPE_MASK))
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * @return Returns the field of a rule of the flow type, or NULL
+ */
+static const struct flow_field *flow_find_field(int type, const char *name)
+{
+	const struct flow_field *f;
+
+	for (f = flow_types[type].fields; f->name; f++) {
+		if (strcmp(f->name, name) == 0)
+			return f;
+	}
+	for (f = flow_ext_fields; f->name; f++) {
+		if (strcmp(f->name, name) == 0)
+			return f;
+	}
+	return NULL;
+}
+
+static uint8_t *flow_value_ptr(struct ethtool_rx_flow_spec *fs,
+			       const struct flow_field *f, int mask)
+{
+	if (f->flag)
+		return (uint8_t *)(mask ? &fs->m_ext : &fs->h_ext) + f->offset;
+	return (mask ? fs->m_u.hdata : fs->h_u.hdata) + f->offset;
+}
+
+static int flow_field_present(const struct ethtool_rx_flow_spec *fs,
+			      const struct flow_field *f)
+{
+	const uint8_t *mask = flow_value_ptr((struct ethtool_rx_flow_spec *)fs, f, 1);
+	int i;
+
+	if (f->flag && !(fs->flow_type & f->flag))
+		return 0;
+	for (i = 0; i < flow_field_size[f->kind]; i++) {
+		if (mask[i])
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * The rule with the fields it does not compare cleared, for comparisons.
+ * Some drivers report FLOW_EXT without matching any of its fields, so the
+ * extension flags are only kept for the fields which are matched.
+ */
+static void flow_normalize(const struct ethtool_rx_flow_spec *fs,
+			   struct ethtool_rx_flow_spec *key)
+{
+	const struct flow_field *f;
+	const uint8_t *h, *m;
+	uint8_t *kh, *km;
+	size_t i;
+
+	memset(key, 0, sizeof(*key));
+	key->flow_type = fs->flow_type & FLOW_TYPE_MASK;
+	key->m_u = fs->m_u;
+	h = fs->h_u.hdata;
+	kh = key->h_u.hdata;
+	for (i = 0; i < sizeof(fs->h_u); i++)
+		kh[i] = h[i] & fs->m_u.hdata[i];
+	for (f = flow_ext_fields; f->name; f++) {
+		if (!flow_field_present(fs, f))
+			continue;
+		key->flow_type |= f->flag;
+		h = flow_value_ptr((struct ethtool_rx_flow_spec *)fs, f, 0);
+		m = flow_value_ptr((struct ethtool_rx_flow_spec *)fs, f, 1);
+		kh = flow_value_ptr(key, f, 0);
+		km = flow_value_ptr(key, f, 1);
+		for (i = 0; i < flow_field_size[f->kind]; i++) {
+			km[i] = m[i];
+			kh[i] = h[i] & m[i];
+		}
+	}
+	key->ring_cookie = fs->ring_cookie;
+}
+
+static int flow_key_cmp(const void *a, const void *b)
+{
+	return memcmp(a, b, sizeof(struct ethtool_rx_flow_spec));
+}
+
+/* A str on both Python 2 and 3 */
+static PyObject *flow_native_str(const char *s)
+{
+#if PY_MAJOR_VERSION >= 3
+	return PyUnicode_FromString(s);
+#else
+	return PyString_FromString(s);
+#endif
+}
+
+/**
+ * Converts a value or a mask of a field to Python
+ */
+static PyObject *flow_field_to_python(const struct flow_field *f, const uint8_t *p)
+{
+	char buf[INET6_ADDRSTRLEN];
+	uint32_t hi, lo;
+	uint16_t v16;
+
+	switch (f->kind) {
+	case FLOW_F_IP4:
+		return flow_native_str(inet_ntop(AF_INET, p, buf, sizeof(buf)));
+	case FLOW_F_IP6:
+		return flow_native_str(inet_ntop(AF_INET6, p, buf, sizeof(buf)));
+	case FLOW_F_MAC:
+		snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x",
+			 p[0], p[1], p[2], p[3], p[4], p[5]);
+		return flow_native_str(buf);
+	case FLOW_F_U8:
+		return PyLong_FromLong(*p);
+	case FLOW_F_BE16:
+		memcpy(&v16, p, 2);
+		return PyLong_FromLong(ntohs(v16));
+	case FLOW_F_BE32:
+		memcpy(&lo, p, 4);
+		return PyLong_FromUnsignedLong(ntohl(lo));
+	default:
+		memcpy(&hi, p, 4);
+		memcpy(&lo, p + 4, 4);
+		return PyLong_FromUnsignedLongLong((uint64_t)ntohl(hi) << 32 | ntohl(lo));
+	}
+}
+
+/**
+ * Copies a str, unicode or bytes object into buf
+ *
+ * @return Returns 0 on success, or -1 with a Python exception set
+ */
+static int flow_cstr(PyObject *obj, char *buf, size_t size)
+{
+	PyObject *bytes;
+	int rc = 0;
+
+	if (PyUnicode_Check(obj)) {
+		bytes = PyUnicode_AsUTF8String(obj);
+		if (!bytes)
+			return -1;
+	} else if (PyBytes_Check(obj)) {
+		bytes = obj;
+		Py_INCREF(bytes);
+	} else {
+		PyErr_SetString(PyExc_TypeError, "an address must be a string");
+		return -1;
+	}
+	if ((size_t)PyBytes_GET_SIZE(bytes) >= size) {
+		PyErr_SetString(PyExc_ValueError, "address too long");
+		rc = -1;
+	} else {
+		strcpy(buf, PyBytes_AS_STRING(bytes));
+	}
+	Py_DECREF(bytes);
+	return rc;
+}
+
+/**
+ * Converts a value or a mask of a field from Python.  An address value may
+ * carry a prefix length, like "10.0.0.0/8", which then gives the mask.
+ *
+ * @param p      Receives the field, in network byte order
+ * @param prefix Receives the mask of the prefix, if not NULL and given
+ *
+ * @return Returns 1 if a prefix was given, 0 if not, or -1 with a Python
+ *         exception set
+ */
+static int flow_field_from_python(const struct flow_field *f, PyObject *obj,
+				  uint8_t *p, uint8_t *prefix)
+{
+	unsigned long long v, max;
+	char buf[64], *slash, *end;
+	unsigned int mac[ETH_ALEN];
+	PyObject *num;
+	char extra;
+	uint32_t v32;
+	uint16_t v16;
+	long bits;
+	int i, size = flow_field_size[f->kind];
+
+	if (f->kind == FLOW_F_IP4 || f->kind == FLOW_F_IP6) {
+		if (flow_cstr(obj, buf, sizeof(buf)) < 0)
+			return -1;
+		slash = strchr(buf, '/');
+		if (slash)
+			*slash++ = '\0';
+		if (inet_pton(f->kind == FLOW_F_IP4 ? AF_INET : AF_INET6, buf, p) != 1) {
+			PyErr_Format(PyExc_ValueError, "%s: invalid address '%s'", f->name, buf);
+			return -1;
+		}
+		if (!slash)
+			return 0;
+		bits = strtol(slash, &end, 10);
+		if (!prefix || *end || end == slash || bits < 0 || bits > size * 8) {
+			PyErr_Format(PyExc_ValueError, "%s: invalid prefix length", f->name);
+			return -1;
+		}
+		memset(prefix, 0, size);
+		for (i = 0; i < bits; i++)
+			prefix[i / 8] |= 0x80 >> (i % 8);
+		return 1;
+	}
+	if (f->kind == FLOW_F_MAC) {
+		if (flow_cstr(obj, buf, sizeof(buf)) < 0)
+			return -1;
+		if (sscanf(buf, "%2x:%2x:%2x:%2x:%2x:%2x%c", &mac[0], &mac[1], &mac[2],
+			   &mac[3], &mac[4], &mac[5], &extra) != 6) {
+			PyErr_Format(PyExc_ValueError, "%s: invalid MAC address '%s'", f->name, buf);
+			return -1;
+		}
+		for (i = 0; i < ETH_ALEN; i++)
+			p[i] = mac[i];
+		return 0;
+	}
+
+	if (!PyLong_Check(obj)
+#if PY_MAJOR_VERSION < 3
+	    && !PyInt_Check(obj)
+#endif
+	    ) {
+		PyErr_Format(PyExc_TypeError, "%s must be an integer", f->name);
+		return -1;
+	}
+	num = PyNumber_Long(obj);
+	if (!num)
+		return -1;
+	v = PyLong_AsUnsignedLongLong(num);
+	Py_DECREF(num);
+	max = size == 8 ? ~0ULL : (1ULL << (size * 8)) - 1;
+	if ((v == (unsigned long long)-1 && PyErr_Occurred()) || v > max) {
+		PyErr_Clear();
+		PyErr_Format(PyExc_ValueError, "%s out of range", f->name);
+		return -1;
+	}
+	switch (f->kind) {
+	case FLOW_F_U8:
+		*p = v;
+		break;
+	case FLOW_F_BE16:
+		v16 = htons(v);
+		memcpy(p, &v16, 2);
+		break;
+	case FLOW_F_BE32:
+		v32 = htonl(v);
+		memcpy(p, &v32, 4);
+		break;
+	default:
+		v32 = htonl(v >> 32);
+		memcpy(p, &v32, 4);
+		v32 = htonl(v);
+		memcpy(p + 4, &v32, 4);
+		break;
+	}
+	return 0;
+}
+
+/**
+ * Sets a field of a rule from a value or a (value, mask) pair
+ *
+ * @return Returns 0 on success, or -1 with a Python exception set
+ */
+static int flow_set_field(struct ethtool_rx_flow_spec *fs, const struct flow_field *f,
+			  PyObject *obj)
+{
+	uint8_t *value = flow_value_ptr(fs, f, 0), *mask = flow_value_ptr(fs, f, 1);
+	PyObject *value_obj = obj, *mask_obj = NULL;
+	uint8_t prefix[16];
+	int size = flow_field_size[f->kind], rc, i;
+
+	if (PyTuple_Check(obj) &&
+	    !PyArg_ParseTuple(obj, "OO;a field is a value or a (value, mask) pair",
+			      &value_obj, &mask_obj))
+		return -1;
+	rc = flow_field_from_python(f, value_obj, value, mask_obj ? NULL : prefix);
+	if (rc < 0)
+		return -1;
+	if (mask_obj) {
+		if (flow_field_from_python(f, mask_obj, mask, NULL) < 0)
+			return -1;
+	} else if (rc) {
+		memcpy(mask, prefix, size);
+	} else {
+		memset(mask, 0xff, size);
+	}
+	for (i = 0; i < size; i++)
+		value[i] &= mask[i];
+	fs->flow_type |= f->flag;
+	return 0;
+}
+
+static int flow_action_to_cookie(long action, unsigned int vf, __u64 *cookie)
+{
+	if (action == FLOW_ACTION_DROP)
+		*cookie = RX_CLS_FLOW_DISC;
+	else if (action == FLOW_ACTION_WAKE)
+		*cookie = RX_CLS_FLOW_WAKE;
+	else if (action < 0 || (unsigned long)action > 0xffffffffUL || vf > 0xff)
+		return -1;
+	else
+		*cookie = (uint64_t)action | (uint64_t)vf << ETHTOOL_RX_FLOW_SPEC_RING_VF_OFF;
+	return 0;
+}
+
+static PyObject *flow_wrap(const struct ethtool_rx_flow_spec *fs)
+{
+	PyFlowRule *rule = PyObject_New(PyFlowRule, &PyFlowRule_Type);
+
+	if (rule)
+		rule->fs = *fs;
+	return (PyObject *)rule;
+}
+
+static const char *flow_key_name(PyObject *key)
+{
+#if PY_MAJOR_VERSION >= 3
+	return PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : NULL;
+#else
+	return PyString_Check(key) ? PyString_AsString(key) : NULL;
+#endif
+}
+
+/**
+ * ethtool.FlowRule(flow_type, action=0, location=None, vf=0, **fields)
+ */
+static PyObject *flow_rule_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "flow_type", "action", "location", "vf", NULL };
+	struct ethtool_rx_flow_spec fs;
+	const struct flow_field *f;
+	PyObject *location = Py_None, *fixed, *fields, *key, *value;
+	PyFlowRule *rule = NULL;
+	const char *type_name, *name;
+	unsigned int vf = 0;
+	Py_ssize_t pos = 0;
+	long action = 0;
+	int t;
+
+	/* The match fields are told apart from the fixed arguments by name */
+	fixed = PyDict_New();
+	fields = PyDict_New();
+	if (!fixed || !fields)
+		goto out;
+	while (kwds && PyDict_Next(kwds, &pos, &key, &value)) {
+		if (!(name = flow_key_name(key))) {
+			PyErr_SetString(PyExc_TypeError, "keywords must be strings");
+			goto out;
+		}
+		if (PyDict_SetItem(strcmp(name, "flow_type") && strcmp(name, "action") &&
+				   strcmp(name, "location") && strcmp(name, "vf") ?
+				   fields : fixed, key, value) < 0)
+			goto out;
+	}
+	if (!PyArg_ParseTupleAndKeywords(args, fixed, "s|lOI:FlowRule", kwlist,
+					 &type_name, &action, &location, &vf))
+		goto out;
+	for (t = 0; t < (int)ARRAY_SIZE(flow_types); t++) {
+		if (strcmp(flow_types[t].name, type_name) == 0)
+			break;
+	}
+	if (t == (int)ARRAY_SIZE(flow_types)) {
+		PyErr_Format(PyExc_ValueError, "unknown flow type '%s'", type_name);
+		goto out;
+	}
+
+	memset(&fs, 0, sizeof(fs));
+	fs.flow_type = flow_types[t].type;
+	if (fs.flow_type == IPV4_USER_FLOW)
+		fs.h_u.usr_ip4_spec.ip_ver = ETH_RX_NFC_IP4;
+	pos = 0;
+	while (PyDict_Next(fields, &pos, &key, &value)) {
+		name = flow_key_name(key);
+		if (!(f = flow_find_field(t, name))) {
+			PyErr_Format(PyExc_TypeError, "%s rules have no field '%s'",
+				     type_name, name);
+			goto out;
+		}
+		if (flow_set_field(&fs, f, value) < 0)
+			goto out;
+	}
+	if (flow_action_to_cookie(action, vf, &fs.ring_cookie) < 0) {
+		PyErr_SetString(PyExc_ValueError,
+				"action must be a queue, -1 to drop or -2 to wake");
+		goto out;
+	}
+	fs.location = RX_CLS_LOC_ANY;
+	if (location != Py_None) {
+		unsigned long loc = PyLong_AsUnsignedLong(location);
+
+		if ((loc == (unsigned long)-1 && PyErr_Occurred()) || loc >= RX_CLS_LOC_SPECIAL) {
+			PyErr_Clear();
+			PyErr_SetString(PyExc_ValueError, "invalid location");
+			goto out;
+		}
+		fs.location = loc;
+	}
+	rule = (PyFlowRule *)type->tp_alloc(type, 0);
+	if (rule)
+		rule->fs = fs;
+ out:
+	Py_XDECREF(fixed);
+	Py_XDECREF(fields);
+	return (PyObject *)rule;
+}
+
+static PyObject *flow_rule_flow_type(PyFlowRule *self, void *unused __unused)
+{
+	int t = flow_type_index(self->fs.flow_type);
+
+	if (t < 0)
+		return PyLong_FromUnsignedLong(self->fs.flow_type & FLOW_TYPE_MASK);
+	return flow_native_str(flow_types[t].name);
+}
+
+static PyObject *flow_rule_action(PyFlowRule *self, void *unused __unused)
+{
+	if (self->fs.ring_cookie == RX_CLS_FLOW_DISC)
+		return PyLong_FromLong(FLOW_ACTION_DROP);
+	if (self->fs.ring_cookie == RX_CLS_FLOW_WAKE)
+		return PyLong_FromLong(FLOW_ACTION_WAKE);
+	return PyLong_FromUnsignedLong(self->fs.ring_cookie & ETHTOOL_RX_FLOW_SPEC_RING);
+}
+
+static PyObject *flow_rule_vf(PyFlowRule *self, void *unused __unused)
+{
+	if (self->fs.ring_cookie == RX_CLS_FLOW_DISC ||
+	    self->fs.ring_cookie == RX_CLS_FLOW_WAKE)
+		return PyLong_FromLong(0);
+	return PyLong_FromUnsignedLong((self->fs.ring_cookie & ETHTOOL_RX_FLOW_SPEC_RING_VF) >>
+				       ETHTOOL_RX_FLOW_SPEC_RING_VF_OFF);
+}
+
+static PyObject *flow_rule_location(PyFlowRule *self, void *unused __unused)
+{
+	if (self->fs.location & RX_CLS_LOC_SPECIAL)
+		Py_RETURN_NONE;
+	return PyLong_FromUnsignedLong(self->fs.location);
+}
+
+/**
+ * Calls func for each field of the rule which is compared
+ *
+ * @return Returns 0, or -1 as soon as func does
+ */
+static int flow_for_each_field(const PyFlowRule *self,
+			       int (*func)(const struct flow_field *f, void *arg), void *arg)
+{
+	const struct flow_field *f;
+	int t = flow_type_index(self->fs.flow_type);
+
+	if (t < 0)
+		return 0;
+	for (f = flow_types[t].fields; f->name; f++) {
+		if (flow_field_present(&self->fs, f) && func(f, arg) < 0)
+			return -1;
+	}
+	for (f = flow_ext_fields; f->name; f++) {
+		/* ether rules have their own dst_mac */
+		if (flow_find_field(t, f->name) != f)
+			continue;
+		if (flow_field_present(&self->fs, f) && func(f, arg) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+struct flow_fields_arg {
+	PyFlowRule *self;
+	PyObject   *dict;
+};
+
+static int flow_add_field(const struct flow_field *f, void *arg)
+{
+	struct flow_fields_arg *a = arg;
+	PyObject *pair;
+	int rc;
+
+	pair = Py_BuildValue("(NN)",
+			     flow_field_to_python(f, flow_value_ptr(&a->self->fs, f, 0)),
+			     flow_field_to_python(f, flow_value_ptr(&a->self->fs, f, 1)));
+	if (!pair)
+		return -1;
+	rc = PyDict_SetItemString(a->dict, f->name, pair);
+	Py_DECREF(pair);
+	return rc;
+}
+
+static PyObject *flow_rule_fields(PyFlowRule *self, void *unused __unused)
+{
+	struct flow_fields_arg a = { self, PyDict_New() };
+
+	if (a.dict && flow_for_each_field(self, flow_add_field, &a) < 0)
+		Py_CLEAR(a.dict);
+	return a.dict;
+}
+
+/* Match fields read as attributes, None when the rule does not compare them */
+static PyObject *flow_rule_getattro(PyFlowRule *self, PyObject *name)
+{
+	const struct flow_field *f;
+	PyObject *value;
+	const char *s;
+	int t;
+
+	value = PyObject_GenericGetAttr((PyObject *)self, name);
+	if (value || !PyErr_ExceptionMatches(PyExc_AttributeError))
+		return value;
+	t = flow_type_index(self->fs.flow_type);
+	if (t < 0 || !(s = flow_key_name(name)) || !(f = flow_find_field(t, s)))
+		return NULL;
+	PyErr_Clear();
+	if (!flow_field_present(&self->fs, f))
+		Py_RETURN_NONE;
+	return flow_field_to_python(f, flow_value_ptr(&self->fs, f, 0));
+}
+
+struct flow_repr_arg {
+	PyFlowRule *self;
+	PyObject   *parts;
+};
+
+static int flow_repr_field(const struct flow_field *f, void *arg)
+{
+	struct flow_repr_arg *a = arg;
+	const uint8_t *mask = flow_value_ptr(&a->self->fs, f, 1);
+	PyObject *value, *part;
+	int i, full = 1, rc;
+
+	for (i = 0; i < flow_field_size[f->kind]; i++)
+		full &= mask[i] == 0xff;
+	value = flow_field_to_python(f, flow_value_ptr(&a->self->fs, f, 0));
+	if (value && !full)
+		value = Py_BuildValue("(NN)", value, flow_field_to_python(f, mask));
+	if (!value)
+		return -1;
+	part = PyUnicode_FromFormat("%s=%R", f->name, value);
+	Py_DECREF(value);
+	if (!part)
+		return -1;
+	rc = PyList_Append(a->parts, part);
+	Py_DECREF(part);
+	return rc;
+}
+
+static PyObject *flow_rule_repr(PyFlowRule *self)
+{
+	struct flow_repr_arg a = { self, PyList_New(0) };
+	PyObject *type, *sep, *joined, *result = NULL, *part;
+
+	if (!a.parts)
+		return NULL;
+	type = flow_rule_flow_type(self, NULL);
+	part = type ? PyUnicode_FromFormat("%R", type) : NULL;
+	Py_XDECREF(type);
+	if (!part || PyList_Append(a.parts, part) < 0 ||
+	    flow_for_each_field(self, flow_repr_field, &a) < 0)
+		goto out;
+	Py_CLEAR(part);
+	if (self->fs.ring_cookie == RX_CLS_FLOW_DISC)
+		part = PyUnicode_FromString("action=-1");
+	else if (self->fs.ring_cookie == RX_CLS_FLOW_WAKE)
+		part = PyUnicode_FromString("action=-2");
+	else
+		part = PyUnicode_FromFormat("action=%lu",
+					    (unsigned long)(self->fs.ring_cookie &
+							    ETHTOOL_RX_FLOW_SPEC_RING));
+	if (!part || PyList_Append(a.parts, part) < 0)
+		goto out;
+	Py_CLEAR(part);
+	if (!(self->fs.location & RX_CLS_LOC_SPECIAL)) {
+		part = PyUnicode_FromFormat("location=%u", self->fs.location);
+		if (!part || PyList_Append(a.parts, part) < 0)
+			goto out;
+	}
+	sep = PyUnicode_FromString(", ");
+	joined = sep ? PyUnicode_Join(sep, a.parts) : NULL;
+	Py_XDECREF(sep);
+	if (joined)
+		result = PyUnicode_FromFormat("FlowRule(%U)", joined);
+	Py_XDECREF(joined);
+ out:
+	Py_XDECREF(part);
+	Py_DECREF(a.parts);
+	return result;
+}
+
+static PyObject *flow_rule_richcompare(PyObject *a, PyObject *b, int op)
+{
+	struct ethtool_rx_flow_spec ka, kb;
+	int eq;
+
+	if ((op != Py_EQ && op != Py_NE) ||
+	    !PyObject_TypeCheck(a, &PyFlowRule_Type) || !PyObject_TypeCheck(b, &PyFlowRule_Type)) {
+		Py_INCREF(Py_NotImplemented);
+		return Py_NotImplemented;
+	}
+	flow_normalize(&((PyFlowRule *)a)->fs, &ka);
+	flow_normalize(&((PyFlowRule *)b)->fs, &kb);
+	eq = flow_key_cmp(&ka, &kb) == 0;
+	return PyBool_FromLong(op == Py_EQ ? eq : !eq);
+}
+
+static Py_hash_t flow_rule_hash(PyFlowRule *self)
+{
+	struct ethtool_rx_flow_spec key;
+	const uint8_t *p = (const uint8_t *)&key;
+	uint64_t h = 14695981039346656037ULL;
+	size_t i;
+
+	flow_normalize(&self->fs, &key);
+	for (i = 0; i < sizeof(key); i++)
+		h = (h ^ p[i]) * 1099511628211ULL;
+	return h == (uint64_t)-1 ? -2 : (Py_hash_t)h;
+}
+
+static PyGetSetDef flow_rule_getset[] = {
+	{"flow_type", (getter)flow_rule_flow_type, NULL,
+	 "The flow type, like 'tcp4', 'udp6' or 'ether'", NULL},
+	{"action", (getter)flow_rule_action, NULL,
+	 "The queue of matching packets, -1 to drop them or -2 to wake", NULL},
+	{"vf", (getter)flow_rule_vf, NULL,
+	 "The virtual function the queue is of, 0 for the device itself", NULL},
+	{"location", (getter)flow_rule_location, NULL,
+	 "The location of the rule in the table, None to let it be chosen", NULL},
+	{"fields", (getter)flow_rule_fields, NULL,
+	 "The compared fields, as a dict of (value, mask) pairs", NULL},
+	{NULL}
+};
+
+PyTypeObject PyFlowRule_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.FlowRule",
+	.tp_basicsize = sizeof(PyFlowRule),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_new = flow_rule_new,
+	.tp_getattro = (getattrofunc)flow_rule_getattro,
+	.tp_repr = (reprfunc)flow_rule_repr,
+	.tp_richcompare = flow_rule_richcompare,
+	.tp_hash = (hashfunc)flow_rule_hash,
+	.tp_getset = flow_rule_getset,
+	.tp_doc = "FlowRule(flow_type, action=0, location=None, vf=0, **fields)\n\n"
+		  "An RX flow classification (ntuple) rule.  flow_type is one of "
+		  "tcp4, udp4, sctp4, ah4, esp4, ip4, tcp6, udp6, sctp6, ah6, esp6, "
+		  "ip6 and ether.  The fields, src_ip, dst_ip, src_port, dst_port, "
+		  "tos, tclass, spi, l4_bytes, l4_proto, src_mac, dst_mac, ethertype, "
+		  "vlan_etype, vlan_tci and user_def as the flow type has them, are "
+		  "values or (value, mask) pairs, and addresses may have a prefix "
+		  "length.  Rules compare equal when they match the same packets "
+		  "with the same action, whatever their locations."
+};
+
+/**
+ * Issues an ETHTOOL_*RX* command
+ *
+ * @param devname Name which fits ifr_name, see devname_converter()
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int flow_ioctl(int fd, const char *devname, struct ethtool_rxnfc *nfc, size_t size)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, devname, IFNAMSIZ);
+	ifr.ifr_data = (void *)nfc;
+	return backend_ioctl(fd, SIOCETHTOOL, &ifr, size) < 0 ? errno : 0;
+}
+
+static void flow_table_free(struct flow_table *table)
+{
+	free(table->rules);
+	free(table->used);
+	memset(table, 0, sizeof(*table));
+}
+
+/**
+ * Reads the rules of a device.  Does not need the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int flow_table_load(int fd, const char *devname, struct flow_table *table)
+{
+	struct ethtool_rxnfc nfc, *all;
+	uint32_t i, count;
+	int err;
+
+	memset(table, 0, sizeof(*table));
+	memset(&nfc, 0, sizeof(nfc));
+	nfc.cmd = ETHTOOL_GRXCLSRLCNT;
+	if ((err = flow_ioctl(fd, devname, &nfc, sizeof(nfc))) != 0)
+		return err;
+	count = nfc.rule_cnt;
+	table->special = !!(nfc.data & RX_CLS_LOC_SPECIAL);
+	table->size = nfc.data & ~(uint64_t)RX_CLS_LOC_SPECIAL;
+
+	all = calloc(1, sizeof(*all) + (size_t)count * sizeof(all->rule_locs[0]));
+	table->rules = calloc(count + 1, sizeof(*table->rules));
+	table->used = calloc(table->size + 1, 1);
+	if (!all || !table->rules || !table->used) {
+		free(all);
+		flow_table_free(table);
+		return ENOMEM;
+	}
+	all->cmd = ETHTOOL_GRXCLSRLALL;
+	all->rule_cnt = count;
+	err = flow_ioctl(fd, devname, all, sizeof(*all) + count * sizeof(all->rule_locs[0]));
+	if (!err && all->rule_cnt < count)
+		count = all->rule_cnt;
+	for (i = 0; !err && i < count; i++) {
+		memset(&nfc, 0, sizeof(nfc));
+		nfc.cmd = ETHTOOL_GRXCLSRULE;
+		nfc.fs.location = all->rule_locs[i];
+		if ((err = flow_ioctl(fd, devname, &nfc, sizeof(nfc))) != 0)
+			break;
+		table->rules[table->nr_rules++] = nfc.fs;
+		if (nfc.fs.location < table->size)
+			table->used[nfc.fs.location] = 1;
+	}
+	free(all);
+	if (err)
+		flow_table_free(table);
+	return err;
+}
+
+/**
+ * Inserts a rule, and sets its location to the one it got.  Does not need
+ * the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int flow_insert(int fd, const char *devname, struct flow_table *table,
+		       struct ethtool_rx_flow_spec *fs)
+{
+	struct ethtool_rxnfc nfc;
+	uint32_t loc = fs->location, i;
+	int err;
+
+	/* Drivers which do not pick a location get the last free one */
+	if ((loc & RX_CLS_LOC_SPECIAL) && !table->special) {
+		for (i = 0; i < table->size; i++) {
+			loc = table->size - 1 - i;
+			if (!table->used[loc])
+				break;
+		}
+		if (i == table->size)
+			return ENOSPC;
+	}
+	memset(&nfc, 0, sizeof(nfc));
+	nfc.cmd = ETHTOOL_SRXCLSRLINS;
+	nfc.fs = *fs;
+	nfc.fs.location = loc;
+	if ((err = flow_ioctl(fd, devname, &nfc, sizeof(nfc))) != 0)
+		return err;
+	fs->location = nfc.fs.location;
+	if (fs->location < table->size)
+		table->used[fs->location] = 1;
+	return 0;
+}
+
+static int flow_delete(int fd, const char *devname, struct flow_table *table, uint32_t loc)
+{
+	struct ethtool_rxnfc nfc;
+	int err;
+
+	memset(&nfc, 0, sizeof(nfc));
+	nfc.cmd = ETHTOOL_SRXCLSRLDEL;
+	nfc.fs.location = loc;
+	if ((err = flow_ioctl(fd, devname, &nfc, sizeof(nfc))) != 0)
+		return err;
+	if (loc < table->size)
+		table->used[loc] = 0;
+	return 0;
+}
+
+static PyObject *flow_raise(int err, const char *devname)
+{
+	errno = err;
+	if (err == ENOMEM)
+		return PyErr_NoMemory();
+	return PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)devname);
+}
+
+static int flow_socket(void)
+{
+	return socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+}
+
+static PyObject *flow_rules_list(const struct ethtool_rx_flow_spec *rules, uint32_t n)
+{
+	PyObject *list, *rule;
+	uint32_t i;
+
+	list = PyList_New(n);
+	for (i = 0; list && i < n; i++) {
+		rule = flow_wrap(&rules[i]);
+		if (!rule) {
+			Py_CLEAR(list);
+			break;
+		}
+		PyList_SET_ITEM(list, i, rule);
+	}
+	return list;
+}
+
+/**
+ * Copies the specs of a sequence of FlowRules
+ *
+ * @return Returns a malloc()ed array, or NULL with a Python exception set
+ */
+static struct ethtool_rx_flow_spec *flow_specs_from_python(PyObject *rules, uint32_t *n)
+{
+	struct ethtool_rx_flow_spec *specs;
+	PyObject *seq, *item;
+	Py_ssize_t i;
+
+	seq = PySequence_Fast(rules, "rules must be a sequence of FlowRules");
+	if (!seq)
+		return NULL;
+	*n = PySequence_Fast_GET_SIZE(seq);
+	specs = calloc(*n + 1, sizeof(*specs));
+	if (!specs) {
+		Py_DECREF(seq);
+		PyErr_NoMemory();
+		return NULL;
+	}
+	for (i = 0; i < (Py_ssize_t)*n; i++) {
+		item = PySequence_Fast_GET_ITEM(seq, i);
+		if (!PyObject_TypeCheck(item, &PyFlowRule_Type)) {
+			PyErr_SetString(PyExc_TypeError, "rules must be FlowRules");
+			free(specs);
+			specs = NULL;
+			break;
+		}
+		specs[i] = ((PyFlowRule *)item)->fs;
+	}
+	Py_DECREF(seq);
+	return specs;
+}
+
+/**
+ * ethtool.get_flow_rules(devname)
+ */
+PyObject *flow_get_rules(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", NULL };
+	struct flow_table table;
+	char devname[IFNAMSIZ];
+	PyObject *list;
+	int fd, err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&:get_flow_rules", kwlist,
+					 devname_converter, devname))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	fd = flow_socket();
+	if (fd < 0) {
+		err = errno;
+	} else {
+		err = flow_table_load(fd, devname, &table);
+		close(fd);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err)
+		return flow_raise(err, devname);
+	list = flow_rules_list(table.rules, table.nr_rules);
+	flow_table_free(&table);
+	return list;
+}
+
+/**
+ * ethtool.add_flow_rules(devname, rules)
+ */
+PyObject *flow_add_rules(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", "rules", NULL };
+	struct ethtool_rx_flow_spec *specs;
+	struct flow_table table = { 0 };
+	PyObject *rules, *list, *loc;
+	char devname[IFNAMSIZ];
+	uint32_t n, i;
+	int fd, err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O:add_flow_rules", kwlist,
+					 devname_converter, devname, &rules))
+		return NULL;
+	if (!(specs = flow_specs_from_python(rules, &n)))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	fd = flow_socket();
+	if (fd < 0) {
+		err = errno;
+	} else {
+		err = flow_table_load(fd, devname, &table);
+		for (i = 0; !err && i < n; i++)
+			err = flow_insert(fd, devname, &table, &specs[i]);
+		flow_table_free(&table);
+		close(fd);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		free(specs);
+		return flow_raise(err, devname);
+	}
+	list = PyList_New(n);
+	for (i = 0; list && i < n; i++) {
+		loc = PyLong_FromUnsignedLong(specs[i].location);
+		if (!loc) {
+			Py_CLEAR(list);
+			break;
+		}
+		PyList_SET_ITEM(list, i, loc);
+	}
+	free(specs);
+	return list;
+}
+
+/**
+ * ethtool.delete_flow_rules(devname, locations)
+ */
+PyObject *flow_delete_rules(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", "locations", NULL };
+	struct flow_table table = { 0 };
+	PyObject *locations, *seq, *item;
+	char devname[IFNAMSIZ];
+	uint32_t *locs;
+	Py_ssize_t i, n;
+	unsigned long loc;
+	int fd, err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O:delete_flow_rules", kwlist,
+					 devname_converter, devname, &locations))
+		return NULL;
+	seq = PySequence_Fast(locations, "locations must be a sequence");
+	if (!seq)
+		return NULL;
+	n = PySequence_Fast_GET_SIZE(seq);
+	locs = calloc(n + 1, sizeof(*locs));
+	if (!locs) {
+		Py_DECREF(seq);
+		return PyErr_NoMemory();
+	}
+	for (i = 0; i < n; i++) {
+		item = PySequence_Fast_GET_ITEM(seq, i);
+		if (PyObject_TypeCheck(item, &PyFlowRule_Type)) {
+			loc = ((PyFlowRule *)item)->fs.location;
+		} else {
+			loc = PyLong_AsUnsignedLong(item);
+			if (loc == (unsigned long)-1 && PyErr_Occurred())
+				break;
+		}
+		if (loc >= RX_CLS_LOC_SPECIAL) {
+			PyErr_SetString(PyExc_ValueError, "a rule to delete has no location");
+			break;
+		}
+		locs[i] = loc;
+	}
+	Py_DECREF(seq);
+	if (i < n) {
+		free(locs);
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	fd = flow_socket();
+	if (fd < 0) {
+		err = errno;
+	} else {
+		for (i = 0; !err && i < n; i++)
+			err = flow_delete(fd, devname, &table, locs[i]);
+		close(fd);
+	}
+	Py_END_ALLOW_THREADS
+
+	free(locs);
+	if (err)
+		return flow_raise(err, devname);
+	Py_RETURN_NONE;
+}
+
+/**
+ * Works out which installed rules to delete and which wanted ones to
+ * insert.  A wanted rule is kept if an equal one is installed, at its
+ * location if it has one.  Does not need the GIL.
+ *
+ * @param insert Receives 1 for each wanted rule to insert
+ * @param delete Receives 1 for each installed rule to delete
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int flow_diff(const struct flow_table *table, const struct ethtool_rx_flow_spec *want,
+		     uint32_t nr_want, uint8_t *insert, uint8_t *delete)
+{
+	struct flow_key {
+		struct ethtool_rx_flow_spec key;
+		uint32_t		    index;
+	} *keys, probe;
+	uint32_t i, lo, hi, mid, n = table->nr_rules;
+	int cmp;
+
+	keys = calloc(n + 1, sizeof(*keys));
+	if (!keys)
+		return ENOMEM;
+	for (i = 0; i < n; i++) {
+		flow_normalize(&table->rules[i], &keys[i].key);
+		keys[i].index = i;
+		delete[i] = 1;
+	}
+	qsort(keys, n, sizeof(*keys), flow_key_cmp);
+
+	for (i = 0; i < nr_want; i++) {
+		insert[i] = 1;
+		flow_normalize(&want[i], &probe.key);
+		lo = 0;
+		hi = n;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			cmp = flow_key_cmp(&keys[mid].key, &probe.key);
+			if (cmp < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		for (; lo < n && flow_key_cmp(&keys[lo].key, &probe.key) == 0; lo++) {
+			const struct ethtool_rx_flow_spec *have = &table->rules[keys[lo].index];
+
+			if (!delete[keys[lo].index])
+				continue;
+			if (!(want[i].location & RX_CLS_LOC_SPECIAL) &&
+			    want[i].location != have->location)
+				continue;
+			delete[keys[lo].index] = 0;
+			insert[i] = 0;
+			break;
+		}
+	}
+	free(keys);
+	return 0;
+}
+
+/**
+ * ethtool.diff_flow_rules(installed, rules)
+ */
+PyObject *flow_diff_rules(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "installed", "rules", NULL };
+	struct ethtool_rx_flow_spec *want;
+	struct flow_table table = { 0 };
+	uint8_t *insert, *delete;
+	PyObject *installed, *rules, *ins_list, *del_list, *item;
+	uint32_t n, i;
+	int err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO:diff_flow_rules", kwlist,
+					 &installed, &rules))
+		return NULL;
+	if (!(table.rules = flow_specs_from_python(installed, &table.nr_rules)))
+		return NULL;
+	if (!(want = flow_specs_from_python(rules, &n))) {
+		free(table.rules);
+		return NULL;
+	}
+
+	insert = calloc(n + 1, 1);
+	delete = calloc(table.nr_rules + 1, 1);
+	err = insert && delete ? flow_diff(&table, want, n, insert, delete) : ENOMEM;
+	ins_list = err ? NULL : PyList_New(0);
+	del_list = err ? NULL : PyList_New(0);
+	for (i = 0; ins_list && del_list && i < n; i++) {
+		if (!insert[i])
+			continue;
+		item = flow_wrap(&want[i]);
+		if (!item || PyList_Append(ins_list, item) < 0)
+			Py_CLEAR(ins_list);
+		Py_XDECREF(item);
+	}
+	for (i = 0; ins_list && del_list && i < table.nr_rules; i++) {
+		if (!delete[i])
+			continue;
+		item = flow_wrap(&table.rules[i]);
+		if (!item || PyList_Append(del_list, item) < 0)
+			Py_CLEAR(del_list);
+		Py_XDECREF(item);
+	}
+	free(table.rules);
+	free(want);
+	free(insert);
+	free(delete);
+	if (err)
+		return PyErr_NoMemory();
+	if (!ins_list || !del_list) {
+		Py_XDECREF(ins_list);
+		Py_XDECREF(del_list);
+		return NULL;
+	}
+	return Py_BuildValue("(NN)", ins_list, del_list);
+}
+
+/**
+ * ethtool.sync_flow_rules(devname, rules, apply=True)
+ */
+PyObject *flow_sync_rules(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", "rules", "apply", NULL };
+	struct ethtool_rx_flow_spec *want, *added = NULL;
+	struct flow_table table = { 0 };
+	uint8_t *insert = NULL, *delete = NULL;
+	PyObject *rules, *ins_list = NULL, *del_list = NULL, *item;
+	char devname[IFNAMSIZ];
+	uint32_t n, i, nr_added = 0;
+	int apply = 1, fd, err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O|i:sync_flow_rules", kwlist,
+					 devname_converter, devname, &rules, &apply))
+		return NULL;
+	if (!(want = flow_specs_from_python(rules, &n)))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	fd = flow_socket();
+	if (fd < 0) {
+		err = errno;
+	} else {
+		err = flow_table_load(fd, devname, &table);
+		if (!err) {
+			insert = calloc(n + 1, 1);
+			delete = calloc(table.nr_rules + 1, 1);
+			added = calloc(n + 1, sizeof(*added));
+			err = insert && delete && added ?
+				flow_diff(&table, want, n, insert, delete) : ENOMEM;
+		}
+		/* Deleting first frees the locations of the rules being replaced */
+		for (i = 0; !err && apply && i < table.nr_rules; i++) {
+			if (delete[i])
+				err = flow_delete(fd, devname, &table, table.rules[i].location);
+		}
+		for (i = 0; !err && i < n; i++) {
+			if (!insert[i])
+				continue;
+			added[nr_added] = want[i];
+			if (apply && (err = flow_insert(fd, devname, &table, &added[nr_added])))
+				break;
+			nr_added++;
+		}
+		close(fd);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (!err) {
+		ins_list = flow_rules_list(added, nr_added);
+		del_list = PyList_New(0);
+		for (i = 0; ins_list && del_list && i < table.nr_rules; i++) {
+			if (!delete[i])
+				continue;
+			item = PyLong_FromUnsignedLong(table.rules[i].location);
+			if (!item || PyList_Append(del_list, item) < 0) {
+				Py_XDECREF(item);
+				Py_CLEAR(del_list);
+				break;
+			}
+			Py_DECREF(item);
+		}
+	}
+	flow_table_free(&table);
+	free(want);
+	free(added);
+	free(insert);
+	free(delete);
+	if (err)
+		return flow_raise(err, devname);
+	if (!ins_list || !del_list) {
+		Py_XDECREF(ins_list);
+		Py_XDECREF(del_list);
+		return NULL;
+	}
+	return Py_BuildValue("(NN)", ins_list, del_list);
+}
@@ -0,0 +1,28 @@
+/* flow.h - RX network flow classification (ntuple) rules
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _FLOW_H
+#define _FLOW_H
+
+#include <Python.h>
+
+extern PyTypeObject PyFlowRule_Type;
+
+PyObject *flow_get_rules(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *flow_add_rules(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *flow_delete_rules(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *flow_diff_rules(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *flow_sync_rules(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif
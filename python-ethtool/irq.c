@@ -0,0 +1,720 @@
+/* irq.c - Interrupt affinity of the queues of a device
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * The interrupts of a device are those listed in the msi_irqs directory of
+ * its bus device, or of the parent of that for e.g. virtio, plus those
+ * whose action name in /proc/interrupts carries the device name or the
+ * bus_info of ETHTOOL_GDRVINFO, like "eth0-TxRx-3" or
+ * "mlx5_comp3@pci:0000:3b:00.0".  The queue of an interrupt is the number
+ * ending a name which mentions rx, tx, a completion queue or the like.
+ *
+ * The plan pins the interrupts of the Nth queue to the Nth of the allowed
+ * CPUs, round robin, as QueueSteering.spread() does for RPS and XPS.  The
+ * allowed CPUs default to those local to the NUMA node of the device minus
+ * the isolated ones, the first thread of each core coming before the
+ * other threads of the cores.
+ */
+
+#include <Python.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/sockios.h>
+
+#include "irq.h"
+#include "steering.h"
+#include "ethtool.h"
+#include "backend.h"
+
+#define IRQ_NAME_LEN	64
+#define IRQ_PATH_LEN	(IFNAMSIZ + 64)
+
+#define IRQ_CPU_PATH	"/sys/devices/system/cpu"
+
+/* Words in the names of queue interrupts */
+static const char *irq_queue_words[] = {
+	"rx", "tx", "comp", "input", "output", "queue", "fp"
+};
+
+struct irq_info {
+	unsigned int	  irq;
+	int		  queue;		/**< -1 if not a queue interrupt */
+	char		  name[IRQ_NAME_LEN];
+	struct steer_mask affinity;
+};
+
+/**
+ * What is known about the interrupts of a device
+ */
+struct irq_map {
+	char		  bus_info[ETHTOOL_BUSINFO_LEN];
+	int		  numa_node;		/**< -1 if none */
+	struct steer_mask local_cpus;
+	uint32_t	  nr_irqs;
+	struct irq_info	  *irqs;		/**< Sorted by queue, then IRQ */
+	char		  failed[IRQ_PATH_LEN];	/**< File that could not be read */
+};
+
+/**
+ * The MSI interrupts of the bus device
+ */
+struct irq_list {
+	uint32_t     n;
+	uint32_t     size;
+	unsigned int *irqs;
+};
+
+/**
+ * Reads a file of CPUs, as a mask or as a list
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int irq_read_cpus(const char *path, int list, struct steer_mask *m)
+{
+	size_t len;
+	char *buf;
+	int err;
+
+	if ((err = backend_read_file(path, &buf, &len)) != 0)
+		return err;
+	err = list ? steer_parse_list(buf, m) : steer_parse_mask(buf, m);
+	free(buf);
+	return err;
+}
+
+static void irq_bus_info(const char *devname, char *bus_info)
+{
+	struct ethtool_drvinfo info;
+	struct ifreq ifr;
+	int fd;
+
+	bus_info[0] = '\0';
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return;
+	memset(&info, 0, sizeof(info));
+	info.cmd = ETHTOOL_GDRVINFO;
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, devname, IFNAMSIZ - 1);
+	ifr.ifr_data = (void *)&info;
+	if (backend_ioctl(fd, SIOCETHTOOL, &ifr, sizeof(info)) == 0) {
+		memcpy(bus_info, info.bus_info, ETHTOOL_BUSINFO_LEN);
+		bus_info[ETHTOOL_BUSINFO_LEN - 1] = '\0';
+	}
+	close(fd);
+}
+
+/**
+ * Lists the MSI interrupts in a msi_irqs directory
+ *
+ * @return Returns 0 on success or if there is no such directory, otherwise
+ *         an errno
+ */
+static int irq_msi_irqs(const char *path, struct irq_list *list)
+{
+	unsigned int *irqs;
+	struct dirent *de;
+	unsigned long irq;
+	char *end;
+	DIR *dir;
+	int err = 0;
+
+	dir = opendir(path);
+	if (!dir)
+		return errno == ENOENT || errno == ENOTDIR ? 0 : errno;
+	while (!err && (de = readdir(dir)) != NULL) {
+		irq = strtoul(de->d_name, &end, 10);
+		if (end == de->d_name || *end)
+			continue;
+		if (list->n == list->size) {
+			list->size = list->size ? list->size * 2 : 64;
+			irqs = realloc(list->irqs, list->size * sizeof(*irqs));
+			if (!irqs) {
+				err = ENOMEM;
+				break;
+			}
+			list->irqs = irqs;
+		}
+		list->irqs[list->n++] = irq;
+	}
+	closedir(dir);
+	return err;
+}
+
+static int irq_list_has(const struct irq_list *list, unsigned int irq)
+{
+	uint32_t i;
+
+	for (i = 0; i < list->n; i++) {
+		if (list->irqs[i] == irq)
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * Whether a name holds a word, delimited by anything but letters and digits
+ */
+static int irq_name_has(const char *name, const char *word)
+{
+	size_t len = strlen(word);
+	const char *p = name;
+
+	if (!len)
+		return 0;
+	while ((p = strstr(p, word)) != NULL) {
+		if ((p == name || !isalnum((unsigned char)p[-1])) &&
+		    !isalnum((unsigned char)p[len]))
+			return 1;
+		p++;
+	}
+	return 0;
+}
+
+/**
+ * @return Returns the queue of an interrupt, or -1
+ */
+static int irq_queue(const char *name)
+{
+	char lower[IRQ_NAME_LEN];
+	size_t len, i, end;
+	int queue = 0;
+
+	/* mlx5_comp3@pci:0000:3b:00.0 */
+	len = strcspn(name, "@");
+	if (len >= sizeof(lower))
+		len = sizeof(lower) - 1;
+	for (i = 0; i < len; i++)
+		lower[i] = tolower((unsigned char)name[i]);
+	lower[len] = '\0';
+
+	for (i = 0; i < ARRAY_SIZE(irq_queue_words); i++) {
+		if (strstr(lower, irq_queue_words[i]))
+			break;
+	}
+	if (i == ARRAY_SIZE(irq_queue_words))
+		return -1;
+
+	end = len;
+	while (len > 0 && isdigit((unsigned char)lower[len - 1]))
+		len--;
+	if (len == end || end - len > 6)
+		return -1;
+	for (i = len; i < end; i++)
+		queue = queue * 10 + lower[i] - '0';
+	return queue;
+}
+
+static int irq_cmp(const void *a, const void *b)
+{
+	const struct irq_info *x = a, *y = b;
+
+	/* Queue interrupts first */
+	if ((x->queue < 0) != (y->queue < 0))
+		return x->queue < 0 ? 1 : -1;
+	if (x->queue != y->queue)
+		return x->queue < y->queue ? -1 : 1;
+	return x->irq < y->irq ? -1 : x->irq > y->irq;
+}
+
+/**
+ * Goes through /proc/interrupts for the interrupts of a device
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int irq_scan(struct irq_map *map, const char *devname, const struct irq_list *msi)
+{
+	char path[IRQ_PATH_LEN], *buf, *line, *next, *name, *end;
+	struct irq_info *irqs, *info;
+	unsigned long irq;
+	size_t len, n;
+	uint32_t size = 0;
+	int err;
+
+	strcpy(path, "/proc/interrupts");
+	if ((err = backend_read_file(path, &buf, &len)) != 0) {
+		strcpy(map->failed, path);
+		return err;
+	}
+
+	for (line = buf; line && *line; line = next) {
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+		irq = strtoul(line, &end, 10);
+		if (end == line || *end != ':')
+			continue;
+
+		/* The action names come last */
+		n = strlen(line);
+		while (n > 0 && isspace((unsigned char)line[n - 1]))
+			line[--n] = '\0';
+		name = strrchr(line, ' ');
+		name = name ? name + 1 : end + 1;
+		if (!irq_list_has(msi, irq) && !irq_name_has(name, devname) &&
+		    !(map->bus_info[0] && strstr(name, map->bus_info)))
+			continue;
+
+		if (map->nr_irqs == size) {
+			size = size ? size * 2 : 16;
+			irqs = realloc(map->irqs, size * sizeof(*irqs));
+			if (!irqs) {
+				err = ENOMEM;
+				break;
+			}
+			map->irqs = irqs;
+		}
+		info = &map->irqs[map->nr_irqs++];
+		memset(info, 0, sizeof(*info));
+		info->irq = irq;
+		strncpy(info->name, name, IRQ_NAME_LEN - 1);
+		info->queue = irq_queue(info->name);
+		snprintf(path, sizeof(path), "/proc/irq/%lu/smp_affinity_list", irq);
+		irq_read_cpus(path, 1, &info->affinity);
+	}
+	free(buf);
+	if (!err)
+		qsort(map->irqs, map->nr_irqs, sizeof(*map->irqs), irq_cmp);
+	return err;
+}
+
+/**
+ * Finds the bus_info, NUMA node, local CPUs and interrupts of a device.
+ * Does not need the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int irq_collect(struct irq_map *map, const char *devname)
+{
+	struct irq_list msi = { 0, 0, NULL };
+	char path[IRQ_PATH_LEN];
+	size_t len;
+	char *buf;
+	int err;
+
+	memset(map, 0, sizeof(*map));
+	map->numa_node = -1;
+	if (!if_nametoindex(devname)) {
+		snprintf(map->failed, sizeof(map->failed), "%s", devname);
+		return ENODEV;
+	}
+	irq_bus_info(devname, map->bus_info);
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", devname);
+	if (backend_read_file(path, &buf, &len) == 0) {
+		map->numa_node = strtol(buf, NULL, 10);
+		free(buf);
+	}
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s/device/local_cpus", devname);
+	err = irq_read_cpus(path, 0, &map->local_cpus);
+	if (err == ENOENT) {
+		strcpy(path, IRQ_CPU_PATH "/online");
+		err = irq_read_cpus(path, 1, &map->local_cpus);
+	}
+	if (err) {
+		strcpy(map->failed, path);
+		return err;
+	}
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s/device/msi_irqs", devname);
+	err = irq_msi_irqs(path, &msi);
+	if (!err && !msi.n) {
+		snprintf(path, sizeof(path), "/sys/class/net/%s/device/../msi_irqs", devname);
+		err = irq_msi_irqs(path, &msi);
+	}
+	if (err)
+		strcpy(map->failed, path);
+	else
+		err = irq_scan(map, devname, &msi);
+	free(msi.irqs);
+	return err;
+}
+
+/**
+ * Orders CPUs for spreading interrupts: the first thread of each core,
+ * then the others
+ *
+ * @return Returns the number of CPUs in order
+ */
+static uint32_t irq_order_cpus(const struct steer_mask *cpus, uint32_t *order)
+{
+	struct steer_mask siblings;
+	char path[IRQ_PATH_LEN];
+	uint32_t cpu, first, n = 0, pass;
+
+	for (pass = 0; pass < 2; pass++) {
+		for (cpu = 0; cpu < STEER_MAX_CPUS; cpu++) {
+			if (!steer_mask_test(cpus, cpu))
+				continue;
+			snprintf(path, sizeof(path),
+				 IRQ_CPU_PATH "/cpu%u/topology/thread_siblings_list", cpu);
+			first = cpu;
+			if (irq_read_cpus(path, 1, &siblings) == 0) {
+				for (first = 0; first < cpu; first++) {
+					if (steer_mask_test(&siblings, first))
+						break;
+				}
+			}
+			if ((first == cpu) == (pass == 0))
+				order[n++] = cpu;
+		}
+	}
+	return n;
+}
+
+/**
+ * Pins the Nth queue to the Nth CPU, round robin.  Does not need the GIL.
+ *
+ * @param cpus  Allowed CPUs
+ * @param plan  Receives an IRQ and a CPU per queue interrupt
+ *
+ * @return Returns the number of entries of the plan, or -1 if there are no
+ *         CPUs to use
+ */
+static int irq_plan(const struct irq_map *map, const struct steer_mask *cpus,
+		    unsigned int (*plan)[2])
+{
+	uint32_t *order, n, i, k = 0;
+	int count = 0;
+
+	order = malloc(STEER_MAX_CPUS * sizeof(*order));
+	if (!order)
+		return -1;
+	n = irq_order_cpus(cpus, order);
+	for (i = 0; n && i < map->nr_irqs && map->irqs[i].queue >= 0; i++) {
+		if (i && map->irqs[i].queue != map->irqs[i - 1].queue)
+			k++;
+		plan[count][0] = map->irqs[i].irq;
+		plan[count][1] = order[k % n];
+		count++;
+	}
+	free(order);
+	return n ? count : -1;
+}
+
+static PyObject *irq_raise(int err, const char *path)
+{
+	errno = err;
+	if (err == ENOMEM)
+		return PyErr_NoMemory();
+	return PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)path);
+}
+
+static PyObject *irq_info_dict(const struct irq_info *info)
+{
+	PyObject *dict = PyDict_New();
+
+	if (dict &&
+	    (dict_set_steal(dict, "irq", PyLong_FromUnsignedLong(info->irq)) ||
+	     dict_set_steal(dict, "name", PyBytes_FromString(info->name)) ||
+	     dict_set_steal(dict, "affinity", steer_mask_to_python(&info->affinity))))
+		Py_CLEAR(dict);
+	if (dict && info->queue < 0 && PyDict_SetItemString(dict, "queue", Py_None) < 0)
+		Py_CLEAR(dict);
+	if (dict && info->queue >= 0 &&
+	    dict_set_steal(dict, "queue", PyLong_FromLong(info->queue)) < 0)
+		Py_CLEAR(dict);
+	return dict;
+}
+
+/**
+ * ethtool.get_irq_map(devname)
+ */
+PyObject *irq_get_map(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", NULL };
+	PyObject *dict, *irqs, *info;
+	char devname[IFNAMSIZ];
+	struct irq_map *map;
+	uint32_t i;
+	int err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&:get_irq_map", kwlist,
+					 devname_converter, devname))
+		return NULL;
+	map = malloc(sizeof(*map));
+	if (!map)
+		return PyErr_NoMemory();
+
+	Py_BEGIN_ALLOW_THREADS
+	err = irq_collect(map, devname);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		irq_raise(err, map->failed);
+		free(map->irqs);
+		free(map);
+		return NULL;
+	}
+
+	irqs = PyList_New(map->nr_irqs);
+	for (i = 0; irqs && i < map->nr_irqs; i++) {
+		info = irq_info_dict(&map->irqs[i]);
+		if (!info)
+			Py_CLEAR(irqs);
+		else
+			PyList_SET_ITEM(irqs, i, info);
+	}
+	dict = irqs ? PyDict_New() : NULL;
+	if (dict &&
+	    (dict_set_steal(dict, "bus_info", PyBytes_FromString(map->bus_info)) ||
+	     dict_set_steal(dict, "numa_node", PyLong_FromLong(map->numa_node)) ||
+	     dict_set_steal(dict, "local_cpus", steer_mask_to_python(&map->local_cpus)) ||
+	     PyDict_SetItemString(dict, "irqs", irqs) < 0))
+		Py_CLEAR(dict);
+	Py_XDECREF(irqs);
+	free(map->irqs);
+	free(map);
+	return dict;
+}
+
+/**
+ * ethtool.plan_irq_affinity(devname, cpus=None)
+ */
+PyObject *irq_plan_affinity(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", "cpus", NULL };
+	PyObject *cpus_obj = NULL, *list = NULL, *item;
+	unsigned int (*plan)[2] = NULL;
+	struct steer_mask *cpus = NULL, *isolated = NULL;
+	char devname[IFNAMSIZ];
+	struct irq_map *map;
+	int err, count = 0, i;
+	uint32_t w;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|O:plan_irq_affinity", kwlist,
+					 devname_converter, devname, &cpus_obj))
+		return NULL;
+	map = calloc(1, sizeof(*map));
+	cpus = malloc(sizeof(*cpus));
+	isolated = calloc(1, sizeof(*isolated));
+	if (!map || !cpus || !isolated) {
+		PyErr_NoMemory();
+		goto out;
+	}
+	if (cpus_obj && cpus_obj != Py_None && steer_mask_from_python(cpus_obj, cpus) < 0)
+		goto out;
+
+	Py_BEGIN_ALLOW_THREADS
+	err = irq_collect(map, devname);
+	if (!err && (!cpus_obj || cpus_obj == Py_None)) {
+		/* Isolated CPUs are kept for the work they were isolated for */
+		if (irq_read_cpus(IRQ_CPU_PATH "/isolated", 1, isolated) != 0)
+			memset(isolated, 0, sizeof(*isolated));
+		for (w = 0; w < STEER_WORDS; w++)
+			cpus->w[w] = map->local_cpus.w[w] & ~isolated->w[w];
+	}
+	if (!err) {
+		plan = calloc(map->nr_irqs + 1, sizeof(*plan));
+		if (!plan)
+			err = ENOMEM;
+		else
+			count = irq_plan(map, cpus, plan);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		irq_raise(err, map->failed);
+		goto out;
+	}
+	if (count < 0) {
+		PyErr_Format(PyExc_ValueError, "No CPUs to pin the interrupts of %s to", devname);
+		goto out;
+	}
+
+	list = PyList_New(count);
+	for (i = 0; list && i < count; i++) {
+		item = Py_BuildValue("(II)", plan[i][0], plan[i][1]);
+		if (!item)
+			Py_CLEAR(list);
+		else
+			PyList_SET_ITEM(list, i, item);
+	}
+out:
+	if (map)
+		free(map->irqs);
+	free(map);
+	free(cpus);
+	free(isolated);
+	free(plan);
+	return list;
+}
+
+/* Longest list of CPUs, every other one */
+#define IRQ_LIST_BUF	(STEER_MAX_CPUS / 2 * 6 + 2)
+
+/**
+ * Formats CPUs as a list, like "0-3,8"
+ *
+ * @param buf At least IRQ_LIST_BUF bytes
+ */
+static size_t irq_format_list(const struct steer_mask *m, char *buf)
+{
+	uint32_t cpu, last;
+	size_t len = 0;
+
+	for (cpu = 0; cpu < STEER_MAX_CPUS; cpu++) {
+		if (!steer_mask_test(m, cpu))
+			continue;
+		for (last = cpu; last + 1 < STEER_MAX_CPUS && steer_mask_test(m, last + 1); last++)
+			;
+		len += sprintf(buf + len, len ? ",%u" : "%u", cpu);
+		if (last > cpu)
+			len += sprintf(buf + len, "-%u", last);
+		cpu = last;
+	}
+	buf[len++] = '\n';
+	buf[len] = '\0';
+	return len;
+}
+
+/**
+ * @param buf  IRQ_LIST_BUF bytes to format the CPUs into
+ * @param path Receives the file written
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int irq_write_affinity(unsigned int irq, const struct steer_mask *cpus,
+			      char *buf, char *path)
+{
+	size_t len;
+	ssize_t n;
+	int fd, err = 0;
+
+	snprintf(path, IRQ_PATH_LEN, "/proc/irq/%u/smp_affinity_list", irq);
+	len = irq_format_list(cpus, buf);
+	fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+		return errno;
+	n = write(fd, buf, len);
+	if (n < 0)
+		err = errno;
+	else if ((size_t)n != len)
+		err = EIO;
+	close(fd);
+	return err;
+}
+
+/**
+ * ethtool.set_irq_affinity(plan)
+ */
+PyObject *irq_set_affinity(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "plan", NULL };
+	PyObject *plan, *seq, *item, *cpus_obj;
+	struct steer_mask *cpus, *online;
+	char path[IRQ_PATH_LEN], *buf;
+	unsigned int *irqs;
+	Py_ssize_t i, n;
+	uint32_t w;
+	long cpu;
+	int err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O:set_irq_affinity", kwlist, &plan))
+		return NULL;
+	seq = PySequence_Fast(plan, "plan must be a sequence of (irq, cpus) pairs");
+	if (!seq)
+		return NULL;
+	n = PySequence_Fast_GET_SIZE(seq);
+	cpus = calloc(n + 1, sizeof(*cpus));
+	irqs = calloc(n + 1, sizeof(*irqs));
+	buf = malloc(IRQ_LIST_BUF);
+	online = malloc(sizeof(*online));
+	if (!cpus || !irqs || !buf || !online) {
+		Py_DECREF(seq);
+		free(cpus);
+		free(irqs);
+		free(buf);
+		free(online);
+		return PyErr_NoMemory();
+	}
+	strcpy(path, IRQ_CPU_PATH "/online");
+	Py_BEGIN_ALLOW_THREADS
+	err = irq_read_cpus(path, 1, online);
+	Py_END_ALLOW_THREADS
+	if (err) {
+		Py_DECREF(seq);
+		free(cpus);
+		free(irqs);
+		free(buf);
+		free(online);
+		return irq_raise(err, path);
+	}
+
+	/* Everything is checked before anything is written */
+	for (i = 0; i < n; i++) {
+		item = PySequence_Fast_GET_ITEM(seq, i);
+		if (!PyArg_ParseTuple(item, "IO:set_irq_affinity", &irqs[i], &cpus_obj))
+			break;
+		if (PyLong_Check(cpus_obj)
+#if PY_MAJOR_VERSION < 3
+		    || PyInt_Check(cpus_obj)
+#endif
+		    ) {
+			cpu = PyLong_AsLong(cpus_obj);
+			if (cpu < 0 || cpu >= STEER_MAX_CPUS) {
+				if (!PyErr_Occurred())
+					PyErr_Format(PyExc_ValueError, "CPU %ld out of range", cpu);
+				break;
+			}
+			steer_mask_set(&cpus[i], cpu);
+		} else if (steer_mask_from_python(cpus_obj, &cpus[i]) < 0) {
+			break;
+		}
+		/* The kernel would refuse these, after the IRQs before */
+		for (w = 0; w < STEER_WORDS && !cpus[i].w[w]; w++)
+			;
+		if (w == STEER_WORDS) {
+			PyErr_Format(PyExc_ValueError, "No CPUs to pin IRQ %u to", irqs[i]);
+			break;
+		}
+		for (w = 0; w < STEER_WORDS && !(cpus[i].w[w] & ~online->w[w]); w++)
+			;
+		if (w < STEER_WORDS) {
+			PyErr_Format(PyExc_ValueError, "IRQ %u would be pinned to offline CPUs",
+				     irqs[i]);
+			break;
+		}
+	}
+	Py_DECREF(seq);
+	free(online);
+	if (i < n) {
+		free(cpus);
+		free(irqs);
+		free(buf);
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	for (i = 0; i < n && !err; i++)
+		err = irq_write_affinity(irqs[i], &cpus[i], buf, path);
+	Py_END_ALLOW_THREADS
+
+	free(cpus);
+	free(irqs);
+	free(buf);
+	if (err)
+		return irq_raise(err, path);
+	Py_RETURN_NONE;
+}
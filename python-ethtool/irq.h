@@ -0,0 +1,24 @@
+/* irq.h - Interrupt affinity of the queues of a device
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _IRQ_H
+#define _IRQ_H
+
+#include <Python.h>
+
+PyObject *irq_get_map(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *irq_plan_affinity(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *irq_set_affinity(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif
@@ -0,0 +1,609 @@
+/* linksettings.c - Speed, duplex, autoneg and link modes (ETHTOOL_[GS]LINKSETTINGS)
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * ETHTOOL_GLINKSETTINGS takes link mode masks of as many u32 as the kernel
+ * has, which is found with a first request of none: the kernel answers it
+ * with minus its number of words.  Drivers without it get the 32 bit masks
+ * of ETHTOOL_GSET instead.
+ *
+ * get_all_link_settings() caches the settings of every device until a
+ * RTM_NEWLINK or RTM_DELLINK about it comes in on a NETLINK_ROUTE socket
+ * listening to RTMGRP_LINK, so exporters polling it cost a recv() once the
+ * settings are known.
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sockios.h>
+
+#include "linksettings.h"
+#include "ethtool.h"
+#include "backend.h"
+
+/* Words of each link mode mask, the kernel has 4 as of 6.13 */
+#define LSET_MAX_NWORDS	16
+
+#define LSET_EVENTS_BUF	8192
+
+/* Kernel names of the ethtool_link_mode_bit_indices */
+static const char *const lset_mode_names[] = {
+	"10baseT/Half", "10baseT/Full", "100baseT/Half", "100baseT/Full",
+	"1000baseT/Half", "1000baseT/Full", "Autoneg", "TP", "AUI", "MII",
+	"FIBRE", "BNC", "10000baseT/Full", "Pause", "Asym_Pause",
+	"2500baseX/Full", "Backplane", "1000baseKX/Full", "10000baseKX4/Full",
+	"10000baseKR/Full", "10000baseR_FEC", "20000baseMLD2/Full",
+	"20000baseKR2/Full", "40000baseKR4/Full", "40000baseCR4/Full",
+	"40000baseSR4/Full", "40000baseLR4/Full", "56000baseKR4/Full",
+	"56000baseCR4/Full", "56000baseSR4/Full", "56000baseLR4/Full",
+	"25000baseCR/Full", "25000baseKR/Full", "25000baseSR/Full",
+	"50000baseCR2/Full", "50000baseKR2/Full", "100000baseKR4/Full",
+	"100000baseSR4/Full", "100000baseCR4/Full", "100000baseLR4_ER4/Full",
+	"50000baseSR2/Full", "1000baseX/Full", "10000baseCR/Full",
+	"10000baseSR/Full", "10000baseLR/Full", "10000baseLRM/Full",
+	"10000baseER/Full", "2500baseT/Full", "5000baseT/Full", "None", "RS",
+	"BASER", "50000baseKR/Full", "50000baseSR/Full", "50000baseCR/Full",
+	"50000baseLR_ER_FR/Full", "50000baseDR/Full", "100000baseKR2/Full",
+	"100000baseSR2/Full", "100000baseCR2/Full",
+	"100000baseLR2_ER2_FR2/Full", "100000baseDR2/Full",
+	"200000baseKR4/Full", "200000baseSR4/Full",
+	"200000baseLR4_ER4_FR4/Full", "200000baseDR4/Full",
+	"200000baseCR4/Full", "100baseT1/Full", "1000baseT1/Full",
+	"400000baseKR8/Full", "400000baseSR8/Full",
+	"400000baseLR8_ER8_FR8/Full", "400000baseDR8/Full",
+	"400000baseCR8/Full", "LLRS", "100000baseKR/Full", "100000baseSR/Full",
+	"100000baseLR_ER_FR/Full", "100000baseCR/Full", "100000baseDR/Full",
+	"200000baseKR2/Full", "200000baseSR2/Full",
+	"200000baseLR2_ER2_FR2/Full", "200000baseDR2/Full",
+	"200000baseCR2/Full", "400000baseKR4/Full", "400000baseSR4/Full",
+	"400000baseLR4_ER4_FR4/Full", "400000baseDR4/Full",
+	"400000baseCR4/Full", "100baseFX/Half", "100baseFX/Full",
+	"10baseT1L/Full", "800000baseCR8/Full", "800000baseKR8/Full",
+	"800000baseDR8/Full", "800000baseDR8_2/Full", "800000baseSR8/Full",
+	"800000baseVR8/Full", "10baseT1S/Full", "10baseT1S/Half",
+	"10baseT1S_P2MP/Half",
+};
+
+/* The link settings of a device, as GLINKSETTINGS gives them */
+struct lset {
+	union {
+		struct ethtool_link_settings req;
+		uint8_t raw[sizeof(struct ethtool_link_settings) +
+			    3 * LSET_MAX_NWORDS * sizeof(uint32_t)];
+	};
+	struct ethtool_cmd ecmd;	/**< What GSET gave, when legacy */
+	int		   legacy;
+};
+
+/* A device in the cache of get_all_link_settings() */
+struct lset_entry {
+	int	    ifindex;
+	char	    name[IFNAMSIZ];
+	int	    err;	/**< Of reading the settings, cached too */
+	struct lset ls;
+};
+
+static pthread_mutex_t lset_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct lset_entry *lset_cache;
+static size_t lset_cache_len;
+static int lset_events = -1;
+
+/* devname fits ifr_name, see devname_converter() */
+static int lset_ioctl(int fd, const char *devname, void *data, size_t size)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, devname, IFNAMSIZ);
+	ifr.ifr_data = data;
+	return backend_ioctl(fd, SIOCETHTOOL, &ifr, size) < 0 ? errno : 0;
+}
+
+static uint32_t *lset_mask(struct lset *ls, int which)
+{
+	return ls->req.link_mode_masks + which * ls->req.link_mode_masks_nwords;
+}
+
+/**
+ * Reads the link settings of a device.  Does not need the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int lset_read(int fd, const char *devname, struct lset *ls)
+{
+	struct ethtool_cmd *ecmd = &ls->ecmd;
+	int err, nwords;
+
+	memset(ls, 0, sizeof(*ls));
+	ls->req.cmd = ETHTOOL_GLINKSETTINGS;
+	err = lset_ioctl(fd, devname, ls->raw, sizeof(ls->raw));
+	if (err == 0) {
+		nwords = -ls->req.link_mode_masks_nwords;
+		if (nwords <= 0 || ls->req.cmd != ETHTOOL_GLINKSETTINGS)
+			return EPROTO;
+		if (nwords > LSET_MAX_NWORDS)
+			return EOVERFLOW;
+		memset(ls, 0, sizeof(*ls));
+		ls->req.cmd = ETHTOOL_GLINKSETTINGS;
+		ls->req.link_mode_masks_nwords = nwords;
+		err = lset_ioctl(fd, devname, ls->raw, sizeof(ls->raw));
+		if (!err && ls->req.link_mode_masks_nwords != nwords)
+			err = EAGAIN;
+		return err;
+	}
+	if (err != EOPNOTSUPP)
+		return err;
+
+	ecmd->cmd = ETHTOOL_GSET;
+	if ((err = lset_ioctl(fd, devname, ecmd, sizeof(*ecmd))) != 0)
+		return err;
+	ls->legacy = 1;
+	ls->req.speed = ecmd->speed | (uint32_t)ecmd->speed_hi << 16;
+	ls->req.duplex = ecmd->duplex;
+	ls->req.port = ecmd->port;
+	ls->req.phy_address = ecmd->phy_address;
+	ls->req.autoneg = ecmd->autoneg;
+	ls->req.eth_tp_mdix = ecmd->eth_tp_mdix;
+	ls->req.eth_tp_mdix_ctrl = ecmd->eth_tp_mdix_ctrl;
+	ls->req.transceiver = ecmd->transceiver;
+	ls->req.link_mode_masks_nwords = 1;
+	lset_mask(ls, 0)[0] = ecmd->supported;
+	lset_mask(ls, 1)[0] = ecmd->advertising;
+	lset_mask(ls, 2)[0] = ecmd->lp_advertising;
+	return 0;
+}
+
+/**
+ * Writes back link settings read by lset_read().  Does not need the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int lset_write(int fd, const char *devname, struct lset *ls)
+{
+	struct ethtool_cmd *ecmd = &ls->ecmd;
+
+	if (!ls->legacy) {
+		ls->req.cmd = ETHTOOL_SLINKSETTINGS;
+		return lset_ioctl(fd, devname, ls->raw, sizeof(ls->raw));
+	}
+	ecmd->cmd = ETHTOOL_SSET;
+	ecmd->speed = ls->req.speed & 0xffff;
+	ecmd->speed_hi = ls->req.speed >> 16;
+	ecmd->duplex = ls->req.duplex;
+	ecmd->autoneg = ls->req.autoneg;
+	ecmd->advertising = lset_mask(ls, 1)[0];
+	return lset_ioctl(fd, devname, ecmd, sizeof(*ecmd));
+}
+
+static PyObject *lset_str(const char *s)
+{
+#if PY_MAJOR_VERSION >= 3
+	return PyUnicode_FromString(s);
+#else
+	return PyString_FromString(s);
+#endif
+}
+
+/* The string of a str, NULL if not one */
+static const char *lset_cstr(PyObject *obj)
+{
+#if PY_MAJOR_VERSION >= 3
+	const char *s = PyUnicode_Check(obj) ? PyUnicode_AsUTF8(obj) : NULL;
+
+	PyErr_Clear();
+	return s;
+#else
+	return PyString_Check(obj) ? PyString_AsString(obj) : NULL;
+#endif
+}
+
+/**
+ * The named link modes of a mask, modes newer than this module as their
+ * bit numbers
+ */
+static PyObject *lset_modes(struct lset *ls, int which)
+{
+	const uint32_t *mask = lset_mask(ls, which);
+	PyObject *list, *mode;
+	uint32_t bit, nbits = ls->req.link_mode_masks_nwords * 32;
+
+	list = PyList_New(0);
+	for (bit = 0; list && bit < nbits; bit++) {
+		if (!(mask[bit / 32] & (1U << (bit % 32))))
+			continue;
+		if (bit < ARRAY_SIZE(lset_mode_names))
+			mode = lset_str(lset_mode_names[bit]);
+		else
+			mode = PyLong_FromUnsignedLong(bit);
+		if (!mode || PyList_Append(list, mode) < 0)
+			Py_CLEAR(list);
+		Py_XDECREF(mode);
+	}
+	return list;
+}
+
+static PyObject *lset_to_python(struct lset *ls)
+{
+	PyObject *dict, *speed, *duplex;
+
+	if (ls->req.speed == 0 || ls->req.speed == (uint32_t)SPEED_UNKNOWN) {
+		speed = Py_None;
+		Py_INCREF(speed);
+	} else {
+		speed = PyLong_FromUnsignedLong(ls->req.speed);
+	}
+	if (ls->req.duplex == DUPLEX_HALF || ls->req.duplex == DUPLEX_FULL) {
+		duplex = lset_str(ls->req.duplex == DUPLEX_FULL ? "full" : "half");
+	} else {
+		duplex = Py_None;
+		Py_INCREF(duplex);
+	}
+
+	dict = PyDict_New();
+	if (!dict ||
+	    dict_set_steal(dict, "speed", speed) ||
+	    dict_set_steal(dict, "duplex", duplex) ||
+	    dict_set_steal(dict, "autoneg", PyBool_FromLong(ls->req.autoneg == AUTONEG_ENABLE)) ||
+	    dict_set_steal(dict, "port", PyLong_FromLong(ls->req.port)) ||
+	    dict_set_steal(dict, "phy_address", PyLong_FromLong(ls->req.phy_address)) ||
+	    dict_set_steal(dict, "supported", lset_modes(ls, 0)) ||
+	    dict_set_steal(dict, "advertising", lset_modes(ls, 1)) ||
+	    dict_set_steal(dict, "lp_advertising", lset_modes(ls, 2))) {
+		Py_XDECREF(dict);
+		return NULL;
+	}
+	return dict;
+}
+
+static PyObject *lset_raise(int err, const char *devname)
+{
+	errno = err;
+	if (err == ENOMEM)
+		return PyErr_NoMemory();
+	return PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)devname);
+}
+
+/**
+ * ethtool.get_link_settings(devname)
+ */
+PyObject *lset_get(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", NULL };
+	char devname[IFNAMSIZ];
+	struct lset ls;
+	int fd, err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&:get_link_settings", kwlist,
+					 devname_converter, devname))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		err = errno;
+	} else {
+		err = lset_read(fd, devname, &ls);
+		close(fd);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err)
+		return lset_raise(err, devname);
+	return lset_to_python(&ls);
+}
+
+/**
+ * Sets the link modes of a sequence of names or bit numbers in the
+ * advertising mask
+ *
+ * @return Returns 0, or -1 with a Python exception set
+ */
+static int lset_parse_modes(struct lset *ls, PyObject *modes)
+{
+	uint32_t *mask = lset_mask(ls, 1);
+	uint32_t bit, nbits = ls->req.link_mode_masks_nwords * 32;
+	PyObject *seq, *item;
+	const char *name;
+	Py_ssize_t i;
+	unsigned long v;
+	int rc = -1;
+
+	seq = PySequence_Fast(modes, "advertising must be a sequence of link modes");
+	if (!seq)
+		return -1;
+	memset(mask, 0, ls->req.link_mode_masks_nwords * sizeof(uint32_t));
+	for (i = 0; i < PySequence_Fast_GET_SIZE(seq); i++) {
+		item = PySequence_Fast_GET_ITEM(seq, i);
+		if (PyLong_Check(item)
+#if PY_MAJOR_VERSION < 3
+		    || PyInt_Check(item)
+#endif
+		    ) {
+			v = PyLong_AsUnsignedLong(item);
+			if (v == (unsigned long)-1 && PyErr_Occurred())
+				goto out;
+			if (v >= nbits) {
+				PyErr_Format(PyExc_ValueError, "the device has no link mode %lu", v);
+				goto out;
+			}
+			bit = v;
+		} else {
+			if (!(name = lset_cstr(item))) {
+				PyErr_SetString(PyExc_TypeError, "link modes must be names or bits");
+				goto out;
+			}
+			for (bit = 0; bit < ARRAY_SIZE(lset_mode_names); bit++) {
+				if (strcmp(lset_mode_names[bit], name) == 0)
+					break;
+			}
+			if (bit == ARRAY_SIZE(lset_mode_names)) {
+				PyErr_Format(PyExc_ValueError, "unknown link mode '%s'", name);
+				goto out;
+			}
+		}
+		if (bit >= nbits) {
+			PyErr_Format(PyExc_ValueError, "the device has no link mode %s",
+				     lset_mode_names[bit]);
+			goto out;
+		}
+		mask[bit / 32] |= 1U << (bit % 32);
+	}
+	rc = 0;
+ out:
+	Py_DECREF(seq);
+	return rc;
+}
+
+/**
+ * ethtool.set_link_settings(devname, speed=None, duplex=None, autoneg=None,
+ *			     advertising=None)
+ */
+PyObject *lset_set(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", "speed", "duplex", "autoneg", "advertising", NULL };
+	PyObject *speed = Py_None, *duplex = Py_None, *autoneg = Py_None;
+	PyObject *advertising = Py_None;
+	const char *s;
+	char devname[IFNAMSIZ];
+	unsigned long v;
+	struct lset ls;
+	int fd, err, on;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|OOOO:set_link_settings", kwlist,
+					 devname_converter, devname, &speed, &duplex, &autoneg,
+					 &advertising))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	err = fd < 0 ? errno : lset_read(fd, devname, &ls);
+	Py_END_ALLOW_THREADS
+
+	if (err)
+		goto out;
+	if (speed != Py_None) {
+		v = PyLong_AsUnsignedLong(speed);
+		if (v == (unsigned long)-1 && PyErr_Occurred())
+			goto out;
+		if (v == 0 || v >= (uint32_t)SPEED_UNKNOWN) {
+			PyErr_SetString(PyExc_ValueError, "invalid speed");
+			goto out;
+		}
+		ls.req.speed = v;
+	}
+	if (duplex != Py_None) {
+		s = lset_cstr(duplex);
+		if (!s || (strcmp(s, "half") && strcmp(s, "full"))) {
+			PyErr_SetString(PyExc_ValueError, "duplex must be 'half' or 'full'");
+			goto out;
+		}
+		ls.req.duplex = strcmp(s, "full") == 0 ? DUPLEX_FULL : DUPLEX_HALF;
+	}
+	if (autoneg != Py_None) {
+		if ((on = PyObject_IsTrue(autoneg)) < 0)
+			goto out;
+		ls.req.autoneg = on ? AUTONEG_ENABLE : AUTONEG_DISABLE;
+	}
+	if (advertising != Py_None && lset_parse_modes(&ls, advertising) < 0)
+		goto out;
+
+	Py_BEGIN_ALLOW_THREADS
+	err = lset_write(fd, devname, &ls);
+	Py_END_ALLOW_THREADS
+
+ out:
+	if (fd >= 0)
+		close(fd);
+	if (err)
+		return lset_raise(err, devname);
+	if (PyErr_Occurred())
+		return NULL;
+	Py_RETURN_NONE;
+}
+
+/**
+ * Forgets the cached settings of the devices link events came for, or of
+ * all of them when events were lost.  Called with lset_lock held.
+ */
+static void lset_drain_events(void)
+{
+	struct sockaddr_nl addr;
+	struct nlmsghdr *nlh;
+	struct ifinfomsg *ifi;
+	char buf[LSET_EVENTS_BUF];
+	size_t i;
+	ssize_t n;
+	int all = 0;
+
+	if (lset_events < 0) {
+		lset_events = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK,
+				     NETLINK_ROUTE);
+		memset(&addr, 0, sizeof(addr));
+		addr.nl_family = AF_NETLINK;
+		addr.nl_groups = RTMGRP_LINK;
+		if (lset_events >= 0 &&
+		    bind(lset_events, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+			close(lset_events);
+			lset_events = -1;
+		}
+		/* Nothing said what changed before, or can without events */
+		all = 1;
+	}
+	while (lset_events >= 0) {
+		n = recv(lset_events, buf, sizeof(buf), MSG_DONTWAIT);
+		if (n < 0) {
+			if (errno == ENOBUFS) {
+				all = 1;
+				continue;
+			}
+			if (errno != EAGAIN && errno != EINTR)
+				all = 1;
+			if (errno != EINTR)
+				break;
+			continue;
+		}
+		for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, (size_t)n);
+		     nlh = NLMSG_NEXT(nlh, n)) {
+			if ((nlh->nlmsg_type != RTM_NEWLINK && nlh->nlmsg_type != RTM_DELLINK) ||
+			    nlh->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi)))
+				continue;
+			ifi = NLMSG_DATA(nlh);
+			for (i = 0; i < lset_cache_len; i++) {
+				if (lset_cache[i].ifindex == ifi->ifi_index)
+					lset_cache[i].ifindex = 0;
+			}
+		}
+	}
+	if (all)
+		lset_cache_len = 0;
+}
+
+/**
+ * Brings the cache up to date with the devices there are now.  Does not
+ * need the GIL.
+ *
+ * @param out Receives a copy of the cache, to be freed
+ *
+ * @return Returns the number of devices, or -1 with errno set
+ */
+static ssize_t lset_read_all(int refresh, struct lset_entry **out)
+{
+	struct if_nameindex *names, *ni;
+	struct lset_entry *entries, *e;
+	size_t i, n = 0, count = 0;
+	int fd, saved;
+
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -1;
+	names = if_nameindex();
+	if (!names) {
+		saved = errno;
+		close(fd);
+		errno = saved;
+		return -1;
+	}
+	for (ni = names; ni->if_index; ni++)
+		count++;
+	entries = calloc(count + 1, sizeof(*entries));
+	*out = calloc(count + 1, sizeof(**out));
+	if (!entries || !*out) {
+		free(entries);
+		free(*out);
+		if_freenameindex(names);
+		close(fd);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	pthread_mutex_lock(&lset_lock);
+	lset_drain_events();
+	if (refresh)
+		lset_cache_len = 0;
+	for (ni = names; ni->if_index; ni++) {
+		e = &entries[n++];
+		for (i = 0; i < lset_cache_len; i++) {
+			if (lset_cache[i].ifindex == (int)ni->if_index &&
+			    strcmp(lset_cache[i].name, ni->if_name) == 0)
+				break;
+		}
+		if (i < lset_cache_len) {
+			*e = lset_cache[i];
+			continue;
+		}
+		e->ifindex = ni->if_index;
+		strncpy(e->name, ni->if_name, IFNAMSIZ - 1);
+		e->err = lset_read(fd, e->name, &e->ls);
+	}
+	free(lset_cache);
+	lset_cache = entries;
+	lset_cache_len = n;
+	memcpy(*out, entries, n * sizeof(*entries));
+	/* Without events nothing can be trusted next time */
+	if (lset_events < 0)
+		lset_cache_len = 0;
+	pthread_mutex_unlock(&lset_lock);
+
+	if_freenameindex(names);
+	close(fd);
+	return n;
+}
+
+/**
+ * ethtool.get_all_link_settings(refresh=False)
+ */
+PyObject *lset_get_all(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "refresh", NULL };
+	struct lset_entry *entries = NULL;
+	PyObject *dict, *value;
+	int refresh = 0;
+	ssize_t i, n;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i:get_all_link_settings", kwlist,
+					 &refresh))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	n = lset_read_all(refresh, &entries);
+	Py_END_ALLOW_THREADS
+
+	if (n < 0) {
+		if (errno == ENOMEM)
+			return PyErr_NoMemory();
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+	dict = PyDict_New();
+	for (i = 0; dict && i < n; i++) {
+		/* Devices without link settings, or gone since, are left out */
+		if (entries[i].err)
+			continue;
+		value = lset_to_python(&entries[i].ls);
+		if (!value || PyDict_SetItemString(dict, entries[i].name, value) < 0)
+			Py_CLEAR(dict);
+		Py_XDECREF(value);
+	}
+	free(entries);
+	return dict;
+}
@@ -0,0 +1,898 @@
+/* metrics.c - OpenMetrics exposition of the interface state
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Renders the interface state in the OpenMetrics text format, for
+ * Prometheus and the like to scrape.  The text is written straight from
+ * the snapshot records (see snapshot.c) into a buffer the renderer keeps
+ * across scrapes, so a scrape creates no Python objects but its result
+ * and costs about as much as the text it writes.
+ *
+ * The format wants all samples of a metric family together, so the
+ * families are written one after the other, each going over all
+ * interfaces.  Driver statistics (ETHTOOL_GSTATS) get a queue label when
+ * their name carries a queue number, see metrics_split_queue().
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netlink/netlink.h>
+#include <netlink/route/link.h>
+#include <netlink/route/rtnl.h>
+
+#include "metrics.h"
+#include "snapshot.h"
+#include "nicstats.h"
+#include "backend.h"
+#include "stats.h"
+
+/* Groups of metric families, selected by name with families= */
+#define METRICS_LINK		0x0001
+#define METRICS_COUNTERS	0x0002
+#define METRICS_ADDRESSES	0x0004
+#define METRICS_COALESCE	0x0008
+#define METRICS_RINGPARAM	0x0010
+#define METRICS_DRVINFO		0x0020
+#define METRICS_FEATURES	0x0040
+#define METRICS_NIC_STATS	0x0080
+#define METRICS_ALL		0x00ff
+
+/* Groups needing the ETHTOOL settings in the snapshot */
+#define METRICS_ETHTOOL \
+	(METRICS_COALESCE | METRICS_RINGPARAM | METRICS_DRVINFO | METRICS_FEATURES)
+
+static const char *metrics_group_names[] = {
+	"link", "counters", "addresses", "coalesce",
+	"ringparam", "drvinfo", "features", "nic_stats",
+};
+
+#define METRICS_PREFIX_MAX	64
+#define METRICS_MIN_SIZE	4096
+
+/**
+ * Driver statistics of one interface, kept across scrapes so their names
+ * are only fetched when the driver changes
+ */
+struct metrics_nic {
+	int32_t		ifindex;
+	int		ok;	/**< Read by the current scrape */
+	struct nicstats ns;
+};
+
+/**
+ * The ethtool.MetricsRenderer object
+ */
+typedef struct {
+	PyObject_HEAD
+	pthread_mutex_t	   lock;	/**< Serialises render() and the exports */
+	int		   groups;	/**< METRICS_* */
+	int		   ioctl_fd;	/**< -1 unless ETHTOOL groups are rendered */
+	struct nl_sock	   *sk;
+	struct metrics_out out;
+	Py_ssize_t	   exports;	/**< Buffers pointing to out.data */
+	uint32_t	   nr_nics;
+	struct metrics_nic *nics;	/**< Sorted by interface index */
+	char		   prefix[METRICS_PREFIX_MAX];
+} PyMetricsRenderer;
+
+/*
+ *
+ *   Output buffer
+ *
+ */
+
+static int metrics_reserve(struct metrics_out *o, size_t n)
+{
+	size_t size;
+	char *data;
+
+	if (o->len + n <= o->size)
+		return 0;
+	if (o->err)
+		return -1;
+
+	size = o->size ? o->size : METRICS_MIN_SIZE;
+	while (size < o->len + n)
+		size *= 2;
+	data = realloc(o->data, size);
+	if (!data) {
+		o->err = ENOMEM;
+		return -1;
+	}
+	o->data = data;
+	o->size = size;
+	return 0;
+}
+
+void metrics_put(struct metrics_out *o, const char *s, size_t n)
+{
+	if (metrics_reserve(o, n) == 0) {
+		memcpy(o->data + o->len, s, n);
+		o->len += n;
+	}
+}
+
+void metrics_puts(struct metrics_out *o, const char *s)
+{
+	metrics_put(o, s, strlen(s));
+}
+
+void metrics_put_u64(struct metrics_out *o, uint64_t v)
+{
+	char buf[20], *p = buf + sizeof(buf);
+
+	do {
+		*--p = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	metrics_put(o, p, buf + sizeof(buf) - p);
+}
+
+/**
+ * Writes a label value, which may not be NUL terminated within max bytes
+ */
+static void metrics_put_escaped(struct metrics_out *o, const char *s, size_t max)
+{
+	size_t len = strnlen(s, max), i, start = 0;
+	const char *esc;
+
+	for (i = 0; i < len; i++) {
+		switch (s[i]) {
+		case '\\':
+			esc = "\\\\";
+			break;
+		case '"':
+			esc = "\\\"";
+			break;
+		case '\n':
+			esc = "\\n";
+			break;
+		default:
+			continue;
+		}
+		metrics_put(o, s + start, i - start);
+		metrics_put(o, esc, 2);
+		start = i + 1;
+	}
+	metrics_put(o, s + start, len - start);
+}
+
+static void metrics_name(struct metrics_out *o, const char *name)
+{
+	metrics_puts(o, o->prefix);
+	metrics_put(o, "_", 1);
+	metrics_puts(o, name);
+}
+
+void metrics_family(struct metrics_out *o, const char *name,
+		    const char *type, const char *help)
+{
+	metrics_puts(o, "# TYPE ");
+	metrics_name(o, name);
+	metrics_put(o, " ", 1);
+	metrics_puts(o, type);
+	metrics_puts(o, "\n# HELP ");
+	metrics_name(o, name);
+	metrics_put(o, " ", 1);
+	metrics_puts(o, help);
+	metrics_put(o, "\n", 1);
+}
+
+/**
+ * Starts a sample of a device, to be followed by its other labels and
+ * metrics_value()
+ */
+void metrics_sample(struct metrics_out *o, const char *name, const char *suffix,
+		    const char *device)
+{
+	metrics_name(o, name);
+	metrics_puts(o, suffix);
+	metrics_puts(o, "{device=\"");
+	metrics_put_escaped(o, device, IFNAMSIZ);
+	metrics_put(o, "\"", 1);
+}
+
+void metrics_label(struct metrics_out *o, const char *key,
+		   const char *value, size_t max)
+{
+	metrics_put(o, ",", 1);
+	metrics_puts(o, key);
+	metrics_puts(o, "=\"");
+	metrics_put_escaped(o, value, max);
+	metrics_put(o, "\"", 1);
+}
+
+void metrics_value(struct metrics_out *o, uint64_t v)
+{
+	metrics_puts(o, "} ");
+	metrics_put_u64(o, v);
+	metrics_put(o, "\n", 1);
+}
+
+/*
+ *
+ *   Families
+ *
+ */
+
+static void metrics_render_u32(struct metrics_out *o, const struct snapshot *snap,
+			       const char *name, const char *help, size_t offset)
+{
+	uint32_t i, v;
+
+	metrics_family(o, name, "gauge", help);
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		memcpy(&v, (const char *)&snap->ifaces[i] + offset, sizeof(v));
+		metrics_sample(o, name, "", snap->ifaces[i].name);
+		metrics_value(o, v);
+	}
+}
+
+static void metrics_render_link(struct metrics_out *o, const struct snapshot *snap)
+{
+	const struct snapshot_iface *iface;
+	char buf[SNAPSHOT_HWADDR_LEN * 3], *p;
+	uint32_t i;
+	int j;
+
+	metrics_family(o, "interface", "info", "Identity and state of the interface");
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		iface = &snap->ifaces[i];
+		metrics_sample(o, "interface", "_info", iface->name);
+
+		p = buf;
+		*p = 0;
+		for (j = 0; j < iface->hwaddr_len && j < SNAPSHOT_HWADDR_LEN; j++)
+			p += sprintf(p, j ? ":%02x" : "%02x", iface->hwaddr[j]);
+		metrics_label(o, "mac_address", buf, sizeof(buf));
+		rtnl_link_operstate2str(iface->operstate, buf, sizeof(buf));
+		metrics_label(o, "operstate", buf, sizeof(buf));
+		if (iface->valid & SNAPSHOT_HAVE_DRVINFO)
+			metrics_label(o, "driver", iface->driver, SNAPSHOT_DRVINFO_LEN);
+		metrics_value(o, 1);
+	}
+
+	metrics_family(o, "interface_up", "gauge", "Whether the interface is up");
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		metrics_sample(o, "interface_up", "", snap->ifaces[i].name);
+		metrics_value(o, (snap->ifaces[i].flags & IFF_UP) != 0);
+	}
+
+	metrics_render_u32(o, snap, "interface_flags", "Interface flags (IFF_*)",
+			   offsetof(struct snapshot_iface, flags));
+	metrics_render_u32(o, snap, "interface_mtu_bytes", "Interface MTU",
+			   offsetof(struct snapshot_iface, mtu));
+	metrics_render_u32(o, snap, "interface_txqlen", "Interface transmit queue length",
+			   offsetof(struct snapshot_iface, txqlen));
+}
+
+static void metrics_render_counters(struct metrics_out *o, const struct snapshot *snap)
+{
+	char name[64], help[96];
+	uint32_t i;
+	int c;
+
+	for (c = 0; c < SNAPSHOT_NR_COUNTERS; c++) {
+		snprintf(name, sizeof(name), "interface_%s", snapshot_counter_names[c]);
+		snprintf(help, sizeof(help), "Link counter %s", snapshot_counter_names[c]);
+		metrics_family(o, name, "counter", help);
+		for (i = 0; i < snap->nr_ifaces; i++) {
+			metrics_sample(o, name, "_total", snap->ifaces[i].name);
+			metrics_value(o, snap->ifaces[i].counters[c]);
+		}
+	}
+}
+
+static void metrics_render_addresses(struct metrics_out *o, const struct snapshot *snap)
+{
+	const struct snapshot_iface *iface;
+	const struct snapshot_addr *a;
+	char buf[INET6_ADDRSTRLEN];
+	uint32_t i, j;
+	int len;
+
+	metrics_family(o, "interface_address", "info", "IPv4 and IPv6 addresses of the interface");
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		iface = &snap->ifaces[i];
+		for (j = 0; j < iface->nr_addrs; j++) {
+			a = &snap->addrs[iface->first_addr + j];
+			metrics_sample(o, "interface_address", "_info", iface->name);
+			metrics_label(o, "family", a->family == AF_INET6 ? "inet6" : "inet", 8);
+			if (!inet_ntop(a->family, a->local, buf, sizeof(buf)))
+				buf[0] = 0;
+			metrics_label(o, "address", buf, sizeof(buf));
+			len = snprintf(buf, sizeof(buf), "%u", a->prefixlen);
+			metrics_label(o, "prefixlen", buf, len);
+			rtnl_scope2str(a->scope, buf, sizeof(buf));
+			metrics_label(o, "scope", buf, sizeof(buf));
+			metrics_value(o, 1);
+		}
+	}
+}
+
+/**
+ * Renders the members of an ETHTOOL struct as one family with a setting
+ * label
+ */
+static void metrics_render_settings(struct metrics_out *o, const struct snapshot *snap,
+				    const char *name, const char *help, int valid,
+				    size_t offset, const struct struct_desc *table, int nr_entries)
+{
+	const struct snapshot_iface *iface;
+	uint32_t i, v;
+	int j;
+
+	metrics_family(o, name, "gauge", help);
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		iface = &snap->ifaces[i];
+		if (!(iface->valid & valid))
+			continue;
+		for (j = 0; j < nr_entries; j++) {
+			if (table[j].size != sizeof(v))
+				continue;
+			memcpy(&v, (const char *)iface + offset + table[j].offset, sizeof(v));
+			metrics_sample(o, name, "", iface->name);
+			metrics_label(o, "setting", table[j].name, ETH_GSTRING_LEN);
+			metrics_value(o, v);
+		}
+	}
+}
+
+static void metrics_render_drvinfo(struct metrics_out *o, const struct snapshot *snap)
+{
+	const struct snapshot_iface *iface;
+	uint32_t i;
+
+	metrics_family(o, "driver", "info", "Driver of the interface (ETHTOOL_GDRVINFO)");
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		iface = &snap->ifaces[i];
+		if (!(iface->valid & SNAPSHOT_HAVE_DRVINFO))
+			continue;
+		metrics_sample(o, "driver", "_info", iface->name);
+		metrics_label(o, "driver", iface->driver, SNAPSHOT_DRVINFO_LEN);
+		metrics_label(o, "version", iface->version, SNAPSHOT_DRVINFO_LEN);
+		metrics_label(o, "fw_version", iface->fw_version, SNAPSHOT_DRVINFO_LEN);
+		metrics_label(o, "bus_info", iface->bus_info, SNAPSHOT_DRVINFO_LEN);
+		metrics_value(o, 1);
+	}
+}
+
+static void metrics_render_features(struct metrics_out *o, const struct snapshot *snap)
+{
+	const struct snapshot_iface *iface;
+	uint32_t i;
+	int f;
+
+	metrics_family(o, "feature_enabled", "gauge", "Whether an offload is enabled");
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		iface = &snap->ifaces[i];
+		if (!(iface->valid & SNAPSHOT_HAVE_FEATURES))
+			continue;
+		for (f = 0; f < SNAPSHOT_NR_FEATURES; f++) {
+			if (!(iface->features_valid & (1U << f)))
+				continue;
+			metrics_sample(o, "feature_enabled", "", iface->name);
+			metrics_label(o, "feature", snapshot_feature_names[f], ETH_GSTRING_LEN);
+			metrics_value(o, (iface->features >> f) & 1);
+		}
+	}
+}
+
+/**
+ * Parses up to 6 digits
+ *
+ * @return Returns the number of digits, 0 if s does not start with one
+ */
+static size_t metrics_number(const char *s, size_t len, long *v)
+{
+	size_t i;
+
+	*v = 0;
+	for (i = 0; i < len && i < 6 && s[i] >= '0' && s[i] <= '9'; i++)
+		*v = *v * 10 + s[i] - '0';
+	return i;
+}
+
+/* Copies name without the bytes from..to */
+static void metrics_cut(const char *name, size_t len, size_t from, size_t to, char *stat)
+{
+	memcpy(stat, name, from);
+	memcpy(stat + from, name + to, len - to);
+	stat[from + len - to] = 0;
+}
+
+/**
+ * Splits the queue number out of the name of a driver statistic.  Drivers
+ * name per queue statistics in a few ways:
+ *
+ *   rx_queue_3_packets, queue_3_tx_bytes	-> rx_packets, tx_bytes
+ *   rx3_packets				-> rx_packets
+ *   rx-3.rx_packets				-> rx_packets
+ *   [3]: rx_ucast_packets			-> rx_ucast_packets
+ *
+ * @param name Statistic name, ETH_GSTRING_LEN bytes at most
+ * @param stat Receives the name without the queue, NUL terminated, so it
+ *             needs ETH_GSTRING_LEN + 1 bytes
+ *
+ * @return Returns the queue number, or -1 if the name has none
+ */
+static long metrics_split_queue(const char *name, char *stat)
+{
+	size_t len = strnlen(name, ETH_GSTRING_LEN), i, d;
+	const char *p;
+	long q;
+
+	if (name[0] == '[') {
+		d = metrics_number(name + 1, len - 1, &q);
+		if (d && d + 4 <= len && memcmp(name + 1 + d, "]: ", 3) == 0) {
+			metrics_cut(name, len, 0, d + 4, stat);
+			return q;
+		}
+	}
+
+	if (len > 3 && (name[0] == 'r' || name[0] == 't') && name[1] == 'x') {
+		i = name[2] == '-' ? 3 : 2;
+		d = metrics_number(name + i, len - i, &q);
+		if (d && i + d < len) {
+			if (i == 2 && name[i + d] == '_') {
+				metrics_cut(name, len, 2, 2 + d, stat);
+				return q;
+			}
+			if (i == 3 && name[i + d] == '.') {
+				metrics_cut(name, len, 0, i + d + 1, stat);
+				return q;
+			}
+		}
+	}
+
+	for (p = name; (p = memmem(p, name + len - p, "queue_", 6)) != NULL; p++) {
+		if (p != name && p[-1] != '_')
+			continue;
+		i = p - name + 6;
+		d = metrics_number(name + i, len - i, &q);
+		if (!d)
+			continue;
+		if (i + d == len && p != name) {
+			metrics_cut(name, len, p - name - 1, len, stat);
+			return q;
+		}
+		if (i + d < len && name[i + d] == '_') {
+			metrics_cut(name, len, p - name, i + d + 1, stat);
+			return q;
+		}
+	}
+
+	metrics_cut(name, len, len, len, stat);
+	return -1;
+}
+
+static void metrics_render_nic_stats(PyMetricsRenderer *self, const struct snapshot *snap)
+{
+	struct metrics_out *o = &self->out;
+	const struct snapshot_iface *iface;
+	const struct metrics_nic *nic;
+	char stat[ETH_GSTRING_LEN + 1], buf[24];
+	uint32_t i, j;
+	long q;
+
+	metrics_family(o, "nic_stat", "unknown", "Driver statistic (ETHTOOL_GSTATS)");
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		iface = &snap->ifaces[i];
+		nic = &self->nics[i];
+		if (!nic->ok)
+			continue;
+		for (j = 0; j < nic->ns.n; j++) {
+			q = metrics_split_queue(nic->ns.names[j], stat);
+			metrics_sample(o, "nic_stat", "", iface->name);
+			metrics_label(o, "driver", nic->ns.driver, sizeof(nic->ns.driver));
+			if (q >= 0) {
+				snprintf(buf, sizeof(buf), "%ld", q);
+				metrics_label(o, "queue", buf, sizeof(buf));
+			}
+			metrics_label(o, "stat", stat, sizeof(stat));
+			metrics_value(o, nic->ns.values[j]);
+		}
+	}
+}
+
+/*
+ *
+ *   Renderer
+ *
+ */
+
+/**
+ * Lines the driver statistics up with the interfaces of the snapshot,
+ * keeping those of interfaces still there, and reads them.  Devices
+ * without statistics, or failing to give them, are left out.
+ */
+static int metrics_read_nics(PyMetricsRenderer *self, const struct snapshot *snap)
+{
+	struct metrics_nic *nics;
+	uint32_t i, j = 0;
+
+	nics = calloc(snap->nr_ifaces ? snap->nr_ifaces : 1, sizeof(*nics));
+	if (!nics)
+		return ENOMEM;
+
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		int32_t ifindex = snap->ifaces[i].ifindex;
+
+		while (j < self->nr_nics && self->nics[j].ifindex < ifindex)
+			nicstats_free(&self->nics[j++].ns);
+		if (j < self->nr_nics && self->nics[j].ifindex == ifindex)
+			nics[i] = self->nics[j++];
+		nics[i].ifindex = ifindex;
+		nics[i].ok = nicstats_read(&nics[i].ns, self->ioctl_fd,
+					   snap->ifaces[i].name) == 0;
+	}
+	while (j < self->nr_nics)
+		nicstats_free(&self->nics[j++].ns);
+
+	free(self->nics);
+	self->nics = nics;
+	self->nr_nics = snap->nr_ifaces;
+	return 0;
+}
+
+/**
+ * Renders a snapshot into the output buffer.  Runs without the GIL, under
+ * the lock.
+ */
+static int metrics_render(PyMetricsRenderer *self, const struct snapshot *snap)
+{
+	struct metrics_out *o = &self->out;
+	int err;
+
+	o->len = 0;
+	o->err = 0;
+	o->prefix = self->prefix;
+	if ((self->groups & METRICS_NIC_STATS) &&
+	    (err = metrics_read_nics(self, snap)) != 0)
+		return err;
+
+	if (self->groups & METRICS_LINK)
+		metrics_render_link(o, snap);
+	if (self->groups & METRICS_COUNTERS)
+		metrics_render_counters(o, snap);
+	if (self->groups & METRICS_ADDRESSES)
+		metrics_render_addresses(o, snap);
+	if (self->groups & METRICS_COALESCE)
+		metrics_render_settings(o, snap, "coalesce", "Interrupt coalescing setting",
+					SNAPSHOT_HAVE_COALESCE,
+					offsetof(struct snapshot_iface, coalesce),
+					ethtool_coalesce_desc, ethtool_coalesce_desc_len);
+	if (self->groups & METRICS_RINGPARAM)
+		metrics_render_settings(o, snap, "ringparam", "Ring size setting",
+					SNAPSHOT_HAVE_RINGPARAM,
+					offsetof(struct snapshot_iface, ringparam),
+					ethtool_ringparam_desc, ethtool_ringparam_desc_len);
+	if (self->groups & METRICS_DRVINFO)
+		metrics_render_drvinfo(o, snap);
+	if (self->groups & METRICS_FEATURES)
+		metrics_render_features(o, snap);
+	if (self->groups & METRICS_NIC_STATS)
+		metrics_render_nic_stats(self, snap);
+	metrics_puts(o, "# EOF\n");
+	return o->err;
+}
+
+static int metrics_parse_groups(PyObject *families)
+{
+	PyObject *iter, *item;
+	const char *name;
+	int groups = 0;
+	size_t i;
+
+	if (!families || families == Py_None)
+		return METRICS_ALL;
+
+	iter = PyObject_GetIter(families);
+	if (!iter)
+		return -1;
+	while ((item = PyIter_Next(iter)) != NULL) {
+		name = NULL;
+		if (PyBytes_Check(item))
+			name = PyBytes_AsString(item);
+#if PY_MAJOR_VERSION >= 3
+		else if (PyUnicode_Check(item))
+			name = PyUnicode_AsUTF8(item);
+#endif
+		if (!name) {
+			if (!PyErr_Occurred())
+				PyErr_SetString(PyExc_TypeError, "Family names must be strings");
+			goto err;
+		}
+		for (i = 0; i < ARRAY_SIZE(metrics_group_names); i++) {
+			if (strcmp(metrics_group_names[i], name) == 0)
+				break;
+		}
+		if (i == ARRAY_SIZE(metrics_group_names)) {
+			PyErr_Format(PyExc_ValueError, "Unknown metric family '%s'", name);
+			goto err;
+		}
+		groups |= 1 << i;
+		Py_DECREF(item);
+	}
+	Py_DECREF(iter);
+	return PyErr_Occurred() ? -1 : groups;
+err:
+	Py_DECREF(item);
+	Py_DECREF(iter);
+	return -1;
+}
+
+/* Metric names are [a-zA-Z_:][a-zA-Z0-9_:]* */
+int metrics_valid_prefix(const char *prefix)
+{
+	const char *p;
+
+	if (!*prefix || strlen(prefix) >= METRICS_PREFIX_MAX ||
+	    (*prefix >= '0' && *prefix <= '9'))
+		return 0;
+	for (p = prefix; *p; p++) {
+		if (!((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') ||
+		      (*p >= '0' && *p <= '9') || *p == '_' || *p == ':'))
+			return 0;
+	}
+	return 1;
+}
+
+static void metrics_close(PyMetricsRenderer *self)
+{
+	uint32_t i;
+
+	for (i = 0; i < self->nr_nics; i++)
+		nicstats_free(&self->nics[i].ns);
+	free(self->nics);
+	self->nics = NULL;
+	self->nr_nics = 0;
+	if (self->sk) {
+		nl_close(self->sk);
+		nl_socket_free(self->sk);
+		self->sk = NULL;
+	}
+	if (self->ioctl_fd >= 0) {
+		close(self->ioctl_fd);
+		self->ioctl_fd = -1;
+	}
+	free(self->out.data);
+	memset(&self->out, 0, sizeof(self->out));
+}
+
+/**
+ * ethtool.metrics_renderer(families=None, prefix="ethtool")
+ *
+ * @return Returns a new MetricsRenderer object
+ */
+PyObject *metrics_renderer(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "families", "prefix", NULL };
+	PyObject *families = NULL;
+	const char *prefix = "ethtool";
+	PyMetricsRenderer *r;
+	int groups, err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Os:metrics_renderer", kwlist,
+					 &families, &prefix))
+		return NULL;
+	if (!metrics_valid_prefix(prefix)) {
+		PyErr_Format(PyExc_ValueError, "Invalid metric name prefix '%s'", prefix);
+		return NULL;
+	}
+	if ((groups = metrics_parse_groups(families)) < 0)
+		return NULL;
+
+	r = PyObject_New(PyMetricsRenderer, &PyMetricsRenderer_Type);
+	if (!r)
+		return NULL;
+	pthread_mutex_init(&r->lock, NULL);
+	r->groups = groups;
+	r->ioctl_fd = -1;
+	r->sk = NULL;
+	memset(&r->out, 0, sizeof(r->out));
+	r->exports = 0;
+	r->nr_nics = 0;
+	r->nics = NULL;
+	strcpy(r->prefix, prefix);
+
+	Py_BEGIN_ALLOW_THREADS
+	if (groups & (METRICS_ETHTOOL | METRICS_NIC_STATS)) {
+		r->ioctl_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+		if (r->ioctl_fd < 0)
+			err = errno;
+	}
+	if (!err) {
+		r->sk = nl_socket_alloc();
+		if (!r->sk)
+			err = ENOMEM;
+		else if ((err = nl_connect(r->sk, NETLINK_ROUTE)) == 0)
+			backend_nl_setup(r->sk);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		if (err < 0)
+			PyErr_SetString(PyExc_OSError, nl_geterror(err));
+		else {
+			errno = err;
+			PyErr_SetFromErrno(PyExc_IOError);
+		}
+		Py_DECREF(r);
+		return NULL;
+	}
+	return (PyObject *)r;
+}
+
+static PyObject *renderer_render(PyMetricsRenderer *self, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "snapshot", "copy", NULL };
+	const struct snapshot *given = NULL;
+	PyObject *snap_obj = NULL, *result;
+	struct snapshot own;
+	struct stats_scope scope;
+	int copy = 0, flags, err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Oi:render", kwlist,
+					 &snap_obj, &copy))
+		return NULL;
+	if (snap_obj && snap_obj != Py_None && !(given = snapshot_records(snap_obj)))
+		return NULL;
+	flags = self->groups & METRICS_ETHTOOL ? SNAPSHOT_ETHTOOL : 0;
+
+	/* The export taken here keeps the text until it is handed out */
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	stats_enter(&scope, STATS_RENDER_METRICS);
+	if (self->exports) {
+		err = EBUSY;
+	} else if (!self->sk) {
+		err = EBADF;
+	} else if (given) {
+		err = metrics_render(self, given);
+	} else if ((err = snapshot_collect(&own, self->sk, self->ioctl_fd, flags)) == 0) {
+		err = metrics_render(self, &own);
+		snapshot_free(&own);
+	}
+	if (!err)
+		self->exports++;
+	stats_leave(&scope);
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	if (err == EBUSY) {
+		PyErr_SetString(PyExc_BufferError,
+				"the output of an earlier render() is still in use");
+		return NULL;
+	}
+	if (err < 0) {
+		PyErr_SetString(PyExc_OSError, nl_geterror(err));
+		return NULL;
+	}
+	if (err == ENOMEM)
+		return PyErr_NoMemory();
+	if (err) {
+		errno = err;
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+
+	if (copy)
+		result = PyBytes_FromStringAndSize(self->out.data, self->out.len);
+	else
+		result = PyMemoryView_FromObject((PyObject *)self);
+
+	pthread_mutex_lock(&self->lock);
+	self->exports--;
+	pthread_mutex_unlock(&self->lock);
+	return result;
+}
+
+/* The lock is only held without the GIL, so taking it with the GIL is fine */
+static int renderer_getbuffer(PyMetricsRenderer *self, Py_buffer *view, int flags)
+{
+	int rc;
+
+	pthread_mutex_lock(&self->lock);
+	rc = PyBuffer_FillInfo(view, (PyObject *)self,
+			       self->out.data ? self->out.data : "",
+			       self->out.len, 1, flags);
+	if (rc == 0)
+		self->exports++;
+	pthread_mutex_unlock(&self->lock);
+	return rc;
+}
+
+static void renderer_releasebuffer(PyMetricsRenderer *self, Py_buffer *view __unused)
+{
+	pthread_mutex_lock(&self->lock);
+	self->exports--;
+	pthread_mutex_unlock(&self->lock);
+}
+
+static PyObject *renderer_families(PyMetricsRenderer *self, void *unused __unused)
+{
+	PyObject *tuple, *name;
+	size_t i;
+	int n = 0;
+
+	tuple = PyTuple_New(__builtin_popcount(self->groups));
+	if (!tuple)
+		return NULL;
+	for (i = 0; i < ARRAY_SIZE(metrics_group_names); i++) {
+		if (!(self->groups & (1 << i)))
+			continue;
+		name = PyUnicode_FromString(metrics_group_names[i]);
+		if (!name) {
+			Py_DECREF(tuple);
+			return NULL;
+		}
+		PyTuple_SET_ITEM(tuple, n++, name);
+	}
+	return tuple;
+}
+
+static void renderer_dealloc(PyMetricsRenderer *self)
+{
+	metrics_close(self);
+	pthread_mutex_destroy(&self->lock);
+	PyObject_Del(self);
+}
+
+static PyMethodDef renderer_methods[] = {
+	{"render", (PyCFunction)renderer_render, METH_VARARGS | METH_KEYWORDS,
+	 "render(snapshot=None, copy=False)\n\n"
+	 "Renders the metrics of a snapshot, or of the current state of all "
+	 "interfaces if none is given, in the OpenMetrics text format "
+	 "(application/openmetrics-text; version=1.0.0).  Returns a read-only "
+	 "memoryview of the text, which stays valid until the next render() "
+	 "and must be released before it, or bytes if copy is true."},
+	{NULL}
+};
+
+static PyGetSetDef renderer_getset[] = {
+	{"families", (getter)renderer_families, NULL,
+	 "The metric families rendered", NULL},
+	{NULL}
+};
+
+static PyBufferProcs renderer_as_buffer = {
+	.bf_getbuffer = (getbufferproc)renderer_getbuffer,
+	.bf_releasebuffer = (releasebufferproc)renderer_releasebuffer,
+};
+
+PyTypeObject PyMetricsRenderer_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.MetricsRenderer",
+	.tp_basicsize = sizeof(PyMetricsRenderer),
+#if PY_MAJOR_VERSION >= 3
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+#else
+	.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER,
+#endif
+	.tp_dealloc = (destructor)renderer_dealloc,
+	.tp_methods = renderer_methods,
+	.tp_getset = renderer_getset,
+	.tp_as_buffer = &renderer_as_buffer,
+	.tp_doc = "Renders interface metrics for Prometheus, see ethtool.metrics_renderer()"
+};
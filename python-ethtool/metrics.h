@@ -0,0 +1,48 @@
+/* metrics.h - OpenMetrics exposition of the interface state
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <Python.h>
+#include <stdint.h>
+
+/**
+ * Text in the OpenMetrics format, in a buffer which only grows
+ */
+struct metrics_out {
+	char	   *data;
+	size_t	   len;
+	size_t	   size;
+	int	   err;		/**< ENOMEM once growing failed */
+	const char *prefix;	/**< Of all metric names */
+};
+
+void metrics_put(struct metrics_out *o, const char *s, size_t n);
+void metrics_puts(struct metrics_out *o, const char *s);
+void metrics_put_u64(struct metrics_out *o, uint64_t v);
+void metrics_family(struct metrics_out *o, const char *name,
+		    const char *type, const char *help);
+void metrics_sample(struct metrics_out *o, const char *name, const char *suffix,
+		    const char *device);
+void metrics_label(struct metrics_out *o, const char *key,
+		   const char *value, size_t max);
+void metrics_value(struct metrics_out *o, uint64_t v);
+int metrics_valid_prefix(const char *prefix);
+
+extern PyTypeObject PyMetricsRenderer_Type;
+
+PyObject *metrics_renderer(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif
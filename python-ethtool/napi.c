@@ -0,0 +1,537 @@
+/* napi.c - NAPI interrupt deferral, threaded NAPI and busy polling
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * The software half of interrupt moderation, next to the hardware half of
+ * get_coalesce() and set_coalesce():
+ *
+ *   /sys/class/net/<dev>/napi_defer_hard_irqs  Empty polls before the
+ *                                              interrupt is unmasked again
+ *   /sys/class/net/<dev>/gro_flush_timeout     Nanoseconds GRO holds packets,
+ *                                              and the deferral timer
+ *   /sys/class/net/<dev>/threaded              Poll in napi/<dev>-<id> kthreads
+ *   /proc/sys/net/core/busy_poll               Global, microseconds
+ *   /proc/sys/net/core/busy_read               Global, microseconds
+ *
+ * Writing the per device files resets the settings of every NAPI instance
+ * of the device; single instances are set with set_netdev_napi() in netdev.c.
+ *
+ * The kthreads of threaded NAPI are found by their comm in /proc.  The kernel
+ * truncates comm to 15 characters, so with long interface names the NAPI id
+ * may be cut short and threads of interfaces with a common prefix may be
+ * mistaken for each other.
+ */
+
+#include <Python.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+
+#include "napi.h"
+#include "steering.h"
+#include "ethtool.h"
+#include "backend.h"
+
+#define NAPI_PATH_LEN	(IFNAMSIZ + 64)
+#define NAPI_COMM_LEN	16		/* TASK_COMM_LEN */
+
+#define NAPI_PROC_CORE	"/proc/sys/net/core"
+
+/* Settings, in the order of set_napi()'s arguments */
+enum {
+	NAPI_DEFER_HARD_IRQS,
+	NAPI_GRO_FLUSH_TIMEOUT,
+	NAPI_THREADED,
+	NAPI_BUSY_POLL,
+	NAPI_BUSY_READ,
+	NAPI_NR_SETTINGS
+};
+
+static const struct {
+	const char *name;
+	int	   global;		/**< In NAPI_PROC_CORE, not per device */
+} napi_settings[NAPI_NR_SETTINGS] = {
+	{ "napi_defer_hard_irqs", 0 },
+	{ "gro_flush_timeout", 0 },
+	{ "threaded", 0 },
+	{ "busy_poll", 1 },
+	{ "busy_read", 1 },
+};
+
+struct napi_thread {
+	pid_t		  pid;
+	long		  id;		/**< NAPI id, -1 if cut off */
+	char		  comm[NAPI_COMM_LEN];
+	struct steer_mask affinity;
+};
+
+struct napi_threads {
+	uint32_t	   n;
+	uint32_t	   size;
+	struct napi_thread *threads;	/**< Sorted by NAPI id, then pid */
+};
+
+static void napi_path(char *path, const char *devname, int setting)
+{
+	if (napi_settings[setting].global)
+		snprintf(path, NAPI_PATH_LEN, NAPI_PROC_CORE "/%s",
+			 napi_settings[setting].name);
+	else
+		snprintf(path, NAPI_PATH_LEN, "/sys/class/net/%s/%s", devname,
+			 napi_settings[setting].name);
+}
+
+/**
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int napi_read(const char *path, unsigned long long *value)
+{
+	char *buf, *end;
+	size_t len;
+	int err;
+
+	if ((err = backend_read_file(path, &buf, &len)) != 0)
+		return err;
+	errno = 0;
+	*value = strtoull(buf, &end, 0);
+	if (errno || end == buf)
+		err = errno ? errno : EINVAL;
+	free(buf);
+	return err;
+}
+
+/**
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int napi_write(const char *path, unsigned long value)
+{
+	char buf[24];
+	size_t len;
+	ssize_t n;
+	int fd, err = 0;
+
+	len = snprintf(buf, sizeof(buf), "%lu\n", value);
+	fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+		return errno;
+	n = write(fd, buf, len);
+	if (n < 0)
+		err = errno;
+	else if ((size_t)n != len)
+		err = EIO;
+	close(fd);
+	return err;
+}
+
+static int napi_thread_cmp(const void *a, const void *b)
+{
+	const struct napi_thread *ta = a, *tb = b;
+
+	if (ta->id != tb->id)
+		return ta->id < tb->id ? -1 : 1;
+	return ta->pid < tb->pid ? -1 : ta->pid > tb->pid;
+}
+
+/**
+ * Checks that a task is a kernel thread, which has an empty command line
+ */
+static int napi_is_kthread(pid_t pid)
+{
+	char path[NAPI_PATH_LEN], c;
+	ssize_t n;
+	int fd;
+
+	snprintf(path, sizeof(path), "/proc/%d/cmdline", (int)pid);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return 0;
+	n = read(fd, &c, 1);
+	close(fd);
+	return n == 0;
+}
+
+/**
+ * Finds the threaded NAPI kthreads of a device.  Does not need the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int napi_find_threads(const char *devname, struct napi_threads *list)
+{
+	char prefix[NAPI_COMM_LEN], path[NAPI_PATH_LEN], comm[NAPI_COMM_LEN];
+	struct napi_thread *thread;
+	struct dirent *de;
+	cpu_set_t *set;
+	size_t prefix_len, set_size;
+	uint32_t cpu;
+	ssize_t n;
+	char *end;
+	long pid;
+	int fd, err = 0;
+	DIR *dir;
+
+	/* What is left of "napi/<dev>-" within comm */
+	snprintf(prefix, sizeof(prefix), "napi/%s-", devname);
+	prefix_len = strlen(prefix);
+
+	set = CPU_ALLOC(STEER_MAX_CPUS);
+	if (!set)
+		return ENOMEM;
+	set_size = CPU_ALLOC_SIZE(STEER_MAX_CPUS);
+	dir = opendir("/proc");
+	if (!dir) {
+		CPU_FREE(set);
+		return errno;
+	}
+	while (!err && (de = readdir(dir)) != NULL) {
+		if (!isdigit((unsigned char)de->d_name[0]))
+			continue;
+		pid = strtol(de->d_name, &end, 10);
+		if (*end)
+			continue;
+		snprintf(path, sizeof(path), "/proc/%ld/comm", pid);
+		fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+		n = read(fd, comm, sizeof(comm) - 1);
+		close(fd);
+		if (n <= 0)
+			continue;
+		comm[n] = '\0';
+		comm[strcspn(comm, "\n")] = '\0';
+		if (strncmp(comm, prefix, prefix_len) != 0 || !napi_is_kthread(pid))
+			continue;
+
+		if (list->n == list->size) {
+			uint32_t size = list->size ? list->size * 2 : 16;
+
+			thread = realloc(list->threads, size * sizeof(*thread));
+			if (!thread) {
+				err = ENOMEM;
+				break;
+			}
+			list->threads = thread;
+			list->size = size;
+		}
+		thread = &list->threads[list->n];
+		memset(thread, 0, sizeof(*thread));
+		thread->pid = pid;
+		memcpy(thread->comm, comm, sizeof(comm));
+		thread->id = -1;
+		if (prefix_len < strlen(comm) && isdigit((unsigned char)comm[prefix_len]))
+			thread->id = strtol(comm + prefix_len, NULL, 10);
+		CPU_ZERO_S(set_size, set);
+		if (sched_getaffinity(pid, set_size, set) < 0) {
+			/* Gone in the meantime */
+			if (errno == ESRCH)
+				continue;
+			err = errno;
+			break;
+		}
+		for (cpu = 0; cpu < STEER_MAX_CPUS; cpu++) {
+			if (CPU_ISSET_S(cpu, set_size, set))
+				steer_mask_set(&thread->affinity, cpu);
+		}
+		list->n++;
+	}
+	closedir(dir);
+	CPU_FREE(set);
+	if (!err && list->n)
+		qsort(list->threads, list->n, sizeof(*list->threads), napi_thread_cmp);
+	return err;
+}
+
+/**
+ * Pins a task to a CPU
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int napi_pin(pid_t pid, uint32_t cpu)
+{
+	cpu_set_t *set;
+	size_t set_size;
+	int err = 0;
+
+	set = CPU_ALLOC(STEER_MAX_CPUS);
+	if (!set)
+		return ENOMEM;
+	set_size = CPU_ALLOC_SIZE(STEER_MAX_CPUS);
+	CPU_ZERO_S(set_size, set);
+	CPU_SET_S(cpu, set_size, set);
+	if (sched_setaffinity(pid, set_size, set) < 0)
+		err = errno;
+	CPU_FREE(set);
+	return err;
+}
+
+/**
+ * Device names end up in paths, so they must not walk out of
+ * /sys/class/net
+ */
+static int napi_check_devname(const char *devname)
+{
+	if (strchr(devname, '/') || strcmp(devname, ".") == 0 || strcmp(devname, "..") == 0) {
+		PyErr_Format(PyExc_ValueError, "Invalid device name '%s'", devname);
+		return -1;
+	}
+	return 0;
+}
+
+static PyObject *napi_raise(int err, const char *path)
+{
+	errno = err;
+	if (err == ENOMEM)
+		return PyErr_NoMemory();
+	if (path)
+		return PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)path);
+	return PyErr_SetFromErrno(PyExc_IOError);
+}
+
+static PyObject *napi_thread_dict(const struct napi_thread *thread)
+{
+	PyObject *dict = PyDict_New();
+
+	if (dict &&
+	    (dict_set_steal(dict, "pid", PyLong_FromLong(thread->pid)) ||
+	     dict_set_steal(dict, "name", PyBytes_FromString(thread->comm)) ||
+	     dict_set_steal(dict, "affinity", steer_mask_to_python(&thread->affinity))))
+		Py_CLEAR(dict);
+	if (dict && thread->id < 0 && PyDict_SetItemString(dict, "napi_id", Py_None) < 0)
+		Py_CLEAR(dict);
+	if (dict && thread->id >= 0 &&
+	    dict_set_steal(dict, "napi_id", PyLong_FromLong(thread->id)) < 0)
+		Py_CLEAR(dict);
+	return dict;
+}
+
+static PyObject *napi_threads_list(const struct napi_threads *list)
+{
+	PyObject *threads, *thread;
+	uint32_t i;
+
+	threads = PyList_New(list->n);
+	for (i = 0; threads && i < list->n; i++) {
+		thread = napi_thread_dict(&list->threads[i]);
+		if (!thread) {
+			Py_CLEAR(threads);
+			break;
+		}
+		PyList_SET_ITEM(threads, i, thread);
+	}
+	return threads;
+}
+
+/**
+ * ethtool.get_napi(devname)
+ */
+PyObject *napi_get(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", NULL };
+	unsigned long long values[NAPI_NR_SETTINGS];
+	int present[NAPI_NR_SETTINGS];
+	char path[NAPI_PATH_LEN], dev_path[NAPI_PATH_LEN];
+	struct napi_threads list = { 0, 0, NULL };
+	char devname[IFNAMSIZ];
+	PyObject *dict;
+	int i, err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&:get_napi", kwlist,
+					 devname_converter, devname))
+		return NULL;
+	if (napi_check_devname(devname) < 0)
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	snprintf(dev_path, sizeof(dev_path), "/sys/class/net/%s", devname);
+	if (access(dev_path, F_OK) < 0) {
+		err = errno;
+		memcpy(path, dev_path, sizeof(path));
+	}
+	/* Older kernels lack threaded, some devices lack all of them */
+	for (i = 0; !err && i < NAPI_NR_SETTINGS; i++) {
+		napi_path(path, devname, i);
+		err = napi_read(path, &values[i]);
+		present[i] = !err;
+		if (err == ENOENT || err == EOPNOTSUPP)
+			err = 0;
+	}
+	if (!err) {
+		err = napi_find_threads(devname, &list);
+		if (err)
+			snprintf(path, sizeof(path), "/proc");
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		free(list.threads);
+		return napi_raise(err, path);
+	}
+	dict = PyDict_New();
+	for (i = 0; dict && i < NAPI_NR_SETTINGS; i++) {
+		if (present[i] ?
+		    dict_set_steal(dict, napi_settings[i].name,
+				   PyLong_FromUnsignedLongLong(values[i])) < 0 :
+		    PyDict_SetItemString(dict, napi_settings[i].name, Py_None) < 0)
+			Py_CLEAR(dict);
+	}
+	if (dict && dict_set_steal(dict, "threads", napi_threads_list(&list)) < 0)
+		Py_CLEAR(dict);
+	free(list.threads);
+	return dict;
+}
+
+/**
+ * ethtool.set_napi(devname, napi_defer_hard_irqs=None, gro_flush_timeout=None,
+ *		    threaded=None, busy_poll=None, busy_read=None)
+ */
+PyObject *napi_set(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", "napi_defer_hard_irqs", "gro_flush_timeout",
+				  "threaded", "busy_poll", "busy_read", NULL };
+	PyObject *objs[NAPI_NR_SETTINGS] = { NULL };
+	unsigned long values[NAPI_NR_SETTINGS];
+	char path[NAPI_PATH_LEN];
+	char devname[IFNAMSIZ];
+	int i, err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|OOOOO:set_napi", kwlist,
+					 devname_converter, devname, &objs[0], &objs[1], &objs[2],
+					 &objs[3], &objs[4]))
+		return NULL;
+	if (napi_check_devname(devname) < 0)
+		return NULL;
+
+	/* Everything is checked before anything is written */
+	for (i = 0; i < NAPI_NR_SETTINGS; i++) {
+		if (objs[i] == Py_None)
+			objs[i] = NULL;
+		if (!objs[i])
+			continue;
+		if (!PyLong_Check(objs[i])
+#if PY_MAJOR_VERSION < 3
+		    && !PyInt_Check(objs[i])
+#endif
+		    ) {
+			PyErr_Format(PyExc_ValueError, "%s must be a non-negative integer",
+				     napi_settings[i].name);
+			return NULL;
+		}
+		values[i] = PyLong_AsUnsignedLong(objs[i]);
+		if (values[i] == (unsigned long)-1 && PyErr_Occurred()) {
+			if (PyErr_ExceptionMatches(PyExc_TypeError) ||
+			    PyErr_ExceptionMatches(PyExc_OverflowError)) {
+				PyErr_Clear();
+				PyErr_Format(PyExc_ValueError,
+					     "%s must be a non-negative integer",
+					     napi_settings[i].name);
+			}
+			return NULL;
+		}
+	}
+
+	/* busy_poll and busy_read are global, a typo must not change them */
+	Py_BEGIN_ALLOW_THREADS
+	snprintf(path, sizeof(path), "/sys/class/net/%s", devname);
+	if (access(path, F_OK) < 0)
+		err = errno;
+	for (i = 0; i < NAPI_NR_SETTINGS && !err; i++) {
+		if (!objs[i])
+			continue;
+		napi_path(path, devname, i);
+		err = napi_write(path, values[i]);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err)
+		return napi_raise(err, path);
+	Py_RETURN_NONE;
+}
+
+/**
+ * ethtool.set_napi_affinity(devname, cpus)
+ */
+PyObject *napi_set_affinity(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", "cpus", NULL };
+	struct napi_threads list = { 0, 0, NULL };
+	struct steer_mask *cpus;
+	PyObject *cpus_obj, *plan, *item;
+	char devname[IFNAMSIZ];
+	uint32_t *order, nr_cpus = 0, cpu, i;
+	int err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O:set_napi_affinity", kwlist,
+					 devname_converter, devname, &cpus_obj))
+		return NULL;
+	if (napi_check_devname(devname) < 0)
+		return NULL;
+	cpus = malloc(sizeof(*cpus));
+	order = malloc(STEER_MAX_CPUS * sizeof(*order));
+	if (!cpus || !order) {
+		free(cpus);
+		free(order);
+		return PyErr_NoMemory();
+	}
+	if (steer_mask_from_python(cpus_obj, cpus) < 0) {
+		free(cpus);
+		free(order);
+		return NULL;
+	}
+	for (cpu = 0; cpu < STEER_MAX_CPUS; cpu++) {
+		if (steer_mask_test(cpus, cpu))
+			order[nr_cpus++] = cpu;
+	}
+	free(cpus);
+	if (!nr_cpus) {
+		free(order);
+		PyErr_SetString(PyExc_ValueError, "no CPUs to pin the NAPI threads to");
+		return NULL;
+	}
+
+	/* The Nth thread by NAPI id goes to the Nth CPU, round robin */
+	Py_BEGIN_ALLOW_THREADS
+	err = napi_find_threads(devname, &list);
+	for (i = 0; !err && i < list.n; i++) {
+		err = napi_pin(list.threads[i].pid, order[i % nr_cpus]);
+		/* Threaded NAPI turned off in the meantime */
+		if (err == ESRCH)
+			err = 0;
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		free(list.threads);
+		free(order);
+		return napi_raise(err, NULL);
+	}
+	plan = PyList_New(list.n);
+	for (i = 0; plan && i < list.n; i++) {
+		item = Py_BuildValue("(iI)", (int)list.threads[i].pid, order[i % nr_cpus]);
+		if (!item) {
+			Py_CLEAR(plan);
+			break;
+		}
+		PyList_SET_ITEM(plan, i, item);
+	}
+	free(list.threads);
+	free(order);
+	return plan;
+}
@@ -0,0 +1,24 @@
+/* napi.h - NAPI interrupt deferral, threaded NAPI and busy polling
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _NAPI_H
+#define _NAPI_H
+
+#include <Python.h>
+
+PyObject *napi_get(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *napi_set(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *napi_set_affinity(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif
@@ -0,0 +1,823 @@
+/* netdev.c - Queues, NAPI instances and page pools from the netdev family
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Linux 6.8 and later describe the queues of a device, the NAPI instance
+ * serving each queue and the page pools feeding them through the "netdev"
+ * generic netlink family, and 6.9 added per queue statistics.  Only libnl
+ * core is used: the family is resolved with CTRL_CMD_GETFAMILY and the
+ * messages are built and parsed by hand, as libnl-genl is not a dependency.
+ *
+ * Each of get_netdev_queues(), get_netdev_napis() and get_page_pools() runs
+ * a dump, and for queues and page pools a second one of their statistics
+ * which is merged into the rows of the first by the key columns.  The result
+ * is a NetdevTable, a read-only two dimensional buffer of unsigned 64 bit
+ * integers with a row per object and a column per attribute.  Attributes the
+ * kernel or the driver does not report are NETDEV_MISSING there.
+ *
+ * set_netdev_napi() writes the deferral settings of a single NAPI instance
+ * with NETDEV_CMD_NAPI_SET, from Linux 6.13 on.
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <net/if.h>
+#include <linux/genetlink.h>
+#include <netlink/netlink.h>
+#include <netlink/socket.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+
+#include "netdev.h"
+#include "netdev-copy.h"
+#include "ethtool.h"
+#include "backend.h"
+
+#define NETDEV_MISSING	UINT64_MAX
+
+/* Above the highest attribute of any of the dumps */
+#define NETDEV_MAX_ATTR	NETDEV_A_QSTATS_MAX
+#define NETDEV_MAX_KEYS	3
+
+/**
+ * A column of a table, filled from an attribute of the replies of the
+ * first dump or of the statistics dump
+ */
+struct netdev_col {
+	const char *name;
+	uint16_t   attr;	/**< 0 if not in the first dump */
+	uint16_t   stats_attr;	/**< 0 if not in the statistics dump */
+};
+
+/**
+ * How a table is dumped.  The key columns come first.
+ */
+struct netdev_kind {
+	uint8_t			cmd;
+	uint8_t			stats_cmd;	/**< 0 if there is none */
+	uint16_t		max_attr;
+	uint16_t		max_stats_attr;
+	uint16_t		filter_attr;	/**< ifindex filter of the request, or 0 */
+	uint16_t		stats_filter_attr;
+	uint16_t		stats_info_attr; /**< Nest with the keys as first dump attributes */
+	uint32_t		nr_keys;
+	uint32_t		ifindex_col;
+	uint32_t		nr_cols;
+	const struct netdev_col *cols;
+};
+
+static const struct netdev_col netdev_queue_cols[] = {
+	{ "ifindex", NETDEV_A_QUEUE_IFINDEX, NETDEV_A_QSTATS_IFINDEX },
+	{ "type", NETDEV_A_QUEUE_TYPE, NETDEV_A_QSTATS_QUEUE_TYPE },
+	{ "id", NETDEV_A_QUEUE_ID, NETDEV_A_QSTATS_QUEUE_ID },
+	{ "napi_id", NETDEV_A_QUEUE_NAPI_ID, 0 },
+	{ "rx_packets", 0, NETDEV_A_QSTATS_RX_PACKETS },
+	{ "rx_bytes", 0, NETDEV_A_QSTATS_RX_BYTES },
+	{ "rx_alloc_fail", 0, NETDEV_A_QSTATS_RX_ALLOC_FAIL },
+	{ "rx_hw_drops", 0, NETDEV_A_QSTATS_RX_HW_DROPS },
+	{ "rx_hw_drop_overruns", 0, NETDEV_A_QSTATS_RX_HW_DROP_OVERRUNS },
+	{ "rx_csum_complete", 0, NETDEV_A_QSTATS_RX_CSUM_COMPLETE },
+	{ "rx_csum_unnecessary", 0, NETDEV_A_QSTATS_RX_CSUM_UNNECESSARY },
+	{ "rx_csum_none", 0, NETDEV_A_QSTATS_RX_CSUM_NONE },
+	{ "rx_csum_bad", 0, NETDEV_A_QSTATS_RX_CSUM_BAD },
+	{ "rx_hw_gro_packets", 0, NETDEV_A_QSTATS_RX_HW_GRO_PACKETS },
+	{ "rx_hw_gro_bytes", 0, NETDEV_A_QSTATS_RX_HW_GRO_BYTES },
+	{ "rx_hw_gro_wire_packets", 0, NETDEV_A_QSTATS_RX_HW_GRO_WIRE_PACKETS },
+	{ "rx_hw_gro_wire_bytes", 0, NETDEV_A_QSTATS_RX_HW_GRO_WIRE_BYTES },
+	{ "rx_hw_drop_ratelimits", 0, NETDEV_A_QSTATS_RX_HW_DROP_RATELIMITS },
+	{ "tx_packets", 0, NETDEV_A_QSTATS_TX_PACKETS },
+	{ "tx_bytes", 0, NETDEV_A_QSTATS_TX_BYTES },
+	{ "tx_hw_drops", 0, NETDEV_A_QSTATS_TX_HW_DROPS },
+	{ "tx_hw_drop_errors", 0, NETDEV_A_QSTATS_TX_HW_DROP_ERRORS },
+	{ "tx_csum_none", 0, NETDEV_A_QSTATS_TX_CSUM_NONE },
+	{ "tx_needs_csum", 0, NETDEV_A_QSTATS_TX_NEEDS_CSUM },
+	{ "tx_hw_gso_packets", 0, NETDEV_A_QSTATS_TX_HW_GSO_PACKETS },
+	{ "tx_hw_gso_bytes", 0, NETDEV_A_QSTATS_TX_HW_GSO_BYTES },
+	{ "tx_hw_gso_wire_packets", 0, NETDEV_A_QSTATS_TX_HW_GSO_WIRE_PACKETS },
+	{ "tx_hw_gso_wire_bytes", 0, NETDEV_A_QSTATS_TX_HW_GSO_WIRE_BYTES },
+	{ "tx_hw_drop_ratelimits", 0, NETDEV_A_QSTATS_TX_HW_DROP_RATELIMITS },
+	{ "tx_stop", 0, NETDEV_A_QSTATS_TX_STOP },
+	{ "tx_wake", 0, NETDEV_A_QSTATS_TX_WAKE },
+};
+
+static const struct netdev_col netdev_napi_cols[] = {
+	{ "id", NETDEV_A_NAPI_ID, 0 },
+	{ "ifindex", NETDEV_A_NAPI_IFINDEX, 0 },
+	{ "irq", NETDEV_A_NAPI_IRQ, 0 },
+	{ "pid", NETDEV_A_NAPI_PID, 0 },
+	{ "defer_hard_irqs", NETDEV_A_NAPI_DEFER_HARD_IRQS, 0 },
+	{ "gro_flush_timeout", NETDEV_A_NAPI_GRO_FLUSH_TIMEOUT, 0 },
+	{ "irq_suspend_timeout", NETDEV_A_NAPI_IRQ_SUSPEND_TIMEOUT, 0 },
+};
+
+static const struct netdev_col netdev_page_pool_cols[] = {
+	{ "id", NETDEV_A_PAGE_POOL_ID, 0 },
+	{ "ifindex", NETDEV_A_PAGE_POOL_IFINDEX, 0 },
+	{ "napi_id", NETDEV_A_PAGE_POOL_NAPI_ID, 0 },
+	{ "inflight", NETDEV_A_PAGE_POOL_INFLIGHT, 0 },
+	{ "inflight_mem", NETDEV_A_PAGE_POOL_INFLIGHT_MEM, 0 },
+	{ "detach_time", NETDEV_A_PAGE_POOL_DETACH_TIME, 0 },
+	{ "alloc_fast", 0, NETDEV_A_PAGE_POOL_STATS_ALLOC_FAST },
+	{ "alloc_slow", 0, NETDEV_A_PAGE_POOL_STATS_ALLOC_SLOW },
+	{ "alloc_slow_high_order", 0, NETDEV_A_PAGE_POOL_STATS_ALLOC_SLOW_HIGH_ORDER },
+	{ "alloc_empty", 0, NETDEV_A_PAGE_POOL_STATS_ALLOC_EMPTY },
+	{ "alloc_refill", 0, NETDEV_A_PAGE_POOL_STATS_ALLOC_REFILL },
+	{ "alloc_waive", 0, NETDEV_A_PAGE_POOL_STATS_ALLOC_WAIVE },
+	{ "recycle_cached", 0, NETDEV_A_PAGE_POOL_STATS_RECYCLE_CACHED },
+	{ "recycle_cache_full", 0, NETDEV_A_PAGE_POOL_STATS_RECYCLE_CACHE_FULL },
+	{ "recycle_ring", 0, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING },
+	{ "recycle_ring_full", 0, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING_FULL },
+	{ "recycle_released_refcnt", 0, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RELEASED_REFCNT },
+};
+
+static const struct netdev_kind netdev_queues = {
+	.cmd = NETDEV_CMD_QUEUE_GET,
+	.stats_cmd = NETDEV_CMD_QSTATS_GET,
+	.max_attr = NETDEV_A_QUEUE_MAX,
+	.max_stats_attr = NETDEV_A_QSTATS_MAX,
+	.filter_attr = NETDEV_A_QUEUE_IFINDEX,
+	.stats_filter_attr = NETDEV_A_QSTATS_IFINDEX,
+	.nr_keys = 3,
+	.ifindex_col = 0,
+	.nr_cols = ARRAY_SIZE(netdev_queue_cols),
+	.cols = netdev_queue_cols,
+};
+
+static const struct netdev_kind netdev_napis = {
+	.cmd = NETDEV_CMD_NAPI_GET,
+	.max_attr = NETDEV_A_NAPI_MAX,
+	.filter_attr = NETDEV_A_NAPI_IFINDEX,
+	.nr_keys = 1,
+	.ifindex_col = 1,
+	.nr_cols = ARRAY_SIZE(netdev_napi_cols),
+	.cols = netdev_napi_cols,
+};
+
+/* Neither page pool dump can be filtered by the kernel */
+static const struct netdev_kind netdev_page_pools = {
+	.cmd = NETDEV_CMD_PAGE_POOL_GET,
+	.stats_cmd = NETDEV_CMD_PAGE_POOL_STATS_GET,
+	.max_attr = NETDEV_A_PAGE_POOL_MAX,
+	.max_stats_attr = NETDEV_A_PAGE_POOL_STATS_MAX,
+	.stats_info_attr = NETDEV_A_PAGE_POOL_STATS_INFO,
+	.nr_keys = 1,
+	.ifindex_col = 1,
+	.nr_cols = ARRAY_SIZE(netdev_page_pool_cols),
+	.cols = netdev_page_pool_cols,
+};
+
+/**
+ * Rows being dumped
+ */
+struct netdev_dump {
+	const struct netdev_kind *kind;
+	uint64_t		 ifindex;	/**< Of the rows to keep, or NETDEV_MISSING */
+	uint32_t		 nr_rows;
+	uint32_t		 size;
+	uint64_t		 *rows;
+	int			 err;		/**< Set by the callbacks, an errno */
+};
+
+/**
+ * The ethtool.NetdevTable object
+ */
+typedef struct {
+	PyObject_HEAD
+	const struct netdev_kind *kind;
+	Py_ssize_t		 shape[2];
+	Py_ssize_t		 strides[2];
+	uint64_t		 *rows;
+} PyNetdevTable;
+
+/**
+ * Reads an attribute of type u8 to u64, or uint, which is 32 or 64 bits
+ */
+static uint64_t netdev_attr_value(const struct nlattr *nla)
+{
+	switch (nla_len(nla)) {
+	case 1:
+		return nla_get_u8(nla);
+	case 2:
+		return nla_get_u16(nla);
+	case 4:
+		return nla_get_u32(nla);
+	case 8:
+		return nla_get_u64(nla);
+	}
+	return NETDEV_MISSING;
+}
+
+static int netdev_family_msg(struct nl_msg *msg, void *arg)
+{
+	struct nlattr *tb[CTRL_ATTR_MAX + 1];
+	int *family = arg;
+
+	if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, tb, CTRL_ATTR_MAX, NULL) < 0 ||
+	    !tb[CTRL_ATTR_FAMILY_ID])
+		return NL_SKIP;
+	*family = nla_get_u16(tb[CTRL_ATTR_FAMILY_ID]);
+	return NL_STOP;
+}
+
+/**
+ * Starts a request of a generic netlink family
+ *
+ * @return Returns the message, or NULL if out of memory
+ */
+struct nl_msg *netdev_msg(int family, uint8_t cmd, uint8_t version, int flags)
+{
+	struct genlmsghdr hdr = { .cmd = cmd, .version = version };
+	struct nl_msg *msg;
+
+	msg = nlmsg_alloc_simple(family, flags);
+	if (msg && nlmsg_append(msg, &hdr, sizeof(hdr), NLMSG_ALIGNTO) < 0) {
+		nlmsg_free(msg);
+		msg = NULL;
+	}
+	return msg;
+}
+
+/**
+ * Sends a request and reads the replies, the valid ones going to a callback
+ *
+ * @return Returns 0 on success, otherwise a negative libnl error code
+ */
+int netdev_exchange(struct nl_sock *sk, struct nl_msg *msg,
+		    nl_recvmsg_msg_cb_t func, void *arg)
+{
+	int err;
+
+	nl_socket_modify_cb(sk, NL_CB_VALID, NL_CB_CUSTOM, func, arg);
+	err = nl_send_auto(sk, msg);
+	nlmsg_free(msg);
+	if (err < 0)
+		return err;
+	err = nl_recvmsgs_default(sk);
+	return err < 0 ? err : 0;
+}
+
+/**
+ * Looks up the id of a generic netlink family
+ *
+ * @return Returns 0 on success, otherwise a negative libnl error code
+ */
+int netdev_resolve(struct nl_sock *sk, const char *name, int *family)
+{
+	struct nl_msg *msg;
+	int err;
+
+	*family = 0;
+	msg = netdev_msg(GENL_ID_CTRL, CTRL_CMD_GETFAMILY, 1, 0);
+	if (!msg || nla_put_string(msg, CTRL_ATTR_FAMILY_NAME, name) < 0) {
+		nlmsg_free(msg);
+		return -NLE_NOMEM;
+	}
+	err = netdev_exchange(sk, msg, netdev_family_msg, family);
+	if (!err && !*family)
+		err = -NLE_OBJ_NOTFOUND;
+	return err;
+}
+
+static int netdev_row_cmp(const uint64_t *a, const uint64_t *b, uint32_t nr_keys)
+{
+	uint32_t i;
+
+	for (i = 0; i < nr_keys; i++) {
+		if (a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+static int netdev_qsort_cmp(const void *a, const void *b, void *arg)
+{
+	return netdev_row_cmp(a, b, *(const uint32_t *)arg);
+}
+
+/**
+ * @return Returns the row with the keys, or NULL if there is none
+ */
+static uint64_t *netdev_find(struct netdev_dump *d, const uint64_t *keys)
+{
+	const struct netdev_kind *kind = d->kind;
+	uint32_t lo = 0, hi = d->nr_rows, mid;
+	uint64_t *row;
+	int cmp;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		row = d->rows + (size_t)mid * kind->nr_cols;
+		cmp = netdev_row_cmp(keys, row, kind->nr_keys);
+		if (cmp == 0)
+			return row;
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return NULL;
+}
+
+static int netdev_dump_msg(struct nl_msg *msg, void *arg)
+{
+	struct netdev_dump *d = arg;
+	const struct netdev_kind *kind = d->kind;
+	struct nlattr *tb[NETDEV_MAX_ATTR + 1];
+	uint64_t *row;
+	uint32_t i;
+
+	if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, tb, kind->max_attr, NULL) < 0)
+		return NL_SKIP;
+	if (d->ifindex != NETDEV_MISSING &&
+	    (!tb[kind->cols[kind->ifindex_col].attr] ||
+	     netdev_attr_value(tb[kind->cols[kind->ifindex_col].attr]) != d->ifindex))
+		return NL_SKIP;
+
+	if (d->nr_rows == d->size) {
+		uint32_t size = d->size ? d->size * 2 : 64;
+
+		row = realloc(d->rows, (size_t)size * kind->nr_cols * sizeof(*row));
+		if (!row) {
+			d->err = ENOMEM;
+			return NL_STOP;
+		}
+		d->rows = row;
+		d->size = size;
+	}
+	row = d->rows + (size_t)d->nr_rows++ * kind->nr_cols;
+	for (i = 0; i < kind->nr_cols; i++) {
+		row[i] = NETDEV_MISSING;
+		if (kind->cols[i].attr && tb[kind->cols[i].attr])
+			row[i] = netdev_attr_value(tb[kind->cols[i].attr]);
+	}
+	return NL_OK;
+}
+
+static int netdev_stats_msg(struct nl_msg *msg, void *arg)
+{
+	struct netdev_dump *d = arg;
+	const struct netdev_kind *kind = d->kind;
+	struct nlattr *tb[NETDEV_MAX_ATTR + 1], *info[NETDEV_MAX_ATTR + 1];
+	uint64_t keys[NETDEV_MAX_KEYS], *row;
+	uint32_t i;
+
+	if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, tb, kind->max_stats_attr, NULL) < 0)
+		return NL_SKIP;
+	if (kind->stats_info_attr &&
+	    (!tb[kind->stats_info_attr] ||
+	     nla_parse_nested(info, kind->max_attr, tb[kind->stats_info_attr], NULL) < 0))
+		return NL_SKIP;
+	for (i = 0; i < kind->nr_keys; i++) {
+		const struct nlattr *nla = kind->stats_info_attr ?
+			info[kind->cols[i].attr] : tb[kind->cols[i].stats_attr];
+
+		if (!nla)
+			return NL_SKIP;
+		keys[i] = netdev_attr_value(nla);
+	}
+	row = netdev_find(d, keys);
+	if (!row)
+		return NL_SKIP;
+	for (i = kind->nr_keys; i < kind->nr_cols; i++) {
+		if (kind->cols[i].stats_attr && tb[kind->cols[i].stats_attr])
+			row[i] = netdev_attr_value(tb[kind->cols[i].stats_attr]);
+	}
+	return NL_OK;
+}
+
+/**
+ * Runs the dumps of a table.  Does not need the GIL.
+ *
+ * @param ifindex Of the device to dump, 0 for all of them
+ *
+ * @return Returns 0 on success, a positive errno or a negative libnl error
+ *         code
+ */
+static int netdev_collect(struct netdev_dump *d, unsigned int ifindex)
+{
+	const struct netdev_kind *kind = d->kind;
+	struct nl_sock *sk;
+	struct nl_msg *msg;
+	int family, err;
+
+	d->ifindex = ifindex ? ifindex : NETDEV_MISSING;
+	sk = nl_socket_alloc();
+	if (!sk)
+		return ENOMEM;
+	if ((err = nl_connect(sk, NETLINK_GENERIC)) < 0) {
+		nl_socket_free(sk);
+		return err;
+	}
+	backend_nl_setup(sk);
+	/* A dump is not acknowledged, the family request needs no ack */
+	nl_socket_disable_auto_ack(sk);
+
+	if ((err = netdev_resolve(sk, NETDEV_FAMILY_NAME, &family)) < 0)
+		goto out;
+
+	msg = netdev_msg(family, kind->cmd, NETDEV_FAMILY_VERSION, NLM_F_DUMP);
+	if (!msg || (ifindex && kind->filter_attr &&
+		     nla_put_u32(msg, kind->filter_attr, ifindex) < 0)) {
+		nlmsg_free(msg);
+		err = -NLE_NOMEM;
+		goto out;
+	}
+	if ((err = netdev_exchange(sk, msg, netdev_dump_msg, d)) < 0 || d->err)
+		goto out;
+	if (!kind->stats_cmd || !d->nr_rows)
+		goto out;
+	qsort_r(d->rows, d->nr_rows, kind->nr_cols * sizeof(*d->rows),
+		netdev_qsort_cmp, (void *)&kind->nr_keys);
+
+	msg = netdev_msg(family, kind->stats_cmd, NETDEV_FAMILY_VERSION, NLM_F_DUMP);
+	if (!msg ||
+	    (ifindex && kind->stats_filter_attr &&
+	     nla_put_u32(msg, kind->stats_filter_attr, ifindex) < 0) ||
+	    (kind->stats_cmd == NETDEV_CMD_QSTATS_GET &&
+	     nla_put_u32(msg, NETDEV_A_QSTATS_SCOPE, NETDEV_QSTATS_SCOPE_QUEUE) < 0)) {
+		nlmsg_free(msg);
+		err = -NLE_NOMEM;
+		goto out;
+	}
+	/* Drivers without statistics and kernels without them leave them missing */
+	err = netdev_exchange(sk, msg, netdev_stats_msg, d);
+	if (err == -NLE_OPNOTSUPP || err == -NLE_INVAL)
+		err = 0;
+ out:
+	nl_close(sk);
+	nl_socket_free(sk);
+	return d->err ? d->err : err;
+}
+
+static PyObject *netdev_table(const struct netdev_kind *kind, PyObject *args,
+			      PyObject *kwds, const char *format)
+{
+	static char *kwlist[] = { "devname", NULL };
+	struct netdev_dump d = { .kind = kind };
+	const char *devname = NULL;
+	unsigned int ifindex = 0;
+	PyNetdevTable *table;
+	PyObject *value;
+	int err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, format, kwlist, &devname))
+		return NULL;
+	if (devname && !(ifindex = if_nametoindex(devname))) {
+		PyErr_SetFromErrno(PyExc_IOError);
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	err = netdev_collect(&d, ifindex);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		free(d.rows);
+		if (err == ENOMEM || err == -NLE_NOMEM)
+			return PyErr_NoMemory();
+		if (err == -NLE_OBJ_NOTFOUND || err == -NLE_OPNOTSUPP) {
+			value = Py_BuildValue("(is)", EOPNOTSUPP,
+					      "the kernel lacks the netdev generic "
+					      "netlink family or command");
+			if (value) {
+				PyErr_SetObject(PyExc_IOError, value);
+				Py_DECREF(value);
+			}
+			return NULL;
+		}
+		if (err < 0) {
+			PyErr_SetString(PyExc_OSError, nl_geterror(err));
+			return NULL;
+		}
+		errno = err;
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+
+	table = PyObject_New(PyNetdevTable, &PyNetdevTable_Type);
+	if (!table) {
+		free(d.rows);
+		return NULL;
+	}
+	table->kind = kind;
+	table->shape[0] = d.nr_rows;
+	table->shape[1] = kind->nr_cols;
+	table->strides[0] = kind->nr_cols * sizeof(uint64_t);
+	table->strides[1] = sizeof(uint64_t);
+	table->rows = d.rows;
+	return (PyObject *)table;
+}
+
+/**
+ * ethtool.get_netdev_queues(devname=None)
+ */
+PyObject *netdev_get_queues(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	return netdev_table(&netdev_queues, args, kwds, "|z:get_netdev_queues");
+}
+
+/**
+ * ethtool.get_netdev_napis(devname=None)
+ */
+PyObject *netdev_get_napis(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	return netdev_table(&netdev_napis, args, kwds, "|z:get_netdev_napis");
+}
+
+/**
+ * ethtool.get_page_pools(devname=None)
+ */
+PyObject *netdev_get_page_pools(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	return netdev_table(&netdev_page_pools, args, kwds, "|z:get_page_pools");
+}
+
+/* Settings of set_netdev_napi(), in the order of its arguments */
+static const struct {
+	const char *name;
+	uint16_t   attr;
+	uint64_t   max;
+} netdev_napi_settings[] = {
+	{ "defer_hard_irqs", NETDEV_A_NAPI_DEFER_HARD_IRQS, INT32_MAX },
+	{ "gro_flush_timeout", NETDEV_A_NAPI_GRO_FLUSH_TIMEOUT, UINT64_MAX },
+	{ "irq_suspend_timeout", NETDEV_A_NAPI_IRQ_SUSPEND_TIMEOUT, UINT64_MAX },
+};
+
+#define NETDEV_NR_NAPI_SETTINGS	ARRAY_SIZE(netdev_napi_settings)
+
+/**
+ * Writes settings of a NAPI instance.  Does not need the GIL.
+ *
+ * @param given  Bitmap of the settings to write
+ * @param values The values to write, by setting
+ *
+ * @return Returns 0 on success, otherwise a negative libnl error code
+ */
+static int netdev_napi_apply(uint32_t napi_id, uint32_t given, const uint64_t *values)
+{
+	struct nl_sock *sk;
+	struct nl_msg *msg;
+	int family, err;
+	size_t i;
+
+	sk = nl_socket_alloc();
+	if (!sk)
+		return -NLE_NOMEM;
+	if ((err = nl_connect(sk, NETLINK_GENERIC)) < 0) {
+		nl_socket_free(sk);
+		return err;
+	}
+	backend_nl_setup(sk);
+	/* The family request is answered, only the write waits for an ack */
+	nl_socket_disable_auto_ack(sk);
+
+	if ((err = netdev_resolve(sk, NETDEV_FAMILY_NAME, &family)) < 0) {
+		if (err == -NLE_OBJ_NOTFOUND)
+			err = -NLE_OPNOTSUPP;
+		goto out;
+	}
+
+	msg = netdev_msg(family, NETDEV_CMD_NAPI_SET, NETDEV_FAMILY_VERSION, 0);
+	if (!msg || nla_put_u32(msg, NETDEV_A_NAPI_ID, napi_id) < 0) {
+		nlmsg_free(msg);
+		err = -NLE_NOMEM;
+		goto out;
+	}
+	for (i = 0; i < NETDEV_NR_NAPI_SETTINGS; i++) {
+		if (!(given & (1U << i)))
+			continue;
+		if ((netdev_napi_settings[i].max <= UINT32_MAX ?
+		     nla_put_u32(msg, netdev_napi_settings[i].attr, values[i]) :
+		     nla_put_u64(msg, netdev_napi_settings[i].attr, values[i])) < 0) {
+			nlmsg_free(msg);
+			err = -NLE_NOMEM;
+			goto out;
+		}
+	}
+	/* The unacknowledged family request left the expected sequence behind */
+	nl_socket_disable_seq_check(sk);
+	nl_socket_enable_auto_ack(sk);
+	err = nl_send_sync(sk, msg);
+ out:
+	nl_close(sk);
+	nl_socket_free(sk);
+	return err;
+}
+
+/**
+ * Converts a setting of set_netdev_napi()
+ *
+ * @return Returns 0 on success, otherwise -1 with a Python exception set
+ */
+static int netdev_napi_value(PyObject *obj, size_t i, uint64_t *value)
+{
+	int bad = 1;
+
+#if PY_MAJOR_VERSION < 3
+	if (PyInt_Check(obj)) {
+		bad = PyInt_AS_LONG(obj) < 0;
+		*value = PyInt_AS_LONG(obj);
+	} else
+#endif
+	if (PyLong_Check(obj)) {
+		*value = PyLong_AsUnsignedLongLong(obj);
+		if (*value == (unsigned long long)-1 && PyErr_Occurred()) {
+			if (!PyErr_ExceptionMatches(PyExc_OverflowError))
+				return -1;
+			PyErr_Clear();
+		} else {
+			bad = 0;
+		}
+	}
+	if (bad || *value > netdev_napi_settings[i].max) {
+		PyErr_Format(PyExc_ValueError, "%s must be an integer from 0 to %llu",
+			     netdev_napi_settings[i].name,
+			     (unsigned long long)netdev_napi_settings[i].max);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * ethtool.set_netdev_napi(napi_id, defer_hard_irqs=None, gro_flush_timeout=None,
+ *			   irq_suspend_timeout=None)
+ */
+PyObject *netdev_set_napi(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "napi_id", "defer_hard_irqs", "gro_flush_timeout",
+				  "irq_suspend_timeout", NULL };
+	PyObject *objs[NETDEV_NR_NAPI_SETTINGS] = { NULL }, *value;
+	uint64_t values[NETDEV_NR_NAPI_SETTINGS];
+	unsigned int napi_id;
+	uint32_t given = 0;
+	size_t i;
+	int err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "I|OOO:set_netdev_napi", kwlist,
+					 &napi_id, &objs[0], &objs[1], &objs[2]))
+		return NULL;
+	for (i = 0; i < NETDEV_NR_NAPI_SETTINGS; i++) {
+		if (!objs[i] || objs[i] == Py_None)
+			continue;
+		if (netdev_napi_value(objs[i], i, &values[i]) < 0)
+			return NULL;
+		given |= 1U << i;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	err = netdev_napi_apply(napi_id, given, values);
+	Py_END_ALLOW_THREADS
+
+	switch (err) {
+	case 0:
+		Py_RETURN_NONE;
+	case -NLE_NOMEM:
+		return PyErr_NoMemory();
+	case -NLE_OPNOTSUPP:
+		value = Py_BuildValue("(is)", EOPNOTSUPP,
+				      "the kernel lacks the netdev generic "
+				      "netlink family or command");
+		if (value) {
+			PyErr_SetObject(PyExc_IOError, value);
+			Py_DECREF(value);
+		}
+		return NULL;
+	}
+	errno = backend_nlerr2syserr(err);
+	return PyErr_SetFromErrno(PyExc_IOError);
+}
+
+/* The table is immutable, so any number of exports is fine */
+static int table_getbuffer(PyNetdevTable *self, Py_buffer *view, int flags)
+{
+	static uint64_t empty;
+
+	if (flags & PyBUF_WRITABLE) {
+		PyErr_SetString(PyExc_BufferError, "NetdevTable is read-only");
+		return -1;
+	}
+	view->obj = (PyObject *)self;
+	Py_INCREF(self);
+	view->buf = self->rows ? (void *)self->rows : (void *)&empty;
+	view->len = self->shape[0] * self->strides[0];
+	view->readonly = 1;
+	view->itemsize = sizeof(uint64_t);
+	view->format = (flags & PyBUF_FORMAT) ? "Q" : NULL;
+	view->ndim = 2;
+	view->shape = (flags & PyBUF_ND) == PyBUF_ND ? self->shape : NULL;
+	view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : NULL;
+	view->suboffsets = NULL;
+	view->internal = NULL;
+	return 0;
+}
+
+static Py_ssize_t table_len(PyNetdevTable *self)
+{
+	return self->shape[0];
+}
+
+static PyObject *table_columns(PyNetdevTable *self, void *unused __unused)
+{
+	PyObject *tuple, *name;
+	uint32_t i;
+
+	tuple = PyTuple_New(self->kind->nr_cols);
+	for (i = 0; tuple && i < self->kind->nr_cols; i++) {
+		name = PyUnicode_FromString(self->kind->cols[i].name);
+		if (!name) {
+			Py_CLEAR(tuple);
+			break;
+		}
+		PyTuple_SET_ITEM(tuple, i, name);
+	}
+	return tuple;
+}
+
+static PyObject *table_row(PyNetdevTable *self, PyObject *args)
+{
+	const uint64_t *row;
+	PyObject *dict, *value;
+	Py_ssize_t i;
+	uint32_t col;
+
+	if (!PyArg_ParseTuple(args, "n:row", &i))
+		return NULL;
+	if (i < 0)
+		i += self->shape[0];
+	if (i < 0 || i >= self->shape[0]) {
+		PyErr_SetString(PyExc_IndexError, "row index out of range");
+		return NULL;
+	}
+	row = self->rows + i * self->shape[1];
+	dict = PyDict_New();
+	for (col = 0; dict && col < self->kind->nr_cols; col++) {
+		if (row[col] == NETDEV_MISSING)
+			continue;
+		value = PyLong_FromUnsignedLongLong(row[col]);
+		if (!value || PyDict_SetItemString(dict, self->kind->cols[col].name, value) < 0)
+			Py_CLEAR(dict);
+		Py_XDECREF(value);
+	}
+	return dict;
+}
+
+static void table_dealloc(PyNetdevTable *self)
+{
+	free(self->rows);
+	PyObject_Del(self);
+}
+
+static PyMethodDef table_methods[] = {
+	{"row", (PyCFunction)table_row, METH_VARARGS,
+	 "row(i)\n\n"
+	 "Returns the Nth row as a dict of the columns the kernel reported."},
+	{NULL}
+};
+
+static PyGetSetDef table_getset[] = {
+	{"columns", (getter)table_columns, NULL,
+	 "The names of the columns", NULL},
+	{NULL}
+};
+
+static PySequenceMethods table_as_sequence = {
+	.sq_length = (lenfunc)table_len,
+};
+
+static PyBufferProcs table_as_buffer = {
+	.bf_getbuffer = (getbufferproc)table_getbuffer,
+};
+
+PyTypeObject PyNetdevTable_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.NetdevTable",
+	.tp_basicsize = sizeof(PyNetdevTable),
+#if PY_MAJOR_VERSION >= 3
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+#else
+	.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER,
+#endif
+	.tp_dealloc = (destructor)table_dealloc,
+	.tp_methods = table_methods,
+	.tp_getset = table_getset,
+	.tp_as_sequence = &table_as_sequence,
+	.tp_as_buffer = &table_as_buffer,
+	.tp_doc = "Rows of unsigned 64 bit integers from the netdev generic "
+		  "netlink family, exported as a read-only buffer of format 'Q' "
+		  "and shape (rows, columns).  2**64 - 1 marks attributes the "
+		  "kernel did not report."
+};
@@ -0,0 +1,35 @@
+/* netdev.h - Queues, NAPI instances and page pools from the netdev family
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _NETDEV_H
+#define _NETDEV_H
+
+#include <Python.h>
+#include <stdint.h>
+#include <netlink/handlers.h>
+
+extern PyTypeObject PyNetdevTable_Type;
+
+PyObject *netdev_get_queues(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *netdev_get_napis(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *netdev_get_page_pools(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *netdev_set_napi(PyObject *self, PyObject *args, PyObject *kwds);
+
+/* Generic netlink requests with libnl core */
+struct nl_msg *netdev_msg(int family, uint8_t cmd, uint8_t version, int flags);
+int netdev_exchange(struct nl_sock *sk, struct nl_msg *msg,
+		    nl_recvmsg_msg_cb_t func, void *arg);
+int netdev_resolve(struct nl_sock *sk, const char *name, int *family);
+
+#endif
@@ -24,6 +24,7 @@
 #include <netlink/route/rtnl.h>
 #include "etherinfo_struct.h"
 #include "etherinfo.h"
+#include "probes.h"
 
 
 /* IP Address parsing: */
@@ -34,9 +35,13 @@ PyNetlinkIPaddress_from_rtnl_addr(struct rtnl_addr *addr)
 	char buf[INET6_ADDRSTRLEN+1];
 	struct nl_addr *peer_addr = NULL, *brdcst = NULL;
 
+	ETHTOOL_PROBE2(ipaddress_new_entry, rtnl_addr_get_ifindex(addr),
+		       rtnl_addr_get_family(addr));
 	py_obj = PyObject_New(PyNetlinkIPaddress,
 			      &ethtool_netlink_ip_address_Type);
 	if (!py_obj) {
+		ETHTOOL_PROBE3(ipaddress_new_return, rtnl_addr_get_ifindex(addr),
+			       rtnl_addr_get_family(addr), -1);
 		return NULL;
 	}
 
@@ -96,9 +101,13 @@ PyNetlinkIPaddress_from_rtnl_addr(struct rtnl_addr *addr)
 	rtnl_scope2str(rtnl_addr_get_scope(addr), buf, sizeof(buf));
 	py_obj->scope = PyBytes_FromString(buf);
 
+	ETHTOOL_PROBE3(ipaddress_new_return, rtnl_addr_get_ifindex(addr),
+		       py_obj->family, 0);
 	return (PyObject*)py_obj;
 
  error:
+	ETHTOOL_PROBE3(ipaddress_new_return, rtnl_addr_get_ifindex(addr),
+		       rtnl_addr_get_family(addr), -1);
 	Py_DECREF(py_obj);
 	return NULL;
 }
@@ -18,20 +18,83 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <assert.h>
 #include <netlink/netlink.h>
 #include <netlink/socket.h>
 
 #include "etherinfo_struct.h"
+#include "etherinfo.h"
+#include "backend.h"
 
-pthread_mutex_t nlc_counter_mtx = PTHREAD_MUTEX_INITIALIZER;
-static struct nl_sock *nlconnection = NULL;
-static unsigned int nlconnection_users = 0;  /* How many NETLINK users are active? */
+/**
+ * Allocates a new, not yet connected, NETLINK connection holder.  Each
+ * instance of the ethtool module owns one of these in its module state.
+ *
+ * @return Returns a pointer with one reference held, or NULL on out of memory.
+ */
+nlConnection *nlc_new(void)
+{
+	nlConnection *nlc = calloc(1, sizeof(nlConnection));
+
+	if( !nlc ) {
+		return NULL;
+	}
+	pthread_mutex_init(&nlc->lock, NULL);
+	nlc->refcnt = 1;
+	return nlc;
+}
+
+
+/**
+ * Takes an additional reference to a NETLINK connection holder
+ *
+ * @param nlc  nlConnection to reference
+ *
+ * @return Returns nlc
+ */
+nlConnection *nlc_get(nlConnection *nlc)
+{
+	pthread_mutex_lock(&nlc->lock);
+	nlc->refcnt++;
+	pthread_mutex_unlock(&nlc->lock);
+	return nlc;
+}
+
+
+/**
+ * Drops a reference to a NETLINK connection holder, freeing it together
+ * with the NETLINK socket when the last reference is gone.
+ *
+ * @param nlc  nlConnection to release, may be NULL
+ */
+void nlc_put(nlConnection *nlc)
+{
+	unsigned int refcnt;
+
+	if( !nlc ) {
+		return;
+	}
+
+	pthread_mutex_lock(&nlc->lock);
+	refcnt = --nlc->refcnt;
+	pthread_mutex_unlock(&nlc->lock);
+	if( refcnt > 0 ) {
+		return;
+	}
+
+	if( nlc->sock ) {
+		nl_close(nlc->sock);
+		nl_socket_free(nlc->sock);
+	}
+	pthread_mutex_destroy(&nlc->lock);
+	free(nlc);
+}
 
 
 /**
  * Connects to the NETLINK interface.  This will be called
- * for each etherinfo object being generated, and it will
- * keep a separate file descriptor open for each object
+ * for each etherinfo object being generated, and all objects
+ * created by the same module instance share one NETLINK socket.
  *
  * @param ethi PyEtherInfo structure (basically the "self" object)
  *
@@ -39,56 +102,82 @@ static unsigned int nlconnection_users = 0;  /* How many NETLINK users are activ
  */
 int open_netlink(PyEtherInfo *ethi)
 {
-	if( !ethi ) {
+	nlConnection *nlc;
+	int ret = 0;
+
+	if( !ethi || !ethi->nlc ) {
 		return 0;
 	}
+	nlc = ethi->nlc;
+
+	pthread_mutex_lock(&nlc->lock);
 
 	/* Reuse already established NETLINK connection, if a connection exists */
-	if( nlconnection ) {
+	if( nlc->sock ) {
 		/* If this object has not used NETLINK earlier, tag it as a user */
 		if( !ethi->nlc_active ) {
-			pthread_mutex_lock(&nlc_counter_mtx);
-			nlconnection_users++;
-			pthread_mutex_unlock(&nlc_counter_mtx);
+			nlc->users++;
 		}
 		ethi->nlc_active = 1;
-		return 1;
+		ret = 1;
+		goto out;
 	}
 
 	/* No earlier connections exists, establish a new one */
-	nlconnection = nl_socket_alloc();
-	if( nlconnection != NULL ) {
-		if( nl_connect(nlconnection, NETLINK_ROUTE) < 0 ) {
-			return 0;
+	nlc->sock = nl_socket_alloc();
+	if( nlc->sock != NULL ) {
+		if( nl_connect(nlc->sock, NETLINK_ROUTE) < 0 ) {
+			nl_socket_free(nlc->sock);
+			nlc->sock = NULL;
+			goto out;
 		}
 		/* Force O_CLOEXEC flag on the NETLINK socket */
-		if( fcntl(nl_socket_get_fd(nlconnection), F_SETFD, FD_CLOEXEC) == -1 ) {
+		if( fcntl(nl_socket_get_fd(nlc->sock), F_SETFD, FD_CLOEXEC) == -1 ) {
 			fprintf(stderr,
 				"**WARNING** Failed to set O_CLOEXEC on NETLINK socket: %s\n",
 				strerror(errno));
 		}
+		/* Route the traffic through the selected backend */
+		backend_nl_setup(nlc->sock);
 
 		/* Tag this object as an active user */
-		pthread_mutex_lock(&nlc_counter_mtx);
-		nlconnection_users++;
-		pthread_mutex_unlock(&nlc_counter_mtx);
+		nlc->users++;
 		ethi->nlc_active = 1;
-		return 1;
-	} else {
-		return 0;
+		ret = 1;
 	}
+ out:
+	pthread_mutex_unlock(&nlc->lock);
+	return ret;
 }
 
 
 /**
- * Return a reference to the global netlink connection
+ * Grants exclusive use of the NETLINK connection of an object which has
+ * successfully called open_netlink().  libnl sockets must not be used from
+ * several threads at once, so every request/dump has to be done between
+ * lock_netlink() and unlock_netlink().  This may block, so callers should
+ * not hold the GIL.
+ *
+ * @param ethi PyEtherInfo structure (basically the "self" object)
  *
  * @returns Returns a pointer to a NETLINK connection libnl functions can use
  */
-struct nl_sock * get_nlc()
+struct nl_sock * lock_netlink(PyEtherInfo *ethi)
 {
-	assert(nlconnection);
-	return nlconnection;
+	assert(ethi->nlc_active);
+	pthread_mutex_lock(&ethi->nlc->lock);
+	assert(ethi->nlc->sock);
+	return ethi->nlc->sock;
+}
+
+/**
+ * Releases the NETLINK connection taken by lock_netlink()
+ *
+ * @param ethi PyEtherInfo structure (basically the "self" object)
+ */
+void unlock_netlink(PyEtherInfo *ethi)
+{
+	pthread_mutex_unlock(&ethi->nlc->lock);
 }
 
 /**
@@ -99,25 +188,26 @@ struct nl_sock * get_nlc()
  */
 void close_netlink(PyEtherInfo *ethi)
 {
-	if( !ethi || !nlconnection ) {
+	nlConnection *nlc;
+
+	if( !ethi || !ethi->nlc || !ethi->nlc_active ) {
 		return;
 	}
+	nlc = ethi->nlc;
+
+	pthread_mutex_lock(&nlc->lock);
 
 	/* Untag this object as a NETLINK user */
 	ethi->nlc_active = 0;
-	pthread_mutex_lock(&nlc_counter_mtx);
-	nlconnection_users--;
-	pthread_mutex_unlock(&nlc_counter_mtx);
+	nlc->users--;
 
-	/* Don't close the connection if there are more users */
-	if( nlconnection_users > 0) {
-		return;
+	/* Close NETLINK connection, unless there are more users */
+	if( nlc->users == 0 && nlc->sock ) {
+		nl_close(nlc->sock);
+		nl_socket_free(nlc->sock);
+		nlc->sock = NULL;
 	}
-
-	/* Close NETLINK connection */
-	nl_close(nlconnection);
-	nl_socket_free(nlconnection);
-	nlconnection = NULL;
+	pthread_mutex_unlock(&nlc->lock);
 }
 
 /*
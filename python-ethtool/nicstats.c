@@ -0,0 +1,283 @@
+/* nicstats.c - Statistics of a device (ETHTOOL_GSTATS, RTM_GETSTATS)
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sockios.h>
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <netlink/socket.h>
+
+#include "nicstats.h"
+#include "backend.h"
+#include "snapshot.h"
+
+/* Source of nicstats.generation */
+static uint32_t nicstats_generation;
+
+static int nicstats_ioctl(int fd, const char *devname, void *data, size_t size)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, devname, IFNAMSIZ - 1);
+	ifr.ifr_data = data;
+	return backend_ioctl(fd, SIOCETHTOOL, &ifr, size) < 0 ? errno : 0;
+}
+
+void nicstats_free(struct nicstats *ns)
+{
+	free(ns->names);
+	free(ns->req);
+	memset(ns, 0, sizeof(*ns));
+}
+
+/**
+ * Fetches the names of n statistics
+ */
+static int nicstats_names(struct nicstats *ns, int fd, const char *devname, uint32_t n)
+{
+	struct ethtool_gstrings *strings;
+	size_t size = sizeof(*strings) + (size_t)n * ETH_GSTRING_LEN;
+	int err;
+
+	nicstats_free(ns);
+	strings = calloc(1, size);
+	ns->names = calloc(n ? n : 1, ETH_GSTRING_LEN);
+	ns->req = calloc(1, sizeof(*ns->req) + (size_t)n * sizeof(uint64_t));
+	if (!strings || !ns->names || !ns->req) {
+		free(strings);
+		nicstats_free(ns);
+		return ENOMEM;
+	}
+
+	strings->cmd = ETHTOOL_GSTRINGS;
+	strings->string_set = ETH_SS_STATS;
+	strings->len = n;
+	err = nicstats_ioctl(fd, devname, strings, size);
+	if (!err && strings->len != n)
+		err = EAGAIN;
+	if (err) {
+		free(strings);
+		nicstats_free(ns);
+		return err;
+	}
+	memcpy(ns->names, strings->data, (size_t)n * ETH_GSTRING_LEN);
+	ns->values = (uint64_t *)ns->req->data;
+	ns->n = n;
+	ns->generation = __atomic_add_fetch(&nicstats_generation, 1, __ATOMIC_RELAXED);
+	free(strings);
+	return 0;
+}
+
+/**
+ * Reads the statistics of a device, fetching their names first if another
+ * driver or number of them is reported than last time.  Does not need the
+ * GIL.
+ *
+ * @param ns      Statistics of the device, zeroed before the first read
+ * @param fd      AF_INET control socket
+ * @param devname Device name
+ *
+ * @return Returns 0 on success, otherwise an errno.  EOPNOTSUPP means the
+ *         driver has no statistics.
+ */
+int nicstats_read(struct nicstats *ns, int fd, const char *devname)
+{
+	struct ethtool_drvinfo info;
+	int err;
+
+	/* The kernel writes as many values as the driver has right now,
+	 * whatever the request says, so the buffer must be sized for that
+	 */
+	memset(&info, 0, sizeof(info));
+	info.cmd = ETHTOOL_GDRVINFO;
+	if ((err = nicstats_ioctl(fd, devname, &info, sizeof(info))) != 0)
+		return err;
+	if (info.n_stats == 0) {
+		nicstats_free(ns);
+		return EOPNOTSUPP;
+	}
+	if (!ns->req || info.n_stats != ns->n ||
+	    strncmp(info.driver, ns->driver, sizeof(ns->driver)) != 0) {
+		if ((err = nicstats_names(ns, fd, devname, info.n_stats)) != 0)
+			return err;
+		memcpy(ns->driver, info.driver, sizeof(ns->driver));
+	}
+
+	ns->req->cmd = ETHTOOL_GSTATS;
+	ns->req->n_stats = ns->n;
+	err = nicstats_ioctl(fd, devname, ns->req,
+			     sizeof(*ns->req) + (size_t)ns->n * sizeof(uint64_t));
+	if (err)
+		return err;
+	return ns->req->n_stats == ns->n ? 0 : EAGAIN;
+}
+
+/**
+ * Opens the NETLINK_ROUTE socket of linkstats_read()
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+int linkstats_open(struct linkstats *ls)
+{
+	int err;
+
+	ls->sk = nl_socket_alloc();
+	if (!ls->sk)
+		return ENOMEM;
+	if ((err = nl_connect(ls->sk, NETLINK_ROUTE)) < 0) {
+		linkstats_close(ls);
+		return backend_nlerr2syserr(err);
+	}
+	backend_nl_setup(ls->sk);
+	nl_socket_disable_auto_ack(ls->sk);
+	return 0;
+}
+
+void linkstats_close(struct linkstats *ls)
+{
+	if (ls->sk)
+		nl_socket_free(ls->sk);
+	ls->sk = NULL;
+}
+
+/**
+ * if_nametoindex() through the backend, so that recordings can be replayed
+ *
+ * @param fd Socket for the SIOCGIFINDEX ioctl
+ *
+ * @return Returns the index, or 0 with errno set
+ */
+unsigned int linkstats_ifindex(int fd, const char *devname)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, devname, IFNAMSIZ - 1);
+	if (backend_ioctl(fd, SIOCGIFINDEX, &ifr, 0) < 0)
+		return 0;
+	return ifr.ifr_ifindex;
+}
+
+/**
+ * Reads the link statistics of a device with a single RTM_GETSTATS request.
+ * Does not need the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+int linkstats_read64(struct linkstats *ls, int ifindex, struct rtnl_link_stats64 *st)
+{
+	struct if_stats_msg ifsm;
+	struct sockaddr_nl nla;
+	struct nl_msg *msg;
+	struct nlmsghdr *nh;
+	struct rtattr *rta;
+	unsigned char *buf;
+	uint32_t seq;
+	int len, rtlen, err;
+
+	memset(&ifsm, 0, sizeof(ifsm));
+	ifsm.ifindex = ifindex;
+	ifsm.filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+	msg = nlmsg_alloc_simple(RTM_GETSTATS, 0);
+	if (!msg)
+		return ENOMEM;
+	if ((err = nlmsg_append(msg, &ifsm, sizeof(ifsm), NLMSG_ALIGNTO)) == 0)
+		err = nl_send_auto(ls->sk, msg);
+	seq = nlmsg_hdr(msg)->nlmsg_seq;
+	nlmsg_free(msg);
+	if (err < 0)
+		return backend_nlerr2syserr(err);
+
+	/* Replies to earlier requests which failed halfway are skipped */
+	for (;;) {
+		buf = NULL;
+		len = backend_nl_recv(ls->sk, &nla, &buf, NULL);
+		if (len <= 0) {
+			free(buf);
+			return len < 0 ? backend_nlerr2syserr(len) : EBADMSG;
+		}
+		nh = (struct nlmsghdr *)buf;
+		if (!NLMSG_OK(nh, (unsigned int)len)) {
+			free(buf);
+			return EBADMSG;
+		}
+		if (nh->nlmsg_seq == seq)
+			break;
+		free(buf);
+	}
+
+	err = EBADMSG;
+	if (nh->nlmsg_type == NLMSG_ERROR) {
+		const struct nlmsgerr *e = NLMSG_DATA(nh);
+
+		if (e->error)
+			err = -e->error;
+		goto out;
+	}
+	if (nh->nlmsg_type != RTM_NEWSTATS ||
+	    nh->nlmsg_len < NLMSG_LENGTH(sizeof(struct if_stats_msg)))
+		goto out;
+
+	rta = (struct rtattr *)((char *)NLMSG_DATA(nh) +
+				NLMSG_ALIGN(sizeof(struct if_stats_msg)));
+	rtlen = nh->nlmsg_len - NLMSG_SPACE(sizeof(struct if_stats_msg));
+	for (; RTA_OK(rta, rtlen); rta = RTA_NEXT(rta, rtlen)) {
+		if (rta->rta_type != IFLA_STATS_LINK_64 || RTA_PAYLOAD(rta) < sizeof(*st))
+			continue;
+		memcpy(st, RTA_DATA(rta), sizeof(*st));
+		err = 0;
+		break;
+	}
+out:
+	free(buf);
+	return err;
+}
+
+/**
+ * Reads the link counters of a device, see linkstats_read64()
+ *
+ * @param values Receives SNAPSHOT_NR_COUNTERS counters
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+int linkstats_read(struct linkstats *ls, int ifindex, uint64_t *values)
+{
+	struct rtnl_link_stats64 st;
+	int err;
+
+	if ((err = linkstats_read64(ls, ifindex, &st)) != 0)
+		return err;
+	values[SNAPSHOT_RX_PACKETS] = st.rx_packets;
+	values[SNAPSHOT_TX_PACKETS] = st.tx_packets;
+	values[SNAPSHOT_RX_BYTES] = st.rx_bytes;
+	values[SNAPSHOT_TX_BYTES] = st.tx_bytes;
+	values[SNAPSHOT_RX_ERRORS] = st.rx_errors;
+	values[SNAPSHOT_TX_ERRORS] = st.tx_errors;
+	values[SNAPSHOT_RX_DROPPED] = st.rx_dropped;
+	values[SNAPSHOT_TX_DROPPED] = st.tx_dropped;
+	values[SNAPSHOT_MULTICAST] = st.multicast;
+	values[SNAPSHOT_COLLISIONS] = st.collisions;
+	return 0;
+}
@@ -0,0 +1,55 @@
+/* nicstats.h - Statistics of a device (ETHTOOL_GSTATS, RTM_GETSTATS)
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _NICSTATS_H
+#define _NICSTATS_H
+
+#include <stdint.h>
+
+#include "ethtool.h"
+
+struct nl_sock;
+struct rtnl_link_stats64;
+
+/**
+ * The statistics of one device.  The names are only fetched again when
+ * another driver or number of statistics is reported.
+ */
+struct nicstats {
+	char	 driver[32];
+	uint32_t n;
+	char	 (*names)[ETH_GSTRING_LEN];	/**< Not NUL terminated when full */
+	uint64_t *values;			/**< Points into req */
+	struct ethtool_stats *req;		/**< Reused for every read */
+	uint32_t generation;			/**< Changes whenever the names do */
+};
+
+int nicstats_read(struct nicstats *ns, int fd, const char *devname);
+void nicstats_free(struct nicstats *ns);
+
+/**
+ * A NETLINK_ROUTE socket reading the link counters of single devices,
+ * through the backend
+ */
+struct linkstats {
+	struct nl_sock *sk;	/**< NULL when closed */
+};
+
+int linkstats_open(struct linkstats *ls);
+unsigned int linkstats_ifindex(int fd, const char *devname);
+void linkstats_close(struct linkstats *ls);
+int linkstats_read(struct linkstats *ls, int ifindex, uint64_t *values);
+int linkstats_read64(struct linkstats *ls, int ifindex, struct rtnl_link_stats64 *st);
+
+#endif
@@ -0,0 +1,701 @@
+/* parallel.c - Query many devices concurrently from native worker threads
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Some drivers take a very long time to answer ETHTOOL_GDRVINFO,
+ * ETHTOOL_GCOALESCE and friends.  Querying the devices one by one makes
+ * the whole host wait for the sum of all of them.  parallel_query() hands
+ * the devices out to a set of native threads instead, each with its own
+ * sockets, and waits for them until a deadline.  Whatever did not answer
+ * in time is reported as timed out; the worker threads are detached and
+ * clean up after themselves whenever the driver finally returns.
+ *
+ * There are at most PQ_MAX_WORKERS threads, so a query of more devices
+ * than that can take as long as several slow devices in a row.
+ *
+ * The worker threads never touch Python objects, they only fill in
+ * struct pq_result slots which are converted once the batch is done.
+ */
+
+#include <Python.h>
+#include <bytesobject.h>
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/sockios.h>
+#include <netlink/netlink.h>
+#include <netlink/errno.h>
+#include <netlink/route/link.h>
+
+#include "ethtool.h"
+#include "parallel.h"
+#include "backend.h"
+#include "stats.h"
+
+#define PQ_MAX_WORKERS		64
+#define PQ_MAX_TIMEOUT		(365 * 86400.0)	/* Seconds, longer ones are clamped */
+#define PQ_WAIT_SLICE_MS	100	/* How often to look for pending signals */
+#define PQ_STACK_SIZE		(256 * 1024)
+
+enum pq_kind {
+	PQ_IFREQ_FLAGS,		/* SIOCGIFFLAGS */
+	PQ_IFREQ_HWADDR,	/* SIOCGIFHWADDR */
+	PQ_IFREQ_INADDR,	/* SIOCGIFADDR, SIOCGIFNETMASK, SIOCGIFBRDADDR */
+	PQ_ETHTOOL_VALUE,	/* ETHTOOL_G* commands using struct ethtool_value */
+	PQ_DRVINFO_DRIVER,	/* ETHTOOL_GDRVINFO, driver name */
+	PQ_DRVINFO_BUSINFO,	/* ETHTOOL_GDRVINFO, bus info */
+	PQ_ETHTOOL_STRUCT,	/* ETHTOOL_G* commands described by a struct_desc table */
+	PQ_NETLINK_LINK,	/* RTM_GETLINK for a single device */
+};
+
+/**
+ * A field which can be requested from parallel_query().  The names match
+ * the module functions returning the same information.
+ */
+struct pq_field {
+	const char	   *name;
+	enum pq_kind	   kind;
+	unsigned long	   request;	/**< SIOCGIF* ioctl or ETHTOOL_G* command */
+	struct struct_desc *desc;	/**< PQ_ETHTOOL_STRUCT: struct layout */
+	const int	   *desc_len;
+};
+
+static const struct pq_field pq_fields[] = {
+	{ "module",    PQ_DRVINFO_DRIVER,  ETHTOOL_GDRVINFO },
+	{ "businfo",   PQ_DRVINFO_BUSINFO, ETHTOOL_GDRVINFO },
+	{ "hwaddr",    PQ_IFREQ_HWADDR,    SIOCGIFHWADDR },
+	{ "ipaddr",    PQ_IFREQ_INADDR,    SIOCGIFADDR },
+	{ "netmask",   PQ_IFREQ_INADDR,    SIOCGIFNETMASK },
+	{ "broadcast", PQ_IFREQ_INADDR,    SIOCGIFBRDADDR },
+	{ "flags",     PQ_IFREQ_FLAGS,     SIOCGIFFLAGS },
+	{ "tso",       PQ_ETHTOOL_VALUE,   ETHTOOL_GTSO },
+	{ "ufo",       PQ_ETHTOOL_VALUE,   ETHTOOL_GUFO },
+	{ "gso",       PQ_ETHTOOL_VALUE,   ETHTOOL_GGSO },
+	{ "sg",        PQ_ETHTOOL_VALUE,   ETHTOOL_GSG },
+	{ "coalesce",  PQ_ETHTOOL_STRUCT,  ETHTOOL_GCOALESCE,
+	  ethtool_coalesce_desc, &ethtool_coalesce_desc_len },
+	{ "ringparam", PQ_ETHTOOL_STRUCT,  ETHTOOL_GRINGPARAM,
+	  ethtool_ringparam_desc, &ethtool_ringparam_desc_len },
+	{ "pauseparam", PQ_ETHTOOL_STRUCT, ETHTOOL_GPAUSEPARAM,
+	  ethtool_pauseparam_desc, &ethtool_pauseparam_desc_len },
+	{ "eee",       PQ_ETHTOOL_STRUCT,  ETHTOOL_GEEE,
+	  ethtool_eee_desc, &ethtool_eee_desc_len },
+	{ "link",      PQ_NETLINK_LINK },
+};
+
+enum pq_state { PQ_PENDING = 0, PQ_DONE, PQ_FAILED };
+
+struct pq_result {
+	enum pq_state state;
+	int	      err;	/**< errno, or a negative libnl error code */
+	union {
+		int			 ival;
+		char			 str[ETHTOOL_BUSINFO_LEN + 1];
+		struct ethtool_coalesce	 coalesce;
+		struct ethtool_ringparam ringparam;
+		struct ethtool_pauseparam pauseparam;
+		struct ethtool_eee	 eee;
+		struct {
+			int	     ifindex;
+			unsigned int mtu;
+			unsigned int flags;
+			unsigned int txqlen;
+			char	     operstate[32];
+			char	     mac_address[64];
+		} link;
+	} v;
+};
+
+/**
+ * One parallel_query() call.  The batch is shared between the calling
+ * thread and the workers and freed by whoever drops the last reference.
+ * Once the caller gives up on the batch (abandoned), workers stop picking
+ * up devices and no longer write into results.
+ */
+struct pq_batch {
+	pthread_mutex_t	       lock;
+	pthread_cond_t	       cond;
+	unsigned int	       refcnt;
+	int		       abandoned;
+	int		       next_dev;	/**< Next device to hand out */
+	int		       nr_done;		/**< Devices completely answered */
+	int		       nr_devs;
+	int		       nr_fields;
+	char		       (*devnames)[IFNAMSIZ];
+	const struct pq_field  **fields;
+	struct pq_result       *results;	/**< nr_devs * nr_fields slots */
+};
+
+static struct pq_batch *pq_batch_new(int nr_devs, int nr_fields)
+{
+	struct pq_batch *b;
+	pthread_condattr_t cattr;
+
+	b = calloc(1, sizeof(*b));
+	if (!b)
+		return NULL;
+
+	b->devnames = calloc(nr_devs ? nr_devs : 1, IFNAMSIZ);
+	b->fields = calloc(nr_fields ? nr_fields : 1, sizeof(*b->fields));
+	b->results = calloc((size_t)(nr_devs ? nr_devs : 1) * (nr_fields ? nr_fields : 1),
+			    sizeof(*b->results));
+	if (!b->devnames || !b->fields || !b->results) {
+		free(b->devnames);
+		free(b->fields);
+		free(b->results);
+		free(b);
+		return NULL;
+	}
+
+	pthread_mutex_init(&b->lock, NULL);
+	pthread_condattr_init(&cattr);
+	pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+	pthread_cond_init(&b->cond, &cattr);
+	pthread_condattr_destroy(&cattr);
+	b->refcnt = 1;
+	b->nr_devs = nr_devs;
+	b->nr_fields = nr_fields;
+	return b;
+}
+
+static void pq_batch_put(struct pq_batch *b)
+{
+	unsigned int refcnt;
+
+	pthread_mutex_lock(&b->lock);
+	refcnt = --b->refcnt;
+	pthread_mutex_unlock(&b->lock);
+
+	if (refcnt > 0)
+		return;
+
+	pthread_cond_destroy(&b->cond);
+	pthread_mutex_destroy(&b->lock);
+	free(b->devnames);
+	free(b->fields);
+	free(b->results);
+	free(b);
+}
+
+static int pq_ioctl(int fd, unsigned long request, struct ifreq *ifr, size_t data_len)
+{
+	return backend_ioctl(fd, request, ifr, data_len) < 0 ? errno : 0;
+}
+
+static int pq_fetch_link(struct nl_sock **nls, const char *devname,
+			 struct pq_result *res)
+{
+	struct rtnl_link *link = NULL;
+	struct nl_addr *addr;
+	int err;
+
+	if (!*nls) {
+		*nls = nl_socket_alloc();
+		if (!*nls)
+			return ENOMEM;
+		if ((err = nl_connect(*nls, NETLINK_ROUTE)) < 0) {
+			nl_socket_free(*nls);
+			*nls = NULL;
+			return err;
+		}
+		backend_nl_setup(*nls);
+	}
+
+	if ((err = rtnl_link_get_kernel(*nls, 0, devname, &link)) < 0)
+		return (err == -NLE_NODEV || err == -NLE_OBJ_NOTFOUND) ? ENODEV : err;
+
+	res->v.link.ifindex = rtnl_link_get_ifindex(link);
+	res->v.link.mtu = rtnl_link_get_mtu(link);
+	res->v.link.flags = rtnl_link_get_flags(link);
+	res->v.link.txqlen = rtnl_link_get_txqlen(link);
+	rtnl_link_operstate2str(rtnl_link_get_operstate(link),
+				res->v.link.operstate,
+				sizeof(res->v.link.operstate));
+	addr = rtnl_link_get_addr(link);
+	if (addr)
+		nl_addr2str(addr, res->v.link.mac_address,
+			    sizeof(res->v.link.mac_address));
+	rtnl_link_put(link);
+	return 0;
+}
+
+/**
+ * Retrieve one field for one device.  Runs in a worker thread, without the GIL.
+ *
+ * @param fd      AF_INET control socket of this worker, or -1
+ * @param fd_err  errno from creating the control socket if fd is -1
+ * @param nls     NETLINK socket of this worker, opened on first use
+ * @param devname Device to query
+ * @param field   Field to retrieve
+ * @param res     Where to store the result
+ */
+static void pq_fetch(int fd, int fd_err, struct nl_sock **nls, const char *devname,
+		     const struct pq_field *field, struct pq_result *res)
+{
+	struct ifreq ifr;
+	struct ethtool_value eval;
+	struct ethtool_drvinfo drvinfo;
+	unsigned char *sa;
+	int err = 0;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(&ifr.ifr_name[0], devname, IFNAMSIZ);
+	ifr.ifr_name[IFNAMSIZ - 1] = 0;
+
+	/* The names no device can have are left empty */
+	if (!devname[0]) {
+		err = ENODEV;
+		goto out;
+	}
+	if (fd < 0 && field->kind != PQ_NETLINK_LINK) {
+		err = fd_err;
+		goto out;
+	}
+
+	switch (field->kind) {
+	case PQ_IFREQ_FLAGS:
+		if (!(err = pq_ioctl(fd, field->request, &ifr, 0)))
+			res->v.ival = ifr.ifr_flags;
+		break;
+
+	case PQ_IFREQ_HWADDR:
+		if (!(err = pq_ioctl(fd, field->request, &ifr, 0))) {
+			sa = (unsigned char *)ifr.ifr_hwaddr.sa_data;
+			snprintf(res->v.str, sizeof(res->v.str),
+				 "%02x:%02x:%02x:%02x:%02x:%02x",
+				 sa[0], sa[1], sa[2], sa[3], sa[4], sa[5]);
+		}
+		break;
+
+	case PQ_IFREQ_INADDR:
+		/* ifr_addr, ifr_netmask and ifr_broadaddr share the same storage */
+		if (!(err = pq_ioctl(fd, field->request, &ifr, 0))) {
+			sa = (unsigned char *)ifr.ifr_addr.sa_data;
+			snprintf(res->v.str, sizeof(res->v.str), "%u.%u.%u.%u",
+				 sa[2], sa[3], sa[4], sa[5]);
+		}
+		break;
+
+	case PQ_ETHTOOL_VALUE:
+		memset(&eval, 0, sizeof(eval));
+		eval.cmd = field->request;
+		ifr.ifr_data = (caddr_t)&eval;
+		if (!(err = pq_ioctl(fd, SIOCETHTOOL, &ifr, sizeof(eval))))
+			res->v.ival = eval.data;
+		break;
+
+	case PQ_DRVINFO_DRIVER:
+	case PQ_DRVINFO_BUSINFO:
+		memset(&drvinfo, 0, sizeof(drvinfo));
+		drvinfo.cmd = field->request;
+		ifr.ifr_data = (caddr_t)&drvinfo;
+		if (!(err = pq_ioctl(fd, SIOCETHTOOL, &ifr, sizeof(drvinfo))))
+			strncpy(res->v.str,
+				field->kind == PQ_DRVINFO_DRIVER ? drvinfo.driver
+								 : drvinfo.bus_info,
+				sizeof(res->v.str) - 1);
+		break;
+
+	case PQ_ETHTOOL_STRUCT:
+		/* All the ETHTOOL structs start with the u32 command */
+		*(u32 *)&res->v = field->request;
+		ifr.ifr_data = (caddr_t)&res->v;
+		err = pq_ioctl(fd, SIOCETHTOOL, &ifr, sizeof(res->v));
+		break;
+
+	case PQ_NETLINK_LINK:
+		err = pq_fetch_link(nls, devname, res);
+		break;
+	}
+
+ out:
+	res->err = err;
+	res->state = err ? PQ_FAILED : PQ_DONE;
+}
+
+static void *pq_worker(void *arg)
+{
+	struct pq_batch *b = arg;
+	struct nl_sock *nls = NULL;
+	int fd, fd_err = 0;
+
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		fd_err = errno;
+
+	for (;;) {
+		int dev, f;
+
+		pthread_mutex_lock(&b->lock);
+		if (b->abandoned || b->next_dev >= b->nr_devs) {
+			pthread_mutex_unlock(&b->lock);
+			break;
+		}
+		dev = b->next_dev++;
+		pthread_mutex_unlock(&b->lock);
+
+		for (f = 0; f < b->nr_fields; f++) {
+			struct stats_scope scope;
+			struct pq_result res;
+
+			memset(&res, 0, sizeof(res));
+			stats_enter(&scope, STATS_PARALLEL_QUERY);
+			pq_fetch(fd, fd_err, &nls, b->devnames[dev], b->fields[f], &res);
+			stats_leave(&scope);
+
+			/* Publish every field as soon as it is known, so a
+			 * device which hangs on one request still reports
+			 * the ones which were answered */
+			pthread_mutex_lock(&b->lock);
+			if (!b->abandoned)
+				b->results[dev * b->nr_fields + f] = res;
+			pthread_mutex_unlock(&b->lock);
+		}
+
+		pthread_mutex_lock(&b->lock);
+		b->nr_done++;
+		pthread_cond_signal(&b->cond);
+		pthread_mutex_unlock(&b->lock);
+	}
+
+	if (fd >= 0)
+		close(fd);
+	if (nls) {
+		nl_close(nls);
+		nl_socket_free(nls);
+	}
+	pq_batch_put(b);
+	return NULL;
+}
+
+static void pq_timespec_add_ms(struct timespec *ts, long ms)
+{
+	ts->tv_sec += ms / 1000;
+	ts->tv_nsec += (ms % 1000) * 1000000L;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+static int pq_timespec_before(const struct timespec *a, const struct timespec *b)
+{
+	return a->tv_sec < b->tv_sec ||
+		(a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+/**
+ * Wait until all devices of the batch are answered or the deadline passes.
+ * The GIL is released while waiting, but is taken back regularly to let
+ * Python handle signals (e.g. KeyboardInterrupt).
+ *
+ * @return Returns 0 when the batch is finished or timed out, -1 with a
+ *         Python exception set if a signal handler raised one.
+ */
+static int pq_wait(struct pq_batch *b, const struct timespec *deadline)
+{
+	for (;;) {
+		struct timespec now, slice_end;
+		int expired = 0;
+
+		Py_BEGIN_ALLOW_THREADS
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		slice_end = now;
+		pq_timespec_add_ms(&slice_end, PQ_WAIT_SLICE_MS);
+		if (deadline && pq_timespec_before(deadline, &slice_end))
+			slice_end = *deadline;
+
+		pthread_mutex_lock(&b->lock);
+		while (b->nr_done < b->nr_devs) {
+			if (pthread_cond_timedwait(&b->cond, &b->lock, &slice_end) == ETIMEDOUT)
+				break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (deadline && !pq_timespec_before(&now, deadline))
+			expired = 1;
+		if (b->nr_done == b->nr_devs || expired)
+			b->abandoned = 1;
+		pthread_mutex_unlock(&b->lock);
+		Py_END_ALLOW_THREADS
+
+		if (b->abandoned)
+			return 0;
+
+		if (PyErr_CheckSignals() < 0) {
+			pthread_mutex_lock(&b->lock);
+			b->abandoned = 1;
+			pthread_mutex_unlock(&b->lock);
+			return -1;
+		}
+	}
+}
+
+static PyObject *pq_error(int err)
+{
+	if (err < 0)
+		return PyObject_CallFunction(PyExc_IOError, "is", backend_nlerr2syserr(err),
+					     nl_geterror(err));
+
+	return PyObject_CallFunction(PyExc_IOError, "is", err, strerror(err));
+}
+
+static PyObject *pq_link_dict(struct pq_result *r)
+{
+	PyObject *dict = PyDict_New();
+
+	if (!dict)
+		return NULL;
+
+	if (dict_set_steal(dict, "ifindex", PyLong_FromLong(r->v.link.ifindex)) ||
+	    dict_set_steal(dict, "mtu", PyLong_FromUnsignedLong(r->v.link.mtu)) ||
+	    dict_set_steal(dict, "flags", PyLong_FromUnsignedLong(r->v.link.flags)) ||
+	    dict_set_steal(dict, "txqlen", PyLong_FromUnsignedLong(r->v.link.txqlen)) ||
+	    dict_set_steal(dict, "operstate", PyBytes_FromString(r->v.link.operstate)) ||
+	    dict_set_steal(dict, "mac_address", PyBytes_FromString(r->v.link.mac_address))) {
+		Py_DECREF(dict);
+		return NULL;
+	}
+	return dict;
+}
+
+static PyObject *pq_result_to_python(const struct pq_field *field,
+				     struct pq_result *r)
+{
+	switch (r->state) {
+	case PQ_PENDING:
+		return pq_error(ETIMEDOUT);
+	case PQ_FAILED:
+		return pq_error(r->err);
+	case PQ_DONE:
+		break;
+	}
+
+	switch (field->kind) {
+	case PQ_IFREQ_FLAGS:
+	case PQ_ETHTOOL_VALUE:
+		return Py_BuildValue("i", r->v.ival);
+	case PQ_IFREQ_HWADDR:
+	case PQ_IFREQ_INADDR:
+	case PQ_DRVINFO_DRIVER:
+	case PQ_DRVINFO_BUSINFO:
+		return PyBytes_FromString(r->v.str);
+	case PQ_ETHTOOL_STRUCT:
+		return __struct_desc_create_dict(field->desc, *field->desc_len, &r->v);
+	case PQ_NETLINK_LINK:
+		return pq_link_dict(r);
+	}
+	return NULL;
+}
+
+static PyObject *pq_build_results(struct pq_batch *b, PyObject *devseq)
+{
+	PyObject *result = PyDict_New();
+	int dev, f;
+
+	if (!result)
+		return NULL;
+
+	for (dev = 0; dev < b->nr_devs; dev++) {
+		PyObject *devdict = PyDict_New();
+
+		if (!devdict)
+			goto error;
+
+		for (f = 0; f < b->nr_fields; f++) {
+			PyObject *value;
+
+			value = pq_result_to_python(b->fields[f],
+						    &b->results[dev * b->nr_fields + f]);
+			if (dict_set_steal(devdict, b->fields[f]->name, value) < 0) {
+				Py_DECREF(devdict);
+				goto error;
+			}
+		}
+
+		if (PyDict_SetItem(result, PyTuple_GET_ITEM(devseq, dev), devdict) < 0) {
+			Py_DECREF(devdict);
+			goto error;
+		}
+		Py_DECREF(devdict);
+	}
+	return result;
+
+ error:
+	Py_DECREF(result);
+	return NULL;
+}
+
+static const struct pq_field *pq_lookup_field(PyObject *name)
+{
+	const char *fname = NULL;
+	size_t i;
+
+	if (PyBytes_Check(name))
+		fname = PyBytes_AsString(name);
+#if PY_MAJOR_VERSION >= 3
+	else if (PyUnicode_Check(name))
+		fname = PyUnicode_AsUTF8(name);
+#endif
+	if (!fname) {
+		PyErr_SetString(PyExc_TypeError, "Field names must be strings");
+		return NULL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(pq_fields); i++) {
+		if (strcmp(pq_fields[i].name, fname) == 0)
+			return &pq_fields[i];
+	}
+
+	PyErr_Format(PyExc_ValueError, "Unknown field '%s'", fname);
+	return NULL;
+}
+
+/**
+ * Retrieves a set of fields for a list of devices concurrently
+ *
+ * @param self Not used
+ * @param args Python arguments: devices, fields, workers=0, timeout=None
+ * @param kwds Python keyword arguments
+ *
+ * @return Python dict mapping each device name to a dict of its fields.  Fields
+ *         which failed, or were not answered before the timeout, are set to an
+ *         IOError instance carrying the errno (ETIMEDOUT for the latter).
+ */
+PyObject *parallel_query(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devices", "fields", "workers", "timeout", NULL };
+	PyObject *devices, *fields, *timeout_obj = Py_None;
+	PyObject *devseq = NULL, *fieldseq = NULL, *result = NULL;
+	struct pq_batch *b = NULL;
+	struct timespec deadline;
+	pthread_attr_t attr;
+	double timeout = -1;
+	int workers = 0, nr_devs, nr_fields, started = 0, i;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|iO", kwlist,
+					 &devices, &fields, &workers, &timeout_obj))
+		return NULL;
+
+	if (timeout_obj != Py_None) {
+		timeout = PyFloat_AsDouble(timeout_obj);
+		if (timeout == -1 && PyErr_Occurred())
+			return NULL;
+		if (!isfinite(timeout) || timeout < 0) {
+			PyErr_SetString(PyExc_ValueError,
+					"timeout must be a finite number, not negative");
+			return NULL;
+		}
+		if (timeout > PQ_MAX_TIMEOUT)
+			timeout = PQ_MAX_TIMEOUT;
+	}
+
+	/* Private copies, the sequences may be changed by other threads */
+	devseq = PySequence_Tuple(devices);
+	if (!devseq)
+		return NULL;
+	fieldseq = PySequence_Tuple(fields);
+	if (!fieldseq)
+		goto out;
+
+	nr_devs = PyTuple_GET_SIZE(devseq);
+	nr_fields = PyTuple_GET_SIZE(fieldseq);
+
+	b = pq_batch_new(nr_devs, nr_fields);
+	if (!b) {
+		PyErr_NoMemory();
+		goto out;
+	}
+
+	for (i = 0; i < nr_fields; i++) {
+		b->fields[i] = pq_lookup_field(PyTuple_GET_ITEM(fieldseq, i));
+		if (!b->fields[i])
+			goto out;
+	}
+	for (i = 0; i < nr_devs; i++) {
+		switch (devname_copy(PyTuple_GET_ITEM(devseq, i), b->devnames[i])) {
+		case -1:
+			goto out;
+		case 1:
+			/* Left empty, to fail with ENODEV like an unknown device */
+			b->devnames[i][0] = '\0';
+			break;
+		}
+	}
+
+	if (nr_devs == 0) {
+		result = PyDict_New();
+		goto out;
+	}
+
+	if (workers <= 0 || workers > nr_devs)
+		workers = nr_devs;
+	if (workers > PQ_MAX_WORKERS)
+		workers = PQ_MAX_WORKERS;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	if (timeout >= 0)
+		pq_timespec_add_ms(&deadline, (long)(timeout * 1000));
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	pthread_attr_setstacksize(&attr, PQ_STACK_SIZE);
+	for (i = 0; i < workers; i++) {
+		pthread_t thread;
+		int err;
+
+		pthread_mutex_lock(&b->lock);
+		b->refcnt++;
+		pthread_mutex_unlock(&b->lock);
+
+		if ((err = pthread_create(&thread, &attr, pq_worker, b)) != 0) {
+			pthread_mutex_lock(&b->lock);
+			b->refcnt--;
+			pthread_mutex_unlock(&b->lock);
+			if (started)
+				break;	/* Carry on with the workers we got */
+			errno = err;
+			PyErr_SetFromErrno(PyExc_OSError);
+			pthread_attr_destroy(&attr);
+			goto out;
+		}
+		started++;
+	}
+	pthread_attr_destroy(&attr);
+
+	if (pq_wait(b, timeout < 0 ? NULL : &deadline) < 0)
+		goto out;
+
+	result = pq_build_results(b, devseq);
+
+ out:
+	if (b)
+		pq_batch_put(b);
+	Py_XDECREF(fieldseq);
+	Py_DECREF(devseq);
+	return result;
+}
+
+/*
+Local variables:
+c-basic-offset: 8
+indent-tabs-mode: y
+End:
+*/
@@ -0,0 +1,171 @@
+/* pause.c - Pause frame statistics from the ethtool netlink family
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * The pause parameters themselves go through ETHTOOL_[GS]PAUSEPARAM in
+ * ethtool.c, but the standard pause frame counters of Linux 5.11 and
+ * later are only in ETHTOOL_MSG_PAUSE_GET replies asked for with
+ * ETHTOOL_FLAG_STATS.
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <net/if.h>
+#include <linux/genetlink.h>
+#include <netlink/netlink.h>
+#include <netlink/socket.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+
+#include "pause.h"
+#include "netdev.h"
+#include "ethtool.h"
+#include "backend.h"
+
+/* From linux/ethtool_netlink.h, which older distributions lack */
+#define ETHTOOL_GENL_NAME		"ethtool"
+#define ETHTOOL_GENL_VERSION		1
+#define ETHTOOL_MSG_PAUSE_GET		21
+#define ETHTOOL_A_HEADER_DEV_INDEX	1
+#define ETHTOOL_A_HEADER_FLAGS		3
+#define ETHTOOL_FLAG_STATS		(1 << 2)
+#define ETHTOOL_A_PAUSE_HEADER		1
+#define ETHTOOL_A_PAUSE_STATS		5
+#define ETHTOOL_A_PAUSE_MAX		6
+#define ETHTOOL_A_PAUSE_STAT_TX_FRAMES	2
+#define ETHTOOL_A_PAUSE_STAT_RX_FRAMES	3
+#define ETHTOOL_A_PAUSE_STAT_MAX	3
+
+#define PAUSE_MISSING	UINT64_MAX
+
+struct pause_stats {
+	uint64_t tx_frames;
+	uint64_t rx_frames;
+};
+
+static int pause_msg(struct nl_msg *msg, void *arg)
+{
+	struct nlattr *tb[ETHTOOL_A_PAUSE_MAX + 1];
+	struct nlattr *stats[ETHTOOL_A_PAUSE_STAT_MAX + 1];
+	struct pause_stats *ps = arg;
+
+	if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, tb, ETHTOOL_A_PAUSE_MAX, NULL) < 0 ||
+	    !tb[ETHTOOL_A_PAUSE_STATS] ||
+	    nla_parse_nested(stats, ETHTOOL_A_PAUSE_STAT_MAX, tb[ETHTOOL_A_PAUSE_STATS],
+			     NULL) < 0)
+		return NL_SKIP;
+	if (stats[ETHTOOL_A_PAUSE_STAT_TX_FRAMES])
+		ps->tx_frames = nla_get_u64(stats[ETHTOOL_A_PAUSE_STAT_TX_FRAMES]);
+	if (stats[ETHTOOL_A_PAUSE_STAT_RX_FRAMES])
+		ps->rx_frames = nla_get_u64(stats[ETHTOOL_A_PAUSE_STAT_RX_FRAMES]);
+	return NL_OK;
+}
+
+/**
+ * Asks for the pause parameters and statistics of a device.  Does not need
+ * the GIL.
+ *
+ * @return Returns 0 on success, otherwise a negative libnl error code
+ */
+static int pause_collect(unsigned int ifindex, struct pause_stats *ps)
+{
+	struct nlattr *hdr;
+	struct nl_sock *sk;
+	struct nl_msg *msg;
+	int family, err;
+
+	ps->tx_frames = ps->rx_frames = PAUSE_MISSING;
+	sk = nl_socket_alloc();
+	if (!sk)
+		return -NLE_NOMEM;
+	if ((err = nl_connect(sk, NETLINK_GENERIC)) < 0) {
+		nl_socket_free(sk);
+		return err;
+	}
+	backend_nl_setup(sk);
+	nl_socket_disable_auto_ack(sk);
+
+	if ((err = netdev_resolve(sk, ETHTOOL_GENL_NAME, &family)) < 0)
+		goto out;
+	msg = netdev_msg(family, ETHTOOL_MSG_PAUSE_GET, ETHTOOL_GENL_VERSION, 0);
+	hdr = msg ? nla_nest_start(msg, ETHTOOL_A_PAUSE_HEADER | NLA_F_NESTED) : NULL;
+	if (!hdr ||
+	    nla_put_u32(msg, ETHTOOL_A_HEADER_DEV_INDEX, ifindex) < 0 ||
+	    nla_put_u32(msg, ETHTOOL_A_HEADER_FLAGS, ETHTOOL_FLAG_STATS) < 0) {
+		nlmsg_free(msg);
+		err = -NLE_NOMEM;
+		goto out;
+	}
+	nla_nest_end(msg, hdr);
+	err = netdev_exchange(sk, msg, pause_msg, ps);
+ out:
+	nl_close(sk);
+	nl_socket_free(sk);
+	return err;
+}
+
+/**
+ * ethtool.get_pause_stats(devname)
+ */
+PyObject *pause_get_stats(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", NULL };
+	struct pause_stats ps;
+	unsigned int ifindex;
+	char devname[IFNAMSIZ];
+	PyObject *dict, *value;
+	int err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&:get_pause_stats", kwlist,
+					 devname_converter, devname))
+		return NULL;
+	if (!(ifindex = if_nametoindex(devname)))
+		return PyErr_SetFromErrnoWithFilename(PyExc_IOError, devname);
+
+	Py_BEGIN_ALLOW_THREADS
+	err = pause_collect(ifindex, &ps);
+	Py_END_ALLOW_THREADS
+
+	switch (err) {
+	case 0:
+		break;
+	case -NLE_NOMEM:
+		return PyErr_NoMemory();
+	case -NLE_OBJ_NOTFOUND:
+	case -NLE_OPNOTSUPP:
+		/* Kernels before 5.6, or drivers without pause parameters */
+		errno = EOPNOTSUPP;
+		return PyErr_SetFromErrnoWithFilename(PyExc_IOError, devname);
+	default:
+		PyErr_SetString(PyExc_OSError, nl_geterror(err));
+		return NULL;
+	}
+
+	dict = PyDict_New();
+	if (dict && ps.tx_frames != PAUSE_MISSING) {
+		value = PyLong_FromUnsignedLongLong(ps.tx_frames);
+		if (!value || PyDict_SetItemString(dict, "tx_frames", value) < 0)
+			Py_CLEAR(dict);
+		Py_XDECREF(value);
+	}
+	if (dict && ps.rx_frames != PAUSE_MISSING) {
+		value = PyLong_FromUnsignedLongLong(ps.rx_frames);
+		if (!value || PyDict_SetItemString(dict, "rx_frames", value) < 0)
+			Py_CLEAR(dict);
+		Py_XDECREF(value);
+	}
+	return dict;
+}
@@ -0,0 +1,22 @@
+/* pause.h - Pause frame statistics from the ethtool netlink family
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _PAUSE_H
+#define _PAUSE_H
+
+#include <Python.h>
+
+PyObject *pause_get_stats(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif
@@ -0,0 +1,41 @@
+/* probes.h - USDT probes for tracing the module on live systems
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _PROBES_H
+#define _PROBES_H
+
+/*
+ * Statically defined tracepoints under the "ethtool" provider, listed with
+ * e.g. "bpftrace -l 'usdt:/path/to/ethtool.so:*'".  Each probe is a single
+ * NOP until a tracer attaches to it, the arguments are only evaluated into
+ * registers, so they must stay cheap to compute.  See tools/ for bpftrace
+ * scripts using them.
+ *
+ * Without <sys/sdt.h> (systemtap-sdt-devel) at build time the probes are
+ * compiled out entirely.
+ */
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define ETHTOOL_PROBE1(name, a)		 DTRACE_PROBE1(ethtool, name, a)
+#define ETHTOOL_PROBE2(name, a, b)	 DTRACE_PROBE2(ethtool, name, a, b)
+#define ETHTOOL_PROBE3(name, a, b, c)	 DTRACE_PROBE3(ethtool, name, a, b, c)
+#else
+#define ETHTOOL_PROBE1(name, a)		 do { } while (0)
+#define ETHTOOL_PROBE2(name, a, b)	 do { } while (0)
+#define ETHTOOL_PROBE3(name, a, b, c)	 do { } while (0)
+#endif
+
+#endif
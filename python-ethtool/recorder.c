@@ -0,0 +1,924 @@
+/* recorder.c - Time series of interface counters in a memory mapped file
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * A recorder samples the link counters (RTM_GETSTATS) and the driver
+ * statistics (ETHTOOL_GSTATS) of a few devices at a fixed interval, on a
+ * thread of its own which never takes the GIL, and appends them to a ring
+ * of fixed size records in a memory mapped file:
+ *
+ *   struct recorder_header
+ *   struct recorder_counter   nr_counters descriptions
+ *   (padding up to header_size, a multiple of the page size)
+ *   records                   capacity slots of record_size bytes
+ *
+ * A record is the CLOCK_REALTIME of the sample in nanoseconds followed by
+ * one uint64_t per counter, RECORDER_MISSING where a device did not answer.
+ * Record i goes into slot i % capacity, so the oldest records are
+ * overwritten once the ring is full.  header.writing is advanced before a
+ * record is written and header.head once it is complete, so readers can
+ * copy records out and drop those the recorder overwrote meanwhile,
+ * without any locking.
+ *
+ * Sampling only allocates the NETLINK messages, and the names of driver
+ * statistics which changed, whose values are then reported as missing.
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "ethtool.h"
+#include "recorder.h"
+#include "snapshot.h"
+#include "nicstats.h"
+
+#define RECORDER_MAGIC		"PYETHREC"
+#define RECORDER_VERSION	1
+#define RECORDER_MISSING	UINT64_MAX
+
+#define RECORDER_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define RECORDER_STORE(field, v) __atomic_store_n(&(field), (v), __ATOMIC_RELAXED)
+
+/* recorder_counter.source */
+#define RECORDER_LINK		0	/**< Link counter, see snapshot_counter_names */
+#define RECORDER_NIC		1	/**< Driver statistic */
+
+static const char *recorder_source_names[] = { "link", "nic" };
+
+struct recorder_header {
+	char	 magic[8];	/**< RECORDER_MAGIC, written last */
+	uint32_t version;	/**< RECORDER_VERSION */
+	uint32_t recorder_pid;
+	uint32_t header_size;	/**< Offset of the first record */
+	uint32_t record_size;	/**< 8 bytes per counter, plus the timestamp */
+	uint32_t nr_counters;
+	uint32_t reserved;
+	uint64_t capacity;	/**< Number of record slots */
+	uint64_t interval_ns;
+	uint64_t head;		/**< Number of records written */
+	uint64_t writing;	/**< head + 1 while a record is written, else head */
+	uint64_t overruns;	/**< Samples skipped because sampling fell behind */
+};
+
+struct recorder_counter {
+	char	 device[IFNAMSIZ];
+	char	 name[ETH_GSTRING_LEN];	/**< Not NUL terminated when full */
+	uint32_t source;		/**< RECORDER_LINK or RECORDER_NIC */
+	uint32_t reserved;
+};
+
+/**
+ * One recorded device, whose counters are SNAPSHOT_NR_COUNTERS link
+ * counters followed by nr_stats driver statistics
+ */
+struct recorder_dev {
+	char		name[IFNAMSIZ];
+	int		ifindex;
+	uint32_t	first;		/**< Index of its first counter */
+	uint32_t	nr_stats;
+	char		driver[32];	/**< Driver the statistics were named by */
+	struct nicstats	ns;
+};
+
+/**
+ * The ethtool.Recorder object
+ */
+typedef struct {
+	PyObject_HEAD
+	pthread_mutex_t	       ctl;	/**< Serialises start(), stop() and close() */
+	pthread_mutex_t	       lock;	/**< Protects worker.stopping */
+	struct worker	       worker;	/**< The sampling thread */
+	int		       fd;	/**< -1 once closed */
+	int		       ioctl_fd;
+	struct linkstats       links;
+	uint32_t	       nr_devs;
+	struct recorder_dev    *devs;
+	struct recorder_header *hdr;
+	uint64_t	       *records;
+	size_t		       maplen;
+} PyRecorder;
+
+/**
+ * The ethtool.Recording object
+ */
+typedef struct {
+	PyObject_HEAD
+	pthread_rwlock_t       lock;	/**< Write locked while closing */
+	int		       fd;	/**< -1 once closed */
+	struct recorder_header info;	/**< The fields which never change */
+	struct recorder_header *hdr;
+	size_t		       maplen;
+} PyRecording;
+
+static PyObject *recorder_string(const char *s, size_t max)
+{
+	return PyBytes_FromStringAndSize(s, strnlen(s, max));
+}
+
+/*
+ *
+ *   Sampling
+ *
+ */
+
+static void recorder_missing(uint64_t *values, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+		values[i] = RECORDER_MISSING;
+}
+
+/**
+ * Fills a record with the counters of all devices
+ */
+static void recorder_sample(PyRecorder *self, uint64_t *rec)
+{
+	struct recorder_dev *dev;
+	uint64_t *values;
+	uint32_t i;
+
+	rec[0] = clock_now_ns(CLOCK_REALTIME);
+	for (i = 0; i < self->nr_devs; i++) {
+		dev = &self->devs[i];
+		values = rec + 1 + dev->first;
+		if (linkstats_read(&self->links, dev->ifindex, values) != 0)
+			recorder_missing(values, SNAPSHOT_NR_COUNTERS);
+
+		if (!dev->nr_stats)
+			continue;
+		values += SNAPSHOT_NR_COUNTERS;
+		if (nicstats_read(&dev->ns, self->ioctl_fd, dev->name) == 0 &&
+		    dev->ns.n == dev->nr_stats &&
+		    strncmp(dev->ns.driver, dev->driver, sizeof(dev->driver)) == 0)
+			memcpy(values, dev->ns.values, dev->nr_stats * sizeof(*values));
+		else
+			recorder_missing(values, dev->nr_stats);
+	}
+}
+
+static void *recorder_thread(void *arg)
+{
+	PyRecorder *self = arg;
+	struct recorder_header *hdr = self->hdr;
+	uint64_t head = hdr->head, interval = hdr->interval_ns, next, now, skipped;
+
+	next = clock_now_ns(CLOCK_MONOTONIC);
+	pthread_mutex_lock(&self->lock);
+	while (!self->worker.stopping) {
+		pthread_mutex_unlock(&self->lock);
+
+		RECORDER_STORE(hdr->writing, head + 1);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		recorder_sample(self, self->records +
+				(head % hdr->capacity) * (hdr->nr_counters + 1));
+		__atomic_store_n(&hdr->head, ++head, __ATOMIC_RELEASE);
+
+		/* Keep the cadence, skipping what sampling was too slow for */
+		next += interval;
+		now = clock_now_ns(CLOCK_MONOTONIC);
+		if (now > next) {
+			skipped = (now - next) / interval + 1;
+			next += skipped * interval;
+			__atomic_fetch_add(&hdr->overruns, skipped, __ATOMIC_RELAXED);
+		}
+
+		pthread_mutex_lock(&self->lock);
+		worker_sleep(&self->worker, &self->lock, next);
+	}
+	pthread_mutex_unlock(&self->lock);
+	return NULL;
+}
+
+/*
+ *
+ *   Recorder
+ *
+ */
+
+/**
+ * Finds the devices and names their counters.  Runs without the GIL.
+ *
+ * @param failed Receives the device an error is about
+ */
+static int recorder_init_devs(PyRecorder *self, int nic_stats, const char **failed)
+{
+	struct recorder_dev *dev;
+	uint64_t values[SNAPSHOT_NR_COUNTERS];
+	uint32_t i, first = 0;
+	int err;
+
+	for (i = 0; i < self->nr_devs; i++) {
+		dev = &self->devs[i];
+		*failed = dev->name;
+		dev->ifindex = linkstats_ifindex(self->ioctl_fd, dev->name);
+		if (!dev->ifindex)
+			return errno;
+		if ((err = linkstats_read(&self->links, dev->ifindex, values)) != 0)
+			return err;
+
+		/* Devices without driver statistics only get link counters */
+		if (nic_stats && nicstats_read(&dev->ns, self->ioctl_fd, dev->name) == 0) {
+			dev->nr_stats = dev->ns.n;
+			memcpy(dev->driver, dev->ns.driver, sizeof(dev->driver));
+		}
+		dev->first = first;
+		first += SNAPSHOT_NR_COUNTERS + dev->nr_stats;
+	}
+	*failed = NULL;
+	return 0;
+}
+
+/**
+ * Locks the file at path, as the recorder writing it does for as long as
+ * it runs, so that it cannot be replaced while the lock is held
+ *
+ * @param fd Receives the locked file, or -1 if path does not exist
+ *
+ * @return Returns 0 on success, EWOULDBLOCK if a recorder is still
+ *         running, otherwise an errno
+ */
+static int recorder_lock_path(const char *path, int *fd)
+{
+	struct stat locked, current;
+	int err;
+
+	for (;;) {
+		*fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (*fd < 0)
+			return errno == ENOENT ? 0 : errno;
+		if (flock(*fd, LOCK_EX | LOCK_NB) < 0 || fstat(*fd, &locked) < 0) {
+			err = errno;
+			close(*fd);
+			*fd = -1;
+			return err;
+		}
+		/* Done unless the file was replaced before it was locked */
+		if (stat(path, &current) == 0 && current.st_dev == locked.st_dev &&
+		    current.st_ino == locked.st_ino)
+			return 0;
+		close(*fd);
+	}
+}
+
+/**
+ * Writes a new recording file next to path and renames it into place, so
+ * readers of an earlier recording keep theirs.  Runs without the GIL.
+ */
+static int recorder_init_file(PyRecorder *self, const char *path,
+			      uint64_t capacity, uint64_t interval_ns)
+{
+	struct recorder_header *hdr;
+	struct recorder_counter *c;
+	uint32_t nr_counters = 0, i, j;
+	uint64_t header_size, size;
+	size_t page = sysconf(_SC_PAGESIZE);
+	char *tmp;
+	int fd, err = 0;
+
+	for (i = 0; i < self->nr_devs; i++)
+		nr_counters += SNAPSHOT_NR_COUNTERS + self->devs[i].nr_stats;
+	header_size = sizeof(*hdr) + (uint64_t)nr_counters * sizeof(*c);
+	header_size = (header_size + page - 1) / page * page;
+	size = header_size + capacity * (nr_counters + 1) * sizeof(uint64_t);
+	if (capacity > (UINT64_MAX / 2) / ((nr_counters + 1) * sizeof(uint64_t)) ||
+	    size != (size_t)size)
+		return EFBIG;
+
+	if ((err = recorder_lock_path(path, &fd)) != 0)
+		return err;
+	tmp = malloc(strlen(path) + 8);
+	if (!tmp) {
+		err = ENOMEM;
+		goto out_unlock;
+	}
+	sprintf(tmp, "%s.XXXXXX", path);
+	self->fd = mkostemp(tmp, O_CLOEXEC);
+	if (self->fd < 0) {
+		err = errno;
+		free(tmp);
+		goto out_unlock;
+	}
+
+	if (flock(self->fd, LOCK_EX | LOCK_NB) < 0 || fchmod(self->fd, 0644) < 0 ||
+	    ftruncate(self->fd, size) < 0) {
+		err = errno;
+		goto out;
+	}
+	/* Filesystems which cannot preallocate still have the sparse file */
+	err = posix_fallocate(self->fd, 0, size);
+	if (err && err != EOPNOTSUPP && err != EINVAL)
+		goto out;
+	err = 0;
+
+	hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, self->fd, 0);
+	if (hdr == MAP_FAILED) {
+		err = errno;
+		goto out;
+	}
+	self->hdr = hdr;
+	self->maplen = size;
+	self->records = (uint64_t *)((char *)hdr + header_size);
+
+	hdr->version = RECORDER_VERSION;
+	hdr->recorder_pid = getpid();
+	hdr->header_size = header_size;
+	hdr->record_size = (nr_counters + 1) * sizeof(uint64_t);
+	hdr->nr_counters = nr_counters;
+	hdr->capacity = capacity;
+	hdr->interval_ns = interval_ns;
+	c = (struct recorder_counter *)(hdr + 1);
+	for (i = 0; i < self->nr_devs; i++) {
+		const struct recorder_dev *dev = &self->devs[i];
+
+		for (j = 0; j < SNAPSHOT_NR_COUNTERS + dev->nr_stats; j++, c++) {
+			memcpy(c->device, dev->name, IFNAMSIZ);
+			if (j < SNAPSHOT_NR_COUNTERS) {
+				c->source = RECORDER_LINK;
+				strncpy(c->name, snapshot_counter_names[j], sizeof(c->name));
+			} else {
+				c->source = RECORDER_NIC;
+				memcpy(c->name, dev->ns.names[j - SNAPSHOT_NR_COUNTERS],
+				       sizeof(c->name));
+			}
+		}
+	}
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(hdr->magic, RECORDER_MAGIC, sizeof(hdr->magic));
+
+	/*
+	 * Only replace a file whose lock is held.  Where there is none yet,
+	 * link() fails instead of replacing one which appeared meanwhile.
+	 */
+	for (;;) {
+		if (fd >= 0) {
+			if (rename(tmp, path) < 0)
+				err = errno;
+			break;
+		}
+		if (link(tmp, path) == 0) {
+			unlink(tmp);
+			break;
+		}
+		if (errno != EEXIST) {
+			err = errno;
+			break;
+		}
+		if ((err = recorder_lock_path(path, &fd)) != 0)
+			break;
+	}
+out:
+	if (err)
+		unlink(tmp);
+	free(tmp);
+out_unlock:
+	if (fd >= 0)
+		close(fd);
+	return err;
+}
+
+/* Called with self->ctl held, or from the destructor */
+static void recorder_stop(PyRecorder *self)
+{
+	worker_stop(&self->worker, &self->lock);
+}
+
+/* Called with self->ctl held, or from the destructor */
+static void recorder_close(PyRecorder *self)
+{
+	uint32_t i;
+
+	recorder_stop(self);
+	if (self->hdr)
+		munmap(self->hdr, self->maplen);
+	self->hdr = NULL;
+	self->records = NULL;
+	for (i = 0; i < self->nr_devs; i++)
+		nicstats_free(&self->devs[i].ns);
+	free(self->devs);
+	self->devs = NULL;
+	self->nr_devs = 0;
+	linkstats_close(&self->links);
+	if (self->ioctl_fd >= 0)
+		close(self->ioctl_fd);
+	self->ioctl_fd = -1;
+	if (self->fd >= 0)
+		close(self->fd);	/* Drops the flock() */
+	self->fd = -1;
+}
+
+/**
+ * ethtool.recorder(path, devices, interval=0.01, capacity=65536, nic_stats=True)
+ *
+ * @return Returns a new Recorder object owning the recording file
+ */
+PyObject *recorder_new(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "path", "devices", "interval", "capacity",
+				  "nic_stats", NULL };
+	const char *path, *failed = NULL;
+	PyObject *devices, *seq;
+	PyRecorder *rec;
+	double interval = 0.01;
+	Py_ssize_t capacity = 65536, i, n;
+	int nic_stats = 1, err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "sO|dni:recorder", kwlist,
+					 &path, &devices, &interval, &capacity,
+					 &nic_stats))
+		return NULL;
+	if (!(interval >= 1e-6 && interval <= 3600)) {
+		PyErr_SetString(PyExc_ValueError, "interval must be between 1us and 1h");
+		return NULL;
+	}
+	if (capacity < 2) {
+		PyErr_SetString(PyExc_ValueError, "capacity must be at least 2 records");
+		return NULL;
+	}
+
+	seq = PySequence_Fast(devices, "devices must be a sequence of device names");
+	if (!seq)
+		return NULL;
+	n = PySequence_Fast_GET_SIZE(seq);
+	if (n == 0) {
+		Py_DECREF(seq);
+		PyErr_SetString(PyExc_ValueError, "no devices to record");
+		return NULL;
+	}
+
+	rec = PyObject_New(PyRecorder, &PyRecorder_Type);
+	if (!rec) {
+		Py_DECREF(seq);
+		return NULL;
+	}
+	pthread_mutex_init(&rec->ctl, NULL);
+	pthread_mutex_init(&rec->lock, NULL);
+	worker_init(&rec->worker);
+	rec->fd = rec->ioctl_fd = -1;
+	rec->links.sk = NULL;
+	rec->nr_devs = 0;
+	rec->hdr = NULL;
+	rec->records = NULL;
+	rec->maplen = 0;
+	rec->devs = calloc(n, sizeof(*rec->devs));
+	if (!rec->devs) {
+		Py_DECREF(seq);
+		Py_DECREF(rec);
+		return PyErr_NoMemory();
+	}
+	rec->nr_devs = n;
+	for (i = 0; i < n; i++) {
+		if (!devname_converter(PySequence_Fast_GET_ITEM(seq, i), rec->devs[i].name)) {
+			Py_DECREF(seq);
+			Py_DECREF(rec);
+			return NULL;
+		}
+	}
+	Py_DECREF(seq);
+
+	Py_BEGIN_ALLOW_THREADS
+	rec->ioctl_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (rec->ioctl_fd < 0)
+		err = errno;
+	else
+		err = linkstats_open(&rec->links);
+	if (!err)
+		err = recorder_init_devs(rec, nic_stats, &failed);
+	if (!err)
+		err = recorder_init_file(rec, path, capacity, interval * 1e9);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		errno = err;
+		if (err == EWOULDBLOCK)
+			PyErr_Format(PyExc_IOError, "%s is already being recorded by another process",
+				     path);
+		else
+			PyErr_SetFromErrnoWithFilename(PyExc_IOError, failed ? failed : path);
+		Py_DECREF(rec);
+		return NULL;
+	}
+	return (PyObject *)rec;
+}
+
+static PyObject *recorder_start(PyRecorder *self, PyObject *unused __unused)
+{
+	int err;
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->ctl);
+	if (self->fd < 0)
+		err = EBADF;
+	else
+		err = worker_start(&self->worker, recorder_thread, self);
+	pthread_mutex_unlock(&self->ctl);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		errno = err;
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+	Py_RETURN_NONE;
+}
+
+static PyObject *recorder_stop_method(PyRecorder *self, PyObject *unused __unused)
+{
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->ctl);
+	recorder_stop(self);
+	pthread_mutex_unlock(&self->ctl);
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *recorder_close_method(PyRecorder *self, PyObject *unused __unused)
+{
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->ctl);
+	recorder_close(self);
+	pthread_mutex_unlock(&self->ctl);
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *recorder_get_recorded(PyRecorder *self, void *unused __unused)
+{
+	uint64_t head = 0;
+
+	pthread_mutex_lock(&self->ctl);
+	if (self->hdr)
+		head = __atomic_load_n(&self->hdr->head, __ATOMIC_ACQUIRE);
+	pthread_mutex_unlock(&self->ctl);
+	return PyLong_FromUnsignedLongLong(head);
+}
+
+static PyObject *recorder_get_running(PyRecorder *self, void *unused __unused)
+{
+	return PyBool_FromLong(self->worker.running);
+}
+
+static void recorder_dealloc(PyRecorder *self)
+{
+	Py_BEGIN_ALLOW_THREADS
+	recorder_close(self);
+	Py_END_ALLOW_THREADS
+	worker_destroy(&self->worker);
+	pthread_mutex_destroy(&self->lock);
+	pthread_mutex_destroy(&self->ctl);
+	PyObject_Del(self);
+}
+
+static PyMethodDef recorder_methods[] = {
+	{"start", (PyCFunction)recorder_start, METH_NOARGS,
+	 "Starts sampling on a thread of its own, appending to the recording."},
+	{"stop", (PyCFunction)recorder_stop_method, METH_NOARGS,
+	 "Stops sampling, start() carries on with the same recording."},
+	{"close", (PyCFunction)recorder_close_method, METH_NOARGS,
+	 "Stops sampling for good.  The file is kept."},
+	{NULL}
+};
+
+static PyGetSetDef recorder_getset[] = {
+	{"recorded", (getter)recorder_get_recorded, NULL,
+	 "Number of records written so far", NULL},
+	{"running", (getter)recorder_get_running, NULL,
+	 "Whether the sampling thread is running", NULL},
+	{NULL}
+};
+
+PyTypeObject PyRecorder_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.Recorder",
+	.tp_basicsize = sizeof(PyRecorder),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)recorder_dealloc,
+	.tp_methods = recorder_methods,
+	.tp_getset = recorder_getset,
+	.tp_doc = "Records interface counters at a fixed interval, see ethtool.recorder()"
+};
+
+/*
+ *
+ *   Readers
+ *
+ */
+
+/**
+ * ethtool.open_recording(path)
+ *
+ * @return Returns a new Recording object mapping the recording file
+ */
+PyObject *recorder_open(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "path", NULL };
+	const struct recorder_header *hdr;
+	struct stat sb;
+	PyRecording *r;
+	const char *path;
+	uint64_t need;
+	int err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s:open_recording", kwlist, &path))
+		return NULL;
+
+	r = PyObject_New(PyRecording, &PyRecording_Type);
+	if (!r)
+		return NULL;
+	pthread_rwlock_init(&r->lock, NULL);
+	r->hdr = NULL;
+	r->maplen = 0;
+
+	r->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (r->fd < 0 || fstat(r->fd, &sb) < 0) {
+		err = errno;
+	} else if ((size_t)sb.st_size < sizeof(struct recorder_header)) {
+		err = EINVAL;
+	} else {
+		r->hdr = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, r->fd, 0);
+		if (r->hdr == MAP_FAILED) {
+			r->hdr = NULL;
+			err = errno;
+		} else {
+			r->maplen = sb.st_size;
+		}
+	}
+
+	/* Everything but head and overruns is written before the magic */
+	if (!err) {
+		hdr = r->hdr;
+		if (memcmp(hdr->magic, RECORDER_MAGIC, sizeof(hdr->magic)) != 0)
+			err = EINVAL;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		r->info = *hdr;
+		need = r->info.header_size + r->info.capacity * r->info.record_size;
+		if (!err &&
+		    (r->info.version != RECORDER_VERSION || r->info.capacity == 0 ||
+		     r->info.record_size != (r->info.nr_counters + 1) * sizeof(uint64_t) ||
+		     r->info.header_size % sizeof(uint64_t) ||
+		     r->info.header_size < sizeof(*hdr) +
+		     (uint64_t)r->info.nr_counters * sizeof(struct recorder_counter) ||
+		     r->info.capacity > UINT64_MAX / 2 / r->info.record_size ||
+		     need > r->maplen))
+			err = EINVAL;
+	}
+
+	if (err) {
+		if (err == EINVAL)
+			PyErr_Format(PyExc_ValueError, "%s is not a counter recording", path);
+		else
+			PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
+		Py_DECREF(r);
+		return NULL;
+	}
+	return (PyObject *)r;
+}
+
+/**
+ * Copies the latest records out of the ring, oldest first.  Records the
+ * recorder may have overwritten while they were copied are dropped.
+ * Called with self->lock read locked, without the GIL.
+ *
+ * @param buf   Receives the records, must be freed
+ * @param count Receives the number of records
+ */
+static int recording_copy(PyRecording *self, uint64_t last, uint64_t **buf, uint64_t *count)
+{
+	const struct recorder_header *info = &self->info;
+	const char *records = (const char *)self->hdr + info->header_size;
+	uint64_t head, writing, first, n, slot, part, safe;
+	char *out;
+
+	head = __atomic_load_n(&self->hdr->head, __ATOMIC_ACQUIRE);
+	first = head > info->capacity ? head - info->capacity : 0;
+	if (last && head - first > last)
+		first = head - last;
+	n = head - first;
+
+	out = malloc(n ? n * info->record_size : 1);
+	if (!out)
+		return ENOMEM;
+	slot = first % info->capacity;
+	part = n < info->capacity - slot ? n : info->capacity - slot;
+	memcpy(out, records + slot * info->record_size, part * info->record_size);
+	memcpy(out + part * info->record_size, records, (n - part) * info->record_size);
+
+	/* Writing record w - 1 overwrites record w - 1 - capacity */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	writing = RECORDER_LOAD(self->hdr->writing);
+	safe = writing > info->capacity ? writing - info->capacity : 0;
+	if (safe > first) {
+		part = safe - first < n ? safe - first : n;
+		memmove(out, out + part * info->record_size, (n - part) * info->record_size);
+		n -= part;
+	}
+
+	*buf = (uint64_t *)out;
+	*count = n;
+	return 0;
+}
+
+static PyObject *recording_read(PyRecording *self, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "last", NULL };
+	PyObject *timestamps, *values, *result;
+	unsigned long long last = 0;
+	uint64_t *buf = NULL, count = 0, i, *ts, *v;
+	uint32_t nr_counters = self->info.nr_counters;
+	int err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|K:read", kwlist, &last))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_rwlock_rdlock(&self->lock);
+	err = self->hdr ? recording_copy(self, last, &buf, &count) : EBADF;
+	pthread_rwlock_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		if (err == ENOMEM)
+			return PyErr_NoMemory();
+		errno = err;
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+
+	timestamps = PyBytes_FromStringAndSize(NULL, count * sizeof(uint64_t));
+	values = PyBytes_FromStringAndSize(NULL, count * nr_counters * sizeof(uint64_t));
+	if (!timestamps || !values) {
+		Py_XDECREF(timestamps);
+		Py_XDECREF(values);
+		free(buf);
+		return NULL;
+	}
+	ts = (uint64_t *)PyBytes_AS_STRING(timestamps);
+	v = (uint64_t *)PyBytes_AS_STRING(values);
+	for (i = 0; i < count; i++) {
+		const uint64_t *rec = buf + i * (nr_counters + 1);
+
+		ts[i] = rec[0];
+		memcpy(v + i * nr_counters, rec + 1, nr_counters * sizeof(uint64_t));
+	}
+	free(buf);
+
+	result = PyTuple_Pack(2, timestamps, values);
+	Py_DECREF(timestamps);
+	Py_DECREF(values);
+	return result;
+}
+
+static PyObject *recording_get_counters(PyRecording *self, void *unused __unused)
+{
+	const struct recorder_counter *c;
+	PyObject *list, *item;
+	uint32_t i;
+
+	pthread_rwlock_rdlock(&self->lock);
+	if (!self->hdr) {
+		pthread_rwlock_unlock(&self->lock);
+		errno = EBADF;
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+
+	list = PyList_New(self->info.nr_counters);
+	c = (const struct recorder_counter *)(self->hdr + 1);
+	for (i = 0; list && i < self->info.nr_counters; i++, c++) {
+		item = Py_BuildValue("(NsN)", recorder_string(c->device, IFNAMSIZ),
+				     recorder_source_names[c->source == RECORDER_NIC],
+				     recorder_string(c->name, sizeof(c->name)));
+		if (!item)
+			Py_CLEAR(list);
+		else
+			PyList_SET_ITEM(list, i, item);
+	}
+	pthread_rwlock_unlock(&self->lock);
+	return list;
+}
+
+static PyObject *recording_get_recorded(PyRecording *self, void *unused __unused)
+{
+	uint64_t head = 0;
+
+	pthread_rwlock_rdlock(&self->lock);
+	if (self->hdr)
+		head = __atomic_load_n(&self->hdr->head, __ATOMIC_ACQUIRE);
+	pthread_rwlock_unlock(&self->lock);
+	return PyLong_FromUnsignedLongLong(head);
+}
+
+static PyObject *recording_get_overruns(PyRecording *self, void *unused __unused)
+{
+	uint64_t overruns = 0;
+
+	pthread_rwlock_rdlock(&self->lock);
+	if (self->hdr)
+		overruns = __atomic_load_n(&self->hdr->overruns, __ATOMIC_RELAXED);
+	pthread_rwlock_unlock(&self->lock);
+	return PyLong_FromUnsignedLongLong(overruns);
+}
+
+static PyObject *recording_get_interval(PyRecording *self, void *unused __unused)
+{
+	return PyFloat_FromDouble(self->info.interval_ns / 1e9);
+}
+
+static PyObject *recording_get_capacity(PyRecording *self, void *unused __unused)
+{
+	return PyLong_FromUnsignedLongLong(self->info.capacity);
+}
+
+static PyObject *recording_get_pid(PyRecording *self, void *unused __unused)
+{
+	return PyLong_FromLong(self->info.recorder_pid);
+}
+
+static void recording_close(PyRecording *self)
+{
+	pthread_rwlock_wrlock(&self->lock);
+	if (self->hdr)
+		munmap(self->hdr, self->maplen);
+	self->hdr = NULL;
+	if (self->fd >= 0)
+		close(self->fd);
+	self->fd = -1;
+	pthread_rwlock_unlock(&self->lock);
+}
+
+static PyObject *recording_close_method(PyRecording *self, PyObject *unused __unused)
+{
+	recording_close(self);
+	Py_RETURN_NONE;
+}
+
+static void recording_dealloc(PyRecording *self)
+{
+	recording_close(self);
+	pthread_rwlock_destroy(&self->lock);
+	PyObject_Del(self);
+}
+
+static PyMethodDef recording_methods[] = {
+	{"read", (PyCFunction)recording_read, METH_VARARGS | METH_KEYWORDS,
+	 "read(last=0)\n\n"
+	 "Returns the records still in the ring, or the last ones only, oldest "
+	 "first, as a (timestamps, values) tuple of bytes holding native "
+	 "unsigned 64 bit integers: the CLOCK_REALTIME nanoseconds of each "
+	 "record, and a row of len(counters) values per record.  Counters a "
+	 "device did not report read as 2**64 - 1.  Both can be viewed with "
+	 "array.array('Q', ...) or numpy.frombuffer(..., 'u8')."},
+	{"close", (PyCFunction)recording_close_method, METH_NOARGS,
+	 "Unmaps the recording."},
+	{NULL}
+};
+
+static PyGetSetDef recording_getset[] = {
+	{"counters", (getter)recording_get_counters, NULL,
+	 "(device, source, name) of each counter, source being \"link\" or \"nic\"", NULL},
+	{"recorded", (getter)recording_get_recorded, NULL,
+	 "Number of records written so far", NULL},
+	{"overruns", (getter)recording_get_overruns, NULL,
+	 "Number of samples skipped because sampling fell behind", NULL},
+	{"interval", (getter)recording_get_interval, NULL,
+	 "Sampling interval in seconds", NULL},
+	{"capacity", (getter)recording_get_capacity, NULL,
+	 "Number of records the ring holds", NULL},
+	{"recorder_pid", (getter)recording_get_pid, NULL,
+	 "Process ID of the recorder", NULL},
+	{NULL}
+};
+
+PyTypeObject PyRecording_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.Recording",
+	.tp_basicsize = sizeof(PyRecording),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)recording_dealloc,
+	.tp_methods = recording_methods,
+	.tp_getset = recording_getset,
+	.tp_doc = "A counter recording mapped read-only, see ethtool.open_recording()"
+};
@@ -0,0 +1,26 @@
+/* recorder.h - Time series of interface counters in a memory mapped file
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _RECORDER_H
+#define _RECORDER_H
+
+#include <Python.h>
+
+extern PyTypeObject PyRecorder_Type;
+extern PyTypeObject PyRecording_Type;
+
+PyObject *recorder_new(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *recorder_open(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif
@@ -0,0 +1,658 @@
+/* rings.c - Ring size advice from drop counters
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * A ring advisor samples the ring sizes (ETHTOOL_GRINGPARAM) of devices
+ * along with the counters of packets lost to full rings: the missed, fifo
+ * and overrun link counters, plus the driver statistics known to count
+ * the same, see rings_driver_counters.  A direction which lost at least
+ * min_drops packets since the previous sample is advised to double its
+ * ring, up to the maximum the device reports.  Rings are never advised to
+ * shrink, losing nothing says little about the bursts to come.
+ *
+ * Everything is done on plain counter buffers without the GIL, so sampling
+ * all the devices of a host every few seconds is cheap.  The advice is
+ * applied with ETHTOOL_SRINGPARAM, only when the device is not at it
+ * already, as most drivers reset the device to resize its rings.
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/if_link.h>
+#include <linux/sockios.h>
+
+#include "ethtool.h"
+#include "rings.h"
+#include "nicstats.h"
+#include "backend.h"
+
+enum rings_dir {
+	RINGS_RX,
+	RINGS_TX,
+	RINGS_NR_DIRS
+};
+
+/**
+ * Driver statistics counting packets lost to a full ring, as reported by
+ * common drivers.  Those mirroring the link counters are left out so they
+ * are not counted twice.
+ */
+static const struct {
+	const char    *name;
+	enum rings_dir dir;
+} rings_driver_counters[] = {
+	{ "rx_no_buffer",	 RINGS_RX },
+	{ "rx_no_buffer_count",	 RINGS_RX },
+	{ "rx_no_dma_resources", RINGS_RX },
+	{ "rx_out_of_buffer",	 RINGS_RX },
+	{ "rx_buff_alloc_err",	 RINGS_RX },
+	{ "tx_busy",		 RINGS_TX },
+	{ "tx_restart_queue",	 RINGS_TX },
+	{ "tx_queue_stopped",	 RINGS_TX },
+};
+
+/**
+ * Driver statistic found in rings_driver_counters
+ */
+struct rings_match {
+	uint32_t       index;
+	enum rings_dir dir;
+};
+
+struct rings_dev {
+	char			 name[IFNAMSIZ];
+	int			 ifindex;	/**< 0 until looked up */
+	struct nicstats		 stats;
+	uint32_t		 generation;	/**< Of the stats names matched */
+	uint32_t		 nr_matches;
+	struct rings_match	 *matches;
+	int			 have_prev;
+	int			 prev_driver;	/**< Whether prev_drops has driver statistics */
+	uint64_t		 prev_ns;
+	uint64_t		 prev_drops[RINGS_NR_DIRS];
+
+	/* Advice of the last sample */
+	int			 valid;		/**< Whether the device has rings */
+	int			 err;		/**< Of applying the advice */
+	int			 applied;
+	double			 window;	/**< Seconds the drops were counted over */
+	struct ethtool_ringparam ring;
+	uint64_t		 drops[RINGS_NR_DIRS];
+	uint32_t		 advice[RINGS_NR_DIRS];
+};
+
+/**
+ * The ethtool.RingAdvisor object
+ */
+typedef struct {
+	PyObject_HEAD
+	pthread_mutex_t	 lock;		/**< Protects everything below */
+	int		 all;		/**< Whether to follow all the devices */
+	uint64_t	 min_drops;
+	int		 ioctl_fd;
+	struct linkstats links;
+	uint32_t	 nr_devs;
+	struct rings_dev *devs;		/**< Sorted by ifindex with all set */
+} PyRingAdvisor;
+
+static int rings_ioctl(int fd, const char devname[IFNAMSIZ], void *data, size_t size)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	memcpy(ifr.ifr_name, devname, IFNAMSIZ);
+	ifr.ifr_data = data;
+	return backend_ioctl(fd, SIOCETHTOOL, &ifr, size) < 0 ? errno : 0;
+}
+
+static void rings_dev_free(struct rings_dev *dev)
+{
+	nicstats_free(&dev->stats);
+	free(dev->matches);
+	dev->matches = NULL;
+	dev->nr_matches = 0;
+}
+
+/**
+ * Finds the driver statistics of rings_driver_counters, once per set of names
+ */
+static int rings_match_names(struct rings_dev *dev)
+{
+	const struct nicstats *ns = &dev->stats;
+	char name[ETH_GSTRING_LEN + 1];
+	uint32_t i, j;
+
+	if (dev->generation == ns->generation)
+		return 0;
+
+	free(dev->matches);
+	dev->nr_matches = 0;
+	dev->matches = malloc(sizeof(*dev->matches) * ARRAY_SIZE(rings_driver_counters));
+	if (!dev->matches)
+		return ENOMEM;
+	name[ETH_GSTRING_LEN] = '\0';
+	for (i = 0; i < ns->n && dev->nr_matches < ARRAY_SIZE(rings_driver_counters); i++) {
+		memcpy(name, ns->names[i], ETH_GSTRING_LEN);
+		for (j = 0; j < ARRAY_SIZE(rings_driver_counters); j++) {
+			if (strcmp(name, rings_driver_counters[j].name) == 0) {
+				dev->matches[dev->nr_matches].index = i;
+				dev->matches[dev->nr_matches].dir = rings_driver_counters[j].dir;
+				dev->nr_matches++;
+				break;
+			}
+		}
+	}
+	dev->generation = ns->generation;
+	return 0;
+}
+
+/**
+ * Advises the size of a ring
+ */
+static uint32_t rings_advise(uint32_t pending, uint32_t max, uint64_t drops, uint64_t min_drops)
+{
+	uint64_t want;
+
+	if (drops < min_drops || pending == 0 || pending >= max)
+		return pending;
+	want = (uint64_t)pending * 2;
+	return want > max ? max : want;
+}
+
+/**
+ * Writes the advised ring sizes, unless the device is at them already
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int rings_apply(PyRingAdvisor *self, const struct rings_dev *dev)
+{
+	struct ethtool_ringparam ring;
+	int err;
+
+	memset(&ring, 0, sizeof(ring));
+	ring.cmd = ETHTOOL_GRINGPARAM;
+	if ((err = rings_ioctl(self->ioctl_fd, dev->name, &ring, sizeof(ring))) != 0)
+		return err;
+	if (ring.rx_pending == dev->advice[RINGS_RX] && ring.tx_pending == dev->advice[RINGS_TX])
+		return 0;
+
+	ring.cmd = ETHTOOL_SRINGPARAM;
+	ring.rx_pending = dev->advice[RINGS_RX];
+	ring.tx_pending = dev->advice[RINGS_TX];
+	return rings_ioctl(self->ioctl_fd, dev->name, &ring, sizeof(ring));
+}
+
+/**
+ * Works out the advice of a device from its ring sizes, in dev->ring, and
+ * its drop counters.  Called with self->lock held, without the GIL.
+ *
+ * @param driver Whether drops include driver statistics
+ */
+static void rings_account(PyRingAdvisor *self, struct rings_dev *dev,
+			  const uint64_t drops[RINGS_NR_DIRS], int driver, uint64_t now_ns)
+{
+	int d;
+
+	/* Nothing is counted when the driver statistics came or went, or
+	 * when counters went backwards after a reset
+	 */
+	if (dev->have_prev && driver != dev->prev_driver)
+		dev->have_prev = 0;
+	for (d = 0; d < RINGS_NR_DIRS; d++) {
+		dev->drops[d] = dev->have_prev && drops[d] >= dev->prev_drops[d] ?
+			drops[d] - dev->prev_drops[d] : 0;
+	}
+	dev->window = dev->have_prev ? (now_ns - dev->prev_ns) / 1e9 : 0;
+	dev->advice[RINGS_RX] = rings_advise(dev->ring.rx_pending, dev->ring.rx_max_pending,
+					     dev->drops[RINGS_RX], self->min_drops);
+	dev->advice[RINGS_TX] = rings_advise(dev->ring.tx_pending, dev->ring.tx_max_pending,
+					     dev->drops[RINGS_TX], self->min_drops);
+	memcpy(dev->prev_drops, drops, sizeof(dev->prev_drops));
+	dev->prev_driver = driver;
+	dev->prev_ns = now_ns;
+	dev->have_prev = 1;
+	dev->valid = 1;
+}
+
+/**
+ * Samples a device and works out its advice.  Called with self->lock held,
+ * without the GIL.
+ */
+static void rings_update(PyRingAdvisor *self, struct rings_dev *dev, int apply)
+{
+	struct rtnl_link_stats64 st;
+	uint64_t drops[RINGS_NR_DIRS];
+	uint32_t i;
+	int driver;
+
+	dev->valid = dev->applied = 0;
+	dev->err = 0;
+	memset(&dev->ring, 0, sizeof(dev->ring));
+	dev->ring.cmd = ETHTOOL_GRINGPARAM;
+	if (rings_ioctl(self->ioctl_fd, dev->name, &dev->ring, sizeof(dev->ring)) != 0)
+		goto forget;
+	if (!dev->ifindex)
+		dev->ifindex = linkstats_ifindex(self->ioctl_fd, dev->name);
+	if (!dev->ifindex || linkstats_read64(&self->links, dev->ifindex, &st) != 0) {
+		/* The device may come back under another index */
+		if (!self->all)
+			dev->ifindex = 0;
+		goto forget;
+	}
+	drops[RINGS_RX] = st.rx_missed_errors + st.rx_fifo_errors + st.rx_over_errors;
+	drops[RINGS_TX] = st.tx_fifo_errors;
+	driver = nicstats_read(&dev->stats, self->ioctl_fd, dev->name) == 0 &&
+		rings_match_names(dev) == 0;
+	for (i = 0; driver && i < dev->nr_matches; i++)
+		drops[dev->matches[i].dir] += dev->stats.values[dev->matches[i].index];
+	rings_account(self, dev, drops, driver, clock_now_ns(CLOCK_MONOTONIC));
+
+	if (apply && (dev->advice[RINGS_RX] != dev->ring.rx_pending ||
+		      dev->advice[RINGS_TX] != dev->ring.tx_pending)) {
+		dev->err = rings_apply(self, dev);
+		dev->applied = !dev->err;
+	}
+	return;
+
+forget:
+	/* Devices without rings are sampled again, they may get some */
+	dev->have_prev = 0;
+}
+
+static int rings_cmp_dev(const void *a, const void *b)
+{
+	const struct rings_dev *x = a, *y = b;
+
+	return x->ifindex < y->ifindex ? -1 : x->ifindex > y->ifindex;
+}
+
+/**
+ * Follows the devices of the host, keeping the state of those still there.
+ * Called with self->lock held, without the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int rings_refresh(PyRingAdvisor *self)
+{
+	struct if_nameindex *ni, *p;
+	struct rings_dev *devs, *old;
+	uint32_t i, n = 0;
+
+	ni = if_nameindex();
+	if (!ni)
+		return errno;
+	for (p = ni; p->if_index; p++)
+		n++;
+	devs = calloc(n ? n : 1, sizeof(*devs));
+	if (!devs) {
+		if_freenameindex(ni);
+		return ENOMEM;
+	}
+	for (i = 0; i < n; i++) {
+		strncpy(devs[i].name, ni[i].if_name, IFNAMSIZ - 1);
+		devs[i].ifindex = ni[i].if_index;
+	}
+	if_freenameindex(ni);
+	qsort(devs, n, sizeof(*devs), rings_cmp_dev);
+
+	for (i = 0; i < n; i++) {
+		old = bsearch(&devs[i], self->devs, self->nr_devs, sizeof(*old), rings_cmp_dev);
+		if (old && strcmp(old->name, devs[i].name) == 0) {
+			/* The old entry keeps its key for the searches to come */
+			devs[i] = *old;
+			memset(&old->stats, 0, sizeof(old->stats));
+			old->matches = NULL;
+		}
+	}
+	for (i = 0; i < self->nr_devs; i++)
+		rings_dev_free(&self->devs[i]);
+	free(self->devs);
+	self->devs = devs;
+	self->nr_devs = n;
+	return 0;
+}
+
+/**
+ * ethtool.ring_advisor(devices=None, min_drops=1)
+ *
+ * @return Returns a new RingAdvisor object
+ */
+PyObject *rings_advisor(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devices", "min_drops", NULL };
+	PyObject *devices = Py_None, *seq;
+	unsigned long long min_drops = 1;
+	PyRingAdvisor *ra;
+	Py_ssize_t i, n = 0;
+	int err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OK:ring_advisor", kwlist,
+					 &devices, &min_drops))
+		return NULL;
+	if (min_drops == 0) {
+		PyErr_SetString(PyExc_ValueError, "min_drops must be at least 1");
+		return NULL;
+	}
+
+	ra = PyObject_New(PyRingAdvisor, &PyRingAdvisor_Type);
+	if (!ra)
+		return NULL;
+	pthread_mutex_init(&ra->lock, NULL);
+	ra->all = devices == Py_None;
+	ra->min_drops = min_drops;
+	ra->ioctl_fd = -1;
+	ra->links.sk = NULL;
+	ra->nr_devs = 0;
+	ra->devs = NULL;
+
+	if (!ra->all) {
+		seq = PySequence_Fast(devices, "devices must be a sequence of device names");
+		if (!seq) {
+			Py_DECREF(ra);
+			return NULL;
+		}
+		n = PySequence_Fast_GET_SIZE(seq);
+		ra->devs = calloc(n ? n : 1, sizeof(*ra->devs));
+		if (!ra->devs) {
+			Py_DECREF(seq);
+			Py_DECREF(ra);
+			return PyErr_NoMemory();
+		}
+		ra->nr_devs = n;
+		for (i = 0; i < n; i++) {
+			if (!devname_converter(PySequence_Fast_GET_ITEM(seq, i), ra->devs[i].name)) {
+				Py_DECREF(seq);
+				Py_DECREF(ra);
+				return NULL;
+			}
+		}
+		Py_DECREF(seq);
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	ra->ioctl_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (ra->ioctl_fd < 0)
+		err = errno;
+	else
+		err = linkstats_open(&ra->links);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		errno = err;
+		PyErr_SetFromErrno(PyExc_IOError);
+		Py_DECREF(ra);
+		return NULL;
+	}
+	return (PyObject *)ra;
+}
+
+static PyObject *rings_dev_dict(const struct rings_dev *dev)
+{
+	PyObject *dict = PyDict_New();
+
+	if (dict &&
+	    (dict_set_steal(dict, "rx_pending", PyLong_FromUnsignedLong(dev->ring.rx_pending)) ||
+	     dict_set_steal(dict, "rx_max_pending",
+			    PyLong_FromUnsignedLong(dev->ring.rx_max_pending)) ||
+	     dict_set_steal(dict, "rx_drops", PyLong_FromUnsignedLongLong(dev->drops[RINGS_RX])) ||
+	     dict_set_steal(dict, "rx_advised", PyLong_FromUnsignedLong(dev->advice[RINGS_RX])) ||
+	     dict_set_steal(dict, "tx_pending", PyLong_FromUnsignedLong(dev->ring.tx_pending)) ||
+	     dict_set_steal(dict, "tx_max_pending",
+			    PyLong_FromUnsignedLong(dev->ring.tx_max_pending)) ||
+	     dict_set_steal(dict, "tx_drops", PyLong_FromUnsignedLongLong(dev->drops[RINGS_TX])) ||
+	     dict_set_steal(dict, "tx_advised", PyLong_FromUnsignedLong(dev->advice[RINGS_TX])) ||
+	     dict_set_steal(dict, "window", PyFloat_FromDouble(dev->window)) ||
+	     dict_set_steal(dict, "applied", PyBool_FromLong(dev->applied)) ||
+	     dict_set_steal(dict, "error", PyLong_FromLong(dev->err))))
+		Py_CLEAR(dict);
+	return dict;
+}
+
+static PyObject *rings_sample(PyRingAdvisor *self, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "apply", NULL };
+	PyObject *result, *key, *value;
+	struct rings_dev *devs = NULL;
+	uint32_t i, nr_devs = 0;
+	int apply = 0, err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i:sample", kwlist, &apply))
+		return NULL;
+
+	/* The advice is copied out, the objects are built without the lock */
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	if (self->ioctl_fd < 0)
+		err = EBADF;
+	else if (self->all)
+		err = rings_refresh(self);
+	for (i = 0; !err && i < self->nr_devs; i++)
+		rings_update(self, &self->devs[i], apply);
+	if (!err) {
+		nr_devs = self->nr_devs;
+		devs = malloc((nr_devs + 1) * sizeof(*devs));
+		if (devs)
+			memcpy(devs, self->devs, nr_devs * sizeof(*devs));
+		else
+			err = ENOMEM;
+	}
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	if (err == ENOMEM)
+		return PyErr_NoMemory();
+	if (err) {
+		errno = err;
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+
+	result = PyDict_New();
+	for (i = 0; result && i < nr_devs; i++) {
+		if (!devs[i].valid)
+			continue;
+		key = PyBytes_FromString(devs[i].name);
+		value = rings_dev_dict(&devs[i]);
+		if (!key || !value || PyDict_SetItem(result, key, value) < 0)
+			Py_CLEAR(result);
+		Py_XDECREF(key);
+		Py_XDECREF(value);
+	}
+	free(devs);
+	return result;
+}
+
+/**
+ * Reads an unsigned counter of a simulated sample
+ */
+static int rings_sample_value(PyObject *sample, const char *key, uint64_t *value)
+{
+	PyObject *obj = PyDict_GetItemString(sample, key);
+
+	if (!obj) {
+		PyErr_Format(PyExc_ValueError, "sample has no %s", key);
+		return -1;
+	}
+	if (!PyLong_Check(obj)
+#if PY_MAJOR_VERSION < 3
+	    && !PyInt_Check(obj)
+#endif
+	    ) {
+		PyErr_Format(PyExc_ValueError, "%s must be an integer", key);
+		return -1;
+	}
+#if PY_MAJOR_VERSION >= 3
+	*value = PyLong_AsUnsignedLongLongMask(obj);
+#else
+	*value = PyInt_AsUnsignedLongLongMask(obj);
+#endif
+	return 0;
+}
+
+static PyObject *rings_step(PyRingAdvisor *self, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "samples", "now", NULL };
+	static const char *keys[] = {
+		"rx_pending", "rx_max_pending", "rx_drops",
+		"tx_pending", "tx_max_pending", "tx_drops",
+	};
+	PyObject *samples, *key, *value, *result = NULL;
+	uint64_t (*values)[ARRAY_SIZE(keys)] = NULL, drops[RINGS_NR_DIRS], now_ns;
+	struct rings_dev *dev, *devs = NULL;
+	char devname[IFNAMSIZ];
+	double now = -1;
+	Py_ssize_t pos = 0;
+	char *given = NULL;
+	uint32_t i, k;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|d:step", kwlist,
+					 &PyDict_Type, &samples, &now))
+		return NULL;
+	now_ns = now >= 0 ? (uint64_t)(now * 1e9) : clock_now_ns(CLOCK_MONOTONIC);
+
+	given = calloc(self->nr_devs + 1, 1);
+	values = calloc(self->nr_devs + 1, sizeof(*values));
+	devs = calloc(self->nr_devs + 1, sizeof(*devs));
+	if (!given || !values || !devs) {
+		PyErr_NoMemory();
+		goto out;
+	}
+	while (PyDict_Next(samples, &pos, &key, &value)) {
+		if (!devname_converter(key, devname))
+			goto out;
+		for (i = 0; i < self->nr_devs; i++) {
+			if (strcmp(self->devs[i].name, devname) == 0)
+				break;
+		}
+		if (i == self->nr_devs) {
+			PyErr_Format(PyExc_ValueError, "%s is not advised on", devname);
+			goto out;
+		}
+		if (!PyDict_Check(value)) {
+			PyErr_SetString(PyExc_TypeError, "samples must map device names to dicts");
+			goto out;
+		}
+		for (k = 0; k < ARRAY_SIZE(keys); k++) {
+			if (rings_sample_value(value, keys[k], &values[i][k]) < 0)
+				goto out;
+		}
+		given[i] = 1;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	for (i = 0; i < self->nr_devs; i++) {
+		if (!given[i])
+			continue;
+		dev = &self->devs[i];
+		dev->applied = dev->err = 0;
+		dev->ring.rx_pending = values[i][0];
+		dev->ring.rx_max_pending = values[i][1];
+		dev->ring.tx_pending = values[i][3];
+		dev->ring.tx_max_pending = values[i][4];
+		drops[RINGS_RX] = values[i][2];
+		drops[RINGS_TX] = values[i][5];
+		rings_account(self, dev, drops, dev->prev_driver, now_ns);
+		devs[i] = *dev;
+	}
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	result = PyDict_New();
+	for (i = 0; result && i < self->nr_devs; i++) {
+		if (!given[i])
+			continue;
+		key = PyBytes_FromString(devs[i].name);
+		value = rings_dev_dict(&devs[i]);
+		if (!key || !value || PyDict_SetItem(result, key, value) < 0)
+			Py_CLEAR(result);
+		Py_XDECREF(key);
+		Py_XDECREF(value);
+	}
+ out:
+	free(given);
+	free(values);
+	free(devs);
+	return result;
+}
+
+static void rings_close(PyRingAdvisor *self)
+{
+	uint32_t i;
+
+	for (i = 0; i < self->nr_devs; i++)
+		rings_dev_free(&self->devs[i]);
+	linkstats_close(&self->links);
+	if (self->ioctl_fd >= 0)
+		close(self->ioctl_fd);
+	self->ioctl_fd = -1;
+}
+
+static PyObject *rings_close_method(PyRingAdvisor *self, PyObject *unused __unused)
+{
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	rings_close(self);
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+static void rings_dealloc(PyRingAdvisor *self)
+{
+	rings_close(self);
+	free(self->devs);
+	pthread_mutex_destroy(&self->lock);
+	PyObject_Del(self);
+}
+
+static PyMethodDef rings_methods[] = {
+	{"sample", (PyCFunction)rings_sample, METH_VARARGS | METH_KEYWORDS,
+	 "sample(apply=False)\n\n"
+	 "Samples the ring sizes and drop counters of the devices.  Returns "
+	 "{device: advice} for the devices with rings, with the current, "
+	 "maximum and advised sizes and the drops counted over 'window' "
+	 "seconds since the previous sample for both directions.  With "
+	 "apply=True the advised sizes are written to the devices not at them "
+	 "already."},
+	{"step", (PyCFunction)rings_step, METH_VARARGS | METH_KEYWORDS,
+	 "step(samples, now=None)\n\n"
+	 "Works out the advice from the {device: sample} samples taken at "
+	 "'now' seconds, e.g. from a simulation, instead of from the devices.  "
+	 "A sample has the rx_pending, rx_max_pending, tx_pending and "
+	 "tx_max_pending ring sizes and the rx_drops and tx_drops counters.  "
+	 "Returns the advice as sample() does, and never applies it."},
+	{"close", (PyCFunction)rings_close_method, METH_NOARGS,
+	 "Closes the sockets of the advisor."},
+	{NULL}
+};
+
+PyTypeObject PyRingAdvisor_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.RingAdvisor",
+	.tp_basicsize = sizeof(PyRingAdvisor),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)rings_dealloc,
+	.tp_methods = rings_methods,
+	.tp_doc = "Advises ring sizes from drop counters, see ethtool.ring_advisor()"
+};
@@ -0,0 +1,726 @@
+/* shm.c - Interface state published in shared memory
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * One process per host collects snapshots (see snapshot.c) and publishes
+ * them into a file, normally under /dev/shm, which any number of other
+ * processes map read-only.  The file holds a struct shm_header followed
+ * by the interface and address records of the latest snapshot.
+ *
+ * Updates are protected by a seqlock: the publisher makes header.seq odd
+ * while it rewrites the records and even again when done.  Readers copy
+ * the records out and retry if seq was odd or changed meanwhile, so
+ * reading needs neither locks nor system calls.  The file only grows;
+ * a reader remaps it when it sees a capacity beyond its mapping.
+ *
+ * An exclusive flock() on the file keeps a second publisher away.  The
+ * file is left behind when the publisher goes away, readers notice
+ * through the growing age of the last snapshot.
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netlink/netlink.h>
+
+#include "ethtool.h"
+#include "shm.h"
+#include "snapshot.h"
+#include "backend.h"
+
+#define SHM_MAGIC		"PYETHSHM"
+#define SHM_VERSION		1
+#define SHM_DIR			"/dev/shm/"
+#define SHM_MIN_SIZE		(64 * 1024)
+#define SHM_READ_RETRIES	100000	/* Before giving up on a stuck publisher */
+
+struct shm_header {
+	char	 magic[8];	/**< SHM_MAGIC */
+	uint32_t version;	/**< SHM_VERSION, bumped on incompatible changes */
+	uint32_t publisher_pid;
+
+	/* Everything below is only valid while seq is even and unchanged */
+	uint64_t seq;		/**< Odd while an update is in progress */
+	uint64_t generation;	/**< Number of snapshots published, 0 if none yet */
+	uint64_t timestamp_ns;	/**< CLOCK_REALTIME of the snapshot */
+	uint64_t capacity;	/**< Size of the file */
+	uint32_t header_size;	/**< Offset of the interface records */
+	uint32_t iface_size;	/**< Size of one interface record, may grow */
+	uint32_t addr_size;	/**< Size of one address record, may grow */
+	uint32_t nr_ifaces;
+	uint32_t nr_addrs;	/**< Address records follow the interface records */
+	uint32_t reserved;
+};
+
+/**
+ * The ethtool.Publisher object
+ */
+typedef struct {
+	PyObject_HEAD
+	pthread_mutex_t	  lock;		/**< Serialises publish() and close() */
+	int		  fd;		/**< -1 once closed */
+	int		  ioctl_fd;	/**< -1 unless collecting ETHTOOL settings */
+	int		  flags;	/**< SNAPSHOT_* */
+	struct nl_sock	  *sk;
+	struct shm_header *hdr;
+	size_t		  maplen;
+} PyPublisher;
+
+/**
+ * The ethtool.PublishedState object
+ */
+typedef struct {
+	PyObject_HEAD
+	pthread_rwlock_t  lock;		/**< Write locked while remapping */
+	int		  fd;		/**< -1 once closed */
+	struct shm_header *hdr;
+	size_t		  maplen;
+} PyPublishedState;
+
+#define SHM_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define SHM_STORE(field, v) __atomic_store_n(&(field), (v), __ATOMIC_RELAXED)
+
+static inline void shm_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Names without a slash are taken relative to /dev/shm
+ */
+static char *shm_path(const char *name)
+{
+	char *path;
+
+	if (strchr(name, '/'))
+		return strdup(name);
+
+	path = malloc(strlen(SHM_DIR) + strlen(name) + 1);
+	if (path)
+		sprintf(path, "%s%s", SHM_DIR, name);
+	return path;
+}
+
+static size_t shm_round_size(uint64_t size)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+
+	if (size < SHM_MIN_SIZE)
+		size = SHM_MIN_SIZE;
+	return (size + page - 1) / page * page;
+}
+
+/*
+ *
+ *   Publisher
+ *
+ */
+
+static int publisher_init_file(PyPublisher *self)
+{
+	struct shm_header *hdr;
+	struct stat st;
+	size_t len;
+
+	if (fstat(self->fd, &st) < 0)
+		return errno;
+
+	len = shm_round_size(st.st_size);
+	if ((size_t)st.st_size < len && ftruncate(self->fd, len) < 0)
+		return errno;
+
+	hdr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, self->fd, 0);
+	if (hdr == MAP_FAILED)
+		return errno;
+
+	/* Carry on with the generations of a previous publisher, unless the
+	 * file is new or of an unknown layout */
+	if (memcmp(hdr->magic, SHM_MAGIC, sizeof(hdr->magic)) != 0 ||
+	    hdr->version != SHM_VERSION) {
+		memset(hdr, 0, sizeof(*hdr));
+		hdr->version = SHM_VERSION;
+		memcpy(hdr->magic, SHM_MAGIC, sizeof(hdr->magic));
+	}
+	hdr->publisher_pid = getpid();
+
+	self->hdr = hdr;
+	self->maplen = len;
+	return 0;
+}
+
+/**
+ * Writes a snapshot into the shared memory file, growing it as needed.
+ * Called with self->lock held.
+ */
+static int publisher_write(PyPublisher *self, const struct snapshot *snap)
+{
+	struct shm_header *hdr = self->hdr;
+	uint32_t header_size = sizeof(*hdr);
+	uint64_t need, seq;
+	char *data;
+
+	need = header_size + (uint64_t)snap->nr_ifaces * sizeof(*snap->ifaces) +
+		(uint64_t)snap->nr_addrs * sizeof(*snap->addrs);
+
+	if (need > self->maplen) {
+		size_t len = shm_round_size(need + need / 2);
+		void *p;
+
+		if (ftruncate(self->fd, len) < 0)
+			return errno;
+		p = mremap(hdr, self->maplen, len, MREMAP_MAYMOVE);
+		if (p == MAP_FAILED)
+			return errno;
+		hdr = self->hdr = p;
+		self->maplen = len;
+	}
+
+	/* A publisher which died halfway through an update left seq odd */
+	seq = SHM_LOAD(hdr->seq);
+	seq += (seq & 1) ? 1 : 2;
+	SHM_STORE(hdr->seq, seq - 1);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	data = (char *)hdr + header_size;
+	memcpy(data, snap->ifaces, snap->nr_ifaces * sizeof(*snap->ifaces));
+	memcpy(data + snap->nr_ifaces * sizeof(*snap->ifaces), snap->addrs,
+	       snap->nr_addrs * sizeof(*snap->addrs));
+	SHM_STORE(hdr->generation, hdr->generation + 1);
+	SHM_STORE(hdr->timestamp_ns, snap->timestamp_ns);
+	SHM_STORE(hdr->capacity, self->maplen);
+	SHM_STORE(hdr->header_size, header_size);
+	SHM_STORE(hdr->iface_size, sizeof(*snap->ifaces));
+	SHM_STORE(hdr->addr_size, sizeof(*snap->addrs));
+	SHM_STORE(hdr->nr_ifaces, snap->nr_ifaces);
+	SHM_STORE(hdr->nr_addrs, snap->nr_addrs);
+
+	__atomic_store_n(&hdr->seq, seq, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/* Called with self->lock held, or from the destructor */
+static void publisher_close(PyPublisher *self)
+{
+	if (self->hdr)
+		munmap(self->hdr, self->maplen);
+	self->hdr = NULL;
+	if (self->sk) {
+		nl_close(self->sk);
+		nl_socket_free(self->sk);
+		self->sk = NULL;
+	}
+	if (self->ioctl_fd >= 0)
+		close(self->ioctl_fd);
+	self->ioctl_fd = -1;
+	if (self->fd >= 0)
+		close(self->fd);	/* Drops the flock() */
+	self->fd = -1;
+}
+
+static PyObject *publisher_error(int err)
+{
+	if (err < 0) {
+		PyErr_SetString(PyExc_OSError, nl_geterror(err));
+		return NULL;
+	}
+	errno = err;
+	return PyErr_SetFromErrno(PyExc_IOError);
+}
+
+/**
+ * ethtool.publisher(name, ethtool=True)
+ *
+ * @return Returns a new Publisher object owning the shared memory file
+ */
+PyObject *shm_publisher(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "name", "ethtool", NULL };
+	const char *name;
+	PyPublisher *pub;
+	int with_ethtool = 1, err = 0;
+	char *path;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|i:publisher", kwlist,
+					 &name, &with_ethtool))
+		return NULL;
+
+	path = shm_path(name);
+	if (!path)
+		return PyErr_NoMemory();
+
+	pub = PyObject_New(PyPublisher, &PyPublisher_Type);
+	if (!pub) {
+		free(path);
+		return NULL;
+	}
+	pthread_mutex_init(&pub->lock, NULL);
+	pub->fd = pub->ioctl_fd = -1;
+	pub->flags = with_ethtool ? SNAPSHOT_ETHTOOL : 0;
+	pub->sk = NULL;
+	pub->hdr = NULL;
+	pub->maplen = 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	pub->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (pub->fd < 0)
+		err = errno;
+	else if (flock(pub->fd, LOCK_EX | LOCK_NB) < 0)
+		err = errno;
+	else
+		err = publisher_init_file(pub);
+
+	if (!err && with_ethtool) {
+		pub->ioctl_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+		if (pub->ioctl_fd < 0)
+			err = errno;
+	}
+	if (!err) {
+		pub->sk = nl_socket_alloc();
+		if (!pub->sk)
+			err = ENOMEM;
+		else if ((err = nl_connect(pub->sk, NETLINK_ROUTE)) == 0)
+			backend_nl_setup(pub->sk);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		if (err == EWOULDBLOCK)
+			PyErr_Format(PyExc_IOError, "%s is already published by another process",
+				     path);
+		else
+			publisher_error(err);
+		free(path);
+		Py_DECREF(pub);
+		return NULL;
+	}
+	free(path);
+	return (PyObject *)pub;
+}
+
+static PyObject *publisher_publish(PyPublisher *self, PyObject *unused __unused)
+{
+	struct snapshot snap;
+	uint64_t generation = 0;
+	int err;
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	if (self->fd < 0) {
+		err = EBADF;
+	} else if ((err = snapshot_collect(&snap, self->sk, self->ioctl_fd, self->flags)) == 0) {
+		err = publisher_write(self, &snap);
+		generation = self->hdr->generation;
+		snapshot_free(&snap);
+	}
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	if (err)
+		return publisher_error(err);
+	return PyLong_FromUnsignedLongLong(generation);
+}
+
+static PyObject *publisher_close_method(PyPublisher *self, PyObject *unused __unused)
+{
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	publisher_close(self);
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+static void publisher_dealloc(PyPublisher *self)
+{
+	publisher_close(self);
+	pthread_mutex_destroy(&self->lock);
+	PyObject_Del(self);
+}
+
+static PyMethodDef publisher_methods[] = {
+	{"publish", (PyCFunction)publisher_publish, METH_NOARGS,
+	 "Collects the state of all interfaces and publishes it.  Returns the "
+	 "generation of the new snapshot."},
+	{"close", (PyCFunction)publisher_close_method, METH_NOARGS,
+	 "Stops publishing.  The file is kept, with the last snapshot."},
+	{NULL}
+};
+
+PyTypeObject PyPublisher_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.Publisher",
+	.tp_basicsize = sizeof(PyPublisher),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)publisher_dealloc,
+	.tp_methods = publisher_methods,
+	.tp_doc = "Publishes the interface state in shared memory, see ethtool.publisher()"
+};
+
+/*
+ *
+ *   Readers
+ *
+ */
+
+/**
+ * ethtool.open_published(name)
+ *
+ * @return Returns a new PublishedState object mapping the shared memory file
+ */
+PyObject *shm_open_published(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "name", NULL };
+	PyPublishedState *st;
+	const char *name;
+	struct stat sb;
+	char *path;
+	int err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s:open_published", kwlist, &name))
+		return NULL;
+
+	path = shm_path(name);
+	if (!path)
+		return PyErr_NoMemory();
+
+	st = PyObject_New(PyPublishedState, &PyPublishedState_Type);
+	if (!st) {
+		free(path);
+		return NULL;
+	}
+	pthread_rwlock_init(&st->lock, NULL);
+	st->hdr = NULL;
+	st->maplen = 0;
+
+	st->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (st->fd < 0 || fstat(st->fd, &sb) < 0) {
+		err = errno;
+	} else if ((size_t)sb.st_size < sizeof(struct shm_header)) {
+		err = EINVAL;
+	} else {
+		st->hdr = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, st->fd, 0);
+		if (st->hdr == MAP_FAILED) {
+			st->hdr = NULL;
+			err = errno;
+		} else {
+			st->maplen = sb.st_size;
+			if (memcmp(st->hdr->magic, SHM_MAGIC, sizeof(st->hdr->magic)) != 0)
+				err = EINVAL;
+		}
+	}
+
+	if (err) {
+		if (err == EINVAL)
+			PyErr_Format(PyExc_ValueError, "%s is not a published interface state",
+				     path);
+		else
+			PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
+		free(path);
+		Py_DECREF(st);
+		return NULL;
+	}
+	free(path);
+	return (PyObject *)st;
+}
+
+/**
+ * Maps the file again after the publisher grew it
+ */
+static int published_remap(PyPublishedState *self)
+{
+	struct stat sb;
+	void *p;
+	int err = 0;
+
+	pthread_rwlock_wrlock(&self->lock);
+	if (fstat(self->fd, &sb) < 0) {
+		err = errno;
+	} else if ((size_t)sb.st_size > self->maplen) {
+		p = mremap(self->hdr, self->maplen, sb.st_size, MREMAP_MAYMOVE);
+		if (p == MAP_FAILED) {
+			err = errno;
+		} else {
+			self->hdr = p;
+			self->maplen = sb.st_size;
+		}
+	}
+	pthread_rwlock_unlock(&self->lock);
+	return err;
+}
+
+/**
+ * Whether the records of a header lie within len bytes.  Each table is
+ * checked on its own, as their total size could wrap around.
+ */
+static int shm_tables_fit(const struct shm_header *h, uint64_t len)
+{
+	uint64_t left;
+
+	if (h->header_size > len)
+		return 0;
+	left = len - h->header_size;
+	if (h->nr_ifaces > left / h->iface_size)
+		return 0;
+	left -= (uint64_t)h->nr_ifaces * h->iface_size;
+	return h->nr_addrs <= left / h->addr_size;
+}
+
+/**
+ * Copies the records of the latest consistent snapshot out of the mapping.
+ * Does not make any system call unless the file grew.
+ *
+ * @return Returns 0 on success, EAGAIN if nothing has been published yet or
+ *         the publisher is stuck in an update, EINVAL if the layout is not
+ *         understood, or another errno.
+ */
+static int published_copy(PyPublishedState *self, struct snapshot *snap,
+			  uint64_t *generation, uint32_t *pid)
+{
+	uint32_t max_ifaces = 0, max_addrs = 0;
+	int tries, err = EAGAIN;
+
+	memset(snap, 0, sizeof(*snap));
+	for (tries = 0; tries < SHM_READ_RETRIES; tries++) {
+		struct shm_header *hdr, h;
+		const char *data;
+		uint64_t seq;
+		int remap = 0;
+		uint32_t i;
+
+		pthread_rwlock_rdlock(&self->lock);
+		hdr = self->hdr;
+		if (!hdr) {
+			pthread_rwlock_unlock(&self->lock);
+			err = EBADF;
+			break;
+		}
+		seq = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			pthread_rwlock_unlock(&self->lock);
+			shm_cpu_relax();
+			continue;
+		}
+
+		h.version = SHM_LOAD(hdr->version);
+		h.publisher_pid = SHM_LOAD(hdr->publisher_pid);
+		h.generation = SHM_LOAD(hdr->generation);
+		h.timestamp_ns = SHM_LOAD(hdr->timestamp_ns);
+		h.capacity = SHM_LOAD(hdr->capacity);
+		h.header_size = SHM_LOAD(hdr->header_size);
+		h.iface_size = SHM_LOAD(hdr->iface_size);
+		h.addr_size = SHM_LOAD(hdr->addr_size);
+		h.nr_ifaces = SHM_LOAD(hdr->nr_ifaces);
+		h.nr_addrs = SHM_LOAD(hdr->nr_addrs);
+
+		/* Nonsense read during an update is caught by the seq check below */
+		err = 0;
+		if (h.generation == 0) {
+			err = EAGAIN;
+		} else if (h.version != SHM_VERSION ||
+			   h.iface_size < sizeof(struct snapshot_iface) ||
+			   h.addr_size < sizeof(struct snapshot_addr)) {
+			err = EINVAL;
+		} else if (!shm_tables_fit(&h, self->maplen)) {
+			if (h.capacity > self->maplen)
+				remap = 1;
+			else
+				err = EINVAL;
+		} else if (h.nr_ifaces > max_ifaces || h.nr_addrs > max_addrs) {
+			/* Only grows, so retries do not allocate again */
+			snapshot_free(snap);
+			if (snapshot_alloc(snap, h.nr_ifaces, h.nr_addrs) != 0) {
+				err = ENOMEM;
+			} else {
+				max_ifaces = h.nr_ifaces;
+				max_addrs = h.nr_addrs;
+			}
+		}
+
+		if (!err && !remap) {
+			/* Newer publishers may append fields to the records */
+			data = (const char *)hdr + h.header_size;
+			for (i = 0; i < h.nr_ifaces; i++)
+				memcpy(&snap->ifaces[i], data + (size_t)i * h.iface_size,
+				       sizeof(*snap->ifaces));
+			data += (size_t)h.nr_ifaces * h.iface_size;
+			for (i = 0; i < h.nr_addrs; i++)
+				memcpy(&snap->addrs[i], data + (size_t)i * h.addr_size,
+				       sizeof(*snap->addrs));
+			snap->nr_ifaces = h.nr_ifaces;
+			snap->nr_addrs = h.nr_addrs;
+			snap->timestamp_ns = h.timestamp_ns;
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (SHM_LOAD(hdr->seq) != seq) {
+			pthread_rwlock_unlock(&self->lock);
+			err = EAGAIN;
+			continue;
+		}
+		pthread_rwlock_unlock(&self->lock);
+
+		if (remap) {
+			if ((err = published_remap(self)) != 0)
+				break;
+			continue;
+		}
+		if (err)
+			break;
+
+		*generation = h.generation;
+		*pid = h.publisher_pid;
+		return 0;
+	}
+
+	snapshot_free(snap);
+	return err;
+}
+
+static PyObject *published_error(int err)
+{
+	if (err == EINVAL) {
+		PyErr_SetString(PyExc_ValueError, "unsupported published state layout");
+		return NULL;
+	}
+	errno = err;
+	return PyErr_SetFromErrno(PyExc_IOError);
+}
+
+static PyObject *published_read(PyPublishedState *self, PyObject *unused __unused)
+{
+	struct snapshot snap;
+	struct timespec now;
+	uint64_t generation = 0;
+	uint32_t pid = 0;
+	PyObject *dict;
+	int err;
+
+	err = published_copy(self, &snap, &generation, &pid);
+	if (err)
+		return published_error(err);
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	dict = snapshot_to_python(&snap);
+	if (dict &&
+	    (dict_set_steal(dict, "generation", PyLong_FromUnsignedLongLong(generation)) ||
+	     dict_set_steal(dict, "publisher_pid", PyLong_FromLong(pid)) ||
+	     dict_set_steal(dict, "age",
+			    PyFloat_FromDouble(now.tv_sec + now.tv_nsec / 1e9 -
+					       snap.timestamp_ns / 1e9))))
+		Py_CLEAR(dict);
+	snapshot_free(&snap);
+	return dict;
+}
+
+static PyObject *published_snapshot(PyPublishedState *self, PyObject *unused __unused)
+{
+	struct snapshot snap;
+	uint64_t generation;
+	uint32_t pid;
+	int err;
+
+	err = published_copy(self, &snap, &generation, &pid);
+	if (err)
+		return published_error(err);
+	return snapshot_wrap(&snap);
+}
+
+static PyObject *published_get_generation(PyPublishedState *self, void *unused __unused)
+{
+	uint64_t generation = 0;
+	int closed;
+
+	pthread_rwlock_rdlock(&self->lock);
+	closed = !self->hdr;
+	if (!closed)
+		generation = __atomic_load_n(&self->hdr->generation, __ATOMIC_ACQUIRE);
+	pthread_rwlock_unlock(&self->lock);
+
+	if (closed) {
+		errno = EBADF;
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+	return PyLong_FromUnsignedLongLong(generation);
+}
+
+static void published_close(PyPublishedState *self)
+{
+	pthread_rwlock_wrlock(&self->lock);
+	if (self->hdr)
+		munmap(self->hdr, self->maplen);
+	self->hdr = NULL;
+	if (self->fd >= 0)
+		close(self->fd);
+	self->fd = -1;
+	pthread_rwlock_unlock(&self->lock);
+}
+
+static PyObject *published_close_method(PyPublishedState *self, PyObject *unused __unused)
+{
+	published_close(self);
+	Py_RETURN_NONE;
+}
+
+static void published_dealloc(PyPublishedState *self)
+{
+	published_close(self);
+	pthread_rwlock_destroy(&self->lock);
+	PyObject_Del(self);
+}
+
+static PyMethodDef published_methods[] = {
+	{"read", (PyCFunction)published_read, METH_NOARGS,
+	 "Returns the latest published snapshot as a dict with the interfaces "
+	 "keyed by name (\"interfaces\"), the collection time in seconds since "
+	 "the epoch (\"timestamp\"), how old it is in seconds (\"age\"), its "
+	 "\"generation\" and the \"publisher_pid\".  Raises IOError(EAGAIN) "
+	 "if nothing was published yet."},
+	{"snapshot", (PyCFunction)published_snapshot, METH_NOARGS,
+	 "Returns the latest published snapshot as an ethtool.Snapshot object, "
+	 "without converting it to Python objects."},
+	{"close", (PyCFunction)published_close_method, METH_NOARGS,
+	 "Unmaps the shared memory file."},
+	{NULL}
+};
+
+static PyGetSetDef published_getset[] = {
+	{"generation", (getter)published_get_generation, NULL,
+	 "Number of snapshots published so far, cheap to poll for changes", NULL},
+	{NULL}
+};
+
+PyTypeObject PyPublishedState_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.PublishedState",
+	.tp_basicsize = sizeof(PyPublishedState),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)published_dealloc,
+	.tp_methods = published_methods,
+	.tp_getset = published_getset,
+	.tp_doc = "Interface state published by another process, see ethtool.open_published()"
+};
@@ -0,0 +1,26 @@
+/* shm.h - Interface state published in shared memory
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _SHM_H
+#define _SHM_H
+
+#include <Python.h>
+
+extern PyTypeObject PyPublisher_Type;
+extern PyTypeObject PyPublishedState_Type;
+
+PyObject *shm_publisher(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *shm_open_published(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif
@@ -0,0 +1,1163 @@
+/* snapshot.c - Point in time copy of the interface state of the host
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * A snapshot costs one RTM_GETLINK and one RTM_GETADDR dump for the whole
+ * host, plus optionally a dozen ETHTOOL ioctls per interface, however
+ * many interfaces there are.  It is collected without the GIL into flat
+ * records which are only turned into Python objects on demand.
+ *
+ * Both the interfaces and the addresses are kept sorted by interface
+ * index, and the addresses of one interface by family, address and
+ * prefix length.  Two snapshots can thus be compared in a single merge
+ * pass, creating Python objects only for what differs.
+ */
+
+#include <Python.h>
+#include <bytesobject.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <linux/sockios.h>
+#include <netlink/netlink.h>
+#include <netlink/cache.h>
+#include <netlink/route/addr.h>
+#include <netlink/route/link.h>
+#include <netlink/route/rtnl.h>
+
+#include "ethtool.h"
+#include "snapshot.h"
+#include "backend.h"
+#include "stats.h"
+
+const char *snapshot_counter_names[SNAPSHOT_NR_COUNTERS] = {
+	[SNAPSHOT_RX_PACKETS] = "rx_packets",
+	[SNAPSHOT_TX_PACKETS] = "tx_packets",
+	[SNAPSHOT_RX_BYTES]   = "rx_bytes",
+	[SNAPSHOT_TX_BYTES]   = "tx_bytes",
+	[SNAPSHOT_RX_ERRORS]  = "rx_errors",
+	[SNAPSHOT_TX_ERRORS]  = "tx_errors",
+	[SNAPSHOT_RX_DROPPED] = "rx_dropped",
+	[SNAPSHOT_TX_DROPPED] = "tx_dropped",
+	[SNAPSHOT_MULTICAST]  = "multicast",
+	[SNAPSHOT_COLLISIONS] = "collisions",
+};
+
+const char *snapshot_feature_names[SNAPSHOT_NR_FEATURES] = {
+	[SNAPSHOT_RX_CSUM] = "rx-checksumming",
+	[SNAPSHOT_TX_CSUM] = "tx-checksumming",
+	[SNAPSHOT_SG]	   = "scatter-gather",
+	[SNAPSHOT_TSO]	   = "tcp-segmentation-offload",
+	[SNAPSHOT_UFO]	   = "udp-fragmentation-offload",
+	[SNAPSHOT_GSO]	   = "generic-segmentation-offload",
+	[SNAPSHOT_GRO]	   = "generic-receive-offload",
+	[SNAPSHOT_LRO]	   = "large-receive-offload",
+	[SNAPSHOT_RXVLAN]  = "rx-vlan-offload",
+	[SNAPSHOT_TXVLAN]  = "tx-vlan-offload",
+	[SNAPSHOT_NTUPLE]  = "ntuple-filters",
+	[SNAPSHOT_RXHASH]  = "receive-hashing",
+};
+
+/*
+ * The legacy ETHTOOL commands reporting the offloads, either as a boolean
+ * or as a bit of ETHTOOL_GFLAGS
+ */
+static const struct {
+	uint32_t cmd;
+	uint32_t flag;
+} snapshot_feature_cmds[SNAPSHOT_NR_FEATURES] = {
+	[SNAPSHOT_RX_CSUM] = { ETHTOOL_GRXCSUM, 0 },
+	[SNAPSHOT_TX_CSUM] = { ETHTOOL_GTXCSUM, 0 },
+	[SNAPSHOT_SG]	   = { ETHTOOL_GSG, 0 },
+	[SNAPSHOT_TSO]	   = { ETHTOOL_GTSO, 0 },
+	[SNAPSHOT_UFO]	   = { ETHTOOL_GUFO, 0 },
+	[SNAPSHOT_GSO]	   = { ETHTOOL_GGSO, 0 },
+	[SNAPSHOT_GRO]	   = { ETHTOOL_GGRO, 0 },
+	[SNAPSHOT_LRO]	   = { ETHTOOL_GFLAGS, ETH_FLAG_LRO },
+	[SNAPSHOT_RXVLAN]  = { ETHTOOL_GFLAGS, ETH_FLAG_RXVLAN },
+	[SNAPSHOT_TXVLAN]  = { ETHTOOL_GFLAGS, ETH_FLAG_TXVLAN },
+	[SNAPSHOT_NTUPLE]  = { ETHTOOL_GFLAGS, ETH_FLAG_NTUPLE },
+	[SNAPSHOT_RXHASH]  = { ETHTOOL_GFLAGS, ETH_FLAG_RXHASH },
+};
+
+static const rtnl_link_stat_id_t snapshot_counter_ids[SNAPSHOT_NR_COUNTERS] = {
+	[SNAPSHOT_RX_PACKETS] = RTNL_LINK_RX_PACKETS,
+	[SNAPSHOT_TX_PACKETS] = RTNL_LINK_TX_PACKETS,
+	[SNAPSHOT_RX_BYTES]   = RTNL_LINK_RX_BYTES,
+	[SNAPSHOT_TX_BYTES]   = RTNL_LINK_TX_BYTES,
+	[SNAPSHOT_RX_ERRORS]  = RTNL_LINK_RX_ERRORS,
+	[SNAPSHOT_TX_ERRORS]  = RTNL_LINK_TX_ERRORS,
+	[SNAPSHOT_RX_DROPPED] = RTNL_LINK_RX_DROPPED,
+	[SNAPSHOT_TX_DROPPED] = RTNL_LINK_TX_DROPPED,
+	[SNAPSHOT_MULTICAST]  = RTNL_LINK_MULTICAST,
+	[SNAPSHOT_COLLISIONS] = RTNL_LINK_COLLISIONS,
+};
+
+/**
+ * Allocates zeroed record arrays for a snapshot
+ *
+ * @return Returns 0 on success, otherwise ENOMEM
+ */
+int snapshot_alloc(struct snapshot *snap, uint32_t nr_ifaces, uint32_t nr_addrs)
+{
+	memset(snap, 0, sizeof(*snap));
+	snap->ifaces = calloc(nr_ifaces ? nr_ifaces : 1, sizeof(*snap->ifaces));
+	snap->addrs = calloc(nr_addrs ? nr_addrs : 1, sizeof(*snap->addrs));
+	if (!snap->ifaces || !snap->addrs) {
+		snapshot_free(snap);
+		return ENOMEM;
+	}
+	snap->nr_ifaces = nr_ifaces;
+	snap->nr_addrs = nr_addrs;
+	return 0;
+}
+
+void snapshot_free(struct snapshot *snap)
+{
+	free(snap->ifaces);
+	free(snap->addrs);
+	snap->ifaces = NULL;
+	snap->addrs = NULL;
+	snap->nr_ifaces = snap->nr_addrs = 0;
+}
+
+static int snapshot_cmp_iface(const void *a, const void *b)
+{
+	const struct snapshot_iface *x = a, *y = b;
+
+	return x->ifindex < y->ifindex ? -1 : x->ifindex > y->ifindex;
+}
+
+/**
+ * Orders the addresses of one interface
+ */
+static int snapshot_cmp_addr_key(const struct snapshot_addr *x, const struct snapshot_addr *y)
+{
+	int rc;
+
+	if (x->family != y->family)
+		return x->family < y->family ? -1 : 1;
+	if ((rc = memcmp(x->local, y->local, sizeof(x->local))) != 0)
+		return rc;
+	return x->prefixlen < y->prefixlen ? -1 : x->prefixlen > y->prefixlen;
+}
+
+static int snapshot_cmp_addr(const void *a, const void *b)
+{
+	const struct snapshot_addr *x = a, *y = b;
+
+	if (x->ifindex != y->ifindex)
+		return x->ifindex < y->ifindex ? -1 : 1;
+	return snapshot_cmp_addr_key(x, y);
+}
+
+static void snapshot_copy_addr(uint8_t *to, size_t size, struct nl_addr *addr)
+{
+	size_t len = nl_addr_get_len(addr);
+
+	memcpy(to, nl_addr_get_binary_addr(addr), len < size ? len : size);
+}
+
+static void snapshot_fill_iface(struct snapshot_iface *iface, struct rtnl_link *link)
+{
+	struct nl_addr *addr;
+	const char *name;
+	int i;
+
+	name = rtnl_link_get_name(link);
+	if (name)
+		strncpy(iface->name, name, IFNAMSIZ - 1);
+	iface->ifindex = rtnl_link_get_ifindex(link);
+	iface->flags = rtnl_link_get_flags(link);
+	iface->mtu = rtnl_link_get_mtu(link);
+	iface->txqlen = rtnl_link_get_txqlen(link);
+	iface->operstate = rtnl_link_get_operstate(link);
+
+	addr = rtnl_link_get_addr(link);
+	if (addr) {
+		iface->hwaddr_len = nl_addr_get_len(addr) < SNAPSHOT_HWADDR_LEN
+			? nl_addr_get_len(addr) : SNAPSHOT_HWADDR_LEN;
+		snapshot_copy_addr(iface->hwaddr, SNAPSHOT_HWADDR_LEN, addr);
+	}
+
+	for (i = 0; i < SNAPSHOT_NR_COUNTERS; i++)
+		iface->counters[i] = rtnl_link_get_stat(link, snapshot_counter_ids[i]);
+}
+
+static void snapshot_fill_addr(struct snapshot_addr *a, struct rtnl_addr *addr)
+{
+	struct nl_addr *nla;
+
+	a->ifindex = rtnl_addr_get_ifindex(addr);
+	a->family = rtnl_addr_get_family(addr);
+	a->prefixlen = rtnl_addr_get_prefixlen(addr);
+	a->scope = rtnl_addr_get_scope(addr);
+	if ((nla = rtnl_addr_get_local(addr)))
+		snapshot_copy_addr(a->local, sizeof(a->local), nla);
+	if ((nla = rtnl_addr_get_peer(addr))) {
+		a->has_peer = 1;
+		snapshot_copy_addr(a->peer, sizeof(a->peer), nla);
+	}
+	if (a->family == AF_INET && (nla = rtnl_addr_get_broadcast(addr))) {
+		a->has_broadcast = 1;
+		snapshot_copy_addr(a->broadcast, sizeof(a->broadcast), nla);
+	}
+}
+
+static int snapshot_ethtool(int fd, const struct snapshot_iface *iface,
+			    void *data, size_t size)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	memcpy(ifr.ifr_name, iface->name, IFNAMSIZ);
+	ifr.ifr_data = data;
+	return backend_ioctl(fd, SIOCETHTOOL, &ifr, size);
+}
+
+static void snapshot_drvinfo(int fd, struct snapshot_iface *iface)
+{
+	struct ethtool_drvinfo info;
+
+	memset(&info, 0, sizeof(info));
+	info.cmd = ETHTOOL_GDRVINFO;
+	if (snapshot_ethtool(fd, iface, &info, sizeof(info)) != 0)
+		return;
+
+	memcpy(iface->driver, info.driver, SNAPSHOT_DRVINFO_LEN);
+	memcpy(iface->version, info.version, SNAPSHOT_DRVINFO_LEN);
+	memcpy(iface->fw_version, info.fw_version, SNAPSHOT_DRVINFO_LEN);
+	memcpy(iface->bus_info, info.bus_info, SNAPSHOT_DRVINFO_LEN);
+	iface->valid |= SNAPSHOT_HAVE_DRVINFO;
+}
+
+/**
+ * Queries the offloads one by one, those the device does not report are
+ * left out of features_valid.
+ */
+static void snapshot_features(int fd, struct snapshot_iface *iface)
+{
+	struct ethtool_value eval;
+	uint32_t gflags = 0;
+	int i, have_gflags = -1;
+
+	for (i = 0; i < SNAPSHOT_NR_FEATURES; i++) {
+		int on;
+
+		if (snapshot_feature_cmds[i].flag) {
+			if (have_gflags < 0) {
+				eval.cmd = ETHTOOL_GFLAGS;
+				eval.data = 0;
+				have_gflags = snapshot_ethtool(fd, iface, &eval,
+							       sizeof(eval)) == 0;
+				gflags = eval.data;
+			}
+			if (!have_gflags)
+				continue;
+			on = (gflags & snapshot_feature_cmds[i].flag) != 0;
+		} else {
+			eval.cmd = snapshot_feature_cmds[i].cmd;
+			eval.data = 0;
+			if (snapshot_ethtool(fd, iface, &eval, sizeof(eval)) != 0)
+				continue;
+			on = eval.data != 0;
+		}
+
+		iface->features_valid |= 1U << i;
+		if (on)
+			iface->features |= 1U << i;
+	}
+	if (iface->features_valid)
+		iface->valid |= SNAPSHOT_HAVE_FEATURES;
+}
+
+/**
+ * Links the interfaces to their addresses.  Both arrays must be sorted by
+ * interface index.  Addresses of interfaces which appeared between the
+ * two dumps are left out.
+ */
+static void snapshot_link_addrs(struct snapshot *snap)
+{
+	uint32_t i, a = 0;
+
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		struct snapshot_iface *iface = &snap->ifaces[i];
+
+		while (a < snap->nr_addrs && snap->addrs[a].ifindex < iface->ifindex)
+			a++;
+		iface->first_addr = a;
+		while (a < snap->nr_addrs && snap->addrs[a].ifindex == iface->ifindex)
+			a++;
+		iface->nr_addrs = a - iface->first_addr;
+	}
+}
+
+/**
+ * Collects the state of all interfaces.  Does not need the GIL.
+ *
+ * @param snap  Snapshot to fill in, to be released with snapshot_free()
+ * @param sk    Connected NETLINK_ROUTE socket
+ * @param fd    AF_INET control socket, only used with SNAPSHOT_ETHTOOL
+ * @param flags SNAPSHOT_* flags
+ *
+ * @return Returns 0 on success, otherwise a positive errno or a negative
+ *         libnl error code.
+ */
+int snapshot_collect(struct snapshot *snap, struct nl_sock *sk, int fd, int flags)
+{
+	struct nl_cache *link_cache = NULL, *addr_cache = NULL;
+	struct nl_object *obj;
+	struct stats_scope scope;
+	struct timespec ts;
+	uint32_t i, n;
+	int err;
+
+	memset(snap, 0, sizeof(*snap));
+	stats_enter(&scope, STATS_SNAPSHOT);
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	if ((err = rtnl_link_alloc_cache(sk, AF_UNSPEC, &link_cache)) < 0 ||
+	    (err = rtnl_addr_alloc_cache(sk, &addr_cache)) < 0)
+		goto out;
+
+	/* Only IPv4 and IPv6 addresses are kept */
+	n = 0;
+	for (obj = nl_cache_get_first(addr_cache); obj; obj = nl_cache_get_next(obj)) {
+		int family = rtnl_addr_get_family((struct rtnl_addr *)obj);
+
+		if (family == AF_INET || family == AF_INET6)
+			n++;
+	}
+
+	if ((err = snapshot_alloc(snap, nl_cache_nitems(link_cache), n)) != 0)
+		goto out;
+	snap->timestamp_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+	i = 0;
+	for (obj = nl_cache_get_first(link_cache); obj && i < snap->nr_ifaces;
+	     obj = nl_cache_get_next(obj))
+		snapshot_fill_iface(&snap->ifaces[i++], (struct rtnl_link *)obj);
+	snap->nr_ifaces = i;
+
+	i = 0;
+	for (obj = nl_cache_get_first(addr_cache); obj && i < snap->nr_addrs;
+	     obj = nl_cache_get_next(obj)) {
+		int family = rtnl_addr_get_family((struct rtnl_addr *)obj);
+
+		if (family == AF_INET || family == AF_INET6)
+			snapshot_fill_addr(&snap->addrs[i++], (struct rtnl_addr *)obj);
+	}
+	snap->nr_addrs = i;
+
+	qsort(snap->ifaces, snap->nr_ifaces, sizeof(*snap->ifaces), snapshot_cmp_iface);
+	qsort(snap->addrs, snap->nr_addrs, sizeof(*snap->addrs), snapshot_cmp_addr);
+	snapshot_link_addrs(snap);
+
+	if (flags & SNAPSHOT_ETHTOOL) {
+		for (i = 0; i < snap->nr_ifaces; i++) {
+			struct snapshot_iface *iface = &snap->ifaces[i];
+
+			iface->coalesce.cmd = ETHTOOL_GCOALESCE;
+			if (snapshot_ethtool(fd, iface, &iface->coalesce,
+					     sizeof(iface->coalesce)) == 0)
+				iface->valid |= SNAPSHOT_HAVE_COALESCE;
+			else
+				memset(&iface->coalesce, 0, sizeof(iface->coalesce));
+
+			iface->ringparam.cmd = ETHTOOL_GRINGPARAM;
+			if (snapshot_ethtool(fd, iface, &iface->ringparam,
+					     sizeof(iface->ringparam)) == 0)
+				iface->valid |= SNAPSHOT_HAVE_RINGPARAM;
+			else
+				memset(&iface->ringparam, 0, sizeof(iface->ringparam));
+
+			snapshot_drvinfo(fd, iface);
+			snapshot_features(fd, iface);
+		}
+	}
+	err = 0;
+
+ out:
+	if (link_cache)
+		nl_cache_free(link_cache);
+	if (addr_cache)
+		nl_cache_free(addr_cache);
+	if (err)
+		snapshot_free(snap);
+	stats_leave(&scope);
+	return err;
+}
+
+static PyObject *snapshot_ip_string(int family, const uint8_t *addr)
+{
+	char buf[INET6_ADDRSTRLEN];
+
+	if (!inet_ntop(family, addr, buf, sizeof(buf)))
+		return PyErr_SetFromErrno(PyExc_RuntimeError);
+	return PyBytes_FromString(buf);
+}
+
+static PyObject *snapshot_addr_dict(const struct snapshot_addr *a)
+{
+	PyObject *dict = PyDict_New();
+	char scope[32];
+
+	if (!dict)
+		return NULL;
+
+	rtnl_scope2str(a->scope, scope, sizeof(scope));
+	if (dict_set_steal(dict, "family", PyLong_FromLong(a->family)) ||
+	    dict_set_steal(dict, "address", snapshot_ip_string(a->family, a->local)) ||
+	    dict_set_steal(dict, "netmask", PyLong_FromLong(a->prefixlen)) ||
+	    dict_set_steal(dict, "scope", PyBytes_FromString(scope)) ||
+	    (a->has_peer &&
+	     dict_set_steal(dict, "peer", snapshot_ip_string(a->family, a->peer))) ||
+	    (a->has_broadcast &&
+	     dict_set_steal(dict, "broadcast", snapshot_ip_string(AF_INET, a->broadcast)))) {
+		Py_DECREF(dict);
+		return NULL;
+	}
+	return dict;
+}
+
+static PyObject *snapshot_name(const struct snapshot_iface *iface)
+{
+	return PyBytes_FromStringAndSize(iface->name, strnlen(iface->name, IFNAMSIZ));
+}
+
+static PyObject *snapshot_drvinfo_string(const char *s)
+{
+	return PyBytes_FromStringAndSize(s, strnlen(s, SNAPSHOT_DRVINFO_LEN));
+}
+
+static PyObject *snapshot_drvinfo_dict(const struct snapshot_iface *iface)
+{
+	PyObject *dict = PyDict_New();
+
+	if (!dict)
+		return NULL;
+	if (dict_set_steal(dict, "driver", snapshot_drvinfo_string(iface->driver)) ||
+	    dict_set_steal(dict, "version", snapshot_drvinfo_string(iface->version)) ||
+	    dict_set_steal(dict, "fw_version", snapshot_drvinfo_string(iface->fw_version)) ||
+	    dict_set_steal(dict, "bus_info", snapshot_drvinfo_string(iface->bus_info))) {
+		Py_DECREF(dict);
+		return NULL;
+	}
+	return dict;
+}
+
+static PyObject *snapshot_features_dict(const struct snapshot_iface *iface)
+{
+	PyObject *dict = PyDict_New();
+	int i;
+
+	if (!dict)
+		return NULL;
+	for (i = 0; i < SNAPSHOT_NR_FEATURES; i++) {
+		if (!(iface->features_valid & (1U << i)))
+			continue;
+		if (PyDict_SetItemString(dict, snapshot_feature_names[i],
+					 (iface->features & (1U << i)) ? Py_True : Py_False)) {
+			Py_DECREF(dict);
+			return NULL;
+		}
+	}
+	return dict;
+}
+
+/* Interface settings which are reported by name, and compared by the diff */
+enum snapshot_field {
+	SNAPSHOT_NAME,
+	SNAPSHOT_FLAGS,
+	SNAPSHOT_MTU,
+	SNAPSHOT_TXQLEN,
+	SNAPSHOT_OPERSTATE,
+	SNAPSHOT_MAC_ADDRESS,
+	SNAPSHOT_COALESCE,
+	SNAPSHOT_RINGPARAM,
+	SNAPSHOT_DRVINFO,
+	SNAPSHOT_FEATURES,
+	SNAPSHOT_NR_FIELDS
+};
+
+static const char *snapshot_field_names[SNAPSHOT_NR_FIELDS] = {
+	[SNAPSHOT_NAME]	       = "name",
+	[SNAPSHOT_FLAGS]       = "flags",
+	[SNAPSHOT_MTU]	       = "mtu",
+	[SNAPSHOT_TXQLEN]      = "txqlen",
+	[SNAPSHOT_OPERSTATE]   = "operstate",
+	[SNAPSHOT_MAC_ADDRESS] = "mac_address",
+	[SNAPSHOT_COALESCE]    = "coalesce",
+	[SNAPSHOT_RINGPARAM]   = "ringparam",
+	[SNAPSHOT_DRVINFO]     = "drvinfo",
+	[SNAPSHOT_FEATURES]    = "features",
+};
+
+static int snapshot_field_equal(const struct snapshot_iface *a,
+				const struct snapshot_iface *b, enum snapshot_field field)
+{
+	uint16_t have;
+
+	switch (field) {
+	case SNAPSHOT_NAME:
+		return strncmp(a->name, b->name, IFNAMSIZ) == 0;
+	case SNAPSHOT_FLAGS:
+		return a->flags == b->flags;
+	case SNAPSHOT_MTU:
+		return a->mtu == b->mtu;
+	case SNAPSHOT_TXQLEN:
+		return a->txqlen == b->txqlen;
+	case SNAPSHOT_OPERSTATE:
+		return a->operstate == b->operstate;
+	case SNAPSHOT_MAC_ADDRESS:
+		return a->hwaddr_len == b->hwaddr_len &&
+			memcmp(a->hwaddr, b->hwaddr, a->hwaddr_len) == 0;
+	case SNAPSHOT_COALESCE:
+		have = SNAPSHOT_HAVE_COALESCE;
+		return (a->valid & have) == (b->valid & have) &&
+			memcmp(&a->coalesce, &b->coalesce, sizeof(a->coalesce)) == 0;
+	case SNAPSHOT_RINGPARAM:
+		have = SNAPSHOT_HAVE_RINGPARAM;
+		return (a->valid & have) == (b->valid & have) &&
+			memcmp(&a->ringparam, &b->ringparam, sizeof(a->ringparam)) == 0;
+	case SNAPSHOT_DRVINFO:
+		have = SNAPSHOT_HAVE_DRVINFO;
+		return (a->valid & have) == (b->valid & have) &&
+			strncmp(a->driver, b->driver, SNAPSHOT_DRVINFO_LEN) == 0 &&
+			strncmp(a->version, b->version, SNAPSHOT_DRVINFO_LEN) == 0 &&
+			strncmp(a->fw_version, b->fw_version, SNAPSHOT_DRVINFO_LEN) == 0 &&
+			strncmp(a->bus_info, b->bus_info, SNAPSHOT_DRVINFO_LEN) == 0;
+	case SNAPSHOT_FEATURES:
+		return a->features_valid == b->features_valid &&
+			(a->features & a->features_valid) == (b->features & b->features_valid);
+	case SNAPSHOT_NR_FIELDS:
+		break;
+	}
+	return 1;
+}
+
+/**
+ * @return Returns a new reference, Py_None for ETHTOOL settings the
+ *         device did not report, or NULL with a Python exception set.
+ */
+static PyObject *snapshot_field_value(const struct snapshot_iface *iface,
+				      enum snapshot_field field)
+{
+	char buf[3 * SNAPSHOT_HWADDR_LEN] = "", *p = buf;
+	int i;
+
+	switch (field) {
+	case SNAPSHOT_NAME:
+		return snapshot_name(iface);
+	case SNAPSHOT_FLAGS:
+		return PyLong_FromUnsignedLong(iface->flags);
+	case SNAPSHOT_MTU:
+		return PyLong_FromUnsignedLong(iface->mtu);
+	case SNAPSHOT_TXQLEN:
+		return PyLong_FromUnsignedLong(iface->txqlen);
+	case SNAPSHOT_OPERSTATE:
+		rtnl_link_operstate2str(iface->operstate, buf, sizeof(buf));
+		return PyBytes_FromString(buf);
+	case SNAPSHOT_MAC_ADDRESS:
+		for (i = 0; i < iface->hwaddr_len && i < SNAPSHOT_HWADDR_LEN; i++)
+			p += sprintf(p, i ? ":%02x" : "%02x", iface->hwaddr[i]);
+		return PyBytes_FromString(buf);
+	case SNAPSHOT_COALESCE:
+		if (!(iface->valid & SNAPSHOT_HAVE_COALESCE))
+			Py_RETURN_NONE;
+		return __struct_desc_create_dict(ethtool_coalesce_desc, ethtool_coalesce_desc_len,
+						 (void *)&iface->coalesce);
+	case SNAPSHOT_RINGPARAM:
+		if (!(iface->valid & SNAPSHOT_HAVE_RINGPARAM))
+			Py_RETURN_NONE;
+		return __struct_desc_create_dict(ethtool_ringparam_desc, ethtool_ringparam_desc_len,
+						 (void *)&iface->ringparam);
+	case SNAPSHOT_DRVINFO:
+		if (!(iface->valid & SNAPSHOT_HAVE_DRVINFO))
+			Py_RETURN_NONE;
+		return snapshot_drvinfo_dict(iface);
+	case SNAPSHOT_FEATURES:
+		if (!(iface->valid & SNAPSHOT_HAVE_FEATURES))
+			Py_RETURN_NONE;
+		return snapshot_features_dict(iface);
+	case SNAPSHOT_NR_FIELDS:
+		break;
+	}
+	Py_RETURN_NONE;
+}
+
+static PyObject *snapshot_iface_dict(const struct snapshot *snap,
+				     const struct snapshot_iface *iface)
+{
+	PyObject *dict, *counters = NULL, *addrs = NULL;
+	uint32_t i;
+
+	dict = PyDict_New();
+	counters = PyDict_New();
+	addrs = PyList_New(iface->nr_addrs);
+	if (!dict || !counters || !addrs)
+		goto error;
+
+	for (i = 0; i < SNAPSHOT_NR_COUNTERS; i++) {
+		if (dict_set_steal(counters, snapshot_counter_names[i],
+				   PyLong_FromUnsignedLongLong(iface->counters[i])))
+			goto error;
+	}
+	for (i = 0; i < iface->nr_addrs; i++) {
+		PyObject *a = snapshot_addr_dict(&snap->addrs[iface->first_addr + i]);
+
+		if (!a)
+			goto error;
+		PyList_SET_ITEM(addrs, i, a);
+	}
+
+	if (dict_set_steal(dict, "ifindex", PyLong_FromLong(iface->ifindex)) ||
+	    PyDict_SetItemString(dict, "counters", counters) ||
+	    PyDict_SetItemString(dict, "addresses", addrs))
+		goto error;
+
+	/* The ETHTOOL settings are left out when the device has none */
+	for (i = SNAPSHOT_FLAGS; i < SNAPSHOT_NR_FIELDS; i++) {
+		PyObject *value = snapshot_field_value(iface, i);
+
+		if (value == Py_None) {
+			Py_DECREF(value);
+			continue;
+		}
+		if (dict_set_steal(dict, snapshot_field_names[i], value))
+			goto error;
+	}
+
+	Py_DECREF(counters);
+	Py_DECREF(addrs);
+	return dict;
+
+ error:
+	Py_XDECREF(dict);
+	Py_XDECREF(counters);
+	Py_XDECREF(addrs);
+	return NULL;
+}
+
+/**
+ * Checks that the interfaces are sorted and only refer to existing
+ * addresses, snapshots from shared memory or decoded ones can't be
+ * trusted to be sane.
+ *
+ * @return Returns 0 if the snapshot can be used, otherwise -1 with a
+ *         Python exception set.
+ */
+static int snapshot_check(const struct snapshot *snap)
+{
+	uint32_t i;
+
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		const struct snapshot_iface *iface = &snap->ifaces[i];
+
+		if (iface->first_addr > snap->nr_addrs ||
+		    iface->nr_addrs > snap->nr_addrs - iface->first_addr ||
+		    iface->hwaddr_len > SNAPSHOT_HWADDR_LEN ||
+		    (i && iface->ifindex <= iface[-1].ifindex)) {
+			PyErr_SetString(PyExc_ValueError, "corrupted snapshot");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Converts a snapshot to Python objects
+ *
+ * @return Returns a dict with the collection time in seconds since the
+ *         epoch ("timestamp") and a dict of interface dicts keyed by name
+ *         ("interfaces"), or NULL with a Python exception set.
+ */
+PyObject *snapshot_to_python(const struct snapshot *snap)
+{
+	PyObject *dict, *ifaces;
+	uint32_t i;
+
+	if (snapshot_check(snap) < 0)
+		return NULL;
+
+	dict = PyDict_New();
+	ifaces = PyDict_New();
+	if (!dict || !ifaces)
+		goto error;
+
+	for (i = 0; i < snap->nr_ifaces; i++) {
+		const struct snapshot_iface *iface = &snap->ifaces[i];
+		PyObject *key, *value;
+		int rc;
+
+		key = snapshot_name(iface);
+		value = snapshot_iface_dict(snap, iface);
+		rc = (key && value) ? PyDict_SetItem(ifaces, key, value) : -1;
+		Py_XDECREF(key);
+		Py_XDECREF(value);
+		if (rc < 0)
+			goto error;
+	}
+
+	if (dict_set_steal(dict, "timestamp",
+			   PyFloat_FromDouble(snap->timestamp_ns / 1e9)) ||
+	    PyDict_SetItemString(dict, "interfaces", ifaces))
+		goto error;
+	Py_DECREF(ifaces);
+	return dict;
+
+ error:
+	Py_XDECREF(dict);
+	Py_XDECREF(ifaces);
+	return NULL;
+}
+
+/*
+ *
+ *   Snapshot diff
+ *
+ */
+
+struct snapshot_diff {
+	PyObject *added;		/**< list of names */
+	PyObject *removed;		/**< list of names */
+	PyObject *added_addrs;		/**< dict of address lists keyed by name */
+	PyObject *removed_addrs;	/**< dict of address lists keyed by name */
+	PyObject *changed;		/**< dict of {field: (old, new)} keyed by name */
+};
+
+static int snapshot_diff_list_append(PyObject *list, PyObject *item)
+{
+	int rc;
+
+	if (!item)
+		return -1;
+	rc = PyList_Append(list, item);
+	Py_DECREF(item);
+	return rc;
+}
+
+static int snapshot_diff_addr(PyObject *dict, const struct snapshot_iface *iface,
+			      const struct snapshot_addr *addr)
+{
+	PyObject *key, *list;
+	int rc = -1;
+
+	key = snapshot_name(iface);
+	if (!key)
+		return -1;
+
+	list = PyDict_GetItem(dict, key);
+	if (list) {
+		Py_INCREF(list);
+	} else {
+		list = PyList_New(0);
+		if (!list || PyDict_SetItem(dict, key, list) < 0)
+			goto out;
+	}
+	rc = snapshot_diff_list_append(list, snapshot_addr_dict(addr));
+
+ out:
+	Py_XDECREF(list);
+	Py_DECREF(key);
+	return rc;
+}
+
+/* Address records are the same if all but the interface index match */
+static int snapshot_addr_equal(const struct snapshot_addr *a, const struct snapshot_addr *b)
+{
+	size_t start = offsetof(struct snapshot_addr, family);
+
+	return memcmp((const char *)a + start, (const char *)b + start,
+		      sizeof(*a) - start) == 0;
+}
+
+/**
+ * Merges the sorted address lists of an interface present in both snapshots
+ */
+static int snapshot_diff_addrs(struct snapshot_diff *d,
+			       const struct snapshot *old, const struct snapshot_iface *oi,
+			       const struct snapshot *new, const struct snapshot_iface *ni)
+{
+	const struct snapshot_addr *oa = &old->addrs[oi->first_addr];
+	const struct snapshot_addr *na = &new->addrs[ni->first_addr];
+	uint32_t i = 0, j = 0;
+
+	while (i < oi->nr_addrs || j < ni->nr_addrs) {
+		int cmp;
+
+		if (i == oi->nr_addrs)
+			cmp = 1;
+		else if (j == ni->nr_addrs)
+			cmp = -1;
+		else
+			cmp = snapshot_cmp_addr_key(&oa[i], &na[j]);
+
+		if (cmp < 0) {
+			if (snapshot_diff_addr(d->removed_addrs, oi, &oa[i++]) < 0)
+				return -1;
+		} else if (cmp > 0) {
+			if (snapshot_diff_addr(d->added_addrs, ni, &na[j++]) < 0)
+				return -1;
+		} else {
+			/* Same address with e.g. another scope or broadcast */
+			if (!snapshot_addr_equal(&oa[i], &na[j]) &&
+			    (snapshot_diff_addr(d->removed_addrs, oi, &oa[i]) < 0 ||
+			     snapshot_diff_addr(d->added_addrs, ni, &na[j]) < 0))
+				return -1;
+			i++;
+			j++;
+		}
+	}
+	return 0;
+}
+
+static int snapshot_diff_iface(struct snapshot_diff *d,
+			       const struct snapshot *old, const struct snapshot_iface *oi,
+			       const struct snapshot *new, const struct snapshot_iface *ni)
+{
+	PyObject *changes = NULL, *key;
+	int f, rc = -1;
+
+	for (f = 0; f < SNAPSHOT_NR_FIELDS; f++) {
+		PyObject *pair;
+
+		if (snapshot_field_equal(oi, ni, f))
+			continue;
+		if (!changes && !(changes = PyDict_New()))
+			return -1;
+		pair = Py_BuildValue("(NN)", snapshot_field_value(oi, f),
+				     snapshot_field_value(ni, f));
+		if (dict_set_steal(changes, snapshot_field_names[f], pair) < 0)
+			goto out;
+	}
+
+	if (changes) {
+		key = snapshot_name(ni);
+		if (!key)
+			goto out;
+		rc = PyDict_SetItem(d->changed, key, changes);
+		Py_DECREF(key);
+		if (rc < 0)
+			goto out;
+	}
+	rc = snapshot_diff_addrs(d, old, oi, new, ni);
+
+ out:
+	Py_XDECREF(changes);
+	return rc;
+}
+
+/**
+ * Compares two snapshots in one pass over both, as both are sorted by
+ * interface index.  Interfaces are matched by index, so a renamed
+ * interface shows up as a changed "name".  Counters are not compared.
+ *
+ * @return Returns a dict of the differences, or NULL with a Python
+ *         exception set.
+ */
+static PyObject *snapshot_diff(const struct snapshot *old, const struct snapshot *new)
+{
+	struct snapshot_diff d;
+	PyObject *result = NULL;
+	uint32_t i = 0, j = 0;
+
+	if (snapshot_check(old) < 0 || snapshot_check(new) < 0)
+		return NULL;
+
+	d.added = PyList_New(0);
+	d.removed = PyList_New(0);
+	d.added_addrs = PyDict_New();
+	d.removed_addrs = PyDict_New();
+	d.changed = PyDict_New();
+	if (!d.added || !d.removed || !d.added_addrs || !d.removed_addrs || !d.changed)
+		goto out;
+
+	while (i < old->nr_ifaces || j < new->nr_ifaces) {
+		const struct snapshot_iface *oi = &old->ifaces[i], *ni = &new->ifaces[j];
+		int rc;
+
+		if (j == new->nr_ifaces || (i < old->nr_ifaces && oi->ifindex < ni->ifindex)) {
+			rc = snapshot_diff_list_append(d.removed, snapshot_name(oi));
+			i++;
+		} else if (i == old->nr_ifaces || oi->ifindex > ni->ifindex) {
+			rc = snapshot_diff_list_append(d.added, snapshot_name(ni));
+			j++;
+		} else {
+			rc = snapshot_diff_iface(&d, old, oi, new, ni);
+			i++;
+			j++;
+		}
+		if (rc < 0)
+			goto out;
+	}
+
+	result = Py_BuildValue("{sOsOsOsOsO}",
+			       "added_interfaces", d.added,
+			       "removed_interfaces", d.removed,
+			       "added_addresses", d.added_addrs,
+			       "removed_addresses", d.removed_addrs,
+			       "changed", d.changed);
+ out:
+	Py_XDECREF(d.added);
+	Py_XDECREF(d.removed);
+	Py_XDECREF(d.added_addrs);
+	Py_XDECREF(d.removed_addrs);
+	Py_XDECREF(d.changed);
+	return result;
+}
+
+/*
+ *
+ *   ethtool.Snapshot
+ *
+ */
+
+/**
+ * The ethtool.Snapshot object, keeping the records as they were collected,
+ * or pointing to them in the buffer they were decoded from.
+ */
+typedef struct {
+	PyObject_HEAD
+	struct snapshot snap;
+	int		borrowed;	/**< The records live in view */
+	Py_buffer	view;
+} PySnapshot;
+
+/**
+ * Wraps a snapshot into a Python object
+ *
+ * @param snap Snapshot whose records are taken over by the new object
+ *
+ * @return Returns a new ethtool.Snapshot object, or NULL with a Python
+ *         exception set, in which case the records are released.
+ */
+PyObject *snapshot_wrap(struct snapshot *snap)
+{
+	PySnapshot *obj;
+
+	if (snapshot_check(snap) < 0) {
+		snapshot_free(snap);
+		return NULL;
+	}
+
+	obj = PyObject_New(PySnapshot, &PySnapshot_Type);
+	if (!obj) {
+		snapshot_free(snap);
+		return NULL;
+	}
+	obj->snap = *snap;
+	obj->borrowed = 0;
+	memset(snap, 0, sizeof(*snap));
+	return (PyObject *)obj;
+}
+
+/**
+ * Collects a new snapshot on a transient NETLINK socket
+ *
+ * @param fd    AF_INET control socket, only used with SNAPSHOT_ETHTOOL
+ * @param flags SNAPSHOT_* flags
+ *
+ * @return Returns a new ethtool.Snapshot object, or NULL with a Python
+ *         exception set.
+ */
+PyObject *snapshot_take(int fd, int flags)
+{
+	struct snapshot snap;
+	struct nl_sock *sk;
+	int err;
+
+	Py_BEGIN_ALLOW_THREADS
+	sk = nl_socket_alloc();
+	if (!sk) {
+		err = ENOMEM;
+	} else if ((err = nl_connect(sk, NETLINK_ROUTE)) == 0) {
+		backend_nl_setup(sk);
+		err = snapshot_collect(&snap, sk, fd, flags);
+		nl_close(sk);
+	}
+	if (sk)
+		nl_socket_free(sk);
+	Py_END_ALLOW_THREADS
+
+	if (err < 0) {
+		PyErr_SetString(PyExc_OSError, nl_geterror(err));
+		return NULL;
+	}
+	if (err) {
+		errno = err;
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+	return snapshot_wrap(&snap);
+}
+
+/**
+ * ethtool.load_snapshot(data, copy=False)
+ *
+ * The records are used in place when data is a read-only buffer encoded
+ * on a host like this one, and suitably aligned, which a bytes object or
+ * a read-only mmap of a saved snapshot are with Python 3.
+ */
+PyObject *snapshot_load(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "data", "copy", NULL };
+	struct snapshot snap;
+	PySnapshot *obj;
+	PyObject *data;
+	Py_buffer view;
+	int copy = 0, rc;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|i:load_snapshot", kwlist,
+					 &data, &copy))
+		return NULL;
+	if (PyObject_GetBuffer(data, &view, PyBUF_SIMPLE) < 0)
+		return NULL;
+
+	/* Writable buffers could change under the checked records */
+	rc = snapshot_decode(view.buf, view.len, &snap, copy || !view.readonly);
+	if (rc < 0) {
+		PyBuffer_Release(&view);
+		if (rc == -ENOMEM)
+			return PyErr_NoMemory();
+		PyErr_SetString(PyExc_ValueError, snapshot_decode_error(rc));
+		return NULL;
+	}
+	if (rc == 0) {
+		PyBuffer_Release(&view);
+		return snapshot_wrap(&snap);
+	}
+
+	if (snapshot_check(&snap) < 0 ||
+	    !(obj = PyObject_New(PySnapshot, &PySnapshot_Type))) {
+		PyBuffer_Release(&view);
+		return NULL;
+	}
+	obj->snap = snap;
+	obj->borrowed = 1;
+	obj->view = view;
+	return (PyObject *)obj;
+}
+
+/**
+ * @return Returns the records of an ethtool.Snapshot object, which stay
+ *         valid while it is alive, or NULL with a Python exception set if
+ *         obj is something else.
+ */
+const struct snapshot *snapshot_records(PyObject *obj)
+{
+	if (!PyObject_TypeCheck(obj, &PySnapshot_Type)) {
+		PyErr_Format(PyExc_TypeError, "expected an ethtool.Snapshot, not %.200s",
+			     Py_TYPE(obj)->tp_name);
+		return NULL;
+	}
+	return &((PySnapshot *)obj)->snap;
+}
+
+static PyObject *snapshot_obj_to_dict(PySnapshot *self, PyObject *unused __unused)
+{
+	return snapshot_to_python(&self->snap);
+}
+
+static PyObject *snapshot_obj_diff(PySnapshot *self, PyObject *other)
+{
+	const struct snapshot *snap = snapshot_records(other);
+
+	return snap ? snapshot_diff(&self->snap, snap) : NULL;
+}
+
+static PyObject *snapshot_obj_to_bytes(PySnapshot *self, PyObject *unused __unused)
+{
+	PyObject *bytes;
+
+	bytes = PyBytes_FromStringAndSize(NULL, snapshot_encoded_size(&self->snap));
+	if (!bytes)
+		return NULL;
+	snapshot_encode(&self->snap, PyBytes_AS_STRING(bytes));
+	return bytes;
+}
+
+static PyObject *snapshot_obj_timestamp(PySnapshot *self, void *unused __unused)
+{
+	return PyFloat_FromDouble(self->snap.timestamp_ns / 1e9);
+}
+
+static PyObject *snapshot_obj_zero_copy(PySnapshot *self, void *unused __unused)
+{
+	return PyBool_FromLong(self->borrowed);
+}
+
+static Py_ssize_t snapshot_obj_len(PySnapshot *self)
+{
+	return self->snap.nr_ifaces;
+}
+
+static void snapshot_obj_dealloc(PySnapshot *self)
+{
+	if (self->borrowed)
+		PyBuffer_Release(&self->view);
+	else
+		snapshot_free(&self->snap);
+	PyObject_Del(self);
+}
+
+static PyMethodDef snapshot_obj_methods[] = {
+	{"to_dict", (PyCFunction)snapshot_obj_to_dict, METH_NOARGS,
+	 "Returns the snapshot as a dict with the collection time in seconds "
+	 "since the epoch (\"timestamp\") and a dict of interface dicts keyed "
+	 "by name (\"interfaces\")."},
+	{"diff", (PyCFunction)snapshot_obj_diff, METH_O,
+	 "diff(newer)\n"
+	 "Compares this snapshot to a newer one in time linear in their size.  "
+	 "Returns a dict with the names of the added and removed interfaces "
+	 "(\"added_interfaces\", \"removed_interfaces\"), the added and removed "
+	 "address dicts of the other interfaces keyed by name "
+	 "(\"added_addresses\", \"removed_addresses\"), and a dict of "
+	 "{field: (old, new)} keyed by name for the interfaces whose name, "
+	 "flags, mtu, txqlen, operstate, mac_address, coalesce, ringparam, "
+	 "drvinfo or features changed (\"changed\").  Interfaces are matched "
+	 "by index, counters are not compared."},
+	{"to_bytes", (PyCFunction)snapshot_obj_to_bytes, METH_NOARGS,
+	 "Returns the snapshot in a compact, versioned binary encoding, which "
+	 "ethtool.load_snapshot() turns back into a Snapshot on any host."},
+	{NULL}
+};
+
+static PyGetSetDef snapshot_obj_getset[] = {
+	{"timestamp", (getter)snapshot_obj_timestamp, NULL,
+	 "Collection time in seconds since the epoch", NULL},
+	{"zero_copy", (getter)snapshot_obj_zero_copy, NULL,
+	 "Whether the records are used in place in the buffer given to "
+	 "ethtool.load_snapshot()", NULL},
+	{NULL}
+};
+
+static PySequenceMethods snapshot_obj_as_sequence = {
+	.sq_length = (lenfunc)snapshot_obj_len,
+};
+
+PyTypeObject PySnapshot_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.Snapshot",
+	.tp_basicsize = sizeof(PySnapshot),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)snapshot_obj_dealloc,
+	.tp_as_sequence = &snapshot_obj_as_sequence,
+	.tp_methods = snapshot_obj_methods,
+	.tp_getset = snapshot_obj_getset,
+	.tp_doc = "State of all interfaces at one point in time, see ethtool.snapshot()"
+};
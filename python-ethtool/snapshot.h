@@ -0,0 +1,149 @@
+/* snapshot.h - Point in time copy of the interface state of the host
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <Python.h>
+#include <stdint.h>
+#include <net/if.h>
+
+#include "ethtool.h"
+
+struct nl_sock;
+
+/* Link counters kept for every interface, see snapshot_counter_names */
+enum snapshot_counter {
+	SNAPSHOT_RX_PACKETS,
+	SNAPSHOT_TX_PACKETS,
+	SNAPSHOT_RX_BYTES,
+	SNAPSHOT_TX_BYTES,
+	SNAPSHOT_RX_ERRORS,
+	SNAPSHOT_TX_ERRORS,
+	SNAPSHOT_RX_DROPPED,
+	SNAPSHOT_TX_DROPPED,
+	SNAPSHOT_MULTICAST,
+	SNAPSHOT_COLLISIONS,
+	SNAPSHOT_NR_COUNTERS
+};
+
+extern const char *snapshot_counter_names[SNAPSHOT_NR_COUNTERS];
+
+/* snapshot_iface.valid bits */
+#define SNAPSHOT_HAVE_COALESCE	0x0001
+#define SNAPSHOT_HAVE_RINGPARAM	0x0002
+#define SNAPSHOT_HAVE_DRVINFO	0x0004
+#define SNAPSHOT_HAVE_FEATURES	0x0008
+
+/* snapshot_collect() flags */
+#define SNAPSHOT_ETHTOOL	0x0001	/**< Also query the ETHTOOL settings */
+
+#define SNAPSHOT_HWADDR_LEN	32	/* MAX_ADDR_LEN */
+#define SNAPSHOT_DRVINFO_LEN	32
+
+/* Offloads kept in snapshot_iface.features, see snapshot_feature_names */
+enum snapshot_feature {
+	SNAPSHOT_RX_CSUM,
+	SNAPSHOT_TX_CSUM,
+	SNAPSHOT_SG,
+	SNAPSHOT_TSO,
+	SNAPSHOT_UFO,
+	SNAPSHOT_GSO,
+	SNAPSHOT_GRO,
+	SNAPSHOT_LRO,
+	SNAPSHOT_RXVLAN,
+	SNAPSHOT_TXVLAN,
+	SNAPSHOT_NTUPLE,
+	SNAPSHOT_RXHASH,
+	SNAPSHOT_NR_FEATURES
+};
+
+extern const char *snapshot_feature_names[SNAPSHOT_NR_FEATURES];
+
+/**
+ * One interface.  The records only hold plain data, so they can be copied
+ * around as they are, e.g. into shared memory.
+ */
+struct snapshot_iface {
+	char			 name[IFNAMSIZ];
+	int32_t			 ifindex;
+	uint32_t		 flags;
+	uint32_t		 mtu;
+	uint32_t		 txqlen;
+	uint8_t			 operstate;
+	uint8_t			 hwaddr_len;
+	uint16_t		 valid;		/**< SNAPSHOT_HAVE_* */
+	uint8_t			 hwaddr[SNAPSHOT_HWADDR_LEN];
+	uint32_t		 first_addr;	/**< Index of the first address of the interface */
+	uint32_t		 nr_addrs;
+	uint32_t		 reserved;	/**< Keeps counters aligned, always 0 */
+	uint64_t		 counters[SNAPSHOT_NR_COUNTERS];
+	struct ethtool_coalesce	 coalesce;
+	struct ethtool_ringparam ringparam;
+	uint32_t		 features;	/**< Bit per enabled snapshot_feature */
+	uint32_t		 features_valid; /**< Bit per snapshot_feature the device reported */
+	char			 driver[SNAPSHOT_DRVINFO_LEN];
+	char			 version[SNAPSHOT_DRVINFO_LEN];
+	char			 fw_version[SNAPSHOT_DRVINFO_LEN];
+	char			 bus_info[SNAPSHOT_DRVINFO_LEN];
+};
+
+/**
+ * One IPv4 or IPv6 address
+ */
+struct snapshot_addr {
+	int32_t	ifindex;
+	uint8_t	family;
+	uint8_t	prefixlen;
+	uint8_t	scope;
+	uint8_t	has_peer;
+	uint8_t	has_broadcast;
+	uint8_t	reserved[7];
+	uint8_t	local[16];
+	uint8_t	peer[16];
+	uint8_t	broadcast[16];
+};
+
+/**
+ * The interfaces and the addresses are sorted by interface index, see
+ * snapshot.c.
+ */
+struct snapshot {
+	uint64_t	      timestamp_ns;	/**< CLOCK_REALTIME of the collection */
+	uint32_t	      nr_ifaces;
+	uint32_t	      nr_addrs;
+	struct snapshot_iface *ifaces;
+	struct snapshot_addr  *addrs;
+};
+
+extern PyTypeObject PySnapshot_Type;
+
+int snapshot_alloc(struct snapshot *snap, uint32_t nr_ifaces, uint32_t nr_addrs);
+int snapshot_collect(struct snapshot *snap, struct nl_sock *sk, int fd, int flags);
+void snapshot_free(struct snapshot *snap);
+PyObject *snapshot_to_python(const struct snapshot *snap);
+PyObject *snapshot_wrap(struct snapshot *snap);
+PyObject *snapshot_take(int fd, int flags);
+PyObject *snapshot_load(PyObject *self, PyObject *args, PyObject *kwds);
+const struct snapshot *snapshot_records(PyObject *obj);
+
+/* Binary encoding, see snapshot_codec.c */
+#define SNAPSHOT_FORMAT_VERSION	1
+
+size_t snapshot_encoded_size(const struct snapshot *snap);
+void snapshot_encode(const struct snapshot *snap, void *buf);
+int snapshot_decode(const void *data, size_t len, struct snapshot *snap, int copy);
+const char *snapshot_decode_error(int err);
+
+#endif
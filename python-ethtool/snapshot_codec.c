@@ -0,0 +1,241 @@
+/* snapshot_codec.c - Binary encoding of interface snapshots
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * An encoded snapshot is a header followed by the interface records and
+ * then the address records, exactly as they are kept in memory:
+ *
+ *   struct snapshot_blob   (header_size bytes)
+ *   nr_ifaces records      (iface_size bytes each)
+ *   nr_addrs records       (addr_size bytes each)
+ *
+ * The records are written in the byte order of the encoding host, which
+ * the header records.  A host with the same byte order and record sizes
+ * can thus use the records right where they are, without copying them,
+ * while other hosts swap them while copying.
+ *
+ * Compatible changes only append fields to the records, so the record
+ * sizes are part of the header.  Fields a decoder does not know about are
+ * skipped, fields missing from older encodings read as zero, which the
+ * snapshot_iface.valid bits are there for.  Anything else bumps
+ * SNAPSHOT_FORMAT_VERSION.
+ */
+
+#include <Python.h>
+
+#include <byteswap.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+
+#define SNAPSHOT_MAGIC		"PYETHSNP"
+#define SNAPSHOT_BYTE_ORDER	0x01020304
+
+struct snapshot_blob {
+	char	 magic[8];	/**< SNAPSHOT_MAGIC, not NUL terminated */
+	uint32_t byte_order;	/**< SNAPSHOT_BYTE_ORDER of the encoding host */
+	uint16_t version;	/**< SNAPSHOT_FORMAT_VERSION */
+	uint16_t header_size;	/**< Offset of the first interface record */
+	uint32_t iface_size;	/**< Size of one interface record, may grow */
+	uint32_t addr_size;	/**< Size of one address record, may grow */
+	uint32_t nr_ifaces;
+	uint32_t nr_addrs;
+	uint64_t timestamp_ns;
+};
+
+#define SNAPSHOT_END_OF(type, field) \
+	(offsetof(type, field) + sizeof(((type *)0)->field))
+
+/* The records as they were in version 1 of the format */
+#define SNAPSHOT_IFACE_SIZE_V1	SNAPSHOT_END_OF(struct snapshot_iface, bus_info)
+#define SNAPSHOT_ADDR_SIZE_V1	SNAPSHOT_END_OF(struct snapshot_addr, broadcast)
+
+/**
+ * @return Returns the number of bytes snapshot_encode() writes
+ */
+size_t snapshot_encoded_size(const struct snapshot *snap)
+{
+	return sizeof(struct snapshot_blob) +
+		(size_t)snap->nr_ifaces * sizeof(*snap->ifaces) +
+		(size_t)snap->nr_addrs * sizeof(*snap->addrs);
+}
+
+/**
+ * Encodes a snapshot.  Does not need the GIL.
+ *
+ * @param buf Receives snapshot_encoded_size() bytes
+ */
+void snapshot_encode(const struct snapshot *snap, void *buf)
+{
+	struct snapshot_blob hdr;
+	char *p = buf;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+	hdr.byte_order = SNAPSHOT_BYTE_ORDER;
+	hdr.version = SNAPSHOT_FORMAT_VERSION;
+	hdr.header_size = sizeof(hdr);
+	hdr.iface_size = sizeof(*snap->ifaces);
+	hdr.addr_size = sizeof(*snap->addrs);
+	hdr.nr_ifaces = snap->nr_ifaces;
+	hdr.nr_addrs = snap->nr_addrs;
+	hdr.timestamp_ns = snap->timestamp_ns;
+
+	memcpy(p, &hdr, sizeof(hdr));
+	p += sizeof(hdr);
+	memcpy(p, snap->ifaces, (size_t)snap->nr_ifaces * sizeof(*snap->ifaces));
+	p += (size_t)snap->nr_ifaces * sizeof(*snap->ifaces);
+	memcpy(p, snap->addrs, (size_t)snap->nr_addrs * sizeof(*snap->addrs));
+}
+
+static void snapshot_swap32(uint32_t *v, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		v[i] = bswap_32(v[i]);
+}
+
+/* The ethtool structs only have 32 bit fields */
+static void snapshot_swap_iface(struct snapshot_iface *iface)
+{
+	int i;
+
+	snapshot_swap32((uint32_t *)&iface->ifindex, 1);
+	snapshot_swap32(&iface->flags, 1);
+	snapshot_swap32(&iface->mtu, 1);
+	snapshot_swap32(&iface->txqlen, 1);
+	iface->valid = bswap_16(iface->valid);
+	snapshot_swap32(&iface->first_addr, 1);
+	snapshot_swap32(&iface->nr_addrs, 1);
+	for (i = 0; i < SNAPSHOT_NR_COUNTERS; i++)
+		iface->counters[i] = bswap_64(iface->counters[i]);
+	snapshot_swap32((uint32_t *)&iface->coalesce, sizeof(iface->coalesce) / 4);
+	snapshot_swap32((uint32_t *)&iface->ringparam, sizeof(iface->ringparam) / 4);
+	snapshot_swap32(&iface->features, 1);
+	snapshot_swap32(&iface->features_valid, 1);
+}
+
+/* Addresses are in network byte order already */
+static void snapshot_swap_addr(struct snapshot_addr *addr)
+{
+	snapshot_swap32((uint32_t *)&addr->ifindex, 1);
+}
+
+/**
+ * Decodes a snapshot.  Does not need the GIL.  The records are only
+ * checked to be complete, see snapshot_check() for their contents.
+ *
+ * @param data Encoded snapshot
+ * @param len  Size of data
+ * @param snap Receives the snapshot
+ * @param copy Whether the records must be copied even when they could be
+ *             used in place
+ *
+ * @return Returns 1 if snap points into data, which must then outlive it
+ *         and must not be released with snapshot_free(), 0 if snap holds
+ *         a copy, otherwise a negative errno for snapshot_decode_error().
+ */
+int snapshot_decode(const void *data, size_t len, struct snapshot *snap, int copy)
+{
+	const char *p = data;
+	struct snapshot_blob hdr;
+	size_t left;
+	uint32_t i;
+	int swap, err;
+
+	memset(snap, 0, sizeof(*snap));
+	if (len < sizeof(hdr))
+		return -EBADMSG;
+	memcpy(&hdr, p, sizeof(hdr));
+
+	if (memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic)) != 0)
+		return -EBADMSG;
+	if (hdr.byte_order == SNAPSHOT_BYTE_ORDER) {
+		swap = 0;
+	} else if (hdr.byte_order == bswap_32(SNAPSHOT_BYTE_ORDER)) {
+		swap = 1;
+		hdr.version = bswap_16(hdr.version);
+		hdr.header_size = bswap_16(hdr.header_size);
+		snapshot_swap32(&hdr.iface_size, 4);
+		hdr.timestamp_ns = bswap_64(hdr.timestamp_ns);
+	} else {
+		return -EBADMSG;
+	}
+	if (hdr.version != SNAPSHOT_FORMAT_VERSION)
+		return -EPROTONOSUPPORT;
+
+	if (hdr.header_size < sizeof(hdr) || hdr.header_size > len ||
+	    hdr.iface_size < SNAPSHOT_IFACE_SIZE_V1 ||
+	    hdr.addr_size < SNAPSHOT_ADDR_SIZE_V1)
+		return -EBADMSG;
+	/* Each table on its own, their total size could wrap around */
+	left = len - hdr.header_size;
+	if (hdr.nr_ifaces > left / hdr.iface_size)
+		return -EBADMSG;
+	left -= (size_t)hdr.nr_ifaces * hdr.iface_size;
+	if (hdr.nr_addrs > left / hdr.addr_size)
+		return -EBADMSG;
+	p += hdr.header_size;
+
+	/* Both arrays are 8 byte aligned when the buffer is */
+	if (!copy && !swap &&
+	    hdr.header_size % 8 == 0 && ((uintptr_t)data % 8) == 0 &&
+	    hdr.iface_size == sizeof(*snap->ifaces) &&
+	    hdr.addr_size == sizeof(*snap->addrs)) {
+		snap->timestamp_ns = hdr.timestamp_ns;
+		snap->nr_ifaces = hdr.nr_ifaces;
+		snap->nr_addrs = hdr.nr_addrs;
+		snap->ifaces = (struct snapshot_iface *)p;
+		snap->addrs = (struct snapshot_addr *)(p + (size_t)hdr.nr_ifaces * hdr.iface_size);
+		return 1;
+	}
+
+	if ((err = snapshot_alloc(snap, hdr.nr_ifaces, hdr.nr_addrs)) != 0)
+		return -err;
+	snap->timestamp_ns = hdr.timestamp_ns;
+
+	for (i = 0; i < hdr.nr_ifaces; i++, p += hdr.iface_size) {
+		memcpy(&snap->ifaces[i], p, hdr.iface_size < sizeof(*snap->ifaces)
+		       ? hdr.iface_size : sizeof(*snap->ifaces));
+		if (swap)
+			snapshot_swap_iface(&snap->ifaces[i]);
+	}
+	for (i = 0; i < hdr.nr_addrs; i++, p += hdr.addr_size) {
+		memcpy(&snap->addrs[i], p, hdr.addr_size < sizeof(*snap->addrs)
+		       ? hdr.addr_size : sizeof(*snap->addrs));
+		if (swap)
+			snapshot_swap_addr(&snap->addrs[i]);
+	}
+	return 0;
+}
+
+/**
+ * @return Returns a description of a snapshot_decode() error
+ */
+const char *snapshot_decode_error(int err)
+{
+	switch (err) {
+	case -EPROTONOSUPPORT:
+		return "unsupported snapshot format version";
+	case -ENOMEM:
+		return "out of memory";
+	default:
+		return "not an encoded ethtool snapshot, or a truncated one";
+	}
+}
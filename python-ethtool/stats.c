@@ -0,0 +1,350 @@
+/* stats.c - Always-on per-thread instrumentation counters
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Every thread entering an instrumented code path gets its own set of
+ * counters, so updating them needs neither locks nor atomic
+ * read-modify-write instructions; relaxed stores are enough for the
+ * readers to never see torn values.  The threads are kept on a list which
+ * ethtool.stats() walks to sum them up.
+ *
+ * Counters are never written by anyone but their owner.  reset_stats()
+ * therefore does not clear them, it records a baseline which is
+ * subtracted when reporting.  When a thread exits, whatever it counted
+ * since the baseline is folded into stats_retired.
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+
+#include "ethtool.h"
+#include "stats.h"
+
+#define STATS_HIST_BUCKETS	40	/* Bucket i counts durations below 2^i ns */
+
+struct stats_counters {
+	uint64_t calls;
+	uint64_t ioctls;
+	uint64_t nl_messages;
+	uint64_t nl_bytes;
+	uint64_t time_ns;
+	uint64_t hist[STATS_HIST_BUCKETS];
+};
+
+struct stats_thread {
+	struct stats_counters cur[STATS_NR_SITES];	/**< Written by the owner only */
+	struct stats_counters base[STATS_NR_SITES];	/**< Baseline, under stats_lock */
+	int		      site;			/**< Innermost site, -1 if none */
+	struct stats_thread   *next;
+	struct stats_thread   *prev;
+};
+
+static const char *stats_site_names[STATS_NR_SITES] = {
+	[STATS_SEND_COMMAND]	  = "send_command",
+	[STATS_GET_HWADDR]	  = "get_hwaddr",
+	[STATS_GET_IPADDR]	  = "get_ipaddr",
+	[STATS_GET_FLAGS]	  = "get_flags",
+	[STATS_GET_NETMASK]	  = "get_netmask",
+	[STATS_GET_BROADCAST]	  = "get_broadcast",
+	[STATS_GET_MODULE]	  = "get_module",
+	[STATS_GET_BUSINFO]	  = "get_businfo",
+	[STATS_SET_DEVICE_INDEX]  = "set_device_index",
+	[STATS_ETHERINFO_LINK]	  = "get_etherinfo_link",
+	[STATS_ETHERINFO_ADDRESS] = "get_etherinfo_address",
+	[STATS_PARALLEL_QUERY]	  = "parallel_query",
+	[STATS_SNAPSHOT]	  = "snapshot",
+	[STATS_ITER_INTERFACES]	  = "iter_interfaces_info",
+	[STATS_RENDER_METRICS]	  = "render_metrics",
+};
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+static struct stats_thread *stats_threads;
+static struct stats_counters stats_retired[STATS_NR_SITES];
+static __thread struct stats_thread *stats_self;
+
+#define STATS_READ(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define STATS_ADD(field, n) \
+	__atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
+/**
+ * Adds what a thread counted since the last reset to the given totals.
+ * Called with stats_lock held.
+ */
+static void stats_accumulate(struct stats_counters *totals, struct stats_thread *t)
+{
+	int s, b;
+
+	for (s = 0; s < STATS_NR_SITES; s++) {
+		struct stats_counters *cur = &t->cur[s], *base = &t->base[s];
+
+		totals[s].calls += STATS_READ(cur->calls) - base->calls;
+		totals[s].ioctls += STATS_READ(cur->ioctls) - base->ioctls;
+		totals[s].nl_messages += STATS_READ(cur->nl_messages) - base->nl_messages;
+		totals[s].nl_bytes += STATS_READ(cur->nl_bytes) - base->nl_bytes;
+		totals[s].time_ns += STATS_READ(cur->time_ns) - base->time_ns;
+		for (b = 0; b < STATS_HIST_BUCKETS; b++)
+			totals[s].hist[b] += STATS_READ(cur->hist[b]) - base->hist[b];
+	}
+}
+
+static void stats_thread_exit(void *arg)
+{
+	struct stats_thread *t = arg;
+
+	pthread_mutex_lock(&stats_lock);
+	stats_accumulate(stats_retired, t);
+	if (t->prev)
+		t->prev->next = t->next;
+	else
+		stats_threads = t->next;
+	if (t->next)
+		t->next->prev = t->prev;
+	pthread_mutex_unlock(&stats_lock);
+	free(t);
+}
+
+static void stats_init(void)
+{
+	pthread_key_create(&stats_key, stats_thread_exit);
+}
+
+/**
+ * Returns the counters of the calling thread, registering it on first use
+ *
+ * @return Returns NULL if the counters could not be allocated, in which
+ *         case nothing is counted for this thread.
+ */
+static struct stats_thread *stats_thread(void)
+{
+	struct stats_thread *t = stats_self;
+
+	if (t)
+		return t;
+
+	pthread_once(&stats_once, stats_init);
+	t = calloc(1, sizeof(*t));
+	if (!t)
+		return NULL;
+	t->site = -1;
+
+	pthread_mutex_lock(&stats_lock);
+	t->next = stats_threads;
+	if (stats_threads)
+		stats_threads->prev = t;
+	stats_threads = t;
+	pthread_mutex_unlock(&stats_lock);
+
+	pthread_setspecific(stats_key, t);
+	stats_self = t;
+	return t;
+}
+
+/**
+ * Marks the start of an instrumented code path
+ *
+ * @param scope Activation record, to be passed to stats_leave()
+ * @param site  The code path being entered
+ */
+void stats_enter(struct stats_scope *scope, enum stats_site site)
+{
+	struct stats_thread *t = stats_thread();
+
+	scope->thread = t;
+	if (!t)
+		return;
+	scope->site = site;
+	scope->prev = t->site;
+	t->site = site;
+	scope->start = clock_now_ns(CLOCK_MONOTONIC);
+}
+
+/**
+ * Marks the end of an instrumented code path, accounting the call and
+ * the time spent since stats_enter()
+ *
+ * @param scope Activation record filled in by stats_enter()
+ */
+void stats_leave(struct stats_scope *scope)
+{
+	struct stats_thread *t = scope->thread;
+	struct stats_counters *c;
+	uint64_t ns;
+	int bucket;
+
+	if (!t)
+		return;
+
+	ns = clock_now_ns(CLOCK_MONOTONIC) - scope->start;
+	bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+	if (bucket >= STATS_HIST_BUCKETS)
+		bucket = STATS_HIST_BUCKETS - 1;
+
+	c = &t->cur[scope->site];
+	STATS_ADD(c->calls, 1);
+	STATS_ADD(c->time_ns, ns);
+	STATS_ADD(c->hist[bucket], 1);
+	t->site = scope->prev;
+}
+
+/**
+ * Accounts one ioctl to the current code path
+ */
+void stats_count_ioctl(void)
+{
+	struct stats_thread *t = stats_self;
+
+	if (t && t->site >= 0)
+		STATS_ADD(t->cur[t->site].ioctls, 1);
+}
+
+/**
+ * libnl NL_CB_MSG_IN callback, accounts every received NETLINK message
+ * to the current code path of the receiving thread
+ */
+int stats_nl_msg_in(struct nl_msg *msg, void *arg)
+{
+	struct stats_thread *t = stats_self;
+
+	if (t && t->site >= 0) {
+		STATS_ADD(t->cur[t->site].nl_messages, 1);
+		STATS_ADD(t->cur[t->site].nl_bytes, nlmsg_hdr(msg)->nlmsg_len);
+	}
+	return NL_OK;
+}
+
+static int stats_set_u64(PyObject *dict, const char *key, uint64_t value)
+{
+	PyObject *val = PyLong_FromUnsignedLongLong(value);
+	int rc;
+
+	if (!val)
+		return -1;
+	rc = PyDict_SetItemString(dict, key, val);
+	Py_DECREF(val);
+	return rc;
+}
+
+static PyObject *stats_site_dict(struct stats_counters *c)
+{
+	PyObject *dict, *hist;
+	int b;
+
+	dict = PyDict_New();
+	hist = PyDict_New();
+	if (!dict || !hist)
+		goto error;
+
+	if (stats_set_u64(dict, "calls", c->calls) < 0 ||
+	    stats_set_u64(dict, "ioctls", c->ioctls) < 0 ||
+	    stats_set_u64(dict, "netlink_messages", c->nl_messages) < 0 ||
+	    stats_set_u64(dict, "netlink_bytes", c->nl_bytes) < 0 ||
+	    stats_set_u64(dict, "time_ns", c->time_ns) < 0)
+		goto error;
+
+	/* Only the used buckets, keyed by their upper bound in ns */
+	for (b = 0; b < STATS_HIST_BUCKETS; b++) {
+		PyObject *key, *val;
+		int rc;
+
+		if (!c->hist[b])
+			continue;
+		key = PyLong_FromUnsignedLongLong(1ULL << b);
+		val = PyLong_FromUnsignedLongLong(c->hist[b]);
+		rc = (key && val) ? PyDict_SetItem(hist, key, val) : -1;
+		Py_XDECREF(key);
+		Py_XDECREF(val);
+		if (rc < 0)
+			goto error;
+	}
+	if (PyDict_SetItemString(dict, "histogram", hist) < 0)
+		goto error;
+	Py_DECREF(hist);
+	return dict;
+
+ error:
+	Py_XDECREF(dict);
+	Py_XDECREF(hist);
+	return NULL;
+}
+
+/**
+ * ethtool.stats(): counters of all threads since the last reset_stats()
+ *
+ * @return Returns a dict keyed by code path name
+ */
+PyObject *stats_get(PyObject *self __unused, PyObject *unused __unused)
+{
+	struct stats_counters totals[STATS_NR_SITES];
+	struct stats_thread *t;
+	PyObject *dict;
+	int s;
+
+	pthread_mutex_lock(&stats_lock);
+	memcpy(totals, stats_retired, sizeof(totals));
+	for (t = stats_threads; t; t = t->next)
+		stats_accumulate(totals, t);
+	pthread_mutex_unlock(&stats_lock);
+
+	dict = PyDict_New();
+	if (!dict)
+		return NULL;
+	for (s = 0; s < STATS_NR_SITES; s++) {
+		PyObject *site = stats_site_dict(&totals[s]);
+
+		if (!site || PyDict_SetItemString(dict, stats_site_names[s], site) < 0) {
+			Py_XDECREF(site);
+			Py_DECREF(dict);
+			return NULL;
+		}
+		Py_DECREF(site);
+	}
+	return dict;
+}
+
+/**
+ * ethtool.reset_stats(): starts counting from zero again
+ */
+PyObject *stats_reset(PyObject *self __unused, PyObject *unused __unused)
+{
+	struct stats_thread *t;
+	int s, b;
+
+	pthread_mutex_lock(&stats_lock);
+	memset(stats_retired, 0, sizeof(stats_retired));
+	for (t = stats_threads; t; t = t->next) {
+		for (s = 0; s < STATS_NR_SITES; s++) {
+			struct stats_counters *cur = &t->cur[s], *base = &t->base[s];
+
+			base->calls = STATS_READ(cur->calls);
+			base->ioctls = STATS_READ(cur->ioctls);
+			base->nl_messages = STATS_READ(cur->nl_messages);
+			base->nl_bytes = STATS_READ(cur->nl_bytes);
+			base->time_ns = STATS_READ(cur->time_ns);
+			for (b = 0; b < STATS_HIST_BUCKETS; b++)
+				base->hist[b] = STATS_READ(cur->hist[b]);
+		}
+	}
+	pthread_mutex_unlock(&stats_lock);
+
+	Py_RETURN_NONE;
+}
@@ -0,0 +1,66 @@
+/* stats.h - Always-on per-thread instrumentation counters
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <Python.h>
+#include <stdint.h>
+
+struct nl_msg;
+
+/**
+ * Instrumented code paths, reported by ethtool.stats() under the
+ * names listed in stats.c
+ */
+enum stats_site {
+	STATS_SEND_COMMAND,
+	STATS_GET_HWADDR,
+	STATS_GET_IPADDR,
+	STATS_GET_FLAGS,
+	STATS_GET_NETMASK,
+	STATS_GET_BROADCAST,
+	STATS_GET_MODULE,
+	STATS_GET_BUSINFO,
+	STATS_SET_DEVICE_INDEX,
+	STATS_ETHERINFO_LINK,
+	STATS_ETHERINFO_ADDRESS,
+	STATS_PARALLEL_QUERY,
+	STATS_SNAPSHOT,
+	STATS_ITER_INTERFACES,
+	STATS_RENDER_METRICS,
+	STATS_NR_SITES
+};
+
+/**
+ * One activation of an instrumented code path, lives on the stack of
+ * the instrumented function.  Sites may nest, ioctls and NETLINK messages
+ * are accounted to the innermost one while the time is inclusive.
+ */
+struct stats_scope {
+	struct stats_thread *thread;
+	uint64_t	    start;
+	int		    site;
+	int		    prev;
+};
+
+void stats_enter(struct stats_scope *scope, enum stats_site site);
+void stats_leave(struct stats_scope *scope);
+void stats_count_ioctl(void);
+int stats_nl_msg_in(struct nl_msg *msg, void *arg);
+
+PyObject *stats_get(PyObject *self, PyObject *unused);
+PyObject *stats_reset(PyObject *self, PyObject *unused);
+
+#endif
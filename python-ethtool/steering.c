@@ -0,0 +1,1056 @@
+/* steering.c - RPS, RFS and XPS queue steering
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * The software steering of a device lives in sysfs, one directory per
+ * queue:
+ *
+ *   /sys/class/net/<dev>/queues/rx-N/rps_cpus      CPU mask
+ *   /sys/class/net/<dev>/queues/rx-N/rps_flow_cnt  RFS flow table size
+ *   /sys/class/net/<dev>/queues/tx-N/xps_cpus      CPU mask
+ *
+ * plus the global RFS table size in /proc/sys/net/core/rps_sock_flow_entries.
+ *
+ * A QueueSteering object opens the queue directories once and the files
+ * in them on first use, then reads and writes them with pread() and
+ * pwrite() at offset 0, which makes sysfs show or store the attribute
+ * again.  CPU masks are converted from and to CPU numbers here, in the
+ * comma separated 32 bit words sysfs uses.
+ */
+
+#include <Python.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+
+#include "steering.h"
+#include "ethtool.h"
+
+#define STEER_BUF	(STEER_WORDS * 9 + 2)
+
+#define STEER_PROC_CORE	"/proc/sys/net/core"
+
+/**
+ * A sysfs attribute, opened on first use
+ */
+struct steer_file {
+	int fd;		/**< -1 until opened */
+	int writable;
+};
+
+/* Files of the queues */
+enum {
+	STEER_RPS_CPUS,
+	STEER_RPS_FLOW_CNT,
+	STEER_NR_RX_FILES
+};
+
+enum {
+	STEER_XPS_CPUS,
+	STEER_NR_TX_FILES
+};
+
+static const char *steer_rx_files[STEER_NR_RX_FILES] = { "rps_cpus", "rps_flow_cnt" };
+static const char *steer_tx_files[STEER_NR_TX_FILES] = { "xps_cpus" };
+
+struct steer_queue {
+	int		  dir_fd;	/**< queues/rx-N or queues/tx-N */
+	struct steer_file files[STEER_NR_RX_FILES];
+};
+
+/**
+ * The ethtool.QueueSteering object
+ */
+typedef struct {
+	PyObject_HEAD
+	pthread_mutex_t	   lock;	/**< Protects the file descriptors */
+	char		   devname[IFNAMSIZ];
+	int		   dev_fd;	/**< /sys/class/net/<dev> */
+	int		   core_fd;	/**< /proc/sys/net/core */
+	struct steer_file  flow_entries;
+	uint32_t	   nr_rx;
+	uint32_t	   nr_tx;
+	struct steer_queue *rx;
+	struct steer_queue *tx;
+} PyQueueSteering;
+
+/**
+ * Where a system call failed, for the exception raised
+ */
+struct steer_error {
+	int	    err;
+	char	    what;		/**< 'r' or 't' for a queue, 0 for the device */
+	uint32_t    queue;
+	const char *name;		/**< Relative to the device, or absolute */
+};
+
+void steer_mask_set(struct steer_mask *m, uint32_t cpu)
+{
+	m->w[cpu / 32] |= 1U << (cpu % 32);
+}
+
+int steer_mask_test(const struct steer_mask *m, uint32_t cpu)
+{
+	return (m->w[cpu / 32] >> (cpu % 32)) & 1;
+}
+
+/**
+ * Parses a mask as in "ff,00000000"
+ *
+ * @return Returns 0 on success, otherwise EINVAL
+ */
+int steer_parse_mask(const char *s, struct steer_mask *m)
+{
+	uint32_t groups[STEER_WORDS];
+	unsigned long v;
+	char *end;
+	int i, n = 0;
+
+	memset(m, 0, sizeof(*m));
+	for (;;) {
+		v = strtoul(s, &end, 16);
+		if (end == s || n == STEER_WORDS || v > 0xffffffffUL)
+			return EINVAL;
+		groups[n++] = v;
+		s = end;
+		if (*s != ',')
+			break;
+		s++;
+	}
+	if (*s && *s != '\n')
+		return EINVAL;
+	for (i = 0; i < n; i++)
+		m->w[i] = groups[n - 1 - i];
+	return 0;
+}
+
+/**
+ * Parses a list as in "0-7,16-23"
+ *
+ * @return Returns 0 on success, otherwise EINVAL
+ */
+int steer_parse_list(const char *s, struct steer_mask *m)
+{
+	unsigned long first, last;
+	char *end;
+
+	memset(m, 0, sizeof(*m));
+	while (*s && *s != '\n') {
+		first = last = strtoul(s, &end, 10);
+		if (end == s)
+			return EINVAL;
+		s = end;
+		if (*s == '-') {
+			last = strtoul(s + 1, &end, 10);
+			if (end == s + 1)
+				return EINVAL;
+			s = end;
+		}
+		if (last < first || last >= STEER_MAX_CPUS)
+			return EINVAL;
+		for (; first <= last; first++)
+			steer_mask_set(m, first);
+		if (*s == ',')
+			s++;
+		else if (*s && *s != '\n')
+			return EINVAL;
+	}
+	return 0;
+}
+
+/**
+ * Formats a mask the way sysfs takes it
+ *
+ * @param buf At least STEER_BUF bytes
+ *
+ * @return Returns the length of the text
+ */
+static size_t steer_format_mask(const struct steer_mask *m, char *buf)
+{
+	int top = STEER_WORDS - 1;
+	size_t len;
+
+	while (top > 0 && !m->w[top])
+		top--;
+	len = sprintf(buf, "%x", m->w[top]);
+	while (--top >= 0)
+		len += sprintf(buf + len, ",%08x", m->w[top]);
+	buf[len++] = '\n';
+	buf[len] = '\0';
+	return len;
+}
+
+int steer_mask_from_python(PyObject *obj, struct steer_mask *m)
+{
+	PyObject *iter, *item;
+	long cpu;
+
+	memset(m, 0, sizeof(*m));
+	iter = PyObject_GetIter(obj);
+	if (!iter)
+		return -1;
+	while ((item = PyIter_Next(iter)) != NULL) {
+		cpu = PyLong_AsLong(item);
+		Py_DECREF(item);
+		if (cpu == -1 && PyErr_Occurred())
+			break;
+		if (cpu < 0 || cpu >= STEER_MAX_CPUS) {
+			PyErr_Format(PyExc_ValueError, "CPU %ld out of range", cpu);
+			break;
+		}
+		steer_mask_set(m, cpu);
+	}
+	Py_DECREF(iter);
+	return PyErr_Occurred() ? -1 : 0;
+}
+
+/**
+ * @return Returns a sorted tuple of the CPU numbers in the mask
+ */
+PyObject *steer_mask_to_python(const struct steer_mask *m)
+{
+	PyObject *tuple, *cpu;
+	Py_ssize_t n = 0, i = 0;
+	uint32_t bit;
+
+	for (bit = 0; bit < STEER_MAX_CPUS; bit++)
+		n += steer_mask_test(m, bit);
+	tuple = PyTuple_New(n);
+	for (bit = 0; tuple && i < n; bit++) {
+		if (!steer_mask_test(m, bit))
+			continue;
+		cpu = PyLong_FromLong(bit);
+		if (!cpu) {
+			Py_CLEAR(tuple);
+			break;
+		}
+		PyTuple_SET_ITEM(tuple, i++, cpu);
+	}
+	return tuple;
+}
+
+/**
+ * Opens an attribute, read-only when it cannot be written and does not
+ * have to be
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int steer_open(int dir_fd, const char *name, struct steer_file *f, int write)
+{
+	int fd, writable = 1;
+
+	if (f->fd >= 0 && (f->writable || !write))
+		return 0;
+	fd = openat(dir_fd, name, O_RDWR | O_CLOEXEC);
+	if (fd < 0 && !write && (errno == EACCES || errno == EPERM)) {
+		fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+		writable = 0;
+	}
+	if (fd < 0)
+		return errno;
+	if (f->fd >= 0)
+		close(f->fd);
+	f->fd = fd;
+	f->writable = writable;
+	return 0;
+}
+
+static void steer_close_file(struct steer_file *f)
+{
+	if (f->fd >= 0)
+		close(f->fd);
+	f->fd = -1;
+}
+
+/**
+ * Reads an attribute into buf, NUL terminated
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int steer_read(int dir_fd, const char *name, struct steer_file *f, char *buf, size_t size)
+{
+	ssize_t n;
+	int err;
+
+	if ((err = steer_open(dir_fd, name, f, 0)) != 0)
+		return err;
+	n = pread(f->fd, buf, size - 1, 0);
+	if (n < 0)
+		return errno;
+	buf[n] = '\0';
+	return 0;
+}
+
+/**
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int steer_write(int dir_fd, const char *name, struct steer_file *f, const char *buf, size_t len)
+{
+	ssize_t n;
+	int err;
+
+	if ((err = steer_open(dir_fd, name, f, 1)) != 0)
+		return err;
+	n = pwrite(f->fd, buf, len, 0);
+	if (n < 0)
+		return errno;
+	return (size_t)n == len ? 0 : EIO;
+}
+
+static PyObject *steer_raise(PyQueueSteering *self, const struct steer_error *e)
+{
+	char path[IFNAMSIZ + 64];
+
+	if (e->name[0] == '/')
+		snprintf(path, sizeof(path), "%s", e->name);
+	else if (e->what)
+		snprintf(path, sizeof(path), "%s/queues/%cx-%u/%s", self->devname, e->what,
+			 e->queue, e->name);
+	else
+		snprintf(path, sizeof(path), "%s/%s", self->devname, e->name);
+	errno = e->err;
+	return PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
+}
+
+/**
+ * Opens the queue directories of kind 'r' or 't'
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int steer_open_queues(int queues_fd, char kind, uint32_t n, struct steer_queue *q)
+{
+	char name[32];
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		snprintf(name, sizeof(name), "%cx-%u", kind, i);
+		q[i].dir_fd = openat(queues_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (q[i].dir_fd < 0)
+			return errno;
+	}
+	return 0;
+}
+
+static void steer_init_queues(PyQueueSteering *self)
+{
+	uint32_t i;
+	int f;
+
+	for (i = 0; i < self->nr_rx; i++) {
+		self->rx[i].dir_fd = -1;
+		for (f = 0; f < STEER_NR_RX_FILES; f++)
+			self->rx[i].files[f].fd = -1;
+	}
+	for (i = 0; i < self->nr_tx; i++) {
+		self->tx[i].dir_fd = -1;
+		for (f = 0; f < STEER_NR_TX_FILES; f++)
+			self->tx[i].files[f].fd = -1;
+	}
+}
+
+/**
+ * Opens the directories of a device and counts its queues.  Does not need
+ * the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int steer_open_device(PyQueueSteering *self)
+{
+	char path[IFNAMSIZ + 32];
+	struct dirent *de;
+	unsigned int index;
+	char kind;
+	DIR *dir;
+	int fd, err = 0;
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s", self->devname);
+	self->dev_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (self->dev_fd < 0)
+		return errno;
+	self->core_fd = open(STEER_PROC_CORE, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (self->core_fd < 0)
+		return errno;
+
+	fd = openat(self->dev_fd, "queues", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return errno;
+	/* The queues are numbered from 0 without holes */
+	dir = fdopendir(dup(fd));
+	if (!dir) {
+		err = errno;
+		close(fd);
+		return err;
+	}
+	while ((de = readdir(dir)) != NULL) {
+		if (sscanf(de->d_name, "%cx-%u", &kind, &index) != 2)
+			continue;
+		if (kind == 'r' && index >= self->nr_rx)
+			self->nr_rx = index + 1;
+		else if (kind == 't' && index >= self->nr_tx)
+			self->nr_tx = index + 1;
+	}
+	closedir(dir);
+
+	self->rx = calloc(self->nr_rx + 1, sizeof(*self->rx));
+	self->tx = calloc(self->nr_tx + 1, sizeof(*self->tx));
+	if (!self->rx || !self->tx)
+		err = ENOMEM;
+	else
+		steer_init_queues(self);
+	if (!err)
+		err = steer_open_queues(fd, 'r', self->nr_rx, self->rx);
+	if (!err)
+		err = steer_open_queues(fd, 't', self->nr_tx, self->tx);
+	close(fd);
+	return err;
+}
+
+static void steer_close(PyQueueSteering *self)
+{
+	uint32_t i;
+	int f;
+
+	for (i = 0; self->rx && i < self->nr_rx; i++) {
+		for (f = 0; f < STEER_NR_RX_FILES; f++)
+			steer_close_file(&self->rx[i].files[f]);
+		if (self->rx[i].dir_fd >= 0)
+			close(self->rx[i].dir_fd);
+	}
+	for (i = 0; self->tx && i < self->nr_tx; i++) {
+		for (f = 0; f < STEER_NR_TX_FILES; f++)
+			steer_close_file(&self->tx[i].files[f]);
+		if (self->tx[i].dir_fd >= 0)
+			close(self->tx[i].dir_fd);
+	}
+	free(self->rx);
+	free(self->tx);
+	self->rx = self->tx = NULL;
+	self->nr_rx = self->nr_tx = 0;
+	steer_close_file(&self->flow_entries);
+	if (self->core_fd >= 0)
+		close(self->core_fd);
+	if (self->dev_fd >= 0)
+		close(self->dev_fd);
+	self->core_fd = self->dev_fd = -1;
+}
+
+/**
+ * ethtool.queue_steering(devname)
+ *
+ * @return Returns a new QueueSteering object
+ */
+PyObject *steer_new(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", NULL };
+	PyQueueSteering *qs;
+	char devname[IFNAMSIZ];
+	int err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&:queue_steering", kwlist,
+					 devname_converter, devname))
+		return NULL;
+	if (strlen(devname) >= IFNAMSIZ || strchr(devname, '/') || devname[0] == '.' ||
+	    !devname[0]) {
+		PyErr_Format(PyExc_ValueError, "Invalid device name '%s'", devname);
+		return NULL;
+	}
+
+	qs = PyObject_New(PyQueueSteering, &PyQueueSteering_Type);
+	if (!qs)
+		return NULL;
+	pthread_mutex_init(&qs->lock, NULL);
+	memset(qs->devname, 0, sizeof(qs->devname));
+	strcpy(qs->devname, devname);
+	qs->dev_fd = qs->core_fd = qs->flow_entries.fd = -1;
+	qs->nr_rx = qs->nr_tx = 0;
+	qs->rx = qs->tx = NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	err = steer_open_device(qs);
+	if (err)
+		steer_close(qs);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		errno = err;
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError, devname);
+		Py_DECREF(qs);
+		return NULL;
+	}
+	return (PyObject *)qs;
+}
+
+/**
+ * The settings of all queues, as read or to be written
+ */
+struct steer_settings {
+	struct steer_mask *rps_cpus;	/**< nr_rx of them */
+	uint32_t	  *rps_flow_cnt;
+	struct steer_mask *xps_cpus;	/**< nr_tx of them */
+	char		  *rx_have;	/**< STEER_HAVE_* bits per rx queue */
+	char		  *tx_have;
+};
+
+#define STEER_HAVE_CPUS		0x1
+#define STEER_HAVE_FLOW_CNT	0x2
+
+static int steer_settings_alloc(struct steer_settings *s, uint32_t nr_rx, uint32_t nr_tx)
+{
+	s->rps_cpus = calloc(nr_rx + 1, sizeof(*s->rps_cpus));
+	s->rps_flow_cnt = calloc(nr_rx + 1, sizeof(*s->rps_flow_cnt));
+	s->xps_cpus = calloc(nr_tx + 1, sizeof(*s->xps_cpus));
+	s->rx_have = calloc(nr_rx + 1, 1);
+	s->tx_have = calloc(nr_tx + 1, 1);
+	return s->rps_cpus && s->rps_flow_cnt && s->xps_cpus && s->rx_have && s->tx_have;
+}
+
+static void steer_settings_free(struct steer_settings *s)
+{
+	free(s->rps_cpus);
+	free(s->rps_flow_cnt);
+	free(s->xps_cpus);
+	free(s->rx_have);
+	free(s->tx_have);
+}
+
+/**
+ * Reads the settings of all queues.  Attributes the kernel does not have,
+ * e.g. xps_cpus of single queue devices, are left out.  Called with
+ * self->lock held, without the GIL.
+ */
+static void steer_read_all(PyQueueSteering *self, struct steer_settings *s, struct steer_error *e)
+{
+	char buf[STEER_BUF];
+	unsigned long cnt;
+	uint32_t i;
+
+	for (i = 0; i < self->nr_rx && !e->err; i++) {
+		struct steer_queue *q = &self->rx[i];
+
+		e->what = 'r';
+		e->queue = i;
+		e->name = steer_rx_files[STEER_RPS_CPUS];
+		e->err = steer_read(q->dir_fd, e->name, &q->files[STEER_RPS_CPUS], buf, sizeof(buf));
+		if (!e->err)
+			e->err = steer_parse_mask(buf, &s->rps_cpus[i]);
+		if (!e->err)
+			s->rx_have[i] |= STEER_HAVE_CPUS;
+		else if (e->err == ENOENT)
+			e->err = 0;
+		if (e->err)
+			break;
+
+		e->name = steer_rx_files[STEER_RPS_FLOW_CNT];
+		e->err = steer_read(q->dir_fd, e->name, &q->files[STEER_RPS_FLOW_CNT],
+				    buf, sizeof(buf));
+		if (!e->err) {
+			cnt = strtoul(buf, NULL, 10);
+			s->rps_flow_cnt[i] = cnt;
+			s->rx_have[i] |= STEER_HAVE_FLOW_CNT;
+		} else if (e->err == ENOENT) {
+			e->err = 0;
+		}
+	}
+	for (i = 0; i < self->nr_tx && !e->err; i++) {
+		struct steer_queue *q = &self->tx[i];
+
+		e->what = 't';
+		e->queue = i;
+		e->name = steer_tx_files[STEER_XPS_CPUS];
+		e->err = steer_read(q->dir_fd, e->name, &q->files[STEER_XPS_CPUS], buf, sizeof(buf));
+		if (!e->err)
+			e->err = steer_parse_mask(buf, &s->xps_cpus[i]);
+		if (!e->err)
+			s->tx_have[i] |= STEER_HAVE_CPUS;
+		else if (e->err == ENOENT)
+			e->err = 0;
+	}
+}
+
+/**
+ * Writes the settings marked in rx_have and tx_have, stopping at the first
+ * failure.  Called with self->lock held, without the GIL.
+ */
+static void steer_write_all(PyQueueSteering *self, const struct steer_settings *s,
+			    struct steer_error *e)
+{
+	char buf[STEER_BUF];
+	size_t len;
+	uint32_t i;
+
+	for (i = 0; i < self->nr_rx && !e->err; i++) {
+		struct steer_queue *q = &self->rx[i];
+
+		e->what = 'r';
+		e->queue = i;
+		if (s->rx_have[i] & STEER_HAVE_CPUS) {
+			e->name = steer_rx_files[STEER_RPS_CPUS];
+			len = steer_format_mask(&s->rps_cpus[i], buf);
+			e->err = steer_write(q->dir_fd, e->name, &q->files[STEER_RPS_CPUS], buf, len);
+		}
+		if (!e->err && (s->rx_have[i] & STEER_HAVE_FLOW_CNT)) {
+			e->name = steer_rx_files[STEER_RPS_FLOW_CNT];
+			len = sprintf(buf, "%u\n", s->rps_flow_cnt[i]);
+			e->err = steer_write(q->dir_fd, e->name, &q->files[STEER_RPS_FLOW_CNT],
+					     buf, len);
+		}
+	}
+	for (i = 0; i < self->nr_tx && !e->err; i++) {
+		struct steer_queue *q = &self->tx[i];
+
+		if (!(s->tx_have[i] & STEER_HAVE_CPUS))
+			continue;
+		e->what = 't';
+		e->queue = i;
+		e->name = steer_tx_files[STEER_XPS_CPUS];
+		len = steer_format_mask(&s->xps_cpus[i], buf);
+		e->err = steer_write(q->dir_fd, e->name, &q->files[STEER_XPS_CPUS], buf, len);
+	}
+}
+
+static PyObject *steer_list(uint32_t n, const char *have, int bit,
+			    PyObject *(*item)(const void *, uint32_t), const void *values)
+{
+	PyObject *list = PyList_New(n), *value;
+	uint32_t i;
+
+	for (i = 0; list && i < n; i++) {
+		if (have[i] & bit) {
+			value = item(values, i);
+		} else {
+			value = Py_None;
+			Py_INCREF(value);
+		}
+		if (!value)
+			Py_CLEAR(list);
+		else
+			PyList_SET_ITEM(list, i, value);
+	}
+	return list;
+}
+
+static PyObject *steer_cpus_item(const void *values, uint32_t i)
+{
+	return steer_mask_to_python(&((const struct steer_mask *)values)[i]);
+}
+
+static PyObject *steer_flow_cnt_item(const void *values, uint32_t i)
+{
+	return PyLong_FromUnsignedLong(((const uint32_t *)values)[i]);
+}
+
+static PyObject *steer_get(PyQueueSteering *self, PyObject *unused __unused)
+{
+	struct steer_settings s;
+	struct steer_error e = { 0 };
+	PyObject *dict;
+
+	/* close() only ever drops the queues, so they fit */
+	if (!steer_settings_alloc(&s, self->nr_rx, self->nr_tx)) {
+		steer_settings_free(&s);
+		return PyErr_NoMemory();
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	if (self->dev_fd < 0) {
+		e.err = EBADF;
+		e.name = "queues";
+	} else {
+		steer_read_all(self, &s, &e);
+	}
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	if (e.err) {
+		steer_settings_free(&s);
+		return steer_raise(self, &e);
+	}
+
+	dict = PyDict_New();
+	if (dict &&
+	    (dict_set_steal(dict, "rps_cpus", steer_list(self->nr_rx, s.rx_have, STEER_HAVE_CPUS,
+							steer_cpus_item, s.rps_cpus)) ||
+	     dict_set_steal(dict, "rps_flow_cnt", steer_list(self->nr_rx, s.rx_have,
+							    STEER_HAVE_FLOW_CNT,
+							    steer_flow_cnt_item,
+							    s.rps_flow_cnt)) ||
+	     dict_set_steal(dict, "xps_cpus", steer_list(self->nr_tx, s.tx_have, STEER_HAVE_CPUS,
+							steer_cpus_item, s.xps_cpus))))
+		Py_CLEAR(dict);
+	steer_settings_free(&s);
+	return dict;
+}
+
+/**
+ * Takes a sequence with a setting or None per queue
+ *
+ * @param counts Receives numbers rather than CPU sets into masks, or NULL
+ */
+static int steer_parse_queues(PyObject *obj, const char *what, uint32_t n, char *have,
+			      int bit, struct steer_mask *masks, uint32_t *counts)
+{
+	PyObject *seq, *item;
+	unsigned long cnt;
+	uint32_t i;
+	int rc = 0;
+
+	if (!obj || obj == Py_None)
+		return 0;
+	seq = PySequence_Fast(obj, "Settings must be sequences with an entry per queue");
+	if (!seq)
+		return -1;
+	if (PySequence_Fast_GET_SIZE(seq) != n) {
+		PyErr_Format(PyExc_ValueError, "%s needs an entry for each of the %u queues",
+			     what, n);
+		Py_DECREF(seq);
+		return -1;
+	}
+	for (i = 0; i < n && rc == 0; i++) {
+		item = PySequence_Fast_GET_ITEM(seq, i);
+		if (item == Py_None)
+			continue;
+		if (counts) {
+			cnt = PyLong_AsUnsignedLong(item);
+			if (PyErr_Occurred()) {
+				rc = -1;
+			} else if (cnt > UINT32_MAX) {
+				PyErr_Format(PyExc_ValueError, "%s out of range", what);
+				rc = -1;
+			}
+			counts[i] = cnt;
+		} else {
+			rc = steer_mask_from_python(item, &masks[i]);
+		}
+		have[i] |= bit;
+	}
+	Py_DECREF(seq);
+	return rc;
+}
+
+static PyObject *steer_commit(PyQueueSteering *self, struct steer_settings *s)
+{
+	struct steer_error e = { 0 };
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	if (self->dev_fd < 0) {
+		e.err = EBADF;
+		e.name = "queues";
+	} else {
+		steer_write_all(self, s, &e);
+	}
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	steer_settings_free(s);
+	if (e.err)
+		return steer_raise(self, &e);
+	Py_RETURN_NONE;
+}
+
+static PyObject *steer_set(PyQueueSteering *self, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "rps_cpus", "rps_flow_cnt", "xps_cpus", NULL };
+	PyObject *rps_cpus = NULL, *rps_flow_cnt = NULL, *xps_cpus = NULL;
+	struct steer_settings s;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOO:set", kwlist,
+					 &rps_cpus, &rps_flow_cnt, &xps_cpus))
+		return NULL;
+	if (!steer_settings_alloc(&s, self->nr_rx, self->nr_tx)) {
+		steer_settings_free(&s);
+		return PyErr_NoMemory();
+	}
+	if (steer_parse_queues(rps_cpus, "rps_cpus", self->nr_rx, s.rx_have,
+			       STEER_HAVE_CPUS, s.rps_cpus, NULL) < 0 ||
+	    steer_parse_queues(rps_flow_cnt, "rps_flow_cnt", self->nr_rx, s.rx_have,
+			       STEER_HAVE_FLOW_CNT, NULL, s.rps_flow_cnt) < 0 ||
+	    steer_parse_queues(xps_cpus, "xps_cpus", self->nr_tx, s.tx_have,
+			       STEER_HAVE_CPUS, s.xps_cpus, NULL) < 0) {
+		steer_settings_free(&s);
+		return NULL;
+	}
+	return steer_commit(self, &s);
+}
+
+/**
+ * Reads the CPUs of the NUMA node of the device, or all the online CPUs
+ * for devices without one
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int steer_local_cpus(PyQueueSteering *self, struct steer_mask *m, struct steer_error *e)
+{
+	struct steer_file f = { -1, 0 };
+	char buf[STEER_BUF];
+
+	e->name = "device/local_cpus";
+	e->err = steer_read(self->dev_fd, e->name, &f, buf, sizeof(buf));
+	steer_close_file(&f);
+	if (!e->err)
+		return e->err = steer_parse_mask(buf, m);
+	if (e->err != ENOENT)
+		return e->err;
+
+	e->name = "/sys/devices/system/cpu/online";
+	e->err = steer_read(AT_FDCWD, e->name, &f, buf, sizeof(buf));
+	steer_close_file(&f);
+	if (!e->err)
+		e->err = steer_parse_list(buf, m);
+	return e->err;
+}
+
+static PyObject *steer_spread(PyQueueSteering *self, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "cpus", "rps", "xps", NULL };
+	PyObject *cpus = NULL, *seq;
+	struct steer_settings s;
+	struct steer_error e = { 0 };
+	struct steer_mask local;
+	uint32_t *order = NULL, n = 0, i, bit;
+	int rps = 1, xps = 1;
+	long cpu;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Oii:spread", kwlist, &cpus, &rps, &xps))
+		return NULL;
+
+	if (cpus && cpus != Py_None) {
+		seq = PySequence_Fast(cpus, "cpus must be a sequence of CPU numbers");
+		if (!seq)
+			return NULL;
+		n = PySequence_Fast_GET_SIZE(seq);
+		order = calloc(n + 1, sizeof(*order));
+		for (i = 0; order && i < n; i++) {
+			cpu = PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i));
+			if (cpu == -1 && PyErr_Occurred())
+				break;
+			if (cpu < 0 || cpu >= STEER_MAX_CPUS) {
+				PyErr_Format(PyExc_ValueError, "CPU %ld out of range", cpu);
+				break;
+			}
+			order[i] = cpu;
+		}
+		Py_DECREF(seq);
+		if (!order)
+			return PyErr_NoMemory();
+		if (PyErr_Occurred()) {
+			free(order);
+			return NULL;
+		}
+	} else {
+		Py_BEGIN_ALLOW_THREADS
+		pthread_mutex_lock(&self->lock);
+		if (self->dev_fd < 0) {
+			e.err = EBADF;
+			e.name = "queues";
+		} else {
+			steer_local_cpus(self, &local, &e);
+		}
+		pthread_mutex_unlock(&self->lock);
+		Py_END_ALLOW_THREADS
+
+		if (e.err)
+			return steer_raise(self, &e);
+		order = calloc(STEER_MAX_CPUS, sizeof(*order));
+		if (!order)
+			return PyErr_NoMemory();
+		for (bit = 0; bit < STEER_MAX_CPUS; bit++) {
+			if (steer_mask_test(&local, bit))
+				order[n++] = bit;
+		}
+	}
+	if (n == 0) {
+		free(order);
+		PyErr_SetString(PyExc_ValueError, "No CPUs to spread the queues over");
+		return NULL;
+	}
+
+	if (!steer_settings_alloc(&s, self->nr_rx, self->nr_tx)) {
+		free(order);
+		steer_settings_free(&s);
+		return PyErr_NoMemory();
+	}
+	for (i = 0; rps && i < self->nr_rx; i++) {
+		steer_mask_set(&s.rps_cpus[i], order[i % n]);
+		s.rx_have[i] = STEER_HAVE_CPUS;
+	}
+	for (i = 0; xps && i < self->nr_tx; i++) {
+		steer_mask_set(&s.xps_cpus[i], order[i % n]);
+		s.tx_have[i] = STEER_HAVE_CPUS;
+	}
+	free(order);
+	return steer_commit(self, &s);
+}
+
+static PyObject *steer_close_method(PyQueueSteering *self, PyObject *unused __unused)
+{
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	steer_close(self);
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *steer_get_local_cpus(PyQueueSteering *self, void *unused __unused)
+{
+	struct steer_error e = { 0 };
+	struct steer_mask local;
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	if (self->dev_fd < 0) {
+		e.err = EBADF;
+		e.name = "device";
+	} else {
+		steer_local_cpus(self, &local, &e);
+	}
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	if (e.err)
+		return steer_raise(self, &e);
+	return steer_mask_to_python(&local);
+}
+
+static PyObject *steer_get_flow_entries(PyQueueSteering *self, void *unused __unused)
+{
+	struct steer_error e = { 0, 0, 0, "rps_sock_flow_entries" };
+	char buf[32];
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	if (self->core_fd < 0)
+		e.err = EBADF;
+	else
+		e.err = steer_read(self->core_fd, e.name, &self->flow_entries, buf, sizeof(buf));
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	if (e.err) {
+		errno = e.err;
+		return PyErr_SetFromErrnoWithFilename(PyExc_IOError,
+						      STEER_PROC_CORE "/rps_sock_flow_entries");
+	}
+	return PyLong_FromUnsignedLong(strtoul(buf, NULL, 10));
+}
+
+static int steer_set_flow_entries(PyQueueSteering *self, PyObject *value, void *unused __unused)
+{
+	unsigned long entries;
+	char buf[32];
+	size_t len;
+	int err;
+
+	if (!value) {
+		PyErr_SetString(PyExc_TypeError, "rps_sock_flow_entries cannot be deleted");
+		return -1;
+	}
+	entries = PyLong_AsUnsignedLong(value);
+	if (PyErr_Occurred())
+		return -1;
+	if (entries > UINT32_MAX) {
+		PyErr_SetString(PyExc_ValueError, "rps_sock_flow_entries out of range");
+		return -1;
+	}
+	len = sprintf(buf, "%lu\n", entries);
+
+	Py_BEGIN_ALLOW_THREADS
+	pthread_mutex_lock(&self->lock);
+	if (self->core_fd < 0)
+		err = EBADF;
+	else
+		err = steer_write(self->core_fd, "rps_sock_flow_entries", &self->flow_entries,
+				  buf, len);
+	pthread_mutex_unlock(&self->lock);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		errno = err;
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError,
+					       STEER_PROC_CORE "/rps_sock_flow_entries");
+		return -1;
+	}
+	return 0;
+}
+
+static PyObject *steer_get_rx_queues(PyQueueSteering *self, void *unused __unused)
+{
+	return PyLong_FromUnsignedLong(self->nr_rx);
+}
+
+static PyObject *steer_get_tx_queues(PyQueueSteering *self, void *unused __unused)
+{
+	return PyLong_FromUnsignedLong(self->nr_tx);
+}
+
+static void steer_dealloc(PyQueueSteering *self)
+{
+	steer_close(self);
+	pthread_mutex_destroy(&self->lock);
+	PyObject_Del(self);
+}
+
+static PyMethodDef steer_methods[] = {
+	{"get", (PyCFunction)steer_get, METH_NOARGS,
+	 "Returns {'rps_cpus': [...], 'rps_flow_cnt': [...], 'xps_cpus': [...]} "
+	 "with an entry per receive or transmit queue, the CPU sets being "
+	 "sorted tuples of CPU numbers.  Settings the kernel does not have for "
+	 "a queue are None."},
+	{"set", (PyCFunction)steer_set, METH_VARARGS | METH_KEYWORDS,
+	 "set(rps_cpus=None, rps_flow_cnt=None, xps_cpus=None)\n\n"
+	 "Writes the settings given as sequences with an entry per queue, "
+	 "CPU sets being iterables of CPU numbers.  Queues whose entry is None "
+	 "are left alone.  Stops at the first failure."},
+	{"spread", (PyCFunction)steer_spread, METH_VARARGS | METH_KEYWORDS,
+	 "spread(cpus=None, rps=True, xps=True)\n\n"
+	 "Steers queue N of each direction to CPU cpus[N % len(cpus)], cpus "
+	 "being the CPUs local to the NUMA node of the device by default."},
+	{"close", (PyCFunction)steer_close_method, METH_NOARGS,
+	 "Closes the directories and files of the device."},
+	{NULL}
+};
+
+static PyGetSetDef steer_getset[] = {
+	{"rx_queues", (getter)steer_get_rx_queues, NULL, "Number of receive queues", NULL},
+	{"tx_queues", (getter)steer_get_tx_queues, NULL, "Number of transmit queues", NULL},
+	{"local_cpus", (getter)steer_get_local_cpus, NULL,
+	 "The CPUs of the NUMA node of the device, or all the online CPUs", NULL},
+	{"rps_sock_flow_entries", (getter)steer_get_flow_entries,
+	 (setter)steer_set_flow_entries,
+	 "Size of the global RFS flow table, shared by all devices", NULL},
+	{NULL}
+};
+
+PyTypeObject PyQueueSteering_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "ethtool.QueueSteering",
+	.tp_basicsize = sizeof(PyQueueSteering),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor)steer_dealloc,
+	.tp_methods = steer_methods,
+	.tp_getset = steer_getset,
+	.tp_doc = "RPS, RFS and XPS settings of the queues of a device, see "
+	"ethtool.queue_steering()"
+};
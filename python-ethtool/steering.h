@@ -0,0 +1,42 @@
+/* steering.h - RPS, RFS and XPS queue steering
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _STEERING_H
+#define _STEERING_H
+
+#include <Python.h>
+#include <stdint.h>
+
+#define STEER_MAX_CPUS	8192	/* The largest NR_CPUS of the kernel */
+#define STEER_WORDS	(STEER_MAX_CPUS / 32)
+
+/**
+ * A set of CPUs
+ */
+struct steer_mask {
+	uint32_t w[STEER_WORDS];	/**< Least significant word first */
+};
+
+void steer_mask_set(struct steer_mask *m, uint32_t cpu);
+int steer_mask_test(const struct steer_mask *m, uint32_t cpu);
+int steer_parse_mask(const char *s, struct steer_mask *m);
+int steer_parse_list(const char *s, struct steer_mask *m);
+int steer_mask_from_python(PyObject *obj, struct steer_mask *m);
+PyObject *steer_mask_to_python(const struct steer_mask *m);
+
+extern PyTypeObject PyQueueSteering_Type;
+
+PyObject *steer_new(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif
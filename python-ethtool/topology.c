@@ -0,0 +1,489 @@
+/* topology.c - NUMA and PCIe placement of devices
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * The topology of a device is read in a single walk of sysfs, from the
+ * directory its device link resolves to up to the PCI root, each step
+ * opening ".." relative to the directory before:
+ *
+ *   /sys/devices/pci0000:3a/0000:3a:00.0/0000:3b:00.0/net/eth0
+ *                           bridge       device
+ *
+ * The first PCI device met is the one of the interface, the next ones are
+ * the bridges above it.  Devices on another bus, like virtio, take the
+ * PCI device above them.  The other functions of the same PCI slot are the
+ * sibling ports of the NIC.
+ *
+ * Topology does not change while a device exists, so it is cached by
+ * name and interface index.  Cached devices which were removed or renamed
+ * are dropped whenever a new one is added.
+ */
+
+#include <Python.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+
+#include "topology.h"
+#include "steering.h"
+#include "ethtool.h"
+
+#define TOPO_ADDR_LEN		16	/* "0000:3b:00.0" */
+#define TOPO_MAX_BRIDGES	16
+
+/**
+ * A PCIe link, widths and speeds are 0 when unknown
+ */
+struct topo_link {
+	double	 speed;		/**< GT/s */
+	double	 max_speed;
+	uint32_t width;
+	uint32_t max_width;
+};
+
+struct topo_pci {
+	char		 address[TOPO_ADDR_LEN];
+	int		 have_link;
+	struct topo_link link;
+};
+
+struct topo {
+	char		  name[IFNAMSIZ];
+	int		  ifindex;
+	int		  numa_node;	/**< -1 if none */
+	struct steer_mask local_cpus;
+	int		  have_pci;
+	struct topo_pci	  pci;
+	uint32_t	  nr_bridges;
+	struct topo_pci	  bridges[TOPO_MAX_BRIDGES];	/**< Nearest first */
+	uint32_t	  nr_siblings;
+	char		  (*siblings)[IFNAMSIZ];
+};
+
+static pthread_mutex_t topo_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct topo **topo_cache;
+static uint32_t topo_cache_len;
+
+/**
+ * Reads a small attribute relative to a directory
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int topo_read(int dir_fd, const char *name, char *buf, size_t size)
+{
+	ssize_t n;
+	int fd, err = 0;
+
+	fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return errno;
+	n = read(fd, buf, size - 1);
+	if (n < 0)
+		err = errno;
+	else
+		buf[n] = '\0';
+	close(fd);
+	return err;
+}
+
+static int topo_is_pci(int dir_fd)
+{
+	char target[PATH_MAX];
+	ssize_t n;
+
+	n = readlinkat(dir_fd, "subsystem", target, sizeof(target) - 1);
+	if (n < 0)
+		return 0;
+	target[n] = '\0';
+	n = strlen(target);
+	return n >= 4 && strcmp(target + n - 4, "/pci") == 0;
+}
+
+static void topo_read_link(int dir_fd, struct topo_pci *pci)
+{
+	char buf[64];
+
+	/* "8.0 GT/s PCIe", or "Unknown" */
+	if (topo_read(dir_fd, "current_link_speed", buf, sizeof(buf)) == 0) {
+		pci->have_link = 1;
+		pci->link.speed = strtod(buf, NULL);
+	}
+	if (topo_read(dir_fd, "max_link_speed", buf, sizeof(buf)) == 0)
+		pci->link.max_speed = strtod(buf, NULL);
+	if (topo_read(dir_fd, "current_link_width", buf, sizeof(buf)) == 0)
+		pci->link.width = strtoul(buf, NULL, 10);
+	if (topo_read(dir_fd, "max_link_width", buf, sizeof(buf)) == 0)
+		pci->link.max_width = strtoul(buf, NULL, 10);
+}
+
+/**
+ * Lists the interfaces of the other functions of the PCI slot of a device
+ *
+ * @param parent_fd Directory of the bridge above the device
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int topo_siblings(struct topo *t, int parent_fd)
+{
+	char (*names)[IFNAMSIZ];
+	struct dirent *de, *ne;
+	size_t slot_len;
+	uint32_t size = 0;
+	DIR *dir, *net;
+	int fd, err = 0;
+
+	/* "0000:3b:00." */
+	slot_len = strrchr(t->pci.address, '.') - t->pci.address + 1;
+	dir = fdopendir(dup(parent_fd));
+	if (!dir)
+		return errno;
+	while (!err && (de = readdir(dir)) != NULL) {
+		if (strncmp(de->d_name, t->pci.address, slot_len) != 0 ||
+		    strcmp(de->d_name, t->pci.address) == 0)
+			continue;
+		fd = openat(dirfd(dir), de->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+		net = fdopendir(openat(fd, "net", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+		close(fd);
+		if (!net)
+			continue;
+		while ((ne = readdir(net)) != NULL) {
+			if (ne->d_name[0] == '.' || strlen(ne->d_name) >= IFNAMSIZ)
+				continue;
+			if (t->nr_siblings == size) {
+				size = size ? size * 2 : 4;
+				names = realloc(t->siblings, size * sizeof(*names));
+				if (!names) {
+					err = ENOMEM;
+					break;
+				}
+				t->siblings = names;
+			}
+			strcpy(t->siblings[t->nr_siblings++], ne->d_name);
+		}
+		closedir(net);
+	}
+	closedir(dir);
+	return err;
+}
+
+/* Devices off any NUMA node are local to every online CPU */
+static int topo_online(struct topo *t, char *buf, size_t size)
+{
+	int err;
+
+	err = topo_read(AT_FDCWD, "/sys/devices/system/cpu/online", buf, size);
+	return err ? err : steer_parse_list(buf, &t->local_cpus);
+}
+
+/**
+ * Walks sysfs for the topology of a device.  Does not need the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int topo_walk(struct topo *t)
+{
+	char path[IFNAMSIZ + 32], real[PATH_MAX], buf[STEER_WORDS * 9 + 2], *slash;
+	int fd, parent, err = 0, pci;
+
+	t->numa_node = -1;
+	snprintf(path, sizeof(path), "/sys/class/net/%s/device", t->name);
+	if (!realpath(path, real)) {
+		/* Virtual devices have no device link */
+		return errno == ENOENT ? topo_online(t, buf, sizeof(buf)) : errno;
+	}
+
+	fd = open(real, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return errno;
+	while (!err) {
+		slash = strrchr(real, '/');
+		/* The root complex, like pci0000:3a, is not a PCI device */
+		if (!slash || strncmp(slash + 1, "pci", 3) == 0 || strcmp(real, "/sys/devices") == 0)
+			break;
+		pci = topo_is_pci(fd);
+		parent = openat(fd, "..", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (parent < 0) {
+			err = errno;
+			break;
+		}
+
+		if (pci && !t->have_pci) {
+			t->have_pci = 1;
+			snprintf(t->pci.address, TOPO_ADDR_LEN, "%s", slash + 1);
+			topo_read_link(fd, &t->pci);
+			if (topo_read(fd, "numa_node", buf, sizeof(buf)) == 0)
+				t->numa_node = strtol(buf, NULL, 10);
+			if (topo_read(fd, "local_cpulist", buf, sizeof(buf)) == 0)
+				err = steer_parse_list(buf, &t->local_cpus);
+			else
+				err = topo_online(t, buf, sizeof(buf));
+			if (!err && strrchr(t->pci.address, '.'))
+				err = topo_siblings(t, parent);
+		} else if (pci && t->nr_bridges < TOPO_MAX_BRIDGES) {
+			struct topo_pci *bridge = &t->bridges[t->nr_bridges++];
+
+			snprintf(bridge->address, TOPO_ADDR_LEN, "%s", slash + 1);
+			topo_read_link(fd, bridge);
+		}
+
+		close(fd);
+		fd = parent;
+		*slash = '\0';
+	}
+	close(fd);
+	if (!err && !t->have_pci)
+		err = topo_online(t, buf, sizeof(buf));
+	return err;
+}
+
+static void topo_free(struct topo *t)
+{
+	if (t)
+		free(t->siblings);
+	free(t);
+}
+
+/**
+ * Copies a cached topology, so it can be used once topo_lock is dropped
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int topo_copy(struct topo *copy, const struct topo *t)
+{
+	*copy = *t;
+	copy->siblings = NULL;
+	if (!t->nr_siblings)
+		return 0;
+	copy->siblings = malloc(t->nr_siblings * sizeof(*t->siblings));
+	if (!copy->siblings)
+		return ENOMEM;
+	memcpy(copy->siblings, t->siblings, t->nr_siblings * sizeof(*t->siblings));
+	return 0;
+}
+
+/**
+ * Looks a device up in the cache.  Called with topo_lock held.
+ *
+ * @return Returns the index of the device, or topo_cache_len if it is not
+ *         cached
+ */
+static uint32_t topo_find(const char *devname, int ifindex)
+{
+	uint32_t i;
+
+	for (i = 0; i < topo_cache_len; i++) {
+		if (topo_cache[i]->ifindex == ifindex && strcmp(topo_cache[i]->name, devname) == 0)
+			break;
+	}
+	return i;
+}
+
+/**
+ * Drops the cached devices which were removed or renamed since they were
+ * walked.  Called with topo_lock held.
+ */
+static void topo_prune(void)
+{
+	char name[IFNAMSIZ];
+	uint32_t i, n = 0;
+
+	for (i = 0; i < topo_cache_len; i++) {
+		if (if_indextoname(topo_cache[i]->ifindex, name) &&
+		    strcmp(name, topo_cache[i]->name) == 0)
+			topo_cache[n++] = topo_cache[i];
+		else
+			topo_free(topo_cache[i]);
+	}
+	topo_cache_len = n;
+}
+
+/**
+ * Finds the topology of a device in the cache, or walks sysfs for it.
+ * The walk runs without topo_lock, so devices are walked concurrently.
+ * Called without the GIL.
+ *
+ * @param refresh Whether to walk sysfs even for a cached device
+ * @param result  Receives a copy of the topology, whose siblings the
+ *                caller frees
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int topo_get(const char *devname, int refresh, struct topo *result)
+{
+	struct topo *t, **cache;
+	int ifindex, err;
+	uint32_t i;
+
+	ifindex = if_nametoindex(devname);
+	if (!ifindex)
+		return ENODEV;
+
+	if (!refresh) {
+		pthread_mutex_lock(&topo_lock);
+		i = topo_find(devname, ifindex);
+		err = i < topo_cache_len ? topo_copy(result, topo_cache[i]) : -1;
+		pthread_mutex_unlock(&topo_lock);
+		if (err >= 0)
+			return err;
+	}
+
+	t = calloc(1, sizeof(*t));
+	if (!t)
+		return ENOMEM;
+	strncpy(t->name, devname, IFNAMSIZ);
+	t->ifindex = ifindex;
+	err = topo_walk(t);
+	if (!err)
+		err = topo_copy(result, t);
+	if (err) {
+		topo_free(t);
+		return err;
+	}
+
+	/* Another caller may have walked the same device meanwhile */
+	pthread_mutex_lock(&topo_lock);
+	i = topo_find(devname, ifindex);
+	if (i < topo_cache_len) {
+		topo_free(topo_cache[i]);
+		topo_cache[i] = t;
+		t = NULL;
+	} else {
+		topo_prune();
+		cache = realloc(topo_cache, (topo_cache_len + 1) * sizeof(*cache));
+		if (cache) {
+			topo_cache = cache;
+			topo_cache[topo_cache_len++] = t;
+			t = NULL;
+		}
+	}
+	pthread_mutex_unlock(&topo_lock);
+
+	/* Not caching a walk is no reason to fail it */
+	topo_free(t);
+	return 0;
+}
+
+static PyObject *topo_link_dict(const struct topo_pci *pci)
+{
+	PyObject *dict;
+
+	if (!pci->have_link)
+		Py_RETURN_NONE;
+	dict = PyDict_New();
+	if (dict &&
+	    (dict_set_steal(dict, "speed", PyFloat_FromDouble(pci->link.speed)) ||
+	     dict_set_steal(dict, "width", PyLong_FromUnsignedLong(pci->link.width)) ||
+	     dict_set_steal(dict, "max_speed", PyFloat_FromDouble(pci->link.max_speed)) ||
+	     dict_set_steal(dict, "max_width", PyLong_FromUnsignedLong(pci->link.max_width))))
+		Py_CLEAR(dict);
+	return dict;
+}
+
+static PyObject *topo_pci_dict(const struct topo_pci *pci)
+{
+	PyObject *dict = PyDict_New();
+
+	if (dict &&
+	    (dict_set_steal(dict, "pci_address", PyBytes_FromString(pci->address)) ||
+	     dict_set_steal(dict, "link", topo_link_dict(pci))))
+		Py_CLEAR(dict);
+	return dict;
+}
+
+static PyObject *topo_to_python(const struct topo *t)
+{
+	PyObject *dict, *bridges, *siblings, *item;
+	uint32_t i;
+
+	bridges = PyList_New(t->nr_bridges);
+	for (i = 0; bridges && i < t->nr_bridges; i++) {
+		item = topo_pci_dict(&t->bridges[i]);
+		if (!item)
+			Py_CLEAR(bridges);
+		else
+			PyList_SET_ITEM(bridges, i, item);
+	}
+	siblings = PyList_New(t->nr_siblings);
+	for (i = 0; siblings && i < t->nr_siblings; i++) {
+		item = PyBytes_FromString(t->siblings[i]);
+		if (!item)
+			Py_CLEAR(siblings);
+		else
+			PyList_SET_ITEM(siblings, i, item);
+	}
+
+	dict = bridges && siblings ? PyDict_New() : NULL;
+	if (dict &&
+	    (dict_set_steal(dict, "numa_node", PyLong_FromLong(t->numa_node)) ||
+	     dict_set_steal(dict, "local_cpus", steer_mask_to_python(&t->local_cpus)) ||
+	     PyDict_SetItemString(dict, "bridges", bridges) < 0 ||
+	     PyDict_SetItemString(dict, "siblings", siblings) < 0))
+		Py_CLEAR(dict);
+	if (dict && t->have_pci &&
+	    (dict_set_steal(dict, "pci_address", PyBytes_FromString(t->pci.address)) ||
+	     dict_set_steal(dict, "link", topo_link_dict(&t->pci))))
+		Py_CLEAR(dict);
+	if (dict && !t->have_pci &&
+	    (PyDict_SetItemString(dict, "pci_address", Py_None) < 0 ||
+	     PyDict_SetItemString(dict, "link", Py_None) < 0))
+		Py_CLEAR(dict);
+	Py_XDECREF(bridges);
+	Py_XDECREF(siblings);
+	return dict;
+}
+
+/**
+ * ethtool.get_topology(devname, refresh=False)
+ */
+PyObject *topo_get_topology(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", "refresh", NULL };
+	struct topo t;
+	char devname[IFNAMSIZ];
+	PyObject *result;
+	int refresh = 0, err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|i:get_topology", kwlist,
+					 devname_converter, devname, &refresh))
+		return NULL;
+	if (strlen(devname) >= IFNAMSIZ || strchr(devname, '/')) {
+		PyErr_Format(PyExc_ValueError, "Invalid device name '%s'", devname);
+		return NULL;
+	}
+
+	/* The dict is built from a copy, as building it may run finalizers
+	 * calling back in here
+	 */
+	Py_BEGIN_ALLOW_THREADS
+	err = topo_get(devname, refresh, &t);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		errno = err;
+		return PyErr_SetFromErrnoWithFilename(PyExc_IOError, devname);
+	}
+	result = topo_to_python(&t);
+	free(t.siblings);
+	return result;
+}
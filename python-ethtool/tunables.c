@@ -0,0 +1,473 @@
+/* tunables.c - Driver tunables and private flags (ETHTOOL_[GS]TUNABLE, ETHTOOL_[GS]PFLAGS)
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Tunables are read and written one by one, each with the type the kernel
+ * gives it, and reported in a dict like get_coalesce() does, without the
+ * ones the driver does not have.
+ *
+ * Private flags are a bitmap of at most 32 flags named by the driver's
+ * ETH_SS_PRIV_FLAGS string set.  Adapters of the same driver can expose
+ * different flags, so the names are fetched once per driver, firmware
+ * version and bus address, and a batch of flags is set with a single
+ * ETHTOOL_SPFLAGS, skipped when nothing changes.
+ */
+
+#include <Python.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/sockios.h>
+
+#include "tunables.h"
+#include "ethtool.h"
+#include "backend.h"
+
+#define PFLAGS_MAX	32
+
+struct tunable_desc {
+	const char *name;
+	uint32_t   id;
+	uint32_t   type_id;
+};
+
+static const struct tunable_desc tunable_descs[] = {
+	{ "rx_copybreak",	   ETHTOOL_RX_COPYBREAK,	  ETHTOOL_TUNABLE_U32 },
+	{ "tx_copybreak",	   ETHTOOL_TX_COPYBREAK,	  ETHTOOL_TUNABLE_U32 },
+	{ "pfc_prevention_tout",   ETHTOOL_PFC_PREVENTION_TOUT,	  ETHTOOL_TUNABLE_U16 },
+	{ "tx_copybreak_buf_size", ETHTOOL_TX_COPYBREAK_BUF_SIZE, ETHTOOL_TUNABLE_U32 },
+};
+
+/* The private flag names of an adapter */
+struct pflags_names {
+	char	 driver[32];
+	char	 fw_version[32];
+	char	 bus_info[ETHTOOL_BUSINFO_LEN];
+	uint32_t n;
+	char	 names[PFLAGS_MAX][ETH_GSTRING_LEN];
+};
+
+/* The private flags of a device */
+struct pflags {
+	struct pflags_names names;
+	uint32_t	    value;
+};
+
+static pthread_mutex_t pflags_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct pflags_names *pflags_cache;
+static uint32_t pflags_cache_len;
+
+/* devname fits ifr_name, see devname_converter() */
+static int tunables_ioctl(int fd, const char *devname, void *data, size_t size)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, devname, IFNAMSIZ);
+	ifr.ifr_data = data;
+	return backend_ioctl(fd, SIOCETHTOOL, &ifr, size) < 0 ? errno : 0;
+}
+
+static size_t tunable_size(const struct tunable_desc *d)
+{
+	return d->type_id == ETHTOOL_TUNABLE_U16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+/**
+ * Reads or writes a tunable.  Does not need the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno
+ */
+static int tunable_io(int fd, const char *devname, const struct tunable_desc *d,
+		      uint32_t cmd, uint32_t *value)
+{
+	union {
+		struct ethtool_tunable hdr;
+		uint8_t		       raw[sizeof(struct ethtool_tunable) + sizeof(uint64_t)];
+	} req;
+	uint16_t v16;
+	int err;
+
+	memset(&req, 0, sizeof(req));
+	req.hdr.cmd = cmd;
+	req.hdr.id = d->id;
+	req.hdr.type_id = d->type_id;
+	req.hdr.len = tunable_size(d);
+	if (d->type_id == ETHTOOL_TUNABLE_U16) {
+		v16 = *value;
+		memcpy(req.hdr.data, &v16, sizeof(v16));
+	} else {
+		memcpy(req.hdr.data, value, sizeof(*value));
+	}
+	err = tunables_ioctl(fd, devname, &req, sizeof(req.hdr) + req.hdr.len);
+	if (err || cmd != ETHTOOL_GTUNABLE)
+		return err;
+	if (d->type_id == ETHTOOL_TUNABLE_U16) {
+		memcpy(&v16, req.hdr.data, sizeof(v16));
+		*value = v16;
+	} else {
+		memcpy(value, req.hdr.data, sizeof(*value));
+	}
+	return 0;
+}
+
+static const char *tunables_key_name(PyObject *key)
+{
+#if PY_MAJOR_VERSION >= 3
+	return PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : NULL;
+#else
+	return PyString_Check(key) ? PyString_AsString(key) : NULL;
+#endif
+}
+
+static PyObject *tunables_raise(int err, const char *devname)
+{
+	errno = err;
+	if (err == ENOMEM)
+		return PyErr_NoMemory();
+	return PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)devname);
+}
+
+/**
+ * ethtool.get_tunables(devname)
+ */
+PyObject *tunables_get(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", NULL };
+	uint32_t values[ARRAY_SIZE(tunable_descs)];
+	int present[ARRAY_SIZE(tunable_descs)];
+	char devname[IFNAMSIZ];
+	PyObject *dict, *value;
+	int fd, err = 0;
+	size_t i;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&:get_tunables", kwlist,
+					 devname_converter, devname))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		err = errno;
+	} else {
+		for (i = 0; !err && i < ARRAY_SIZE(tunable_descs); i++) {
+			values[i] = 0;
+			err = tunable_io(fd, devname, &tunable_descs[i], ETHTOOL_GTUNABLE,
+					 &values[i]);
+			present[i] = !err;
+			/* Kernels which do not know a tunable say EINVAL */
+			if (err == EOPNOTSUPP || err == EINVAL)
+				err = 0;
+		}
+		close(fd);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err)
+		return tunables_raise(err, devname);
+	dict = PyDict_New();
+	for (i = 0; dict && i < ARRAY_SIZE(tunable_descs); i++) {
+		if (!present[i])
+			continue;
+		value = PyLong_FromUnsignedLong(values[i]);
+		if (!value || PyDict_SetItemString(dict, tunable_descs[i].name, value) < 0)
+			Py_CLEAR(dict);
+		Py_XDECREF(value);
+	}
+	return dict;
+}
+
+/**
+ * ethtool.set_tunables(devname, tunables)
+ */
+PyObject *tunables_set(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", "tunables", NULL };
+	const struct tunable_desc *descs[ARRAY_SIZE(tunable_descs)];
+	uint32_t values[ARRAY_SIZE(tunable_descs)];
+	PyObject *tunables, *key, *value;
+	const char *name;
+	char devname[IFNAMSIZ];
+	unsigned long v;
+	size_t i, n = 0;
+	Py_ssize_t pos = 0;
+	int fd, err = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O!:set_tunables", kwlist,
+					 devname_converter, devname, &PyDict_Type, &tunables))
+		return NULL;
+	while (PyDict_Next(tunables, &pos, &key, &value)) {
+		if (!(name = tunables_key_name(key))) {
+			PyErr_SetString(PyExc_TypeError, "tunable names must be strings");
+			return NULL;
+		}
+		for (i = 0; i < ARRAY_SIZE(tunable_descs); i++) {
+			if (strcmp(tunable_descs[i].name, name) == 0)
+				break;
+		}
+		if (i == ARRAY_SIZE(tunable_descs)) {
+			PyErr_Format(PyExc_ValueError, "unknown tunable '%s'", name);
+			return NULL;
+		}
+		v = PyLong_AsUnsignedLong(value);
+		if (v == (unsigned long)-1 && PyErr_Occurred())
+			return NULL;
+		if (v > (tunable_descs[i].type_id == ETHTOOL_TUNABLE_U16 ? UINT16_MAX : UINT32_MAX)) {
+			PyErr_Format(PyExc_ValueError, "%s out of range", name);
+			return NULL;
+		}
+		descs[n] = &tunable_descs[i];
+		values[n++] = v;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		err = errno;
+	} else {
+		for (i = 0; !err && i < n; i++)
+			err = tunable_io(fd, devname, descs[i], ETHTOOL_STUNABLE, &values[i]);
+		close(fd);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err)
+		return tunables_raise(err, devname);
+	Py_RETURN_NONE;
+}
+
+/**
+ * Looks the private flag names of an adapter up in the cache
+ *
+ * @return Returns 1 if found, 0 otherwise
+ */
+static int pflags_cached(struct pflags_names *names)
+{
+	uint32_t i;
+	int found = 0;
+
+	pthread_mutex_lock(&pflags_lock);
+	for (i = 0; i < pflags_cache_len; i++) {
+		if (pflags_cache[i].n == names->n &&
+		    strncmp(pflags_cache[i].driver, names->driver, sizeof(names->driver)) == 0 &&
+		    strncmp(pflags_cache[i].fw_version, names->fw_version,
+			    sizeof(names->fw_version)) == 0 &&
+		    strncmp(pflags_cache[i].bus_info, names->bus_info, sizeof(names->bus_info)) == 0) {
+			memcpy(names->names, pflags_cache[i].names, sizeof(names->names));
+			found = 1;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&pflags_lock);
+	return found;
+}
+
+static void pflags_cache_add(const struct pflags_names *names)
+{
+	struct pflags_names *cache;
+
+	pthread_mutex_lock(&pflags_lock);
+	cache = realloc(pflags_cache, (pflags_cache_len + 1) * sizeof(*cache));
+	if (cache) {
+		pflags_cache = cache;
+		pflags_cache[pflags_cache_len++] = *names;
+	}
+	pthread_mutex_unlock(&pflags_lock);
+}
+
+/**
+ * Reads the private flags of a device, and their names unless cached.  Does
+ * not need the GIL.
+ *
+ * @return Returns 0 on success, otherwise an errno.  EOPNOTSUPP means the
+ *         driver has no private flags.
+ */
+static int pflags_read(int fd, const char *devname, struct pflags *pf)
+{
+	struct ethtool_drvinfo info;
+	struct ethtool_gstrings *strings;
+	struct ethtool_value eval;
+	size_t size;
+	int err;
+
+	memset(pf, 0, sizeof(*pf));
+	memset(&info, 0, sizeof(info));
+	info.cmd = ETHTOOL_GDRVINFO;
+	if ((err = tunables_ioctl(fd, devname, &info, sizeof(info))) != 0)
+		return err;
+	if (info.n_priv_flags == 0)
+		return EOPNOTSUPP;
+	memcpy(pf->names.driver, info.driver, sizeof(pf->names.driver));
+	memcpy(pf->names.fw_version, info.fw_version, sizeof(pf->names.fw_version));
+	memcpy(pf->names.bus_info, info.bus_info, sizeof(pf->names.bus_info));
+	pf->names.n = info.n_priv_flags < PFLAGS_MAX ? info.n_priv_flags : PFLAGS_MAX;
+
+	if (!pflags_cached(&pf->names)) {
+		/* The kernel writes all the strings whatever len says */
+		size = sizeof(*strings) + (size_t)info.n_priv_flags * ETH_GSTRING_LEN;
+		strings = calloc(1, size);
+		if (!strings)
+			return ENOMEM;
+		strings->cmd = ETHTOOL_GSTRINGS;
+		strings->string_set = ETH_SS_PRIV_FLAGS;
+		strings->len = info.n_priv_flags;
+		err = tunables_ioctl(fd, devname, strings, size);
+		if (!err && strings->len != info.n_priv_flags)
+			err = EAGAIN;
+		if (!err)
+			memcpy(pf->names.names, strings->data, (size_t)pf->names.n * ETH_GSTRING_LEN);
+		free(strings);
+		if (err)
+			return err;
+		pflags_cache_add(&pf->names);
+	}
+
+	memset(&eval, 0, sizeof(eval));
+	eval.cmd = ETHTOOL_GPFLAGS;
+	if ((err = tunables_ioctl(fd, devname, &eval, sizeof(eval))) != 0)
+		return err;
+	pf->value = eval.data;
+	return 0;
+}
+
+/* Names are not NUL terminated when they fill ETH_GSTRING_LEN */
+static PyObject *pflags_name(const struct pflags *pf, uint32_t i)
+{
+	size_t len = strnlen(pf->names.names[i], ETH_GSTRING_LEN);
+
+#if PY_MAJOR_VERSION >= 3
+	return PyUnicode_FromStringAndSize(pf->names.names[i], len);
+#else
+	return PyString_FromStringAndSize(pf->names.names[i], len);
+#endif
+}
+
+/**
+ * ethtool.get_priv_flags(devname)
+ */
+PyObject *pflags_get(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", NULL };
+	char devname[IFNAMSIZ];
+	struct pflags pf;
+	PyObject *dict, *key;
+	uint32_t i;
+	int fd, err;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&:get_priv_flags", kwlist,
+					 devname_converter, devname))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		err = errno;
+	} else {
+		err = pflags_read(fd, devname, &pf);
+		close(fd);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (err == EOPNOTSUPP)
+		return PyDict_New();
+	if (err)
+		return tunables_raise(err, devname);
+	dict = PyDict_New();
+	for (i = 0; dict && i < pf.names.n; i++) {
+		key = pflags_name(&pf, i);
+		if (!key || PyDict_SetItem(dict, key, (pf.value & (1U << i)) ? Py_True : Py_False) < 0)
+			Py_CLEAR(dict);
+		Py_XDECREF(key);
+	}
+	return dict;
+}
+
+/**
+ * ethtool.set_priv_flags(devname, flags)
+ */
+PyObject *pflags_set(PyObject *self __unused, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "devname", "flags", NULL };
+	struct ethtool_value eval;
+	PyObject *flags, *key, *value;
+	const char *name;
+	char devname[IFNAMSIZ];
+	uint32_t set = 0, clear = 0, i;
+	struct pflags pf;
+	Py_ssize_t pos = 0;
+	int fd, err, on;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O!:set_priv_flags", kwlist,
+					 devname_converter, devname, &PyDict_Type, &flags))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	err = fd < 0 ? errno : pflags_read(fd, devname, &pf);
+	Py_END_ALLOW_THREADS
+
+	if (err) {
+		if (fd >= 0)
+			close(fd);
+		/* Setting no flags of a driver without any does nothing */
+		if (err == EOPNOTSUPP && PyDict_Size(flags) == 0)
+			Py_RETURN_NONE;
+		return tunables_raise(err, devname);
+	}
+	while (PyDict_Next(flags, &pos, &key, &value)) {
+		if (!(name = tunables_key_name(key))) {
+			PyErr_SetString(PyExc_TypeError, "flag names must be strings");
+			goto out_close;
+		}
+		for (i = 0; i < pf.names.n; i++) {
+			if (strncmp(pf.names.names[i], name, ETH_GSTRING_LEN) == 0 &&
+			    strlen(name) <= ETH_GSTRING_LEN)
+				break;
+		}
+		if (i == pf.names.n) {
+			PyErr_Format(PyExc_ValueError, "%s has no private flag '%s'",
+				     devname, name);
+			goto out_close;
+		}
+		if ((on = PyObject_IsTrue(value)) < 0)
+			goto out_close;
+		if (on)
+			set |= 1U << i;
+		else
+			clear |= 1U << i;
+	}
+
+	if (((pf.value | set) & ~clear) != pf.value) {
+		Py_BEGIN_ALLOW_THREADS
+		memset(&eval, 0, sizeof(eval));
+		eval.cmd = ETHTOOL_SPFLAGS;
+		eval.data = (pf.value | set) & ~clear;
+		err = tunables_ioctl(fd, devname, &eval, sizeof(eval));
+		Py_END_ALLOW_THREADS
+	}
+	close(fd);
+	if (err)
+		return tunables_raise(err, devname);
+	Py_RETURN_NONE;
+
+ out_close:
+	close(fd);
+	return NULL;
+}
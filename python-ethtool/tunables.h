@@ -0,0 +1,25 @@
+/* tunables.h - Driver tunables and private flags (ETHTOOL_[GS]TUNABLE, ETHTOOL_[GS]PFLAGS)
+ *
+ * Copyright (C) 2026 Red Hat Inc.
+ *
+ * This application is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; version 2.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _TUNABLES_H
+#define _TUNABLES_H
+
+#include <Python.h>
+
+PyObject *tunables_get(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *tunables_set(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *pflags_get(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject *pflags_set(PyObject *self, PyObject *args, PyObject *kwds);
+
+#endif
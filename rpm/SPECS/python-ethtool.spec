@@ -9,7 +9,7 @@ URL: https://github.com/fedora-python/python-ethtool
 Source: https://github.com/fedora-python/python-ethtool/archive/v%{version}.tar.gz
 License: GPLv2
 Group: System Environment/Libraries
-BuildRequires: python-devel libnl3-devel asciidoc
+BuildRequires: python-devel libnl3-devel asciidoc systemtap-sdt-devel
 BuildRoot:  %{_tmppath}/%{name}-%{version}-%{release}-root-%(%{__id_u} -n)
 
 %description
@@ -39,7 +39,7 @@ rm -rf %{buildroot}
 
 %files
 %defattr(-,root,root)
-%doc COPYING
+%doc COPYING tools/*.bt
 %{_sbindir}/pethtool
 %{_sbindir}/pifconfig
 %doc %{_mandir}/man8/*
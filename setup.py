@@ -7,7 +7,10 @@ try:
     import commands
 except ImportError:
     import subprocess as commands
+import os
+import shutil
 import sys
+import tempfile
 
 version = '0.12'
 
@@ -48,9 +51,46 @@ def pkgconfig(pkg):
             }
 
 
+def have_header(header):
+    """Checks whether the C compiler finds the given header"""
+    from distutils.ccompiler import new_compiler
+    from distutils.errors import CompileError
+
+    tmpdir = tempfile.mkdtemp()
+    try:
+        src = os.path.join(tmpdir, 'check.c')
+        f = open(src, 'w')
+        f.write('#include <%s>\n' % header)
+        f.close()
+        # Keep the compiler's complaints about a missing header quiet
+        sys.stderr.flush()
+        stderr = os.dup(2)
+        devnull = os.open(os.devnull, os.O_WRONLY)
+        os.dup2(devnull, 2)
+        os.close(devnull)
+        try:
+            new_compiler().compile([src], output_dir=tmpdir)
+        except CompileError:
+            return False
+        finally:
+            os.dup2(stderr, 2)
+            os.close(stderr)
+        return True
+    finally:
+        shutil.rmtree(tmpdir)
+
+
 libnl = pkgconfig('libnl-3.0')
 libnl['libs'].append('nl-route-3')
 
+macros = [('VERSION', '"%s"' % version)]
+
+# USDT probes, see python-ethtool/probes.h
+if have_header('sys/sdt.h'):
+    macros.append(('HAVE_SYS_SDT_H', '1'))
+else:
+    print('sys/sdt.h not found, building without USDT probes')
+
 # don't reformat this line, Makefile parses it
 setup(name='ethtool',
       version=version,
@@ -63,15 +103,37 @@ setup(name='ethtool',
             'ethtool',
             sources = [
                 'python-ethtool/ethtool.c',
+                'python-ethtool/common.c',
                 'python-ethtool/etherinfo.c',
                 'python-ethtool/etherinfo_obj.c',
+                'python-ethtool/etherinfo_iter.c',
                 'python-ethtool/netlink.c',
-                'python-ethtool/netlink-address.c'],
+                'python-ethtool/netlink-address.c',
+                'python-ethtool/parallel.c',
+                'python-ethtool/stats.c',
+                'python-ethtool/backend.c',
+                'python-ethtool/snapshot.c',
+                'python-ethtool/snapshot_codec.c',
+                'python-ethtool/shm.c',
+                'python-ethtool/nicstats.c',
+                'python-ethtool/metrics.c',
+                'python-ethtool/recorder.c',
+                'python-ethtool/dim.c',
+                'python-ethtool/rings.c',
+                'python-ethtool/steering.c',
+                'python-ethtool/irq.c',
+                'python-ethtool/topology.c',
+                'python-ethtool/napi.c',
+                'python-ethtool/netdev.c',
+                'python-ethtool/flow.c',
+                'python-ethtool/tunables.c',
+                'python-ethtool/linksettings.c',
+                'python-ethtool/pause.c'],
             extra_compile_args=['-fno-strict-aliasing'],
             include_dirs = libnl['include'],
             library_dirs = libnl['libdirs'],
             libraries = libnl['libs'],
-            define_macros = [('VERSION', '"%s"' % version)]
+            define_macros = macros
             )
         ]
 )
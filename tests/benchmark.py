@@ -0,0 +1,485 @@
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#
+#   Copyright (c) 2026  Red Hat, Inc. All rights reserved.
+#
+#   This copyrighted material is made available to anyone wishing
+#   to use, modify, copy, or redistribute it subject to the terms
+#   and conditions of the GNU General Public License version 2.
+#
+#   This program is distributed in the hope that it will be
+#   useful, but WITHOUT ANY WARRANTY; without even the implied
+#   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+#   PURPOSE. See the GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public
+#   License along with this program; if not, write to the Free
+#   Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+#   Boston, MA 02110-1301, USA.
+#
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+# Benchmark harness for the ethtool module.
+#
+# Every interface count is measured in a fresh unprivileged user+network
+# namespace ("unshare -rn"), populated with dummy, veth and VLAN
+# interfaces carrying several IPv4 and IPv6 addresses each.  Device types
+# the running kernel does not provide are skipped and the remaining types
+# make up the count.
+#
+# For each public API the harness records latency percentiles, the
+# read/write syscall counters and byte counts from /proc/self/io, context
+# switches and the peak RSS reached while the API was exercised.  Results
+# are written as JSON so that two commits can be compared:
+#
+#   PYTHONPATH=build/lib... python tests/benchmark.py -o base.json
+#   PYTHONPATH=build/lib... python tests/benchmark.py -o new.json
+#   python tests/benchmark.py --compare base.json new.json
+#
+# Note that /proc/self/io only counts read- and write-like syscalls;
+# ioctl(), sendmsg() and recvmsg() are not accounted there.  Every API
+# gets at most --budget seconds, so slow paths are measured with fewer
+# calls rather than stalling the run.  Populating and tearing down 10000
+# interfaces alone can take several minutes, depending on the kernel.
+
+from __future__ import print_function
+
+import json
+import optparse
+import os
+import platform
+import resource
+import subprocess
+import sys
+import time
+
+try:
+    timer = time.perf_counter
+except AttributeError:
+    timer = time.time
+
+DEFAULT_SIZES = '1,100,1000,10000'
+KINDS = ('dummy', 'veth', 'vlan')
+
+# Functions taking a single device name
+DEVNAME_FNS = ('get_flags', 'get_hwaddr', 'get_ipaddr', 'get_netmask',
+               'get_broadcast', 'get_module', 'get_businfo', 'get_coalesce',
+               'get_ringparam', 'get_tso', 'get_ufo', 'get_gso', 'get_sg')
+
+ETHERINFO_ATTRS = ('device', 'mac_address', 'ipv4_address', 'ipv4_netmask',
+                   'ipv4_broadcast')
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#  namespace setup
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+def ip_batch(lines):
+    p = subprocess.Popen(['ip', '-force', '-batch', '-'],
+                         stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                         stderr=subprocess.PIPE)
+    out, err = p.communicate(('\n'.join(lines) + '\n').encode('ascii'))
+    return p.returncode, err.decode('ascii', 'replace')
+
+def supported_kinds():
+    kinds = []
+    for kind in KINDS:
+        if kind == 'vlan':
+            cmds = ['link add probe0 type veth peer name probe1',
+                    'link add link probe0 name probe0.2 type vlan id 2']
+        elif kind == 'veth':
+            cmds = ['link add probe0 type veth peer name probe1']
+        else:
+            cmds = ['link add probe0 type %s' % kind]
+        if ip_batch(cmds)[0] == 0:
+            kinds.append(kind)
+        ip_batch(['link del probe0'])
+    return kinds
+
+def address_cmds(dev, idx, naddrs, naddrs6):
+    # Without noprefixroute every address also inserts a route, which
+    # makes populating thousands of interfaces take many minutes
+    cmds = []
+    for a in range(naddrs):
+        cmds.append('addr add 10.%d.%d.%d/24 dev %s noprefixroute' %
+                    ((idx >> 8) & 0xff, idx & 0xff, a + 1, dev))
+    for a in range(naddrs6):
+        cmds.append('addr add fd00:%x::%x/64 dev %s nodad noprefixroute' %
+                    (idx, a + 1, dev))
+    return cmds
+
+def populate(size, naddrs, naddrs6):
+    """
+    Creates about 'size' interfaces, split evenly between the supported
+    kinds.  Returns a dict with the number of interfaces of each kind.
+    """
+    kinds = supported_kinds()
+    if not kinds:
+        raise SystemExit('no usable interface type in this kernel')
+
+    counts = dict((kind, 0) for kind in kinds)
+    for i in range(size):
+        counts[kinds[i % len(kinds)]] += 1
+
+    links, addrs = ['link set lo up'], []
+    idx = 0
+    vlan_parents = []
+
+    for i in range(counts.get('dummy', 0)):
+        dev = 'bd%d' % i
+        links += ['link add %s type dummy' % dev, 'link set %s up' % dev]
+        addrs += address_cmds(dev, idx, naddrs, naddrs6)
+        idx += 1
+
+    # veth devices come in pairs, each end counts as one interface
+    for i in range(0, counts.get('veth', 0), 2):
+        a, b = 'bv%da' % i, 'bv%db' % i
+        links += ['link add %s type veth peer name %s' % (a, b),
+                  'link set %s up' % a, 'link set %s up' % b]
+        addrs += address_cmds(a, idx, naddrs, naddrs6)
+        idx += 1
+        vlan_parents.append(a)
+
+    nvlans = counts.get('vlan', 0)
+    if nvlans:
+        # 4094 usable VLAN ids per parent device
+        for i in range((nvlans + 4093) // 4094):
+            if i >= len(vlan_parents):
+                dev = 'bp%d' % i
+                links += ['link add %s type veth peer name %sb' % (dev, dev),
+                          'link set %s up' % dev, 'link set %sb up' % dev]
+                vlan_parents.append(dev)
+        for i in range(nvlans):
+            dev = 'bl%d' % i
+            links += ['link add link %s name %s type vlan id %d' %
+                      (vlan_parents[i // 4094], dev, i % 4094 + 1),
+                      'link set %s up' % dev]
+            addrs += address_cmds(dev, idx, naddrs, naddrs6)
+            idx += 1
+
+    rc, err = ip_batch(links + addrs)
+    if rc != 0:
+        raise SystemExit('ip -batch failed: %s' % err.strip())
+    return counts
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#  measurements
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+def read_proc_io():
+    io = {}
+    try:
+        for line in open('/proc/self/io'):
+            key, value = line.split(':')
+            io[key] = int(value)
+    except (IOError, OSError):
+        pass
+    return io
+
+def ctx_switches():
+    ru = resource.getrusage(resource.RUSAGE_SELF)
+    return ru.ru_nvcsw + ru.ru_nivcsw
+
+def reset_peak_rss():
+    # Writing 5 resets VmHWM, see proc(5)
+    try:
+        f = open('/proc/self/clear_refs', 'w')
+        f.write('5')
+        f.close()
+        return True
+    except (IOError, OSError):
+        return False
+
+def peak_rss_kb():
+    try:
+        for line in open('/proc/self/status'):
+            if line.startswith('VmHWM:'):
+                return int(line.split()[1])
+    except (IOError, OSError):
+        pass
+    return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+
+def percentile(sorted_samples, pct):
+    if not sorted_samples:
+        return None
+    k = int(round((len(sorted_samples) - 1) * pct / 100.0))
+    return sorted_samples[k]
+
+class Measurement(object):
+    """
+    Accumulates per-call latencies of one API together with the process
+    wide counters sampled around the whole measurement.  Once 'budget'
+    seconds have been spent, exhausted() tells the caller to stop early.
+    """
+    def __init__(self, budget):
+        self.budget = budget
+        self.spent = 0.0
+        self.samples = []
+        self.errors = 0
+        self.rss_reset = reset_peak_rss()
+        self.io = read_proc_io()
+        self.ctx = ctx_switches()
+
+    def call(self, fn, *args):
+        start = timer()
+        try:
+            result = fn(*args)
+        except (IOError, OSError):
+            result = None
+            self.errors += 1
+        elapsed = timer() - start
+        self.samples.append(elapsed)
+        self.spent += elapsed
+        return result
+
+    def exhausted(self):
+        return self.spent >= self.budget
+
+    def result(self):
+        io = read_proc_io()
+        samples = sorted(self.samples)
+        us = lambda v: None if v is None else round(v * 1e6, 3)
+        res = {
+            'calls': len(samples),
+            'errors': self.errors,
+            'mean_us': us(sum(samples) / len(samples)) if samples else None,
+            'p50_us': us(percentile(samples, 50)),
+            'p90_us': us(percentile(samples, 90)),
+            'p99_us': us(percentile(samples, 99)),
+            'max_us': us(samples[-1] if samples else None),
+            'ctx_switches': ctx_switches() - self.ctx,
+            'peak_rss_kb': peak_rss_kb(),
+            'peak_rss_is_per_api': self.rss_reset,
+        }
+        for key in ('syscr', 'syscw', 'rchar', 'wchar'):
+            if key in io and key in self.io:
+                res[key] = io[key] - self.io[key]
+        return res
+
+def sample_of(devices, count):
+    if len(devices) <= count:
+        return list(devices)
+    step = float(len(devices)) / count
+    return [devices[int(i * step)] for i in range(count)]
+
+def run_benchmarks(ethtool, iterations, sample_size, budget):
+    results = {}
+    devices = sorted(ethtool.get_devices())
+    sample = sample_of(devices, sample_size)
+
+    for name in ('get_devices', 'get_active_devices'):
+        m = Measurement(budget)
+        for i in range(iterations):
+            m.call(getattr(ethtool, name))
+            if m.exhausted():
+                break
+        results[name] = m.result()
+
+    m = Measurement(budget)
+    for i in range(iterations):
+        m.call(ethtool.get_interfaces_info, sample)
+        if m.exhausted():
+            break
+    results['get_interfaces_info'] = m.result()
+
+    infos = ethtool.get_interfaces_info(sample)
+    for attr in ETHERINFO_ATTRS:
+        m = Measurement(budget)
+        for i in range(iterations):
+            if m.exhausted():
+                break
+            for ei in infos:
+                m.call(getattr, ei, attr)
+                if m.exhausted():
+                    break
+        results['etherinfo.' + attr] = m.result()
+
+    for method in ('get_ipv4_addresses', 'get_ipv6_addresses'):
+        m = Measurement(budget)
+        for i in range(iterations):
+            if m.exhausted():
+                break
+            for ei in infos:
+                m.call(getattr(ei, method))
+                if m.exhausted():
+                    break
+        results['etherinfo.' + method] = m.result()
+    del infos
+
+    for name in DEVNAME_FNS:
+        fn = getattr(ethtool, name)
+        m = Measurement(budget)
+        for i in range(iterations):
+            if m.exhausted():
+                break
+            for dev in sample:
+                m.call(fn, dev)
+                if m.exhausted():
+                    break
+        results[name] = m.result()
+
+    if hasattr(ethtool, 'parallel_query'):
+        m = Measurement(budget)
+        for i in range(iterations):
+            m.call(ethtool.parallel_query, devices, ('flags', 'hwaddr'))
+            if m.exhausted():
+                break
+        results['parallel_query'] = m.result()
+
+    return len(devices), results
+
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#  driver
+# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+def run_child(opts):
+    """Runs inside the namespace and prints one JSON run record"""
+    start = timer()
+    counts = populate(opts.size, opts.addrs, opts.addrs6)
+    setup = timer() - start
+
+    # Import after the setup so its cost is not part of the peak RSS
+    import ethtool
+    if hasattr(ethtool, 'reset_stats'):
+        ethtool.reset_stats()
+    ninterfaces, apis = run_benchmarks(ethtool, opts.iterations, opts.sample,
+                                       opts.budget)
+    # The module's own counters include the ioctls and NETLINK traffic
+    # /proc/self/io cannot see
+    native = {}
+    if hasattr(ethtool, 'stats'):
+        for site, counters in ethtool.stats().items():
+            if counters['calls']:
+                native[site] = dict((k, v) for k, v in counters.items()
+                                    if k != 'histogram')
+    json.dump({'size': opts.size,
+               'native_stats': native,
+               'interfaces': ninterfaces,
+               'kinds': counts,
+               'ipv4_addresses_per_interface': opts.addrs,
+               'ipv6_addresses_per_interface': opts.addrs6,
+               'setup_seconds': round(setup, 3),
+               'apis': apis}, sys.stdout)
+
+def git_revision():
+    try:
+        p = subprocess.Popen(['git', 'describe', '--always', '--dirty'],
+                             stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                             cwd=os.path.dirname(os.path.abspath(__file__)))
+        out = p.communicate()[0].decode('ascii', 'replace').strip()
+        return out or None
+    except OSError:
+        return None
+
+def run_all(opts):
+    runs = []
+    for size in [int(s) for s in opts.sizes.split(',') if s]:
+        cmd = ['unshare', '-rn', sys.executable, os.path.abspath(__file__),
+               '--child', '--size', str(size), '--addrs', str(opts.addrs),
+               '--addrs6', str(opts.addrs6),
+               '--iterations', str(opts.iterations),
+               '--sample', str(opts.sample), '--budget', str(opts.budget)]
+        sys.stderr.write('benchmarking %d interfaces...\n' % size)
+        p = subprocess.Popen(cmd, stdout=subprocess.PIPE)
+        out = p.communicate()[0]
+        if p.returncode != 0:
+            raise SystemExit('benchmark run for %d interfaces failed' % size)
+        runs.append(json.loads(out.decode('utf-8')))
+
+    report = {
+        'format': 1,
+        'revision': git_revision(),
+        'timestamp': int(time.time()),
+        'python': platform.python_version(),
+        'kernel': platform.release(),
+        'iterations': opts.iterations,
+        'sample': opts.sample,
+        'budget': opts.budget,
+        'runs': runs,
+    }
+    if opts.output == '-':
+        json.dump(report, sys.stdout, indent=2, sort_keys=True)
+        sys.stdout.write('\n')
+    else:
+        f = open(opts.output, 'w')
+        json.dump(report, f, indent=2, sort_keys=True)
+        f.close()
+        print_report(report)
+
+def print_report(report):
+    for run in report['runs']:
+        print('%d interfaces (%s), setup %.1fs' %
+              (run['interfaces'],
+               ', '.join('%s=%d' % kv for kv in sorted(run['kinds'].items())),
+               run['setup_seconds']))
+        print('  %-32s %7s %10s %10s %10s %7s %9s' %
+              ('api', 'calls', 'p50 us', 'p90 us', 'p99 us', 'syscr',
+               'rss kB'))
+        for name, r in sorted(run['apis'].items()):
+            print('  %-32s %7d %10s %10s %10s %7s %9s' %
+                  (name, r['calls'], r['p50_us'], r['p90_us'], r['p99_us'],
+                   r.get('syscr', '-'), r['peak_rss_kb']))
+
+def compare(base_file, new_file, threshold):
+    """
+    Compares the median latencies of two reports, returns the number of
+    APIs that got slower by more than 'threshold'
+    """
+    base = json.load(open(base_file))
+    new = json.load(open(new_file))
+    base_runs = dict((r['size'], r) for r in base['runs'])
+    regressions = 0
+
+    print('%s -> %s' % (base.get('revision'), new.get('revision')))
+    for run in new['runs']:
+        old = base_runs.get(run['size'])
+        if old is None:
+            continue
+        print('%d interfaces' % run['size'])
+        for name, r in sorted(run['apis'].items()):
+            o = old['apis'].get(name)
+            if not o or not o['p50_us'] or r['p50_us'] is None:
+                continue
+            ratio = r['p50_us'] / o['p50_us']
+            flag = ''
+            if ratio > threshold:
+                flag = '  REGRESSION'
+                regressions += 1
+            print('  %-32s %10s -> %10s  x%.2f%s' %
+                  (name, o['p50_us'], r['p50_us'], ratio, flag))
+    return regressions
+
+def main():
+    parser = optparse.OptionParser(
+        usage='%prog [options]\n       %prog --compare BASE.json NEW.json')
+    parser.add_option('-s', '--sizes', default=DEFAULT_SIZES,
+                      help='comma separated interface counts [%default]')
+    parser.add_option('-a', '--addrs', type='int', default=4,
+                      help='IPv4 addresses per interface [%default]')
+    parser.add_option('-6', '--addrs6', type='int', default=1,
+                      help='IPv6 addresses per interface [%default]')
+    parser.add_option('-i', '--iterations', type='int', default=5,
+                      help='iterations per API [%default]')
+    parser.add_option('-n', '--sample', type='int', default=100,
+                      help='devices used for the per-device APIs [%default]')
+    parser.add_option('-b', '--budget', type='float', default=2.0,
+                      help='seconds spent at most on one API [%default]')
+    parser.add_option('-o', '--output', default='-',
+                      help='JSON output file, - for stdout [%default]')
+    parser.add_option('--compare', action='store_true',
+                      help='compare two JSON reports')
+    parser.add_option('--threshold', type='float', default=1.10,
+                      help='p50 ratio reported as regression [%default]')
+    parser.add_option('--child', action='store_true', help=optparse.SUPPRESS_HELP)
+    parser.add_option('--size', type='int', help=optparse.SUPPRESS_HELP)
+    opts, args = parser.parse_args()
+
+    if opts.compare:
+        if len(args) != 2:
+            parser.error('--compare needs two reports')
+        sys.exit(1 if compare(args[0], args[1], opts.threshold) else 0)
+    elif opts.child:
+        run_child(opts)
+    else:
+        run_all(opts)
+
+if __name__ == '__main__':
+    main()
@@ -19,7 +19,13 @@
 #   Author: Dave Malcolm <dmalcolm@redhat.com>
 # ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
+import errno
+import os
+import struct
 import sys
+import tempfile
+import threading
+import time
 import unittest
 from test.test_support import run_unittest # requires python-test subpackage on Fedora/RHEL
 
@@ -208,6 +214,15 @@ class EthtoolTests(unittest.TestCase):
                                               INVALID_DEVICE_NAME, 42)
 
 
+    def test_devname_arguments(self):
+        for devname in ethtool.get_devices():
+            self.assertEqual(ethtool.get_flags(u'%s' % devname),
+                             ethtool.get_flags(devname))
+        self.assertRaises(TypeError, ethtool.get_flags)
+        self.assertRaises(TypeError, ethtool.get_flags, 'lo', 'lo')
+        self.assertRaises(TypeError, ethtool.get_flags, 42)
+        self.assertRaises(ValueError, ethtool.get_flags, 'lo\0')
+
     def test_get_interface_info_invalid(self):
         eis = ethtool.get_interfaces_info(INVALID_DEVICE_NAME)
         self.assertEquals(len(eis), 1)
@@ -232,6 +247,515 @@ class EthtoolTests(unittest.TestCase):
         for devname in ethtool.get_active_devices():
             self._functions_accepting_devnames(devname)
                        
+    def test_parallel_query(self):
+        devnames = ethtool.get_devices()
+        results = ethtool.parallel_query(devnames, ('flags', 'hwaddr'),
+                                         timeout=10)
+        self.assertEqual(sorted(results.keys()), sorted(devnames))
+        for devname in devnames:
+            self.assertEqual(results[devname]['flags'],
+                             ethtool.get_flags(devname))
+            self.assertEqual(results[devname]['hwaddr'],
+                             ethtool.get_hwaddr(devname))
+
+        results = ethtool.parallel_query([INVALID_DEVICE_NAME], ('flags', ))
+        err = results[INVALID_DEVICE_NAME]['flags']
+        self.assert_(isinstance(err, IOError))
+        self.assertEquals(err.errno, 19)
+
+        self.assertRaises(ValueError, ethtool.parallel_query,
+                          devnames, ('no_such_field', ))
+        # Truncating would query whichever device has the first 15 characters
+        self.assertRaises(ValueError, ethtool.parallel_query,
+                          ['lo\0x'], ('flags', ))
+        self.assertRaises(ValueError, ethtool.parallel_query, ['lo'],
+                          ('flags', ), timeout=float('nan'))
+        self.assertEqual(set(ethtool.parallel_query(['lo'], ('flags', ),
+                                                    timeout=1e300)['lo']),
+                         set(['flags']))
+
+    def test_etherinfo_threads(self):
+        # etherinfo objects share one NETLINK connection per module, make
+        # sure concurrent users don't trip over each other
+        devnames = ethtool.get_devices()
+        expected = dict((ei.device, ei.mac_address)
+                        for ei in ethtool.get_interfaces_info(devnames))
+        errors = []
+
+        def worker():
+            try:
+                for i in range(20):
+                    for ei in ethtool.get_interfaces_info(devnames):
+                        self.assertEqual(ei.mac_address, expected[ei.device])
+                        ei.get_ipv4_addresses()
+            except Exception as e:
+                errors.append(e)
+
+        threads = [threading.Thread(target=worker) for i in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertEqual(errors, [])
+
+    def test_stats(self):
+        ethtool.reset_stats()
+        devnames = ethtool.get_devices()
+        for devname in devnames:
+            ethtool.get_flags(devname)
+        for ei in ethtool.get_interfaces_info(devnames):
+            ei.get_ipv4_addresses()
+
+        stats = ethtool.stats()
+        flags = stats['get_flags']
+        self.assertEqual(flags['calls'], len(devnames))
+        self.assertEqual(flags['ioctls'], len(devnames))
+        self.assertEqual(sum(flags['histogram'].values()), len(devnames))
+        addrs = stats['get_etherinfo_address']
+        self.assertEqual(addrs['calls'], len(devnames))
+        self.assert_(addrs['netlink_messages'] > 0)
+        self.assert_(addrs['netlink_bytes'] > 0)
+
+        ethtool.reset_stats()
+        self.assertEqual(ethtool.stats()['get_flags']['calls'], 0)
+
+    def test_backend_record_replay(self):
+        def snapshot():
+            devnames = ethtool.get_devices()
+            return (devnames,
+                    [ethtool.get_flags(devname) for devname in devnames],
+                    [(ei.device, ei.ipv4_address, ei.mac_address)
+                     for ei in ethtool.get_interfaces_info(devnames)])
+
+        fd, path = tempfile.mkstemp()
+        os.close(fd)
+        try:
+            ethtool.set_backend('record', path)
+            self.assertEqual(ethtool.get_backend(), 'record')
+            recorded = snapshot()
+            ethtool.set_backend('replay', path)
+            self.assertEqual(snapshot(), recorded)
+            # Replaying does not consume the capture
+            self.assertEqual(snapshot(), recorded)
+            self.assertRaises(IOError, ethtool.get_flags, 'notadevice')
+        finally:
+            ethtool.set_backend('kernel')
+            os.unlink(path)
+        self.assertRaises(ValueError, ethtool.set_backend, 'nosuchbackend')
+
+    def test_iter_interfaces_info(self):
+        names = []
+        for ei in ethtool.iter_interfaces_info():
+            names.append(ei.device)
+            if ei.device != 'lo':
+                continue
+            ref = ethtool.get_interfaces_info('lo')[0]
+            self.assertEqual(ei.mac_address, ref.mac_address)
+            self.assertEqual(map(str, ei.get_ipv4_addresses()),
+                             map(str, ref.get_ipv4_addresses()))
+            self.assertEqual(map(str, ei.get_ipv6_addresses()),
+                             map(str, ref.get_ipv6_addresses()))
+        self.assertEqual(sorted(names), sorted(ethtool.get_devices()))
+
+    def test_snapshot_diff(self):
+        old = ethtool.snapshot(ethtool=False)
+        new = ethtool.snapshot()
+        self.assertEqual(len(old), len(ethtool.get_devices()))
+        self.assertEqual(sorted(new.to_dict()['interfaces'].keys()),
+                         sorted(ethtool.get_devices()))
+
+        # Nothing was reconfigured in between, only the ETHTOOL settings
+        # which the first snapshot did not collect can differ
+        diff = old.diff(new)
+        self.assertEqual(diff['added_interfaces'], [])
+        self.assertEqual(diff['removed_interfaces'], [])
+        self.assertEqual(diff['added_addresses'], {})
+        self.assertEqual(diff['removed_addresses'], {})
+        for changes in diff['changed'].values():
+            for field, (before, after) in changes.items():
+                self.assert_(field in ('coalesce', 'ringparam', 'drvinfo',
+                                       'features'))
+                self.assertEqual(before, None)
+        self.assertEqual(new.diff(new)['changed'], {})
+        self.assertRaises(TypeError, new.diff, {})
+
+    def test_snapshot_encoding(self):
+        snap = ethtool.snapshot()
+        data = snap.to_bytes()
+        loaded = ethtool.load_snapshot(data)
+        self.assertEqual(loaded.to_dict(), snap.to_dict())
+        self.assertEqual(loaded.diff(snap)['changed'], {})
+        self.assertFalse(ethtool.load_snapshot(data, copy=True).zero_copy)
+        self.assertRaises(ValueError, ethtool.load_snapshot, data[:-1])
+        self.assertRaises(ValueError, ethtool.load_snapshot, 'x' * len(data))
+
+        # The table sizes in this header add up to more than 2^64
+        hdr = struct.pack('=8sIHHIIIIQ', b'PYETHSNP', 0x01020304, 1, 40,
+                          0xffffffff, 0xffffffff, 2, 0xffffffff, 0)
+        self.assertRaises(ValueError, ethtool.load_snapshot, hdr)
+
+    def test_metrics_renderer(self):
+        renderer = ethtool.metrics_renderer(families=['link'], prefix='nic')
+        text = renderer.render()
+        self.assert_(text.tobytes().endswith('# EOF\n'))
+        self.assert_('nic_interface_info{device="lo"' in text.tobytes())
+        self.assert_('_total{' not in text.tobytes())
+        # The text is reused, so it must not be rendered over while viewed
+        self.assertRaises(BufferError, renderer.render)
+        del text
+        snap = ethtool.snapshot(ethtool=False)
+        self.assertEqual(renderer.render(snap, copy=True),
+                         renderer.render(snap, copy=True))
+        self.assertRaises(ValueError, ethtool.metrics_renderer, ['bogus'])
+        self.assertRaises(ValueError, ethtool.metrics_renderer, prefix='no-dash')
+
+    def test_publisher(self):
+        fd, path = tempfile.mkstemp()
+        os.close(fd)
+        try:
+            pub = ethtool.publisher(path, ethtool=False)
+            self.assertRaises(IOError, ethtool.publisher, path)
+            state = ethtool.open_published(path)
+            self.assertRaises(IOError, state.read)
+            self.assertEqual(pub.publish(), 1)
+            self.assertEqual(state.generation, 1)
+
+            snapshot = state.read()
+            self.assertEqual(snapshot['generation'], 1)
+            self.assertEqual(snapshot['publisher_pid'], os.getpid())
+            self.assert_(0 <= snapshot['age'] < 60)
+            self.assertEqual(sorted(snapshot['interfaces'].keys()),
+                             sorted(ethtool.get_devices()))
+            for devname, iface in snapshot['interfaces'].items():
+                # SIOCGIFFLAGS only reports the lower 16 bits
+                self.assertEqual(iface['flags'] & 0xffff, ethtool.get_flags(devname))
+
+            pub.close()
+            self.assertEqual(state.read()['generation'], 1)
+            state.close()
+
+            # The table sizes in this header add up to more than 2^64
+            f = open(path, 'r+b')
+            f.seek(52)
+            f.write(struct.pack('=IIII', 0xffffffff, 0xffffffff, 2,
+                                0xffffffff))
+            f.close()
+            state = ethtool.open_published(path)
+            self.assertRaises(ValueError, state.read)
+            state.close()
+        finally:
+            os.unlink(path)
+
+    def test_recorder(self):
+        fd, path = tempfile.mkstemp()
+        os.close(fd)
+        try:
+            rec = ethtool.recorder(path, ['lo'], interval=0.001, capacity=4)
+            recording = ethtool.open_recording(path)
+            self.assertEqual(recording.counters[0], ('lo', 'link', 'rx_packets'))
+            self.assertEqual(recording.capacity, 4)
+            rec.start()
+            while rec.recorded < 6:
+                time.sleep(0.001)
+            rec.close()
+
+            # Only the last records are kept once the ring is full
+            timestamps, values = recording.read()
+            self.assertEqual(len(timestamps), 4 * 8)
+            timestamps = struct.unpack('=4Q', timestamps)
+            self.assertEqual(sorted(timestamps), list(timestamps))
+            self.assertEqual(len(values), 4 * 8 * len(recording.counters))
+            self.assertEqual(len(recording.read(last=2)[0]), 2 * 8)
+            recording.close()
+            self.assertRaises(IOError, ethtool.recorder, path, ['not a device'])
+        finally:
+            os.unlink(path)
+
+    def test_coalesce_controller(self):
+        c = ethtool.coalesce_controller(['eth0'], apply=False, hysteresis=0.25)
+        self.assertEqual(c.step({'eth0': (0, 0)}, now=0), {})
+        self.assertEqual(c.step({'eth0': (300000, 1000)}, now=1),
+                         {b'eth0': (3, 0)})
+        # 160k packets per second are within the hysteresis of profile 2
+        self.assertEqual(c.step({'eth0': (460000, 2000)}, now=2), {})
+        self.assertEqual(c.step({'eth0': (600000, 3000)}, now=3),
+                         {b'eth0': (2, 0)})
+        state = c.state()[b'eth0']
+        self.assertEqual(state['rx_rate'], 140000)
+        self.assertEqual(state['changes'], 2)
+        self.assertTrue(b'ethtool_coalesce_target_usecs{device="eth0",'
+                        b'direction="rx"} 64\n' in c.metrics())
+        self.assertRaises(ValueError, c.step, {'eth1': (0, 0)})
+        self.assertRaises(ValueError, ethtool.coalesce_controller, ['eth0'],
+                          profiles=[(10, 1, 1), (5, 2, 2)])
+        c.close()
+        self.assertRaises(IOError, c.step, {'eth0': (0, 0)}, now=4)
+
+    def test_ring_advisor(self):
+        advisor = ethtool.ring_advisor()
+        advisor.sample()
+        for devname, advice in advisor.sample().items():
+            self.assertTrue(advice['rx_pending'] <= advice['rx_advised']
+                            <= max(advice['rx_pending'],
+                                   advice['rx_max_pending']))
+            self.assertTrue(advice['window'] > 0)
+            self.assertFalse(advice['applied'])
+        advisor.close()
+        self.assertRaises(IOError, advisor.sample)
+        self.assertRaises(ValueError, ethtool.ring_advisor, min_drops=0)
+
+    def test_ring_advisor_step(self):
+        advisor = ethtool.ring_advisor(['eth0'], min_drops=10)
+
+        def step(now, rx_pending, rx_drops, tx_drops):
+            return advisor.step({'eth0': {
+                'rx_pending': rx_pending, 'rx_max_pending': 4096,
+                'rx_drops': rx_drops, 'tx_pending': 0,
+                'tx_max_pending': 0, 'tx_drops': tx_drops}}, now=now)[b'eth0']
+
+        # Nothing is counted on the first sample
+        advice = step(0, 512, 100, 100)
+        self.assertEqual((advice['rx_advised'], advice['window']), (512, 0))
+        advice = step(2, 512, 120, 200)
+        self.assertEqual((advice['rx_drops'], advice['rx_advised']), (20, 1024))
+        self.assertEqual(advice['window'], 2)
+        self.assertEqual(advice['tx_advised'], 0)
+        self.assertFalse(advice['applied'])
+        # Fewer than min_drops
+        self.assertEqual(step(3, 1024, 129, 200)['rx_advised'], 1024)
+        # Doubling is clamped at the maximum, which is never exceeded
+        self.assertEqual(step(4, 3000, 1000, 200)['rx_advised'], 4096)
+        self.assertEqual(step(5, 4096, 2000, 200)['rx_advised'], 4096)
+        # Counters going backwards after a reset count as no drops
+        self.assertEqual(step(6, 512, 0, 200)['rx_drops'], 0)
+        self.assertRaises(ValueError, advisor.step, {'eth1': {}})
+        self.assertRaises(ValueError, advisor.step, {'eth0': {}})
+        advisor.close()
+
+    def test_queue_steering(self):
+        steering = ethtool.queue_steering('lo')
+        settings = steering.get()
+        self.assertEqual(len(settings['rps_cpus']), steering.rx_queues)
+        self.assertEqual(len(settings['xps_cpus']), steering.tx_queues)
+        self.assertTrue(len(steering.local_cpus) > 0)
+        self.assertRaises(ValueError, steering.set,
+                          rps_cpus=[()] * (steering.rx_queues + 1))
+        steering.close()
+        self.assertRaises(IOError, steering.get)
+        self.assertRaises(IOError, ethtool.queue_steering, 'notadevice')
+
+    def test_irq_affinity_plan(self):
+        for devname in ethtool.get_devices():
+            irq_map = ethtool.get_irq_map(devname)
+            self.assertTrue(len(irq_map['local_cpus']) > 0)
+            queues = [irq['irq'] for irq in irq_map['irqs']
+                      if irq['queue'] is not None]
+            plan = ethtool.plan_irq_affinity(devname)
+            self.assertEqual([irq for irq, cpu in plan], queues)
+            for irq, cpu in plan:
+                self.assertTrue(cpu in irq_map['local_cpus'])
+        self.assertRaises(IOError, ethtool.get_irq_map, 'notadevice')
+
+        # A capture of a host with four CPUs on two cores, where lo has
+        # queue interrupts, lets the plan be checked anywhere
+        files = {
+            '/sys/devices/system/cpu/online': '0-3\n',
+            '/proc/interrupts': '\n'.join([
+                '           CPU0       CPU1       CPU2       CPU3',
+                '  40:          0          0          0          0  lo',
+                '  41:          0          0          0          0  lo-TxRx-1',
+                '  42:          0          0          0          0  lo-TxRx-0',
+                '  43:          0          0          0          0  lo-TxRx-2',
+                '  44:          0          0          0          0  lo-TxRx-3',
+                '  45:          0          0          0          0  lo-TxRx-4',
+                '']),
+        }
+        for cpu, siblings in enumerate(['0-1', '0-1', '2-3', '2-3']):
+            files['/sys/devices/system/cpu/cpu%d/topology/'
+                  'thread_siblings_list' % cpu] = siblings + '\n'
+        ifreq_size = 40 if struct.calcsize('P') == 8 else 32
+        capture = [struct.pack('=8sII', b'PYETHCAP', 1, ifreq_size)]
+        for path, contents in files.items():
+            payload = (struct.pack('=iI', 0, len(path)) + path.encode() +
+                       contents.encode())
+            capture.append(struct.pack('=IIQ', 4, len(payload), 0) + payload)
+        fd, path = tempfile.mkstemp()
+        os.write(fd, b''.join(capture))
+        os.close(fd)
+        try:
+            ethtool.set_backend('replay', path)
+            # Queues in order, first threads of the cores first, round robin
+            self.assertEqual(ethtool.plan_irq_affinity('lo', cpus=range(4)),
+                             [(42, 0), (41, 2), (43, 1), (44, 3), (45, 0)])
+            self.assertEqual(ethtool.plan_irq_affinity('lo', cpus=[1, 3]),
+                             [(42, 1), (41, 3), (43, 1), (44, 3), (45, 1)])
+            self.assertRaises(ValueError, ethtool.set_irq_affinity,
+                              [(42, 0), (41, [])])
+            self.assertRaises(ValueError, ethtool.set_irq_affinity,
+                              [(42, 0), (41, [2, 4])])
+        finally:
+            ethtool.set_backend('kernel')
+            os.unlink(path)
+
+    def test_topology(self):
+        for devname in ethtool.get_devices():
+            topology = ethtool.get_topology(devname)
+            self.assertTrue(len(topology['local_cpus']) > 0)
+            self.assertFalse(devname in topology['siblings'])
+            if topology['pci_address'] is None:
+                self.assertEqual(topology['bridges'], [])
+            self.assertEqual(ethtool.get_topology(devname, refresh=True),
+                             topology)
+        self.assertRaises(IOError, ethtool.get_topology, 'notadevice')
+
+    def test_napi(self):
+        for devname in ethtool.get_devices():
+            napi = ethtool.get_napi(devname)
+            for key in ('napi_defer_hard_irqs', 'gro_flush_timeout',
+                        'threaded', 'busy_poll', 'busy_read'):
+                self.assertTrue(key in napi)
+            for thread in napi['threads']:
+                self.assertTrue(thread['name'].startswith(b'napi/'))
+        self.assertRaises(ValueError, ethtool.set_napi, 'lo', busy_poll=-1)
+        self.assertRaises(ValueError, ethtool.set_napi, 'lo', busy_poll='50')
+        self.assertRaises(ValueError, ethtool.set_napi, '../lo', threaded=0)
+        # The global busy_poll is left alone for devices which do not exist
+        busy_poll = ethtool.get_napi('lo')['busy_poll']
+        self.assertRaises(IOError, ethtool.set_napi, 'notadevice',
+                          busy_poll=(busy_poll or 0) + 1)
+        self.assertEqual(ethtool.get_napi('lo')['busy_poll'], busy_poll)
+        self.assertRaises(IOError, ethtool.get_napi, 'notadevice')
+
+    def test_netdev_tables(self):
+        try:
+            queues = ethtool.get_netdev_queues()
+        except IOError as e:
+            # Kernels before 6.8 lack the netdev family
+            self.assertEqual(e.errno, errno.EOPNOTSUPP)
+            return
+        self.assertEqual(memoryview(queues).shape,
+                         (len(queues), len(queues.columns)))
+        self.assertEqual(queues.columns[:3], ('ifindex', 'type', 'id'))
+        for i in range(len(queues)):
+            self.assertTrue(queues.row(i)['type'] in (0, 1))
+        napis = ethtool.get_netdev_napis()
+        self.assertEqual(memoryview(napis).format, 'Q')
+        self.assertRaises(ValueError, ethtool.set_netdev_napi, 1,
+                          defer_hard_irqs=-1)
+        self.assertRaises(ValueError, ethtool.set_netdev_napi, 1,
+                          defer_hard_irqs=2 ** 31)
+        # No NAPI instance has an id this low
+        self.assertRaises(IOError, ethtool.set_netdev_napi, 1,
+                          gro_flush_timeout=20000)
+        self.assertRaises(IOError, ethtool.get_netdev_queues, 'notadevice')
+
+    def test_flow_rules(self):
+        rule = ethtool.FlowRule('tcp4', dst_ip='10.0.0.0/8', dst_port=11211,
+                                action=3)
+        self.assertEqual(rule.flow_type, 'tcp4')
+        self.assertEqual(rule.dst_port, 11211)
+        self.assertEqual(rule.src_ip, None)
+        self.assertEqual(rule.location, None)
+        self.assertEqual(rule.fields['dst_ip'], ('10.0.0.0', '255.0.0.0'))
+        # The location is not part of what a rule matches
+        same = ethtool.FlowRule('tcp4', dst_ip=('10.0.0.0', '255.0.0.0'),
+                                dst_port=(11211, 0xffff), action=3, location=5)
+        self.assertEqual(rule, same)
+        self.assertEqual(hash(rule), hash(same))
+        self.assertNotEqual(rule, ethtool.FlowRule('tcp4', action=-1))
+        self.assertRaises(ValueError, ethtool.FlowRule, 'tcp5')
+        self.assertRaises(TypeError, ethtool.FlowRule, 'tcp4', spi=1)
+        self.assertRaises(ValueError, ethtool.FlowRule, 'udp6',
+                          dst_ip='fe80::/129')
+        # A rule equal to a wanted one is kept only at the wanted location,
+        # and one to replace is deleted to free its location
+        drop = ethtool.FlowRule('udp4', dst_port=53, action=-1, location=7)
+        other = ethtool.FlowRule('udp4', dst_port=123, action=1, location=5)
+        insert, delete = ethtool.diff_flow_rules([same, drop, other],
+                                                 [rule, drop, ethtool.FlowRule(
+                                                     'udp4', dst_port=123,
+                                                     action=2, location=5)])
+        self.assertEqual([r.location for r in insert], [5])
+        self.assertEqual([r.location for r in delete], [5])
+        self.assertEqual(delete[0].action, 1)
+        # Drivers may report FLOW_EXT with none of its fields matched
+        ext = ethtool.FlowRule('tcp4', dst_ip='10.0.0.0/8', dst_port=11211,
+                               action=3, location=5, vlan_tci=(0, 0))
+        self.assertEqual(ext, rule)
+        self.assertEqual(ext.vlan_tci, None)
+        self.assertEqual(ethtool.diff_flow_rules([ext], [same]), ([], []))
+        self.assertNotEqual(ethtool.FlowRule('tcp4', dst_ip='10.0.0.0/8',
+                                             dst_port=11211, action=3,
+                                             vlan_tci=1), rule)
+        insert, delete = ethtool.diff_flow_rules([same], [same, same])
+        self.assertEqual((len(insert), delete), (1, []))
+        self.assertRaises(TypeError, ethtool.diff_flow_rules, [1], [])
+        self.assertRaises(IOError, ethtool.get_flow_rules, 'notadevice')
+        # Too long to be a device, rather than cut to one which may exist
+        self.assertRaises(IOError, ethtool.sync_flow_rules, 'lo' + 'x' * 14, [])
+
+    def test_tunables(self):
+        tunables = ethtool.get_tunables('lo')
+        self.assertTrue(set(tunables) <= set(['rx_copybreak', 'tx_copybreak',
+                                              'pfc_prevention_tout',
+                                              'tx_copybreak_buf_size']))
+        ethtool.set_tunables('lo', {})
+        self.assertRaises(ValueError, ethtool.set_tunables, 'lo', {'foo': 1})
+        self.assertRaises(ValueError, ethtool.set_tunables, 'lo',
+                          {'pfc_prevention_tout': 1 << 16})
+        # lo has no private flags, so setting none of them does nothing
+        self.assertEqual(ethtool.get_priv_flags('lo'), {})
+        ethtool.set_priv_flags('lo', {})
+        self.assertRaises(IOError, ethtool.get_priv_flags, 'notadevice')
+        self.assertRaises(IOError, ethtool.set_priv_flags, 'lo' + 'x' * 14, {})
+
+    def test_link_settings(self):
+        settings = ethtool.get_all_link_settings()
+        for devname, link in settings.items():
+            self.assertEqual(ethtool.get_link_settings(devname), link)
+            self.assertTrue(link['duplex'] in ('half', 'full', None))
+            self.assertTrue(set(link['advertising']) <= set(link['supported'])
+                            or not link['supported'])
+            self.assertRaises(ValueError, ethtool.set_link_settings, devname,
+                              advertising=['bogus'])
+        # Cached until a link event
+        self.assertEqual(ethtool.get_all_link_settings(), settings)
+        self.assertEqual(ethtool.get_all_link_settings(refresh=True), settings)
+        self.assertRaises(IOError, ethtool.get_link_settings, 'notadevice')
+        self.assertRaises(IOError, ethtool.set_link_settings, 'lo' + 'x' * 14,
+                          autoneg=True)
+
+    def test_pause_eee(self):
+        for devname in ethtool.get_devices():
+            result = ethtool.parallel_query([devname], ['pauseparam', 'eee'])
+            for field, get in (('pauseparam', ethtool.get_pauseparam),
+                               ('eee', ethtool.get_eee)):
+                try:
+                    value = get(devname)
+                except IOError as e:
+                    self.assertEqual(result[devname][field].errno, e.errno)
+                    continue
+                self.assertEqual(sorted(result[devname][field]), sorted(value))
+        self.assertRaises(IOError, ethtool.get_pauseparam, 'notadevice')
+        self.assertRaises(IOError, ethtool.get_pause_stats, 'notadevice')
+
+    def test_hwtstamp(self):
+        for devname in ethtool.get_devices():
+            try:
+                info = ethtool.get_ts_info(devname)
+            except IOError:
+                continue
+            self.assertIsInstance(info['so_timestamping'], list)
+            if info['phc_index'] is None:
+                self.assertIsNone(info['ptp_clock'])
+            else:
+                self.assertEqual(info['ptp_clock'],
+                                 '/dev/ptp%d' % info['phc_index'])
+        self.assertRaises(ValueError, ethtool.set_hwtstamp, 'lo',
+                          {'tx_type': 'sideways', 'rx_filter': 'none'})
+        self.assertRaises(IOError, ethtool.get_ts_info, 'notadevice')
+        self.assertRaises(IOError, ethtool.get_hwtstamp, 'notadevice')
+
     def test_etherinfo_objects(self):
         devnames = ethtool.get_devices()
         eis = ethtool.get_interfaces_info(devnames)